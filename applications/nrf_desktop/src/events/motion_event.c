@@ -25,13 +25,34 @@ static void profile_motion_event(struct log_event_buf *buf,
 	profiler_log_encode_u32(buf, event->dy);
 }
 
+static bool merge_motion_event(struct event_header *queued,
+			       const struct event_header *eh)
+{
+	struct motion_event *queued_event = cast_motion_event(queued);
+	const struct motion_event *event = cast_motion_event(eh);
+
+	s32_t dx = queued_event->dx + event->dx;
+	s32_t dy = queued_event->dy + event->dy;
+
+	if ((dx < INT16_MIN) || (dx > INT16_MAX) ||
+	    (dy < INT16_MIN) || (dy > INT16_MAX)) {
+		return false;
+	}
+
+	queued_event->dx = dx;
+	queued_event->dy = dy;
+
+	return true;
+}
+
 
 EVENT_INFO_DEFINE(motion_event,
 		  ENCODE(PROFILER_ARG_S32, PROFILER_ARG_S32),
 		  ENCODE("dx", "dy"),
 		  profile_motion_event);
 
-EVENT_TYPE_DEFINE(motion_event,
-		  IS_ENABLED(CONFIG_DESKTOP_INIT_LOG_MOTION_EVENT),
-		  log_motion_event,
-		  &motion_event_info);
+EVENT_TYPE_DEFINE_EXT(motion_event,
+		      IS_ENABLED(CONFIG_DESKTOP_INIT_LOG_MOTION_EVENT),
+		      log_motion_event,
+		      &motion_event_info,
+		      EVENT_ATTR_MERGE(merge_motion_event));
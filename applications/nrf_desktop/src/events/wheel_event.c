@@ -16,7 +16,25 @@ static int log_wheel_event(const struct event_header *eh, char *buf,
 	return snprintf(buf, buf_len, "wheel=%d", event->wheel);
 }
 
-EVENT_TYPE_DEFINE(wheel_event,
-		  IS_ENABLED(CONFIG_DESKTOP_INIT_LOG_WHEEL_EVENT),
-		  log_wheel_event,
-		  NULL);
+static bool merge_wheel_event(struct event_header *queued,
+			      const struct event_header *eh)
+{
+	struct wheel_event *queued_event = cast_wheel_event(queued);
+	const struct wheel_event *event = cast_wheel_event(eh);
+
+	s32_t wheel = queued_event->wheel + event->wheel;
+
+	if ((wheel < INT16_MIN) || (wheel > INT16_MAX)) {
+		return false;
+	}
+
+	queued_event->wheel = wheel;
+
+	return true;
+}
+
+EVENT_TYPE_DEFINE_EXT(wheel_event,
+		      IS_ENABLED(CONFIG_DESKTOP_INIT_LOG_WHEEL_EVENT),
+		      log_wheel_event,
+		      NULL,
+		      EVENT_ATTR_MERGE(merge_wheel_event));
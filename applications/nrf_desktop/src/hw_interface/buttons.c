@@ -5,6 +5,7 @@
  */
 
 #include <zephyr/types.h>
+#include <stdlib.h>
 
 #include <kernel.h>
 #include <soc.h>
@@ -28,6 +29,9 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_BUTTONS_LOG_LEVEL);
 
 #define SCAN_INTERVAL CONFIG_DESKTOP_BUTTONS_SCAN_INTERVAL
 
+#define THREAD_STACK_SIZE	CONFIG_DESKTOP_BUTTONS_SCAN_THREAD_STACK_SIZE
+#define THREAD_PRIORITY		CONFIG_DESKTOP_BUTTONS_SCAN_THREAD_PRIORITY
+
 /* For directly connected GPIO, scan rows once. */
 #define COLUMNS MAX(ARRAY_SIZE(col), 1)
 
@@ -43,11 +47,110 @@ static struct gpio_callback gpio_cb[ARRAY_SIZE(port_map)];
 static struct k_delayed_work matrix_scan;
 static struct k_delayed_work button_pressed;
 static enum state state;
+static u32_t scan_deadline;
+static u32_t prev_scan_time;
+
+#ifdef CONFIG_DESKTOP_BUTTONS_SCAN_THREAD
+static K_THREAD_STACK_DEFINE(thread_stack, THREAD_STACK_SIZE);
+static struct k_work_q scan_work_q;
+static K_MUTEX_DEFINE(state_mutex);
+#endif /* CONFIG_DESKTOP_BUTTONS_SCAN_THREAD */
+
+struct scan_stats {
+	u32_t jitter_max;
+	u32_t latency_max;
+	u32_t latency_sum;
+	u32_t event_count;
+};
+
+static struct scan_stats scan_stats;
 
 
 static void scan_fn(struct k_work *work);
 
 
+static void state_lock(void)
+{
+#ifdef CONFIG_DESKTOP_BUTTONS_SCAN_THREAD
+	k_mutex_lock(&state_mutex, K_FOREVER);
+#endif /* CONFIG_DESKTOP_BUTTONS_SCAN_THREAD */
+}
+
+static void state_unlock(void)
+{
+#ifdef CONFIG_DESKTOP_BUTTONS_SCAN_THREAD
+	k_mutex_unlock(&state_mutex);
+#endif /* CONFIG_DESKTOP_BUTTONS_SCAN_THREAD */
+}
+
+static void work_submit(struct k_delayed_work *work, s32_t delay)
+{
+#ifdef CONFIG_DESKTOP_BUTTONS_SCAN_THREAD
+	k_delayed_work_submit_to_queue(&scan_work_q, work, delay);
+#else
+	k_delayed_work_submit(work, delay);
+#endif /* CONFIG_DESKTOP_BUTTONS_SCAN_THREAD */
+}
+
+static void scan_schedule(s32_t delay)
+{
+	scan_deadline = k_cycle_get_32() + k_ms_to_cyc_floor32(delay);
+	work_submit(&matrix_scan, delay);
+}
+
+static void scan_schedule_next(void)
+{
+	/* Scans are done at fixed cadence. The interval is counted from the
+	 * time the previous scan was planned, not from its end.
+	 */
+	scan_deadline += k_ms_to_cyc_floor32(SCAN_INTERVAL);
+
+	s32_t left = scan_deadline - k_cycle_get_32();
+
+	if (left < 0) {
+		/* Scan is late, restart the cadence. */
+		scan_schedule(0);
+	} else {
+		work_submit(&matrix_scan, k_cyc_to_ms_floor32(left));
+	}
+}
+
+static void scan_stats_jitter_update(u32_t scan_time)
+{
+	s32_t jitter = scan_time - scan_deadline;
+	u32_t jitter_us = k_cyc_to_us_floor32(abs(jitter));
+
+	scan_stats.jitter_max = MAX(scan_stats.jitter_max, jitter_us);
+}
+
+static void scan_stats_latency_update(void)
+{
+	/* A change is reported when the new key state is sampled twice.
+	 * Latency is counted from the previous scan, so it misses the delay
+	 * before the first scan and the scans an event was held back for by
+	 * the event limit.
+	 */
+	u32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() -
+					       prev_scan_time);
+
+	scan_stats.latency_max = MAX(scan_stats.latency_max, latency_us);
+	scan_stats.latency_sum += latency_us;
+	scan_stats.event_count++;
+}
+
+static void scan_stats_print(void)
+{
+	if (scan_stats.event_count > 0) {
+		LOG_INF("Scan jitter max:%" PRIu32 "us, event latency avg:%"
+			PRIu32 "us max:%" PRIu32 "us", scan_stats.jitter_max,
+			scan_stats.latency_sum / scan_stats.event_count,
+			scan_stats.latency_max);
+	}
+
+	memset(&scan_stats, 0, sizeof(scan_stats));
+}
+
+
 static int set_cols(u32_t mask)
 {
 	for (size_t i = 0; i < ARRAY_SIZE(col); i++) {
@@ -127,10 +230,14 @@ static int callback_ctrl(bool enable)
 	 * Since we defer the handling code to work we can however assume
 	 * cancel executed after callbacks maintenance will keep things safe.
 	 *
-	 * Note that this code MUST be executed from a system workqueue context.
+	 * Note that this code MUST be executed from a system workqueue context
+	 * or, if the dedicated scanning thread is used, with the state lock
+	 * taken.
 	 *
-	 * We are also safe to access state without a lock as long as it is
-	 * done only from system workqueue context.
+	 * Without the dedicated scanning thread, the work items and the event
+	 * handler all run in the system workqueue context and the state lock
+	 * does nothing. With the thread, the state is accessed by both
+	 * workqueues and must be accessed only with the lock taken.
 	 */
 
 	for (size_t i = 0; (i < ARRAY_SIZE(row)) && !err; i++) {
@@ -208,14 +315,47 @@ static void resume(void)
 	if (err) {
 		module_set_state(MODULE_STATE_ERROR);
 	} else {
+		scan_deadline = k_cycle_get_32();
 		scan_fn(NULL);
 
 		module_set_state(MODULE_STATE_READY);
 	}
 }
 
+static void filter_ghosting(const u32_t *raw_state, u32_t *cur_state)
+{
+	u32_t other_cols = 0;
+
+	/* Rows used by the following columns. */
+	for (size_t i = COLUMNS; i > 0; i--) {
+		cur_state[i - 1] = other_cols;
+		other_cols |= raw_state[i - 1];
+	}
+
+	other_cols = 0;
+
+	for (size_t i = 0; i < COLUMNS; i++) {
+		u32_t blocking_mask = (other_cols | cur_state[i]) ^ raw_state[i];
+
+		other_cols |= raw_state[i];
+		cur_state[i] = raw_state[i];
+		if (!is_power_of_two(raw_state[i])) {
+			/* Power of two means only one bit is set */
+			cur_state[i] &= blocking_mask;
+		}
+	}
+}
+
 static void scan_fn(struct k_work *work)
 {
+	u32_t scan_time = k_cycle_get_32();
+
+	state_lock();
+
+	if (IS_ENABLED(CONFIG_DESKTOP_BUTTONS_SCAN_STATS)) {
+		scan_stats_jitter_update(scan_time);
+	}
+
 	/* Validate state */
 	__ASSERT_NO_MSG((state == STATE_SCANNING) ||
 			(state == STATE_SUSPENDING));
@@ -256,21 +396,8 @@ static void scan_fn(struct k_work *work)
 
 	/* Prevent ghosting */
 	u32_t cur_state[COLUMNS];
-	for (size_t i = 0; i < COLUMNS; i++) {
-		u32_t blocking_mask = 0;
-		for (size_t j = 0; j < COLUMNS; j++) {
-			if (i == j) {
-				continue;
-			}
-			blocking_mask |= raw_state[j];
-		}
-		blocking_mask ^= raw_state[i];
-		cur_state[i] = raw_state[i];
-		if (!is_power_of_two(raw_state[i])) {
-			/* Power of two means only one bit is set */
-			cur_state[i] &= blocking_mask;
-		}
-	}
+
+	filter_ghosting(raw_state, cur_state);
 
 	/* Emit event for any key state change */
 	bool any_pressed = false;
@@ -291,6 +418,10 @@ static void scan_fn(struct k_work *work)
 				event->pressed = is_pressed;
 				EVENT_SUBMIT(event);
 
+				if (IS_ENABLED(CONFIG_DESKTOP_BUTTONS_SCAN_STATS)) {
+					scan_stats_latency_update();
+				}
+
 				evt_limit++;
 
 				WRITE_BIT(settled_state[i], j, is_pressed);
@@ -303,14 +434,20 @@ static void scan_fn(struct k_work *work)
 			      (cur_state[i] != 0);
 	}
 
+	prev_scan_time = scan_time;
+
 	if (any_pressed) {
 		/* Schedule next scan */
-		k_delayed_work_submit(&matrix_scan, SCAN_INTERVAL);
+		scan_schedule_next();
 	} else {
 		/* If no button is pressed module can switch to callbacks */
 
 		int err = 0;
 
+		if (IS_ENABLED(CONFIG_DESKTOP_BUTTONS_SCAN_STATS)) {
+			scan_stats_print();
+		}
+
 		/* Enable callbacks and switch state, then set pins */
 		switch (state) {
 		case STATE_SCANNING:
@@ -344,9 +481,12 @@ static void scan_fn(struct k_work *work)
 		}
 	}
 
+	state_unlock();
+
 	return;
 
 error:
+	state_unlock();
 	module_set_state(MODULE_STATE_ERROR);
 }
 
@@ -387,16 +527,28 @@ static void button_pressed_isr(struct device *gpio_dev,
 		LOG_ERR("Cannot disable callbacks");
 		module_set_state(MODULE_STATE_ERROR);
 	} else {
-		k_delayed_work_submit(&button_pressed, 0);
+		work_submit(&button_pressed, 0);
 	}
 }
 
 static void button_pressed_fn(struct k_work *work)
 {
+	state_lock();
+
+	if ((state == STATE_SCANNING) || (state == STATE_SUSPENDING)) {
+		/* Scanning was started by the resume while the work was
+		 * waiting for the lock.
+		 */
+		__ASSERT_NO_MSG(IS_ENABLED(CONFIG_DESKTOP_BUTTONS_SCAN_THREAD));
+		state_unlock();
+		return;
+	}
+
 	int err = callback_ctrl(false);
 
 	if (err) {
 		LOG_ERR("Cannot disable callbacks");
+		state_unlock();
 		module_set_state(MODULE_STATE_ERROR);
 		return;
 	}
@@ -409,8 +561,7 @@ static void button_pressed_fn(struct k_work *work)
 
 	case STATE_ACTIVE:
 		state = STATE_SCANNING;
-		k_delayed_work_submit(&matrix_scan,
-				      CONFIG_DESKTOP_BUTTONS_DEBOUNCE_INTERVAL);
+		scan_schedule(CONFIG_DESKTOP_BUTTONS_DEBOUNCE_INTERVAL);
 		break;
 
 	case STATE_SCANNING:
@@ -420,6 +571,8 @@ static void button_pressed_fn(struct k_work *work)
 		__ASSERT_NO_MSG(false);
 		break;
 	}
+
+	state_unlock();
 }
 
 static void init_fn(void)
@@ -490,6 +643,7 @@ static void init_fn(void)
 	/* Perform initial scan */
 	state = STATE_SCANNING;
 
+	scan_deadline = k_cycle_get_32();
 	scan_fn(NULL);
 
 	return;
@@ -512,6 +666,14 @@ static bool event_handler(const struct event_header *eh)
 			k_delayed_work_init(&matrix_scan, scan_fn);
 			k_delayed_work_init(&button_pressed, button_pressed_fn);
 
+#ifdef CONFIG_DESKTOP_BUTTONS_SCAN_THREAD
+			k_work_q_start(&scan_work_q, thread_stack,
+				       K_THREAD_STACK_SIZEOF(thread_stack),
+				       THREAD_PRIORITY);
+			k_thread_name_set(&scan_work_q.thread,
+					  MODULE_NAME "_thread");
+#endif /* CONFIG_DESKTOP_BUTTONS_SCAN_THREAD */
+
 			init_fn();
 
 			return false;
@@ -521,13 +683,17 @@ static bool event_handler(const struct event_header *eh)
 	}
 
 	if (is_wake_up_event(eh)) {
+		state_lock();
 		resume();
+		state_unlock();
 
 		return false;
 	}
 
 	if (is_power_down_event(eh)) {
+		state_lock();
 		int err = suspend();
+		state_unlock();
 
 		if (!err) {
 			module_set_state(MODULE_STATE_STANDBY);
@@ -6,6 +6,7 @@
 
 #include <stdlib.h>
 #include <bluetooth/bluetooth.h>
+#include <bluetooth/gatt_dm.h>
 #include <shell/shell.h>
 #include <settings/settings.h>
 
@@ -245,9 +246,15 @@ static int remove_peers(u8_t identity)
 	int err = bt_unpair(get_bt_stack_peer_id(identity), BT_ADDR_LE_ANY);
 	if (err) {
 		LOG_ERR("Failed to remove");
+		return err;
 	}
 
-	return err;
+	err = bt_gatt_dm_cache_clear(BT_ADDR_LE_ANY);
+	if (err) {
+		LOG_WRN("Cannot remove stored discoveries (err %d)", err);
+	}
+
+	return 0;
 }
 
 static void show_single_peer(const struct bt_bond_info *info, void *user_data)
@@ -653,6 +660,12 @@ static void storage_data_overwrite(void)
 		return;
 	}
 
+	err = bt_gatt_dm_cache_clear(NULL);
+
+	if (err) {
+		LOG_WRN("Cannot remove stored discoveries (err %d)", err);
+	}
+
 	/* Reset Bluetooth local identities. */
 	for (size_t i = 1; i < CONFIG_BT_ID_MAX; i++) {
 		err = bt_id_reset(i, NULL, NULL);
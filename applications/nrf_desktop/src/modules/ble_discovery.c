@@ -53,6 +53,12 @@ static void peer_unpair(void)
 		LOG_ERR("Error while unpairing peer (err:%d)", err);
 		module_set_state(MODULE_STATE_ERROR);
 	}
+
+	err = bt_gatt_dm_cache_clear(bt_conn_get_dst(discovering_peer_conn));
+	if (err) {
+		LOG_WRN("Cannot remove stored discovery (err:%d)", err);
+	}
+
 	bt_conn_unref(discovering_peer_conn);
 	discovering_peer_conn = NULL;
 	state = DISCOVERY_STATE_START;
@@ -87,7 +93,7 @@ static void hids_discovery_completed(struct bt_gatt_dm *dm, void *context)
 
 	/* Nothing was found. */
 	LOG_ERR("Unrecognized peer");
-	k_free(event);
+	event_manager_free(event);
 	int err = bt_gatt_dm_data_release(dm);
 
 	if (err) {
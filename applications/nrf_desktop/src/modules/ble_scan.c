@@ -68,6 +68,12 @@ static void verify_bond(const struct bt_bond_info *info, void *user_data)
 	if (err) {
 		LOG_ERR("Cannot unpair peer (err %d)", err);
 		module_set_state(MODULE_STATE_ERROR);
+		return;
+	}
+
+	err = bt_gatt_dm_cache_clear(&info->addr);
+	if (err) {
+		LOG_WRN("Cannot remove stored discovery (err %d)", err);
 	}
 }
 
@@ -5,7 +5,6 @@
  */
 
 #include <zephyr/types.h>
-#include <sys/slist.h>
 
 #include <bluetooth/services/hids_c.h>
 #include <bluetooth/conn.h>
@@ -36,19 +35,57 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_HID_FORWARD_LOG_LEVEL);
 #define FORWARD_TIMEOUT		K_SECONDS(5)
 #define FORWARD_WORK_DELAY	K_SECONDS(1)
 
-#define MAX_ENQUEUED_ITEMS	5
+#define REPORT_SLOT_DATA_SIZE	MAX(MAX(REPORT_SIZE_MOUSE,		\
+					REPORT_SIZE_KEYBOARD_KEYS),	\
+				    MAX(REPORT_SIZE_SYSTEM_CTRL,	\
+					REPORT_SIZE_CONSUMER_CTRL))
 
-struct enqueued_event_item {
-	sys_snode_t node;
-	struct hid_report_event *event;
+#define MOUSE_REPORT_XY_MASK	BIT_MASK(12)
+
+/* Peer PID, maximum and average latency. */
+#define LATENCY_ENTRY_SIZE	(3 * sizeof(u16_t))
+
+struct report_slot {
+	u32_t timestamp;
+	u8_t report_id;
+	u8_t size;
+	u8_t data[REPORT_SLOT_DATA_SIZE];
+};
+
+struct report_queue {
+	struct report_slot slot[CONFIG_DESKTOP_HID_FORWARD_QUEUE_SIZE];
+	u8_t head;
+	u8_t len;
+};
+
+struct latency_stats {
+	u64_t sum;
+	u32_t max;
+	u32_t count;
 };
 
 struct hids_subscriber {
 	struct bt_gatt_hids_c hidc;
+	struct report_queue queue;
+	struct latency_stats latency;
 	u16_t pid;
 	u32_t timestamp;
 };
 
+enum hid_forward_opt {
+	HID_FORWARD_OPT_DROPPED,
+	HID_FORWARD_OPT_MERGED,
+	HID_FORWARD_OPT_LATENCY,
+
+	HID_FORWARD_OPT_COUNT
+};
+
+static const char * const opt_descr[] = {
+	[HID_FORWARD_OPT_DROPPED] = "dropped",
+	[HID_FORWARD_OPT_MERGED] = "merged",
+	[HID_FORWARD_OPT_LATENCY] = "latency"
+};
+
 static struct k_delayed_work config_fwd_timeout;
 
 static struct hids_subscriber subscribers[CONFIG_BT_MAX_CONN];
@@ -58,8 +95,9 @@ static bool usb_busy;
 static bool forward_pending;
 static void *channel_id;
 
-static sys_slist_t enqueued_event_list;
-static size_t enqueued_event_count;
+static size_t next_subscriber;
+static u32_t reports_dropped;
+static u32_t reports_merged;
 
 static struct k_spinlock lock;
 
@@ -184,53 +222,172 @@ static void forward_config_timeout(struct k_work *work_desc)
 	}
 }
 
-static void enqueue_hid_event(struct hid_report_event *event)
+static struct report_slot *queue_slot(struct report_queue *queue,
+				      size_t pos)
 {
-	struct enqueued_event_item *item;
+	__ASSERT_NO_MSG(pos < queue->len);
 
-	if (enqueued_event_count < MAX_ENQUEUED_ITEMS) {
-		item = k_malloc(sizeof(*item));
-		enqueued_event_count++;
-	} else {
-		LOG_WRN("Enqueue dropped the oldest event");
-		item = CONTAINER_OF(sys_slist_get(&enqueued_event_list),
-				    __typeof__(*item),
-				    node);
-		k_free(item->event);
+	return &queue->slot[(queue->head + pos) % ARRAY_SIZE(queue->slot)];
+}
+
+static void queue_pop(struct report_queue *queue)
+{
+	__ASSERT_NO_MSG(queue->len > 0);
+
+	queue->head = (queue->head + 1) % ARRAY_SIZE(queue->slot);
+	queue->len--;
+}
+
+static s16_t mouse_x_get(const u8_t *data)
+{
+	u16_t x = data[2] | ((data[3] & 0x0f) << 8);
+
+	/* Sign extend 12-bit value. */
+	return (x & BIT(11)) ? (s16_t)(x | ~MOUSE_REPORT_XY_MASK) : x;
+}
+
+static s16_t mouse_y_get(const u8_t *data)
+{
+	u16_t y = (data[3] >> 4) | (data[4] << 4);
+
+	return (y & BIT(11)) ? (s16_t)(y | ~MOUSE_REPORT_XY_MASK) : y;
+}
+
+static bool mouse_report_merge(u8_t *dst, const u8_t *src)
+{
+	BUILD_ASSERT_MSG(REPORT_SIZE_MOUSE == 5, "Invalid report size");
+
+	/* Button state changes must be reported separately. */
+	if (dst[0] != src[0]) {
+		return false;
 	}
 
-	if (!item) {
-		LOG_ERR("OOM error");
-		module_set_state(MODULE_STATE_ERROR);
-	} else {
-		item->event = event;
-		sys_slist_append(&enqueued_event_list, &item->node);
+	s16_t wheel = (s8_t)dst[1] + (s8_t)src[1];
+	s16_t dx = mouse_x_get(dst) + mouse_x_get(src);
+	s16_t dy = mouse_y_get(dst) + mouse_y_get(src);
+
+	if ((wheel < MOUSE_REPORT_WHEEL_MIN) ||
+	    (wheel > MOUSE_REPORT_WHEEL_MAX) ||
+	    (dx < MOUSE_REPORT_XY_MIN) || (dx > MOUSE_REPORT_XY_MAX) ||
+	    (dy < MOUSE_REPORT_XY_MIN) || (dy > MOUSE_REPORT_XY_MAX)) {
+		return false;
 	}
+
+	dst[1] = wheel;
+	dst[2] = dx & 0xff;
+	dst[3] = ((dy & 0x0f) << 4) | ((dx >> 8) & 0x0f);
+	dst[4] = (dy >> 4) & 0xff;
+
+	return true;
 }
 
-static void forward_hid_report(u8_t report_id, const u8_t *data, size_t size)
+static void latency_update(struct latency_stats *stats, u32_t timestamp)
 {
-	struct hid_report_event *event = new_hid_report_event(size + sizeof(report_id));
+	u32_t latency = k_cyc_to_us_floor32(k_cycle_get_32() - timestamp);
 
-	k_spinlock_key_t key = k_spin_lock(&lock);
+	stats->sum += latency;
+	stats->max = MAX(stats->max, latency);
+	stats->count++;
+}
 
-	if (!usb_ready) {
-		k_spin_unlock(&lock, key);
-		k_free(event);
+static void enqueue_hid_report(struct report_queue *queue, u8_t report_id,
+			       const u8_t *data, size_t size, u32_t timestamp)
+{
+	if (size > REPORT_SLOT_DATA_SIZE) {
+		LOG_WRN("Report %" PRIu8 " too big to enqueue", report_id);
+		reports_dropped++;
 		return;
 	}
 
+	if ((report_id == REPORT_ID_MOUSE) && (size == REPORT_SIZE_MOUSE) &&
+	    (queue->len > 0)) {
+		struct report_slot *last = queue_slot(queue, queue->len - 1);
+
+		if ((last->report_id == REPORT_ID_MOUSE) &&
+		    (last->size == REPORT_SIZE_MOUSE) &&
+		    mouse_report_merge(last->data, data)) {
+			reports_merged++;
+			return;
+		}
+	}
+
+	if (queue->len == ARRAY_SIZE(queue->slot)) {
+		LOG_WRN("Enqueue dropped the oldest report");
+		queue_pop(queue);
+		reports_dropped++;
+	}
+
+	queue->len++;
+
+	struct report_slot *slot = queue_slot(queue, queue->len - 1);
+
+	slot->timestamp = timestamp;
+	slot->report_id = report_id;
+	slot->size = size;
+	memcpy(slot->data, data, size);
+}
+
+static void submit_hid_report(u8_t report_id, const u8_t *data, size_t size)
+{
+	struct hid_report_event *event =
+		new_hid_report_event(size + sizeof(report_id));
+
 	event->subscriber = usb_id;
 
 	/* Forward report as is adding report id on the front. */
 	event->dyndata.data[0] = report_id;
 	memcpy(&event->dyndata.data[1], data, size);
 
+	EVENT_SUBMIT(event);
+}
+
+static bool submit_enqueued_report(void)
+{
+	/* Peripherals are served in round-robin manner, one report at a time,
+	 * so that a peripheral sending reports at a high rate cannot delay
+	 * reports of the other ones.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		size_t idx = (next_subscriber + i) % ARRAY_SIZE(subscribers);
+		struct hids_subscriber *subscriber = &subscribers[idx];
+		struct report_queue *queue = &subscriber->queue;
+
+		if (queue->len == 0) {
+			continue;
+		}
+
+		struct report_slot *slot = queue_slot(queue, 0);
+
+		submit_hid_report(slot->report_id, slot->data, slot->size);
+		latency_update(&subscriber->latency, slot->timestamp);
+		queue_pop(queue);
+
+		next_subscriber = (idx + 1) % ARRAY_SIZE(subscribers);
+
+		return true;
+	}
+
+	return false;
+}
+
+static void forward_hid_report(struct hids_subscriber *subscriber,
+			       u8_t report_id, const u8_t *data, size_t size)
+{
+	u32_t timestamp = k_cycle_get_32();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (!usb_ready) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
 	if (!usb_busy) {
-		EVENT_SUBMIT(event);
+		submit_hid_report(report_id, data, size);
+		latency_update(&subscriber->latency, timestamp);
 		usb_busy = true;
 	} else {
-		enqueue_hid_event(event);
+		enqueue_hid_report(&subscriber->queue, report_id, data, size,
+				   timestamp);
 	}
 
 	k_spin_unlock(&lock, key);
@@ -255,7 +412,10 @@ static u8_t hidc_read(struct bt_gatt_hids_c *hids_c,
 	__ASSERT_NO_MSG((report_id != REPORT_ID_RESERVED) &&
 			(report_id < REPORT_ID_COUNT));
 
-	forward_hid_report(report_id, data, size);
+	struct hids_subscriber *subscriber =
+		CONTAINER_OF(hids_c, struct hids_subscriber, hidc);
+
+	forward_hid_report(subscriber, report_id, data, size);
 
 	return BT_GATT_ITER_CONTINUE;
 }
@@ -305,7 +465,6 @@ static void init(void)
 	for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
 		bt_gatt_hids_c_init(&subscribers[i].hidc, &params);
 	}
-	sys_slist_init(&enqueued_event_list);
 
 	k_delayed_work_init(&config_fwd_timeout, forward_config_timeout);
 }
@@ -320,6 +479,12 @@ static int register_subscriber(struct bt_gatt_dm *dm, u16_t pid)
 	}
 	__ASSERT_NO_MSG(i < ARRAY_SIZE(subscribers));
 
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	memset(&subscribers[i].latency, 0, sizeof(subscribers[i].latency));
+
+	k_spin_unlock(&lock, key);
+
 	subscribers[i].pid = pid;
 	int err = bt_gatt_hids_c_handles_assign(dm, &subscribers[i].hidc);
 
@@ -573,6 +738,21 @@ static void disconnect_subscriber(struct hids_subscriber *subscriber)
 {
 	LOG_INF("HID device disconnected");
 
+	/* Reports still waiting for the USB are outdated. */
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	subscriber->queue.len = 0;
+
+	struct latency_stats latency = subscriber->latency;
+
+	k_spin_unlock(&lock, key);
+
+	if (latency.count > 0) {
+		LOG_INF("Peer %" PRIx16 " report latency avg:%" PRIu32
+			"us max:%" PRIu32 "us", subscriber->pid,
+			(u32_t)(latency.sum / latency.count), latency.max);
+	}
+
 	struct bt_gatt_hids_c_rep_info *rep = NULL;
 
 	while (NULL != (rep = bt_gatt_hids_c_rep_next(&subscriber->hidc, rep))) {
@@ -588,7 +768,8 @@ static void disconnect_subscriber(struct hids_subscriber *subscriber)
 
 			memset(empty_data, 0, sizeof(empty_data));
 
-			forward_hid_report(report_id, empty_data, size);
+			forward_hid_report(subscriber, report_id, empty_data,
+					   size);
 		}
 	}
 
@@ -606,23 +787,98 @@ static void clear_state(void)
 	usb_busy = false;
 
 	/* Clear all the reports. */
-	while (!sys_slist_is_empty(&enqueued_event_list)) {
-		struct enqueued_event_item *item;;
+	for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		subscribers[i].queue.len = 0;
+	}
 
-		item = CONTAINER_OF(sys_slist_get(&enqueued_event_list),
-				     __typeof__(*item),
-				    node);
-		enqueued_event_count--;
+	k_spin_unlock(&lock, key);
+}
 
-		k_spin_unlock(&lock, key);
+static void update_config(const u8_t opt_id, const u8_t *data,
+			  const size_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	/* Any write resets the counter. */
+	switch (opt_id) {
+	case HID_FORWARD_OPT_DROPPED:
+		reports_dropped = 0;
+		break;
+
+	case HID_FORWARD_OPT_MERGED:
+		reports_merged = 0;
+		break;
+
+	case HID_FORWARD_OPT_LATENCY:
+		for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			memset(&subscribers[i].latency, 0,
+			       sizeof(subscribers[i].latency));
+		}
+		break;
+
+	default:
+		LOG_WRN("Unknown opt: %" PRIu8, opt_id);
+		break;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+static void fill_latency(u8_t *data, size_t *size)
+{
+	size_t pos = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		const struct hids_subscriber *subscriber = &subscribers[i];
+		const struct latency_stats *stats = &subscriber->latency;
+
+		if ((subscriber->pid == 0) || (stats->count == 0)) {
+			continue;
+		}
 
-		k_free(item->event);
-		k_free(item);
+		if (pos + LATENCY_ENTRY_SIZE >
+		    CONFIG_CHANNEL_FETCHED_DATA_MAX_SIZE) {
+			LOG_WRN("No space for latency of all peers");
+			break;
+		}
 
-		key = k_spin_lock(&lock);
+		/* Values in microseconds, saturated to 16 bits. */
+		u32_t avg = stats->sum / stats->count;
+
+		sys_put_le16(subscriber->pid, &data[pos]);
+		pos += sizeof(u16_t);
+		sys_put_le16(MIN(stats->max, UINT16_MAX), &data[pos]);
+		pos += sizeof(u16_t);
+		sys_put_le16(MIN(avg, UINT16_MAX), &data[pos]);
+		pos += sizeof(u16_t);
 	}
 
-	__ASSERT_NO_MSG(enqueued_event_count == 0);
+	*size = pos;
+}
+
+static void fetch_config(const u8_t opt_id, u8_t *data, size_t *size)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	switch (opt_id) {
+	case HID_FORWARD_OPT_DROPPED:
+		sys_put_le32(reports_dropped, data);
+		*size = sizeof(reports_dropped);
+		break;
+
+	case HID_FORWARD_OPT_MERGED:
+		sys_put_le32(reports_merged, data);
+		*size = sizeof(reports_merged);
+		break;
+
+	case HID_FORWARD_OPT_LATENCY:
+		fill_latency(data, size);
+		break;
+
+	default:
+		LOG_WRN("Unknown opt: %" PRIu8, opt_id);
+		break;
+	}
 
 	k_spin_unlock(&lock, key);
 }
@@ -634,23 +890,12 @@ static bool event_handler(const struct event_header *eh)
 
 		__ASSERT_NO_MSG(usb_ready);
 
-		struct enqueued_event_item *item = NULL;
-
-		if (!sys_slist_is_empty(&enqueued_event_list)) {
-			item = CONTAINER_OF(sys_slist_get(&enqueued_event_list),
-					    __typeof__(*item),
-					    node);
-			enqueued_event_count--;
-
-			EVENT_SUBMIT(item->event);
-		} else {
+		if (!submit_enqueued_report()) {
 			usb_busy = false;
 		}
 
 		k_spin_unlock(&lock, key);
 
-		k_free(item);
-
 		return false;
 	}
 
@@ -728,6 +973,9 @@ static bool event_handler(const struct event_header *eh)
 		return false;
 	}
 
+	GEN_CONFIG_EVENT_HANDLERS(STRINGIFY(MODULE), opt_descr, update_config,
+				  fetch_config, false);
+
 	if (IS_ENABLED(CONFIG_DESKTOP_CONFIG_CHANNEL_ENABLE)) {
 		if (is_config_forward_event(eh)) {
 			handle_config_forward(cast_config_forward_event(eh));
@@ -758,4 +1006,6 @@ EVENT_SUBSCRIBE(MODULE, hid_report_sent_event);
 #if CONFIG_DESKTOP_CONFIG_CHANNEL_ENABLE
 EVENT_SUBSCRIBE(MODULE, config_forward_event);
 EVENT_SUBSCRIBE(MODULE, config_forward_get_event);
+EVENT_SUBSCRIBE(MODULE, config_event);
+EVENT_SUBSCRIBE(MODULE, config_fetch_request_event);
 #endif
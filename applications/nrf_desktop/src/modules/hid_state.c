@@ -14,7 +14,6 @@
 #include <sys/types.h>
 
 #include <zephyr/types.h>
-#include <sys/slist.h>
 #include <sys/util.h>
 #include <sys/byteorder.h>
 
@@ -65,6 +64,19 @@ enum state {
 
 #define AXIS_COUNT (IS_ENABLED(CONFIG_DESKTOP_HID_REPORT_MOUSE_SUPPORT) * MOUSE_REPORT_AXIS_COUNT)
 
+/* Items are kept in a hash table that is at most half full. */
+#define ITEM_SLOT_COUNT ((ITEM_COUNT <= 8) ? 16 :	\
+			 (ITEM_COUNT <= 16) ? 32 :	\
+			 (ITEM_COUNT <= 32) ? 64 : 128)
+
+/* Usage IDs of keyboard keys, modifiers and mouse buttons are also tracked
+ * in a bitmap, so that reports are encoded without browsing the items.
+ */
+#define USAGE_BM_SIZE 256
+#define USAGE_BM_WORDS (USAGE_BM_SIZE / 32)
+
+BUILD_ASSERT_MSG(ITEM_COUNT <= ITEM_SLOT_COUNT / 2, "Too many HID items");
+
 
 /**@brief HID state item. */
 struct item {
@@ -76,20 +88,25 @@ struct item {
 struct items {
 	u8_t item_count_max; /**< Maximal numer of items in this set. */
 	u8_t item_count; /**< Current number of items in this set. */
-	struct item item[ITEM_COUNT]; /**< Items set. Browse from the end. */
+	struct item item[ITEM_SLOT_COUNT]; /**< Items hash table, zero usage ID marks a free slot. */
+	u32_t usage_bm[USAGE_BM_WORDS]; /**< Bitmap of usage IDs below USAGE_BM_SIZE present in the set. */
 };
 
 /**@brief Enqueued HID state item. */
 struct item_event {
-	sys_snode_t node; /**< Event queue linked list node. */
 	struct item item; /**< HID state item which has been enqueued. */
 	u32_t timestamp; /**< HID event timestamp. */
 };
 
-/**@brief Event queue. */
+/**@brief Event queue.
+ *
+ * Ring buffer of events. Events are appended in order of their timestamps,
+ * so the oldest event is always at the head.
+ */
 struct eventq {
-	sys_slist_t root;
-	size_t len;
+	struct item_event buf[CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE];
+	u8_t head; /**< Index of the oldest event. */
+	u8_t len; /**< Number of events in the queue. */
 };
 
 /**@brief Axis data. */
@@ -198,27 +215,22 @@ static struct hid_keymap *hid_keymap_get(u16_t key_id)
 	return map;
 }
 
-/**@brief Compare two usage values. */
-static int usage_id_compare(const void *a, const void *b)
+static struct item_event *eventq_at(struct eventq *eventq, size_t pos)
 {
-	const struct item *p_a = a;
-	const struct item *p_b = b;
+	size_t idx = eventq->head + pos;
 
-	return (p_a->usage_id - p_b->usage_id);
+	__ASSERT_NO_MSG(pos < eventq->len);
+
+	if (idx >= ARRAY_SIZE(eventq->buf)) {
+		idx -= ARRAY_SIZE(eventq->buf);
+	}
+
+	return &eventq->buf[idx];
 }
 
 static void eventq_reset(struct eventq *eventq)
 {
-	struct item_event *event;
-	struct item_event *tmp;
-
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
-		sys_slist_remove(&eventq->root, NULL, &event->node);
-
-		k_free(event);
-	}
-
-	sys_slist_init(&eventq->root);
+	eventq->head = 0;
 	eventq->len = 0;
 }
 
@@ -228,65 +240,42 @@ static bool eventq_is_full(const struct eventq *eventq)
 }
 
 
-static bool eventq_is_empty(struct eventq *eventq)
+static bool eventq_is_empty(const struct eventq *eventq)
 {
-	bool empty = sys_slist_is_empty(&eventq->root);
-
-	__ASSERT_NO_MSG(!empty == (eventq->len != 0));
-
-	return empty;
+	return (eventq->len == 0);
 }
 
-static struct item_event *eventq_get(struct eventq *eventq)
+static struct item eventq_get(struct eventq *eventq)
 {
-	sys_snode_t *node = sys_slist_get(&eventq->root);
-
-	if (!node) {
-		return NULL;
-	}
+	struct item item = eventq_at(eventq, 0)->item;
 
+	eventq->head = (eventq->head + 1) % ARRAY_SIZE(eventq->buf);
 	eventq->len--;
 
-	return CONTAINER_OF(node, struct item_event, node);
+	return item;
 }
 
 static void eventq_append(struct eventq *eventq, u16_t usage_id, s16_t value)
 {
-	struct item_event *hid_event = k_malloc(sizeof(*hid_event));
-
-	if (!hid_event) {
-		LOG_WRN("Failed to allocate HID event");
+	if (eventq_is_full(eventq)) {
+		LOG_WRN("No place in the queue for HID event");
 		return;
 	}
 
+	eventq->len++;
+
+	struct item_event *hid_event = eventq_at(eventq, eventq->len - 1);
+
 	hid_event->item.usage_id = usage_id;
 	hid_event->item.value = value;
 	hid_event->timestamp = K_MSEC(k_uptime_get());
-
-	/* Add a new event to the queue. */
-	sys_slist_append(&eventq->root, &hid_event->node);
-
-	eventq->len++;
 }
 
-static void eventq_region_purge(struct eventq *eventq,
-				sys_snode_t *last_to_purge)
+static void eventq_region_purge(struct eventq *eventq, size_t cnt)
 {
-	sys_snode_t *tmp;
-	sys_snode_t *tmp_safe;
-	size_t cnt = 0;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
-		sys_slist_remove(&eventq->root, NULL, tmp);
-
-		k_free(CONTAINER_OF(tmp, struct item_event, node));
-		cnt++;
-
-		if (tmp == last_to_purge) {
-			break;
-		}
-	}
+	__ASSERT_NO_MSG(cnt <= eventq->len);
 
+	eventq->head = (eventq->head + cnt) % ARRAY_SIZE(eventq->buf);
 	eventq->len -= cnt;
 
 	LOG_WRN("%u stale events removed from the queue!", cnt);
@@ -295,34 +284,26 @@ static void eventq_region_purge(struct eventq *eventq,
 
 static void eventq_cleanup(struct eventq *eventq, u32_t timestamp)
 {
-	/* Find timed out events. */
-
-	sys_snode_t *first_valid;
-
-	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
-		u32_t diff = timestamp - CONTAINER_OF(
-			first_valid, struct item_event, node)->timestamp;
+	/* Find timed out events. They are all at the beginning of the queue.
+	 * There is nothing to do if the oldest event is still valid.
+	 */
+	size_t first_valid = 0;
 
-		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
-			break;
-		}
+	while ((first_valid < eventq->len) &&
+	       ((timestamp - eventq_at(eventq, first_valid)->timestamp) >=
+		CONFIG_DESKTOP_HID_REPORT_EXPIRATION)) {
+		first_valid++;
 	}
 
 	/* Remove events but only if key up was generated for each removed
 	 * key down.
 	 */
 
-	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
-	size_t maxfound_pos = 0;
-
-	sys_snode_t *cur;
-	size_t cur_pos = 0;
+	size_t maxfound = 0;
+	size_t purge_cnt = 0;
 
-	sys_snode_t *tmp_safe;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
-		const struct item cur_item =
-			CONTAINER_OF(cur, struct item_event, node)->item;
+	for (size_t cur = 0; cur < first_valid; cur++) {
+		const struct item cur_item = eventq_at(eventq, cur)->item;
 
 		if (cur_item.value > 0) {
 			/* Every key down must be paired with key up.
@@ -330,20 +311,12 @@ static void eventq_cleanup(struct eventq *eventq, u32_t timestamp)
 			 * first key down for this usage.
 			 */
 
-			unsigned int hit_count = cur_item.value;
-			sys_snode_t *j = cur;
-			size_t j_pos = cur_pos;
-
-			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
-				j_pos++;
-				if (j == first_valid) {
-					break;
-				}
+			int hit_count = cur_item.value;
+			size_t j;
 
+			for (j = cur + 1; j < first_valid; j++) {
 				const struct item item =
-					CONTAINER_OF(j,
-						     struct item_event,
-						     node)->item;
+					eventq_at(eventq, j)->item;
 
 				if (cur_item.usage_id == item.usage_id) {
 					hit_count += item.value;
@@ -362,50 +335,132 @@ static void eventq_cleanup(struct eventq *eventq, u32_t timestamp)
 				break;
 			}
 
-			if (j_pos > maxfound_pos) {
-				maxfound = j;
-				maxfound_pos = j_pos;
-			}
-		}
-
-
-		if (cur == first_valid) {
-			break;
+			maxfound = MAX(maxfound, j);
 		}
 
 		if (cur == maxfound) {
 			/* All events up to this point have pairs and can
 			 * be deleted.
 			 */
-			eventq_region_purge(eventq, maxfound);
+			purge_cnt = cur + 1;
 		}
+	}
 
-		cur_pos++;
+	if (purge_cnt > 0) {
+		eventq_region_purge(eventq, purge_cnt);
 	}
 }
 
-static void sort_by_usage_id(struct item items[], size_t array_size)
+static size_t item_slot(u16_t usage_id)
 {
-	for (size_t k = 0; k < array_size; k++) {
-		size_t id = k;
+	/* Usage IDs of pressed keys are usually close to each other. */
+	return usage_id & (ITEM_SLOT_COUNT - 1);
+}
 
-		for (size_t l = k + 1; l < array_size; l++) {
-			if (items[l].usage_id < items[id].usage_id) {
-				id = l;
-			}
+/**@brief Find the slot of an item.
+ *
+ * @return Slot holding the usage ID or free slot where it can be stored.
+ */
+static struct item *item_find(struct items *items, u16_t usage_id)
+{
+	size_t idx = item_slot(usage_id);
+
+	/* The table always has free slots, so the loop ends. */
+	while ((items->item[idx].usage_id != 0) &&
+	       (items->item[idx].usage_id != usage_id)) {
+		idx = (idx + 1) & (ITEM_SLOT_COUNT - 1);
+	}
+
+	return &items->item[idx];
+}
+
+static void item_remove(struct items *items, struct item *p_item)
+{
+	size_t free_idx = p_item - items->item;
+	size_t idx = free_idx;
+
+	/* Move back the items that would not be found past the freed slot. */
+	while (true) {
+		idx = (idx + 1) & (ITEM_SLOT_COUNT - 1);
+
+		u16_t usage_id = items->item[idx].usage_id;
+
+		if (usage_id == 0) {
+			break;
 		}
-		if (id != k) {
-			struct item tmp = items[k];
 
-			items[k] = items[id];
-			items[id] = tmp;
+		size_t slot = item_slot(usage_id);
+		bool in_place = (free_idx < idx) ?
+				((free_idx < slot) && (slot <= idx)) :
+				((free_idx < slot) || (slot <= idx));
+
+		if (!in_place) {
+			items->item[free_idx] = items->item[idx];
+			free_idx = idx;
 		}
 	}
+
+	items->item[free_idx].usage_id = 0;
+	items->item[free_idx].value = 0;
+}
+
+static void usage_bm_update(struct items *items, u16_t usage_id, bool set)
+{
+	if (usage_id >= USAGE_BM_SIZE) {
+		return;
+	}
+
+	if (set) {
+		items->usage_bm[usage_id / 32] |= BIT(usage_id % 32);
+	} else {
+		items->usage_bm[usage_id / 32] &= ~BIT(usage_id % 32);
+	}
+}
+
+/**@brief Get the highest usage ID below USAGE_BM_SIZE present in the set.
+ *
+ * @param[in] items	Set of items.
+ * @param[in] below	Only usage IDs lower than this value are considered.
+ *
+ * @return Usage ID or zero if no usage ID was found.
+ */
+static u16_t usage_bm_prev(const struct items *items, u16_t below)
+{
+	u16_t usage_id = MIN(below, USAGE_BM_SIZE);
+
+	while (usage_id > 0) {
+		usage_id--;
+
+		/* Bits of the word up to and including usage_id */
+		u32_t bits = items->usage_bm[usage_id / 32] &
+			     (UINT32_MAX >> (31 - (usage_id % 32)));
+
+		if (bits) {
+			return (usage_id & ~31) + 31 - __builtin_clz(bits);
+		}
+
+		usage_id &= ~31;
+	}
+
+	return 0;
+}
+
+/**@brief Get the highest usage ID present in the set, or zero if empty. */
+static u16_t usage_max_get(const struct items *items)
+{
+	u16_t usage_id = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(items->item); i++) {
+		usage_id = MAX(usage_id, items->item[i].usage_id);
+	}
+
+	return usage_id;
 }
 
 static void clear_items(struct items *items)
 {
 	memset(items->item, 0, sizeof(items->item));
+	memset(items->usage_bm, 0, sizeof(items->usage_bm));
 	items->item_count = 0;
 }
 
@@ -573,8 +628,6 @@ static void disconnect_subscriber(const void *subscriber_id)
 
 static bool key_value_set(struct items *items, u16_t usage_id, s16_t value)
 {
-	const u8_t prev_item_count = items->item_count;
-
 	bool update_needed = false;
 	struct item *p_item;
 
@@ -584,19 +637,16 @@ static bool key_value_set(struct items *items, u16_t usage_id, s16_t value)
 	/* Report equal to zero brings no change. This should never happen. */
 	__ASSERT_NO_MSG(value != 0);
 
-	p_item = bsearch(&usage_id,
-			 (u8_t *)items->item,
-			 ARRAY_SIZE(items->item),
-			 sizeof(items->item[0]),
-			 usage_id_compare);
+	p_item = item_find(items, usage_id);
 
-	if (p_item) {
-		/* Item is present in the array - update its value. */
+	if (p_item->usage_id) {
+		/* Item is present in the table - update its value. */
 		p_item->value += value;
 		if (p_item->value == 0) {
 			__ASSERT_NO_MSG(items->item_count != 0);
 			items->item_count -= 1;
-			p_item->usage_id = 0;
+			item_remove(items, p_item);
+			usage_bm_update(items, usage_id, false);
 		}
 
 		update_needed = true;
@@ -606,35 +656,22 @@ static bool key_value_set(struct items *items, u16_t usage_id, s16_t value)
 		 * could happen if a key up event is lost and the state
 		 * receives an unpaired key down event.
 		 */
-	} else if (prev_item_count >= items->item_count_max) {
+	} else if (items->item_count >= items->item_count_max) {
 		/* Configuration should allow the HID module to hold data
 		 * about the maximum number of simultaneously pressed keys.
 		 * Generate a warning if an item cannot be recorded.
 		 */
 		LOG_WRN("No place on the list to store HID item!");
 	} else {
-		/* After sort operation, free slots (zeros) are stored
-		 * at the beginning of the array.
-		 */
-		size_t const idx = ARRAY_SIZE(items->item) - prev_item_count - 1;
-
-		__ASSERT_NO_MSG(items->item[idx].usage_id == 0);
-
-		/* Record this value change. */
-		items->item[idx].usage_id = usage_id;
-		items->item[idx].value = value;
+		/* Record this value change in the free slot. */
+		p_item->usage_id = usage_id;
+		p_item->value = value;
 		items->item_count += 1;
+		usage_bm_update(items, usage_id, true);
 
 		update_needed = true;
 	}
 
-	if (prev_item_count != items->item_count) {
-		/* Sort elements on the list. Use simple algorithm
-		 * with small footprint.
-		 */
-		sort_by_usage_id(items->item, ARRAY_SIZE(items->item));
-	}
-
 	return update_needed;
 }
 
@@ -670,27 +707,26 @@ static void send_report_keyboard(u8_t report_id, struct report_data *rd)
 	u8_t modifier_bm = 0;
 	u8_t *keys = &event->dyndata.data[3];
 
-	const size_t max = ARRAY_SIZE(rd->items.item);
+	/* All keyboard usages are tracked in the bitmap. */
+	BUILD_ASSERT(KEYBOARD_REPORT_LAST_MODIFIER < USAGE_BM_SIZE);
+
+	/* Browse pressed keys starting from the highest usage ID. */
 	size_t cnt = 0;
-	for (size_t i = 0; (i < max) && (cnt < KEYBOARD_REPORT_KEY_COUNT_MAX); i++) {
-		struct item item = rd->items.item[max - i - 1];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.value > 0);
-			if (item.usage_id <= KEYBOARD_REPORT_LAST_KEY) {
-				__ASSERT_NO_MSG(item.usage_id <= UINT8_MAX);
-				keys[cnt] = item.usage_id;
-				cnt++;
-			} else if ((item.usage_id >= KEYBOARD_REPORT_FIRST_MODIFIER) &&
-				   (item.usage_id <= KEYBOARD_REPORT_LAST_MODIFIER)) {
-				/* Make sure any key bitmask will fit into modifiers. */
-				BUILD_ASSERT(KEYBOARD_REPORT_LAST_MODIFIER - KEYBOARD_REPORT_FIRST_MODIFIER < 8);
-				modifier_bm |= BIT(item.usage_id - KEYBOARD_REPORT_FIRST_MODIFIER);
-			} else {
-				LOG_WRN("Undefined usage 0x%x", item.usage_id);
-			}
+	u16_t usage_id = usage_bm_prev(&rd->items, USAGE_BM_SIZE);
+
+	for (; (usage_id != 0) && (cnt < KEYBOARD_REPORT_KEY_COUNT_MAX);
+	     usage_id = usage_bm_prev(&rd->items, usage_id)) {
+		if (usage_id <= KEYBOARD_REPORT_LAST_KEY) {
+			__ASSERT_NO_MSG(usage_id <= UINT8_MAX);
+			keys[cnt] = usage_id;
+			cnt++;
+		} else if ((usage_id >= KEYBOARD_REPORT_FIRST_MODIFIER) &&
+			   (usage_id <= KEYBOARD_REPORT_LAST_MODIFIER)) {
+			/* Make sure any key bitmask will fit into modifiers. */
+			BUILD_ASSERT(KEYBOARD_REPORT_LAST_MODIFIER - KEYBOARD_REPORT_FIRST_MODIFIER < 8);
+			modifier_bm |= BIT(usage_id - KEYBOARD_REPORT_FIRST_MODIFIER);
 		} else {
-			break;
+			LOG_WRN("Undefined usage 0x%x", usage_id);
 		}
 	}
 
@@ -729,20 +765,10 @@ static void send_report_mouse(u8_t report_id, struct report_data *rd)
 			  MOUSE_REPORT_WHEEL_MIN);
 	rd->axes.axis[MOUSE_REPORT_AXIS_WHEEL] -= wheel * 2;
 
-	/* Traverse pressed keys and build mouse buttons bitmask */
-	u8_t button_bm = 0;
-	for (size_t i = 0; i < ARRAY_SIZE(rd->items.item); i++) {
-		struct item item = rd->items.item[i];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.usage_id <= 8);
-			__ASSERT_NO_MSG(item.value > 0);
-
-			u8_t mask = 1 << (item.usage_id - 1);
-
-			button_bm |= mask;
-		}
-	}
+	/* Mouse buttons bitmask, button usage IDs start from 1 */
+	BUILD_ASSERT(MOUSE_REPORT_BUTTON_COUNT_MAX <= 8);
+	__ASSERT_NO_MSG(usage_bm_prev(&rd->items, USAGE_BM_SIZE) <= 8);
+	u8_t button_bm = rd->items.usage_bm[0] >> 1;
 
 
 	/* Encode report. */
@@ -797,20 +823,10 @@ static void send_report_boot_mouse(u8_t report_id, struct report_data *rd)
 	rd->axes.axis[MOUSE_REPORT_AXIS_Y] += dy;
 	rd->axes.axis[MOUSE_REPORT_AXIS_WHEEL] = 0;
 
-	/* Traverse pressed keys and build mouse buttons bitmask */
-	u8_t button_bm = 0;
-	for (size_t i = 0; i < ARRAY_SIZE(rd->items.item); i++) {
-		struct item item = rd->items.item[i];
-
-		if (item.usage_id) {
-			__ASSERT_NO_MSG(item.usage_id <= 8);
-			__ASSERT_NO_MSG(item.value > 0);
-
-			u8_t mask = 1 << (item.usage_id - 1);
-
-			button_bm |= mask;
-		}
-	}
+	/* Mouse buttons bitmask, button usage IDs start from 1 */
+	BUILD_ASSERT(MOUSE_REPORT_BUTTON_COUNT_MAX <= 8);
+	__ASSERT_NO_MSG(usage_bm_prev(&rd->items, USAGE_BM_SIZE) <= 8);
+	u8_t button_bm = rd->items.usage_bm[0] >> 1;
 
 
 	size_t report_size = sizeof(report_id) + sizeof(dx) + sizeof(dy) +
@@ -860,9 +876,7 @@ static void send_report_ctrl(u8_t report_id, struct report_data *rd)
 				       sizeof(rd->items.item[0].usage_id));
 	event->dyndata.data[0] = report_id;
 
-	const size_t idx = ARRAY_SIZE(rd->items.item) - 1;
-
-	sys_put_le16(rd->items.item[idx].usage_id,
+	sys_put_le16(usage_max_get(&rd->items),
 		     &event->dyndata.data[sizeof(report_id)]);
 
 	EVENT_SUBMIT(event);
@@ -876,19 +890,14 @@ static bool update_report(struct report_data *rd)
 
 	while (!update_needed && !eventq_is_empty(&rd->eventq)) {
 		/* There are enqueued events to handle. */
-		struct item_event *event = eventq_get(&rd->eventq);
-
-		__ASSERT_NO_MSG(event);
+		struct item item = eventq_get(&rd->eventq);
 
 		update_needed = key_value_set(&rd->items,
-					      event->item.usage_id,
-					      event->item.value);
+					      item.usage_id,
+					      item.value);
 
 		rd->update_needed = rd->update_needed || update_needed;
 
-
-		k_free(event);
-
 		/* If no item was changed, try next event. */
 	}
 
@@ -1108,16 +1117,12 @@ static void enqueue(struct report_data *rd, u16_t usage_id, s16_t value,
 			 * Try to remove queued items starting from the
 			 * oldest one.
 			 */
-			sys_snode_t *i;
-
-			SYS_SLIST_FOR_EACH_NODE(&rd->eventq.root, i) {
+			for (size_t i = 0; i < rd->eventq.len; i++) {
 				/* Initial cleanup was done above. Queue will
 				 * not contain events with expired timestamp.
 				 */
 				u32_t timestamp =
-					CONTAINER_OF(i,
-						     struct item_event,
-						     node)->timestamp +
+					eventq_at(&rd->eventq, i)->timestamp +
 					CONFIG_DESKTOP_HID_REPORT_EXPIRATION;
 
 				eventq_cleanup(&rd->eventq, timestamp);
@@ -43,6 +43,19 @@ struct bt_gatt_dm_attr {
 	u8_t		perm;
 };
 
+/** @brief Handle lookup request for @ref bt_gatt_dm_handles_assign.
+ */
+struct bt_gatt_dm_handle_req {
+	/** UUID of the characteristic */
+	const struct bt_uuid *uuid;
+	/** UUID of the descriptor inside the characteristic,
+	 *  or NULL to get the characteristic value handle
+	 */
+	const struct bt_uuid *desc_uuid;
+	/** Where the handle is stored, 0 if it cannot be found */
+	u16_t *handle;
+};
+
 /** @brief Discovery callback structure.
  *
  *  This structure is used for tracking the result of a discovery.
@@ -192,6 +205,24 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_char_by_uuid(
 	const struct bt_gatt_dm *dm,
 	const struct bt_uuid *uuid);
 
+/** @brief Get the next characteristic with the given UUID
+ *
+ * Function finds the next characteristic attribute with the UUID stored in
+ * its characteristic value. Use it to iterate over the characteristics that
+ * share a UUID, in the order of their handles.
+ *
+ * @param[in] dm Discovery instance
+ * @param[in] prev Previous characteristic, or NULL to get the first one.
+ * @param[in] uuid The UUID of the characteristic
+ *
+ * @return The characteristic attribute after @p prev with the selected UUID
+ *         inside the characteristic value, or NULL if there are no more.
+ */
+const struct bt_gatt_dm_attr *bt_gatt_dm_char_next_by_uuid(
+	const struct bt_gatt_dm *dm,
+	const struct bt_gatt_dm_attr *prev,
+	const struct bt_uuid *uuid);
+
 /** @brief Get attribute by handle
  *
  * Function returns any type of the attribute using its handle.
@@ -259,6 +290,24 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_desc_next(
 	const struct bt_gatt_dm *dm,
 	const struct bt_gatt_dm_attr *prev);
 
+/** @brief Assign the handles of several attributes.
+ *
+ * For each request, the first characteristic with the given UUID is
+ * searched, and then the given descriptor or the characteristic value inside
+ * it. The handle of the found attribute is stored in the request.
+ *
+ * @param[in] dm Discovery Manager instance.
+ * @param[in] reqs Array of requests.
+ * @param[in] cnt Number of requests.
+ *
+ * @retval 0 If all the attributes were found.
+ * @retval -ENOENT If any attribute cannot be found. Its handle is set to 0,
+ *                 the other handles are assigned.
+ */
+int bt_gatt_dm_handles_assign(const struct bt_gatt_dm *dm,
+			      const struct bt_gatt_dm_handle_req *reqs,
+			      size_t cnt);
+
 /** @brief Start service discovery.
  *
  * This function is asynchronous. Discovery results are passed through
@@ -313,6 +362,26 @@ int bt_gatt_dm_continue(struct bt_gatt_dm *dm, void *context);
  */
 int bt_gatt_dm_data_release(struct bt_gatt_dm *dm);
 
+/** @brief Remove the stored discovery data of a peer.
+ *
+ * Call this function when the bond with the peer is removed, so that its
+ * discovery data does not remain in the settings storage.
+ *
+ * @param[in] addr Address of the peer. Use NULL or BT_ADDR_LE_ANY to remove
+ *                 the data of all peers, as with bt_unpair().
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+#ifdef CONFIG_BT_GATT_DM_CACHE
+int bt_gatt_dm_cache_clear(const bt_addr_le_t *addr);
+#else
+static inline int bt_gatt_dm_cache_clear(const bt_addr_le_t *addr)
+{
+	return 0;
+}
+#endif
+
 /** @brief Print service discovery data.
  *
  * This function prints GATT attributes that belong to the discovered service.
@@ -141,8 +141,17 @@ struct bt_scan_adv_info {
 	 */
 	u8_t adv_type;
 
-	/** Received Signal Strength Indication in dBm. */
+	/** Received Signal Strength Indication in dBm. If reports were
+	 *  suppressed by the duplicate filter, this is the average over the
+	 *  suppressed reports and this one.
+	 */
 	s8_t rssi;
+
+	/** Number of reports with the same data that were suppressed by the
+	 *  duplicate filter since the previous report from the device.
+	 *  Always 0 if @option{CONFIG_BT_SCAN_DUPLICATE_FILTER} is disabled.
+	 */
+	u16_t duplicate_cnt;
 };
 
 /**@brief A helper structure to set filters for the name.
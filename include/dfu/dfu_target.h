@@ -22,6 +22,10 @@ extern "C" {
 
 #define DFU_TARGET_IMAGE_TYPE_MCUBOOT 1
 #define DFU_TARGET_IMAGE_TYPE_MODEM_DELTA 2
+#define DFU_TARGET_IMAGE_TYPE_MCUBOOT_DELTA 3
+
+/** Size of the image hash given by @ref dfu_target_hash_get. */
+#define DFU_TARGET_HASH_SIZE 32
 
 enum dfu_target_evt_id {
 	DFU_TARGET_EVT_TIMEOUT,
@@ -107,6 +111,27 @@ int dfu_target_write(const void *const buf, size_t len);
  **/
 int dfu_target_done(bool successful);
 
+/**
+ * @brief Get the SHA-256 hash of the data written to the DFU target.
+ *
+ * The hash is calculated while the data is passed to @ref dfu_target_write,
+ * so it is available without reading the image back. It is available
+ * until the next call to @ref dfu_target_init, also after a successful
+ * @ref dfu_target_done.
+ *
+ * The hash is kept in RAM only. It is not available for an image that was
+ * resumed from a non-zero offset after a reset.
+ *
+ * Requires CONFIG_DFU_TARGET_STREAM_HASH.
+ *
+ * @param[out] hash Buffer of DFU_TARGET_HASH_SIZE bytes for the hash.
+ *
+ * @retval 0 If the hash was calculated.
+ * @retval -ENODATA If the hash does not cover the whole image.
+ * @return Otherwise, a negative error code.
+ */
+int dfu_target_hash_get(u8_t *hash);
+
 #ifdef __cplusplus
 }
 #endif
@@ -54,6 +54,28 @@ extern "C" {
 #define SUBS_PRIO_COUNT (SUBS_PRIO_MAX - SUBS_PRIO_MIN + 1)
 
 
+/** @brief Event dispatch class.
+ *
+ * The Event Manager keeps a separate queue for every dispatch class.
+ * Queued events of a higher class are processed before queued events
+ * of a lower class. Events within one class are processed in the order
+ * of submission, events of different classes are not.
+ */
+enum event_dispatch_class {
+	/** Default class of an event type. */
+	EVENT_DISPATCH_CLASS_NORMAL,
+
+	/** Class of latency-critical events. */
+	EVENT_DISPATCH_CLASS_HIGH,
+
+	/** Class of events processed when no other events are queued. */
+	EVENT_DISPATCH_CLASS_LOW,
+
+	/** Number of dispatch classes. */
+	EVENT_DISPATCH_CLASS_COUNT
+};
+
+
 /** @brief Event header.
  *
  * When defining an event structure, the event header
@@ -65,6 +87,11 @@ struct event_header {
 
 	/** Pointer to the event type object. */
 	const struct event_type *type_id;
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_EVENT_TIMESTAMP
+	/** Event submission time in cycles. */
+	u32_t timestamp;
+#endif
 };
 
 
@@ -122,18 +149,30 @@ struct event_info {
 };
 
 
+/** @brief Runtime state of an event type that supports merging.
+ */
+struct event_merge_state {
+	/** Most recently submitted event of this type that is still
+	 *  queued. */
+	struct event_header *pending;
+
+	/** Number of events merged into queued events. */
+	size_t merged_cnt;
+};
+
+
 /** @brief Event type.
  */
 struct event_type {
 	/** Event name. */
 	const char			*name;
 
-	/** Array of pointers to the array of subscribers. */
-	const struct event_subscriber	*subs_start[SUBS_PRIO_COUNT];
+	/** Pointer to the array of subscribers sorted by priority. */
+	const struct event_subscriber	*subs_start;
 
-	/** Array of pointers to the element directly after the array of
+	/** Pointer to the element directly after the array of
 	 * subscribers. */
-	const struct event_subscriber	*subs_stop[SUBS_PRIO_COUNT];
+	const struct event_subscriber	*subs_stop;
 
 	/** Bool indicating if the event is logged by default. */
 	bool init_log_enable;
@@ -144,6 +183,17 @@ struct event_type {
 
 	/** Logging and formatting information. */
 	const struct event_info *ev_info;
+
+	/** Dispatch class (see @ref event_dispatch_class). */
+	u8_t dispatch_class;
+
+	/** Function merging a newly submitted event into a queued event
+	 *  of the same type. Returns true if the event was merged. */
+	bool (*merge)(struct event_header *queued,
+		      const struct event_header *eh);
+
+	/** Merge state. Set only if the merge function is provided. */
+	struct event_merge_state *merge_state;
 };
 
 
@@ -258,7 +308,60 @@ extern const struct event_type __stop_event_types[];
  * @param ev_info_struct   Data structure describing the event type.
  */
 #define EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct) \
-	_EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct)
+	_EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct, )
+
+
+/** Define an event type with additional attributes.
+ *
+ * This macro works like @ref EVENT_TYPE_DEFINE, but it also allows to
+ * change attributes of the event type. Attributes not listed keep their
+ * default values.
+ *
+ * Example:
+ * @code
+ * EVENT_TYPE_DEFINE_EXT(hid_report_event, false, log_event, NULL,
+ *                       EVENT_ATTR_DISPATCH_CLASS(EVENT_DISPATCH_CLASS_HIGH));
+ * @endcode
+ *
+ * @param ename     	   Name of the event.
+ * @param init_log_en	   Bool indicating if the event is logged
+ *                         by default.
+ * @param log_fn  	   Function to stringify an event of this type.
+ * @param ev_info_struct   Data structure describing the event type.
+ * @param ...		   Comma separated list of event type attributes.
+ */
+#define EVENT_TYPE_DEFINE_EXT(ename, init_log_en, log_fn, ev_info_struct, ...) \
+	_EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct, __VA_ARGS__)
+
+
+/** Set dispatch class of an event type.
+ *
+ * Attribute used with @ref EVENT_TYPE_DEFINE_EXT.
+ *
+ * @param dclass  Dispatch class (see @ref event_dispatch_class).
+ */
+#define EVENT_ATTR_DISPATCH_CLASS(dclass) _EVENT_ATTR_DISPATCH_CLASS(dclass)
+
+
+/** Allow merging events of an event type.
+ *
+ * Attribute used with @ref EVENT_TYPE_DEFINE_EXT.
+ *
+ * When an event of this type is submitted while another event of the same
+ * type is the last event waiting in the queue, the Event Manager calls
+ * @p merge_fn to merge the new event into the queued one. If the function
+ * returns true, the new event is freed and never delivered to the
+ * listeners. Otherwise, it is queued as usual. An event is never merged
+ * across other queued events, so the order of delivery is preserved.
+ *
+ * The merge function is called with interrupts locked. It must be short
+ * and it must not submit events.
+ *
+ * @param merge_fn  Function of type
+ *                  bool merge_fn(struct event_header *queued,
+ *                                const struct event_header *eh).
+ */
+#define EVENT_ATTR_MERGE(merge_fn) _EVENT_ATTR_MERGE(merge_fn)
 
 
 /** Verify if an event ID is valid.
@@ -289,6 +392,33 @@ void _event_submit(struct event_header *eh);
 #define EVENT_SUBMIT(event) _event_submit(&event->header)
 
 
+/** Allocate memory for an event.
+ *
+ * The memory is taken from the event pools if
+ * @option{CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL} is enabled or from
+ * the heap otherwise. On allocation failure the system is rebooted.
+ *
+ * @note This function is used by the event allocators (new_<i>%event_type</i>)
+ *       and there should be no need to call it directly.
+ *
+ * @param size  Size of the event in bytes.
+ *
+ * @return Pointer to the allocated memory or NULL on failure.
+ */
+void *event_manager_alloc(size_t size);
+
+
+/** Free memory of an event.
+ *
+ * @note The Event Manager frees every processed event. This function must
+ *       be used only to release events that were allocated and will not be
+ *       submitted.
+ *
+ * @param addr  Pointer to the event memory.
+ */
+void event_manager_free(void *addr);
+
+
 /** Initialize the Event Manager.
  *
  * @retval 0 If the operation was successful.
@@ -23,6 +23,7 @@ extern "C" {
 
 #include <zephyr/types.h>
 #include <stddef.h>
+#include <sys/slist.h>
 
 /**
  * @brief AT command return codes
@@ -51,17 +52,87 @@ enum at_cmd_state {
  */
 typedef void (*at_cmd_handler_t)(const char *response);
 
+struct at_cmd_async;
+
+/**
+ * @typedefs at_cmd_async_handler_t
+ *
+ * Handler called when an asynchronous AT command is completed.
+ *
+ * The handler is called from the AT command driver thread. It must not block
+ * and must not send AT commands with the synchronous functions. It can queue
+ * new commands with at_cmd_write_async().
+ *
+ * @param cmd      Completed command. The command can be reused or freed
+ *                 when the handler is called.
+ * @param response Null terminated string containing the modem response without
+ *                 the return code. The string points directly to the reception
+ *                 buffer of the driver and is valid only until the handler
+ *                 returns. NULL if no response was received, for example if
+ *                 a queued command could not be sent.
+ * @param len      Length of the response string.
+ * @param state    Return state of the command.
+ * @param code     Return code of the command, with the same meaning as the
+ *                 return value of @ref at_cmd_write.
+ */
+typedef void (*at_cmd_async_handler_t)(struct at_cmd_async *cmd,
+				       const char *response, size_t len,
+				       enum at_cmd_state state, int code);
+
+/**
+ * @brief Asynchronous AT command.
+ *
+ * The structure is provided by the caller of at_cmd_write_async() and must
+ * stay valid until the handler is called, or until at_cmd_write_async()
+ * returns an error. Embed it in a larger structure to
+ * pass a context to the handler.
+ */
+struct at_cmd_async {
+	/** Used internally by the driver. */
+	sys_snode_t node;
+	/** Null terminated AT command string. It must stay valid until
+	 *  the handler is called.
+	 */
+	const char *cmd;
+	/** Handler called when the command is completed. */
+	at_cmd_async_handler_t handler;
+};
+
 /**@brief Initialize AT command driver.
  *
  * @return Zero on success, non-zero otherwise.
  */
 int at_cmd_init(void);
 
+/**
+ * @brief Function to queue an AT command without waiting for the response.
+ *
+ * Commands are sent to the modem in the order in which they were queued,
+ * including the commands sent with the synchronous functions. A command is
+ * sent as soon as the response to the previous command is received, without
+ * waking up the thread that queued the command.
+ *
+ * If the command cannot be sent to the modem right away, the error is
+ * returned and the handler is not called.
+ *
+ * @param cmd Command to queue.
+ *
+ * @retval 0 If the command was queued.
+ * @retval -EINVAL If the command, the command string, or the handler is NULL.
+ * @retval -errno Negative errno if the command could not be sent.
+ */
+int at_cmd_write_async(struct at_cmd_async *cmd);
+
 /**
  * @brief Function to send an AT command to the modem, any data from the modem
  *        will trigger the callback defined by the handler parameter in the
  *        function prototype.
  *
+ * The handler is called in the context of the calling thread, before the
+ * function returns. The response stays in one of the reception buffers of
+ * the driver until the handler returns, but the reception of other responses
+ * and notifications continues while the handler runs.
+ *
  * @param cmd     Pointer to null terminated AT command string.
  * @param handler Pointer to handler that will process any returned data.
  *                NULL pointer is allowed, which means that any returned data
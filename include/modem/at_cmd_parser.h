@@ -107,6 +107,89 @@ int at_parser_max_params_from_str(const char *at_params_str,
 int at_parser_params_from_str(const char *at_params_str, char **next_param_str,
 			      struct at_param_list *const list);
 
+/**
+ * @brief Streaming parser state.
+ *
+ * The fields are used internally by the parser and should not be accessed
+ * directly, except for @p pos.
+ */
+struct at_parser {
+	/** List where parsed parameters are stored. */
+	struct at_param_list *list;
+	/** Maximum number of parameters to parse. */
+	size_t max_params;
+	/** Index of the next parameter. */
+	size_t index;
+	/** Offset of the next character to parse. When parsing is completed,
+	 *  it points to the terminating null character or to the beginning
+	 *  of the next notification.
+	 */
+	size_t pos;
+	/** Offset of the first character of the parameter being parsed. */
+	size_t token_start;
+	/** Value of the number being parsed. */
+	u32_t num;
+	/** Number of elements of the array being parsed. */
+	u8_t array_cnt;
+	/** Parser state. */
+	u8_t state;
+	/** Number being parsed is negative. */
+	bool num_negative;
+	/** Last parsed parameter was a number. */
+	bool last_num;
+};
+
+/**
+ * @brief Initialize the streaming parser.
+ *
+ * The parameter list is cleared.
+ *
+ * @param parser           Parser to initialize.
+ * @param list             Pointer to an initialized list where parameters
+ *                         are stored.
+ * @param max_params_count Maximum number of parameters to parse.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -EINVAL One or more of the supplied parameters are invalid.
+ */
+int at_parser_stream_init(struct at_parser *parser,
+			  struct at_param_list *const list,
+			  size_t max_params_count);
+
+/**
+ * @brief Parse AT command or response parameters from a partially received
+ *        string.
+ *
+ * The parser processes every character of the input only once and it does
+ * not allocate memory. String and array parameters are stored in the list
+ * as views into @p buf (see @ref at_params_string_view_put and
+ * @ref at_params_array_view_put), so the buffer must stay valid for as long
+ * as the parameters are used.
+ *
+ * The function can be called again when more data is appended to the same
+ * buffer. Parsing resumes where it stopped. The end of the response is marked
+ * with the null character, which must be included in @p len.
+ *
+ * If the buffer contains multiple notifications, parsing stops at the start
+ * of the second one, which can be parsed after initializing the parser again,
+ * starting from the @p pos offset of the parser.
+ *
+ * @param parser Initialized parser.
+ * @param buf    Buffer with the received data.
+ * @param len    Number of received characters in the buffer.
+ *
+ * @retval 0 If the response was completely parsed.
+ * @retval -EAGAIN More data is needed to complete parsing.
+ * @retval -E2BIG  The list cannot hold all the parameters. The list contains
+ *                 the maximum number of parameters possible. Also returned
+ *                 if a number does not fit in 32 bits.
+ * @retval -EBADMSG The string is not a valid AT command or response.
+ * @retval -EINVAL One or more of the supplied parameters are invalid, or
+ *                 a negative number is smaller than INT32_MIN.
+ */
+int at_parser_stream_feed(struct at_parser *parser, const char *buf,
+			  size_t len);
+
 enum at_cmd_type {
 	/** Unknown command, indicates that the actual command type could not
 	 *  be resolved.
@@ -27,6 +27,7 @@
 #define AT_PARAMS_H__
 
 #include <zephyr/types.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,6 +57,8 @@ union at_param_value {
 	char *str_val;
 	/** Array of u32_t */
 	u32_t *array_val;
+	/** String or array text in a buffer that is not owned by the list. */
+	const char *view_val;
 };
 
 /** @brief A parameter is defined with a type, length and value. */
@@ -63,6 +66,8 @@ struct at_param {
 	enum at_param_type type;
 	size_t size;
 	union at_param_value value;
+	/** Value is a view into a buffer that is not owned by the list. */
+	bool is_view;
 };
 
 /**
@@ -182,6 +187,47 @@ int at_params_string_put(const struct at_param_list *list, size_t index,
 int at_params_array_put(const struct at_param_list *list, size_t index,
 			const u32_t *array, size_t array_len);
 
+/**
+ * @brief Add a parameter in the list at the specified index and assign it a
+ * string value that refers to an external buffer.
+ *
+ * The string is not copied. The buffer must stay valid and unchanged for as
+ * long as the parameter is used. If a parameter exists at this index, it is
+ * replaced.
+ *
+ * @param[in] list    Parameter list.
+ * @param[in] index   Index in the list where to put the parameter.
+ * @param[in] str     Pointer to the string value.
+ * @param[in] str_len Number of characters of the string value @p str.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int at_params_string_view_put(const struct at_param_list *list, size_t index,
+			      const char *str, size_t str_len);
+
+/**
+ * @brief Add a parameter in the list at the specified index and assign it an
+ * array value that refers to an external buffer.
+ *
+ * The array is kept as the text of comma-separated numbers, for example
+ * "1,2,3", and it is converted when the parameter is read with
+ * @ref at_params_array_get. The text must be followed by the array end
+ * character ')'. The buffer must stay valid and unchanged for as long as
+ * the parameter is used. If a parameter exists at this index, it is replaced.
+ *
+ * @param[in] list      Parameter list.
+ * @param[in] index     Index in the list where to put the parameter.
+ * @param[in] str       Pointer to the text of the array.
+ * @param[in] array_len Length of the array in bytes (number of elements
+ *                      multiplied by 4).
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int at_params_array_view_put(const struct at_param_list *list, size_t index,
+			     const char *str, size_t array_len);
+
 /**
  * @brief Add a parameter in the list at the specified index and assign it a
  * empty status.
@@ -125,6 +125,8 @@ struct download_client {
 	char buf[CONFIG_DOWNLOAD_CLIENT_MAX_RESPONSE_SIZE];
 	/** Buffer offset. */
 	size_t offset;
+	/** HTTP request buffer. */
+	char req_buf[CONFIG_DOWNLOAD_CLIENT_MAX_REQUEST_SIZE];
 
 	/** Size of the file being downloaded, in bytes. */
 	size_t file_size;
@@ -132,11 +134,28 @@ struct download_client {
 	size_t progress;
 	/** Fragment size being used for this download. */
 	size_t fragment_size;
+	/** Offset of the current fragment in the response buffer. */
+	size_t fragment_offset;
+	/** Length of the current fragment, in bytes. */
+	size_t fragment_len;
+	/** Offset of the first byte that has not been requested yet. */
+	size_t request_offset;
+	/** Number of requests whose response has not been fully received. */
+	u8_t pending_requests;
+
+	/** Download start time, in milliseconds. */
+	s64_t start_time;
+	/** Download progress at start time, in bytes. */
+	size_t start_progress;
 
 	/** Whether the HTTP header for
 	 * the current fragment has been processed.
 	 */
 	bool has_header;
+	/** Offset of the first HTTP header byte that has not been parsed. */
+	size_t hdr_parsed;
+	/** Offset of the HTTP header line being parsed. */
+	size_t hdr_line;
 	/** The server has closed the connection. */
 	bool connection_close;
 
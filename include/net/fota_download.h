@@ -26,6 +26,9 @@
 extern "C" {
 #endif
 
+/** Size of the image hash provided by the manifest, in bytes. */
+#define FOTA_DOWNLOAD_HASH_SIZE 32
+
 /**
  * @brief FOTA download event IDs.
  */
@@ -83,6 +86,42 @@ int fota_download_init(fota_download_callback_t client_callback);
  */
 int fota_download_start(const char *host, const char *file, int sec_tag);
 
+/**@brief Start downloading the given file, verified by the given manifest.
+ *
+ * The manifest is downloaded first. It contains the block size and the
+ * SHA-256 hash of every block of the file. Every block of the file is
+ * verified while it is received and written to the DFU target only if its
+ * hash matches the manifest. A corrupted block is downloaded again, up to
+ * CONFIG_FOTA_DOWNLOAD_MANIFEST_BLOCK_RETRIES times.
+ *
+ * Requires CONFIG_FOTA_DOWNLOAD_MANIFEST.
+ *
+ * @param host Hostname which you should start downloading from.
+ * @param file Filepath to the file you wish to download.
+ * @param manifest Filepath to the manifest of the file.
+ * @param sec_tag Security tag you want to use with HTTPS set to -1 to Disable.
+ *
+ * @retval 0	     If download has started successfully.
+ * @retval -EALREADY If download is already ongoing.
+ *                   Otherwise, a negative value is returned.
+ */
+int fota_download_start_with_manifest(const char *host, const char *file,
+				      const char *manifest, int sec_tag);
+
+/**@brief Get the SHA-256 hash of the image given by the manifest.
+ *
+ * The hash is known as soon as the manifest has been downloaded.
+ *
+ * Requires CONFIG_FOTA_DOWNLOAD_MANIFEST.
+ *
+ * @param hash Buffer of FOTA_DOWNLOAD_HASH_SIZE bytes for the hash.
+ *
+ * @retval 0	    If the hash was copied.
+ * @retval -ENODATA If no valid manifest has been downloaded.
+ *                  Otherwise, a negative value is returned.
+ */
+int fota_download_image_hash_get(u8_t *hash);
+
 #ifdef __cplusplus
 }
 #endif
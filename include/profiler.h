@@ -18,6 +18,7 @@
 #include <zephyr/types.h>
 #include <sys/util.h>
 #include <sys/__assert.h>
+#include <sys/atomic.h>
 
 #ifndef CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS
 /** Maximum number of custom events. */
@@ -26,12 +27,12 @@
 
 /** @brief Set of flags for enabling/disabling profiling for given event types.
  */
-extern u32_t profiler_enabled_events;
+extern atomic_t profiler_enabled_events[];
 
 
 /** @brief Number of event types registered in the Profiler.
  */
-extern u8_t profiler_num_events;
+extern u16_t profiler_num_events;
 
 
 /** @brief Data types for profiling.
@@ -104,7 +105,8 @@ static inline bool is_profiling_enabled(size_t profiler_event_id)
 {
 	if (IS_ENABLED(CONFIG_PROFILER)) {
 		__ASSERT_NO_MSG(profiler_event_id < CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS);
-		return (profiler_enabled_events & BIT(profiler_event_id)) != 0;
+		return atomic_test_bit(profiler_enabled_events,
+				       profiler_event_id);
 	}
 	return false;
 }
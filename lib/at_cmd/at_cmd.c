@@ -25,29 +25,43 @@ LOG_MODULE_REGISTER(at_cmd, CONFIG_AT_CMD_LOG_LEVEL);
 static K_THREAD_STACK_DEFINE(socket_thread_stack, \
 				CONFIG_AT_CMD_THREAD_STACK_SIZE);
 
-static K_SEM_DEFINE(cmd_pending, 1, 1);
-
 static int              common_socket_fd;
-static char             *response_buf;
-static u32_t            response_buf_len;
 
 static struct k_thread  socket_thread;
 static at_cmd_handler_t notification_handler;
-static at_cmd_handler_t current_cmd_handler;
+
+/* Queue of commands. The command at the head of the queue is the one
+ * that was sent to the modem and awaits response.
+ */
+static sys_slist_t      cmd_queue;
+static struct k_spinlock cmd_queue_lock;
 
 struct return_state_object {
 	int               code;
 	enum at_cmd_state state;
 };
 
-K_MSGQ_DEFINE(return_code_msq, sizeof(struct return_state_object), 1, 4);
-
 struct callback_work_item {
 	struct k_work    work;
 	char             data[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
 	at_cmd_handler_t callback;
 };
 
+struct sync_cmd {
+	struct at_cmd_async async;
+	struct k_sem        done;
+	char                *buf;
+	size_t              buf_len;
+	at_cmd_handler_t    handler;
+	struct callback_work_item *response;
+	struct return_state_object ret;
+};
+
+/* Reception buffer of the response that is being completed. A synchronous
+ * command takes it over to process the response in the calling thread.
+ */
+static struct callback_work_item *rx_item;
+
 K_MEM_SLAB_DEFINE(rsp_work_items, sizeof(struct callback_work_item),
 		  CONFIG_AT_CMD_RESPONSE_BUFFER_COUNT, 4);
 
@@ -122,6 +136,83 @@ static void callback_worker(struct k_work *item)
 }
 
 
+static struct at_cmd_async *cmd_queue_pop(struct at_cmd_async **next)
+{
+	k_spinlock_key_t key = k_spin_lock(&cmd_queue_lock);
+	sys_snode_t *node = sys_slist_get(&cmd_queue);
+	sys_snode_t *next_node = sys_slist_peek_head(&cmd_queue);
+
+	k_spin_unlock(&cmd_queue_lock, key);
+
+	*next = (next_node != NULL) ?
+		CONTAINER_OF(next_node, struct at_cmd_async, node) : NULL;
+
+	return (node != NULL) ?
+		CONTAINER_OF(node, struct at_cmd_async, node) : NULL;
+}
+
+static int cmd_send(struct at_cmd_async *cmd)
+{
+	int bytes_to_send = strlen(cmd->cmd);
+	int bytes_sent;
+
+	LOG_DBG("Sending command %s", log_strdup(cmd->cmd));
+
+	bytes_sent = send(common_socket_fd, cmd->cmd, bytes_to_send, 0);
+
+	if (bytes_sent == -1) {
+		LOG_ERR("Failed to send AT command (err:%d)", errno);
+		return -errno;
+	}
+
+	LOG_DBG("Bytes sent: %d", bytes_sent);
+
+	if (bytes_sent != bytes_to_send) {
+		LOG_ERR("Bytes sent (%d) was not the same as expected (%d)",
+			bytes_sent, bytes_to_send);
+	}
+
+	return 0;
+}
+
+/* Send the command that has just become the head of the queue.
+ * Commands that cannot be sent are completed with an error and
+ * the next queued command is sent instead.
+ */
+static void cmd_send_next(struct at_cmd_async *cmd)
+{
+	while (cmd != NULL) {
+		int err = cmd_send(cmd);
+		struct at_cmd_async *next;
+
+		if (!err) {
+			return;
+		}
+
+		cmd = cmd_queue_pop(&next);
+		cmd->handler(cmd, NULL, 0, AT_CMD_ERROR, err);
+		cmd = next;
+	}
+}
+
+static void cmd_complete(const char *response, size_t len,
+			 const struct return_state_object *ret)
+{
+	struct at_cmd_async *next;
+	struct at_cmd_async *cmd = cmd_queue_pop(&next);
+
+	if (cmd == NULL) {
+		LOG_WRN("Unexpected response, no command pending");
+		return;
+	}
+
+	/* Handler is called before the next command is sent to make sure
+	 * that commands are completed in order.
+	 */
+	cmd->handler(cmd, response, len, ret->state, ret->code);
+	cmd_send_next(next);
+}
+
 static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 {
 	int                        bytes_read;
@@ -142,6 +233,7 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 		ret.code  = 0;
 		ret.state = AT_CMD_OK;
 		item->callback = NULL;
+		payload_len = 0;
 
 		bytes_read = recv(common_socket_fd, item->data,
 				  sizeof(item->data), 0);
@@ -176,102 +268,147 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 
 		payload_len = get_return_code(item->data, &ret);
 
-		if (ret.state != AT_CMD_NOTIFICATION) {
-			if ((response_buf_len > 0) &&
-			    (response_buf != NULL)) {
-				if (response_buf_len >= payload_len) {
-					memcpy(response_buf, item->data,
-					       payload_len);
-				} else {
-					LOG_ERR("Response buffer not large "
-						"enough");
-
-					ret.code  = -EMSGSIZE;
-				}
-
-				response_buf_len = 0;
-				response_buf     = NULL;
-
-				goto next;
-			}
-		}
-
-		if (payload_len == 0) {
-			goto next;
-		}
-
 		if (ret.state == AT_CMD_NOTIFICATION) {
 			item->callback = notification_handler;
-		} else {
-			item->callback = current_cmd_handler;
 		}
 next:
-		/* If no callback was set, free the item.
+		/* Response is passed to the command handler directly from
+		 * the reception buffer.
+		 */
+		if (ret.state != AT_CMD_NOTIFICATION) {
+			rx_item = item;
+			cmd_complete((payload_len > 0) ? item->data : NULL,
+				     (payload_len > 0) ? (payload_len - 1) : 0,
+				     &ret);
+			item = rx_item;
+			rx_item = NULL;
+		}
+
+		/* If the item was taken over by a synchronous command,
+		 * the command frees it. If no callback was set, free the item.
 		 * Otherwise, work queue callback will free it.
 		 */
-		if (item->callback == NULL) {
+		if (item == NULL) {
+			continue;
+		} else if (item->callback == NULL) {
 			k_mem_slab_free(&rsp_work_items, (void **)&item);
 		} else {
 			k_work_init(&item->work, callback_worker);
 			k_work_submit(&item->work);
 		}
+	}
+}
+
+int at_cmd_write_async(struct at_cmd_async *cmd)
+{
+	if ((cmd == NULL) || (cmd->cmd == NULL) || (cmd->handler == NULL)) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&cmd_queue_lock);
+	bool idle = sys_slist_is_empty(&cmd_queue);
+
+	sys_slist_append(&cmd_queue, &cmd->node);
+	k_spin_unlock(&cmd_queue_lock, key);
+
+	if (idle) {
+		int err = cmd_send(cmd);
 
-		/* Notify back only if command was sent. */
-		if ((k_sem_count_get(&cmd_pending) == 0) &&
-		    (ret.state != AT_CMD_NOTIFICATION)) {
-			current_cmd_handler = NULL;
+		if (err) {
+			struct at_cmd_async *next;
 
-			k_msgq_put(&return_code_msq, &ret, K_FOREVER);
+			/* The command is still at the head of the queue.
+			 * It is dropped without calling its handler and
+			 * the commands queued in the meantime are sent.
+			 */
+			cmd_queue_pop(&next);
+			cmd_send_next(next);
+
+			return err;
 		}
 	}
+
+	return 0;
 }
 
-static inline int at_write(const char *const cmd, enum at_cmd_state *state)
+static void sync_cmd_handler(struct at_cmd_async *async,
+			     const char *response, size_t len,
+			     enum at_cmd_state state, int code)
 {
-	int bytes_sent;
-	int bytes_to_send = strlen(cmd);
-	struct return_state_object ret;
+	struct sync_cmd *cmd = CONTAINER_OF(async, struct sync_cmd, async);
 
-	LOG_DBG("Sending command %s", log_strdup(cmd));
+	cmd->ret.state = state;
+	cmd->ret.code  = code;
 
-	bytes_sent = send(common_socket_fd, cmd, bytes_to_send, 0);
+	if ((response != NULL) && (cmd->buf_len > 0) && (cmd->buf != NULL)) {
+		if (cmd->buf_len > len) {
+			memcpy(cmd->buf, response, len + 1);
+		} else {
+			LOG_ERR("Response buffer not large enough");
 
-	if (bytes_sent == -1) {
-		LOG_ERR("Failed to send AT command (err:%d)", errno);
-		ret.code  = -errno;
-		ret.state = AT_CMD_ERROR;
-	} else {
-		LOG_DBG("Awaiting response for %s", log_strdup(cmd));
-		k_msgq_get(&return_code_msq, &ret, K_FOREVER);
-		LOG_DBG("Bytes sent: %d", bytes_sent);
-
-		if (bytes_sent != bytes_to_send) {
-			LOG_ERR("Bytes sent (%d) was not the "
-				"same as expected (%d)",
-				bytes_sent, bytes_to_send);
+			cmd->ret.code = -EMSGSIZE;
 		}
 	}
 
+	if ((response != NULL) && (cmd->handler != NULL)) {
+		/* Hand the reception buffer over to the caller, so that the
+		 * reception thread does not wait for the handler.
+		 */
+		cmd->response = rx_item;
+		rx_item = NULL;
+	}
+
+	k_sem_give(&cmd->done);
+}
+
+static int at_write(struct sync_cmd *cmd, const char *const cmd_str,
+		    enum at_cmd_state *state)
+{
+	int err;
+
+	/* The response would never be received, as it is the reception
+	 * thread that waits for it.
+	 */
+	__ASSERT(k_current_get() != &socket_thread,
+		 "Synchronous AT command sent from an asynchronous handler");
+
+	cmd->async.cmd     = cmd_str;
+	cmd->async.handler = sync_cmd_handler;
+	cmd->response      = NULL;
+	k_sem_init(&cmd->done, 0, 1);
+
+	err = at_cmd_write_async(&cmd->async);
+	if (err) {
+		if (state) {
+			*state = AT_CMD_ERROR;
+		}
+		return err;
+	}
+
+	LOG_DBG("Awaiting response for %s", log_strdup(cmd_str));
+	k_sem_take(&cmd->done, K_FOREVER);
+
+	if (cmd->response != NULL) {
+		cmd->handler(cmd->response->data);
+		k_mem_slab_free(&rsp_work_items, (void **)&cmd->response);
+	}
+
 	if (state) {
-		*state = ret.state;
+		*state = cmd->ret.state;
 	}
 
-	return ret.code;
+	return cmd->ret.code;
 }
 
 int at_cmd_write_with_callback(const char *const cmd,
 			       at_cmd_handler_t  handler,
 			       enum at_cmd_state *state)
 {
-	k_sem_take(&cmd_pending, K_FOREVER);
-
-	current_cmd_handler = handler;
-
-	int return_code = at_write(cmd, state);
+	struct sync_cmd sync_cmd = {
+		.handler = handler,
+	};
 
-	k_sem_give(&cmd_pending);
-
-	return return_code;
+	return at_write(&sync_cmd, cmd, state);
 }
 
 int at_cmd_write(const char *const cmd,
@@ -279,16 +416,12 @@ int at_cmd_write(const char *const cmd,
 		 size_t buf_len,
 		 enum at_cmd_state *state)
 {
-	k_sem_take(&cmd_pending, K_FOREVER);
-
-	response_buf     = buf;
-	response_buf_len = buf_len;
-
-	int return_code = at_write(cmd, state);
+	struct sync_cmd sync_cmd = {
+		.buf     = buf,
+		.buf_len = buf_len,
+	};
 
-	k_sem_give(&cmd_pending);
-
-	return return_code;
+	return at_write(&sync_cmd, cmd, state);
 }
 
 void at_cmd_set_notification_handler(at_cmd_handler_t handler)
@@ -299,11 +432,7 @@ void at_cmd_set_notification_handler(at_cmd_handler_t handler)
 			notification_handler);
 	}
 
-	k_sem_take(&cmd_pending, K_FOREVER);
-
 	notification_handler = handler;
-
-	k_sem_give(&cmd_pending);
 }
 
 static int at_cmd_driver_init(struct device *dev)
@@ -192,7 +192,7 @@ static int at_parse_process_element(const char **str, int index,
 				tmparray[i++] =
 					(u32_t)strtoul(++tmpstr, &next, 10);
 
-				if (strlen(tmpstr) == strlen(next)) {
+				if (next == tmpstr) {
 					break;
 				} else {
 					tmpstr = next;
@@ -352,6 +352,393 @@ int at_parser_max_params_from_str(const char *at_params_str,
 	return err;
 }
 
+enum at_parser_stream_state {
+	STREAM_START,
+	STREAM_NOTIFICATION,
+	STREAM_COMMAND,
+	STREAM_COMMAND_SUFFIX,
+	STREAM_STRING,
+	STREAM_PARAM,
+	STREAM_NUMBER,
+	STREAM_QUOTED_STRING,
+	STREAM_ARRAY,
+	STREAM_SMS_PDU,
+	STREAM_AFTER_PARAM,
+	STREAM_LINE_END,
+	STREAM_DONE,
+};
+
+static int stream_param_check(struct at_parser *parser)
+{
+	if (parser->index >= parser->max_params) {
+		return -E2BIG;
+	}
+
+	return 0;
+}
+
+static int stream_string_put(struct at_parser *parser, const char *buf)
+{
+	int err = stream_param_check(parser);
+
+	if (err) {
+		return err;
+	}
+
+	at_params_string_view_put(parser->list, parser->index++,
+				  &buf[parser->token_start],
+				  parser->pos - parser->token_start);
+	parser->last_num = false;
+
+	return 0;
+}
+
+static int stream_empty_put(struct at_parser *parser)
+{
+	int err = stream_param_check(parser);
+
+	if (err) {
+		return err;
+	}
+
+	at_params_empty_put(parser->list, parser->index++);
+	parser->last_num = false;
+
+	return 0;
+}
+
+static int stream_number_put(struct at_parser *parser)
+{
+	int err = stream_param_check(parser);
+
+	if (err) {
+		return err;
+	}
+
+	if (!parser->num_negative && (parser->num <= USHRT_MAX)) {
+		at_params_short_put(parser->list, parser->index++,
+				    (u16_t)parser->num);
+	} else if (!parser->num_negative) {
+		at_params_int_put(parser->list, parser->index++, parser->num);
+	} else if (parser->num <= (u32_t)INT_MAX + 1) {
+		/* Negative numbers are stored in two's complement. */
+		at_params_int_put(parser->list, parser->index++,
+				  -parser->num);
+	} else {
+		return -EINVAL;
+	}
+	parser->last_num = true;
+
+	return 0;
+}
+
+static int stream_array_put(struct at_parser *parser, const char *buf)
+{
+	int err = stream_param_check(parser);
+
+	if (err) {
+		return err;
+	}
+
+	at_params_array_view_put(parser->list, parser->index++,
+				 &buf[parser->token_start],
+				 parser->array_cnt * sizeof(u32_t));
+	parser->last_num = false;
+
+	return 0;
+}
+
+/* Handle the first character of a parameter. Returns 1 if parsing of
+ * the response is completed.
+ */
+static int stream_param_start(struct at_parser *parser, char chr)
+{
+	if (is_notification(chr) || is_terminated(chr)) {
+		/* Start of the next notification or end of the string. */
+		return 1;
+	}
+
+	parser->token_start = parser->pos + 1;
+
+	if (isdigit((int)chr) || (chr == '-')) {
+		parser->state = STREAM_NUMBER;
+		parser->token_start = parser->pos;
+		parser->num_negative = (chr == '-');
+		parser->num = parser->num_negative ? 0 : (chr - '0');
+	} else if (is_dblquote(chr)) {
+		parser->state = STREAM_QUOTED_STRING;
+	} else if (is_array_start(chr)) {
+		/* Like in at_parser_params_from_str(), an empty array
+		 * holds one element.
+		 */
+		parser->state = STREAM_ARRAY;
+		parser->array_cnt = 1;
+	} else if (is_separator(chr)) {
+		/* Empty optional parameter. */
+		return stream_empty_put(parser);
+	} else if (is_lfcr(chr)) {
+		/* Empty optional parameter at the end of the line. */
+		parser->state = STREAM_LINE_END;
+		return stream_empty_put(parser);
+	} else if (chr != ' ') {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/* Skip characters of the current token that do not change the parser state.
+ * Returns false if the end of the received data is reached.
+ */
+static inline bool stream_skip(struct at_parser *parser, const char *buf,
+			       size_t len, bool (*in_token)(char chr))
+{
+	while (in_token(buf[parser->pos])) {
+		if (++parser->pos >= len) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool in_string(char chr)
+{
+	return !is_lfcr(chr) && !is_terminated(chr);
+}
+
+static bool in_quoted_string(char chr)
+{
+	return !is_dblquote(chr) && !is_terminated(chr);
+}
+
+static bool in_sms_pdu(char chr)
+{
+	return isxdigit((int)chr);
+}
+
+static int stream_process_char(struct at_parser *parser, const char *buf,
+			       size_t len)
+{
+	char chr = buf[parser->pos];
+	int err = 0;
+
+	switch (parser->state) {
+	case STREAM_START:
+		if (is_notification(chr)) {
+			parser->state = STREAM_NOTIFICATION;
+			parser->token_start = parser->pos;
+			break;
+		}
+
+		if (toupper((int)chr) == 'A') {
+			/* Command type can be detected with three characters. */
+			if ((len - parser->pos < 3) &&
+			    !memchr(&buf[parser->pos], '\0',
+				    len - parser->pos)) {
+				return -EAGAIN;
+			}
+
+			if (is_command(&buf[parser->pos])) {
+				parser->state = STREAM_COMMAND;
+				parser->token_start = parser->pos;
+				parser->pos += sizeof("AT") - 1;
+				if (is_notification(buf[parser->pos]) ||
+				    (buf[parser->pos] ==
+				     AT_CUSTOM_COMMAND_PREFX)) {
+					parser->pos++;
+				}
+				return 0;
+			}
+		}
+
+		/* The whole line is treated as one string parameter. */
+		parser->state = STREAM_STRING;
+		parser->token_start = parser->pos;
+		return 0;
+
+	case STREAM_NOTIFICATION:
+	case STREAM_COMMAND:
+		if (!stream_skip(parser, buf, len, is_valid_notification_char)) {
+			return -EAGAIN;
+		}
+
+		err = stream_string_put(parser, buf);
+		parser->state = (parser->state == STREAM_COMMAND) ?
+				STREAM_COMMAND_SUFFIX : STREAM_AFTER_PARAM;
+		return err;
+
+	case STREAM_COMMAND_SUFFIX:
+		/* Skip read/test special characters. */
+		if (chr == AT_CMD_READ_TEST_IDENTIFIER) {
+			parser->state = STREAM_AFTER_PARAM;
+			break;
+		}
+
+		if (chr == AT_CMD_SEPARATOR) {
+			if (parser->pos + 1 >= len) {
+				return -EAGAIN;
+			}
+
+			if (buf[parser->pos + 1] == AT_CMD_READ_TEST_IDENTIFIER) {
+				parser->pos += 2;
+				parser->state = STREAM_AFTER_PARAM;
+				return 0;
+			}
+		}
+
+		parser->state = STREAM_AFTER_PARAM;
+		return 0;
+
+	case STREAM_STRING:
+		if (!stream_skip(parser, buf, len, in_string)) {
+			return -EAGAIN;
+		}
+
+		parser->state = STREAM_LINE_END;
+		return stream_string_put(parser, buf);
+
+	case STREAM_PARAM:
+		err = stream_param_start(parser, chr);
+		if (err == 1) {
+			parser->state = STREAM_DONE;
+			return 0;
+		}
+		break;
+
+	case STREAM_NUMBER:
+		while (isdigit((int)chr)) {
+			u32_t digit = chr - '0';
+
+			if (parser->num > (UINT32_MAX - digit) / 10) {
+				/* Number does not fit in 32 bits. */
+				return -E2BIG;
+			}
+
+			parser->num = parser->num * 10 + digit;
+			if (++parser->pos >= len) {
+				return -EAGAIN;
+			}
+			chr = buf[parser->pos];
+		}
+
+		parser->state = STREAM_AFTER_PARAM;
+		return stream_number_put(parser);
+
+	case STREAM_QUOTED_STRING:
+		if (!stream_skip(parser, buf, len, in_quoted_string)) {
+			return -EAGAIN;
+		}
+
+		err = stream_string_put(parser, buf);
+		if (is_terminated(buf[parser->pos])) {
+			parser->state = STREAM_DONE;
+			return err;
+		}
+
+		parser->state = STREAM_AFTER_PARAM;
+		break;
+
+	case STREAM_ARRAY:
+		if ((chr == AT_PARAM_SEPARATOR) &&
+		    (parser->array_cnt < AT_CMD_MAX_ARRAY_SIZE)) {
+			parser->array_cnt++;
+		} else if (is_array_stop(chr)) {
+			err = stream_array_put(parser, buf);
+			parser->state = STREAM_AFTER_PARAM;
+		} else if (is_terminated(chr)) {
+			return -EBADMSG;
+		}
+		break;
+
+	case STREAM_SMS_PDU:
+		if (!stream_skip(parser, buf, len, in_sms_pdu)) {
+			return -EAGAIN;
+		}
+
+		parser->state = STREAM_AFTER_PARAM;
+		return stream_string_put(parser, buf);
+
+	case STREAM_AFTER_PARAM:
+		if (is_separator(chr)) {
+			parser->state = STREAM_PARAM;
+		} else if (is_lfcr(chr)) {
+			parser->state = STREAM_LINE_END;
+		} else if (is_terminated(chr)) {
+			parser->state = STREAM_DONE;
+			return 0;
+		} else if (chr != ' ') {
+			return -EBADMSG;
+		}
+		break;
+
+	case STREAM_LINE_END:
+		if (is_lfcr(chr)) {
+			break;
+		}
+
+		if (parser->last_num && isxdigit((int)chr)) {
+			/* Line following a number is a PDU. */
+			parser->state = STREAM_SMS_PDU;
+			parser->token_start = parser->pos;
+			break;
+		}
+
+		/* End of the string, next notification or unexpected data
+		 * that is left for the caller.
+		 */
+		parser->state = STREAM_DONE;
+		return 0;
+
+	default:
+		return 0;
+	}
+
+	parser->pos++;
+
+	return err;
+}
+
+int at_parser_stream_init(struct at_parser *parser,
+			  struct at_param_list *const list,
+			  size_t max_params_count)
+{
+	if (parser == NULL || list == NULL || list->params == NULL) {
+		return -EINVAL;
+	}
+
+	at_params_list_clear(list);
+
+	memset(parser, 0, sizeof(*parser));
+	parser->list = list;
+	parser->max_params = MIN(max_params_count, list->param_count);
+	parser->state = STREAM_START;
+
+	return 0;
+}
+
+int at_parser_stream_feed(struct at_parser *parser, const char *buf,
+			  size_t len)
+{
+	if (parser == NULL || buf == NULL || parser->list == NULL) {
+		return -EINVAL;
+	}
+
+	while (parser->state != STREAM_DONE) {
+		if (parser->pos >= len) {
+			return -EAGAIN;
+		}
+
+		int err = stream_process_char(parser, buf, len);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
 enum at_cmd_type at_parser_cmd_type_get(const char *at_cmd)
 {
 	enum at_cmd_type type;
@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zephyr.h>
 #include <zephyr/types.h>
@@ -28,12 +29,13 @@ static void at_param_clear(struct at_param *param)
 {
 	__ASSERT(param != NULL, "Parameter cannot be NULL.");
 
-	if ((param->type == AT_PARAM_TYPE_STRING) ||
-	    (param->type == AT_PARAM_TYPE_ARRAY)) {
+	if (((param->type == AT_PARAM_TYPE_STRING) ||
+	     (param->type == AT_PARAM_TYPE_ARRAY)) && !param->is_view) {
 		k_free(param->value.str_val);
 	}
 
 	param->value.int_val = 0;
+	param->is_view = false;
 }
 
 /* Internal function. Parameter cannot be null. */
@@ -229,6 +231,72 @@ int at_params_array_put(const struct at_param_list *list, size_t index,
 	return 0;
 }
 
+int at_params_string_view_put(const struct at_param_list *list, size_t index,
+			      const char *str, size_t str_len)
+{
+	if (list == NULL || list->params == NULL || str == NULL) {
+		return -EINVAL;
+	}
+
+	struct at_param *param = at_params_get(list, index);
+
+	if (param == NULL) {
+		return -EINVAL;
+	}
+
+	at_param_clear(param);
+	param->size = str_len;
+	param->type = AT_PARAM_TYPE_STRING;
+	param->value.view_val = str;
+	param->is_view = true;
+
+	return 0;
+}
+
+int at_params_array_view_put(const struct at_param_list *list, size_t index,
+			     const char *str, size_t array_len)
+{
+	if (list == NULL || list->params == NULL || str == NULL) {
+		return -EINVAL;
+	}
+
+	struct at_param *param = at_params_get(list, index);
+
+	if (param == NULL) {
+		return -EINVAL;
+	}
+
+	at_param_clear(param);
+	param->size = array_len;
+	param->type = AT_PARAM_TYPE_ARRAY;
+	param->value.view_val = str;
+	param->is_view = true;
+
+	return 0;
+}
+
+/* Internal function. Convert array text up to the array end character. */
+static void at_param_array_view_copy(u32_t *array, const char *str,
+				     size_t array_len)
+{
+	for (size_t i = 0; i < array_len / sizeof(u32_t); i++) {
+		char *next;
+
+		array[i] = (u32_t)strtoul(str, &next, 10);
+		str = next;
+
+		while ((*str != ',') && (*str != ')')) {
+			str++;
+		}
+
+		if (*str == ')') {
+			break;
+		}
+
+		str++;
+	}
+}
+
 int at_params_size_get(const struct at_param_list *list, size_t index,
 		       size_t *len)
 {
@@ -313,7 +381,7 @@ int at_params_string_get(const struct at_param_list *list, size_t index,
 		return -ENOMEM;
 	}
 
-	memcpy(value, param->value.str_val, param_len);
+	memcpy(value, param->value.view_val, param_len);
 	*len = param_len;
 
 	return 0;
@@ -343,7 +411,12 @@ int at_params_array_get(const struct at_param_list *list, size_t index,
 		return -ENOMEM;
 	}
 
-	memcpy(array, param->value.array_val, param_len);
+	if (param->is_view) {
+		at_param_array_view_copy(array, param->value.view_val,
+					 param_len);
+	} else {
+		memcpy(array, param->value.array_val, param_len);
+	}
 	*len = param_len;
 
 	return 0;
@@ -220,10 +220,9 @@ static inline bool is_number(char chr)
  */
 static inline bool is_command(const char *str)
 {
-	if (strlen(str) < 2) {
-		return false;
-	}
-
+	/* Characters are checked one by one, so the string length does not
+	 * have to be calculated.
+	 */
 	if ((toupper(str[0]) != 'A') || (toupper(str[1]) != 'T')) {
 		return false;
 	}
@@ -357,6 +357,7 @@ static void at_params_list_get(struct at_param_list *dst,
 	for (size_t i = 0; i < src->param_count; i++) {
 		dst->params[i].size = src_param[i].size;
 		dst->params[i].type = src_param[i].type;
+		dst->params[i].is_view = src_param[i].is_view;
 		switch (src_param[i].type) {
 		case AT_PARAM_TYPE_INVALID:
 		case AT_PARAM_TYPE_EMPTY:
@@ -389,6 +390,7 @@ static void at_params_list_translate(struct lwm2m_os_at_param_list *dst,
 	for (size_t i = 0; i < src->param_count; i++) {
 		dst_param[i].size = src->params[i].size;
 		dst_param[i].type = src->params[i].type;
+		dst_param[i].is_view = src->params[i].is_view;
 		switch (src->params[i].type) {
 		case AT_PARAM_TYPE_INVALID:
 		case AT_PARAM_TYPE_EMPTY:
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+
+import hashlib
+import random
+import struct
+import sys
+import argparse
+
+
+DELTA_MAGIC = 0x544c444e  # "NDLT"
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+HEADER = struct.Struct('<III32s')
+COPY = struct.Struct('<BII')
+INSERT = struct.Struct('<BI')
+
+# Length of the source data indexed at every offset.
+MATCH_LEN = 16
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Generate a delta file that reconstructs the new image from the image that "
+                    "is currently running, for use with the MCUboot delta DFU target.",
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+
+    parser.add_argument("--source", "-s", required=True,
+                        help="Signed binary image that is running on the device (the primary slot).")
+    parser.add_argument("--target", "-t", required=True,
+                        help="Signed binary image to update to, for example app_update.bin.")
+    parser.add_argument("--outfile", "-o", "--out", "-out", required=True,
+                        help="Delta file to write.")
+    return parser.parse_args()
+
+
+def _index(source):
+    index = {}
+    for i in range(len(source) - MATCH_LEN + 1):
+        index.setdefault(source[i:i + MATCH_LEN], i)
+    return index
+
+
+def delta(source, target):
+    """Return the delta that reconstructs target from source.
+
+    Matches of at least MATCH_LEN bytes are copied from the source, the rest
+    of the target is inserted literally.
+    """
+    index = _index(source)
+    ops = []
+    literal_start = 0
+    pos = 0
+
+    while pos + MATCH_LEN <= len(target):
+        src = index.get(target[pos:pos + MATCH_LEN])
+        if src is None:
+            pos += 1
+            continue
+
+        # Extend the match in both directions.
+        end = pos + MATCH_LEN
+        src_end = src + MATCH_LEN
+        while end < len(target) and src_end < len(source) and target[end] == source[src_end]:
+            end += 1
+            src_end += 1
+        while pos > literal_start and src > 0 and target[pos - 1] == source[src - 1]:
+            pos -= 1
+            src -= 1
+
+        if pos > literal_start:
+            ops.append(INSERT.pack(OP_INSERT, pos - literal_start) + target[literal_start:pos])
+        ops.append(COPY.pack(OP_COPY, src, end - pos))
+        pos = end
+        literal_start = end
+
+    if literal_start < len(target):
+        ops.append(INSERT.pack(OP_INSERT, len(target) - literal_start) + target[literal_start:])
+
+    header = HEADER.pack(DELTA_MAGIC, len(source), len(target), hashlib.sha256(source).digest())
+    return header + b''.join(ops)
+
+
+def apply(source, delta_file):
+    """Reconstruct the target from source and delta, as done on the device."""
+    magic, source_size, target_size, source_hash = HEADER.unpack_from(delta_file)
+    assert magic == DELTA_MAGIC, "Invalid magic"
+    assert source_size == len(source), "Wrong source size"
+    assert source_hash == hashlib.sha256(source).digest(), "Wrong source"
+
+    target = bytearray()
+    pos = HEADER.size
+    while pos < len(delta_file):
+        op = delta_file[pos]
+        if op == OP_COPY:
+            _, offset, length = COPY.unpack_from(delta_file, pos)
+            target += source[offset:offset + length]
+            pos += COPY.size
+        elif op == OP_INSERT:
+            _, length = INSERT.unpack_from(delta_file, pos)
+            pos += INSERT.size
+            target += delta_file[pos:pos + length]
+            pos += length
+        else:
+            raise RuntimeError("Invalid operation 0x%02x" % op)
+
+    assert len(target) == target_size, "Wrong target size"
+    return bytes(target)
+
+
+def test():
+    rnd = random.Random(0)
+    source = bytes(rnd.getrandbits(8) for _ in range(128 * 1024))
+
+    # Small fix: a few bytes changed in place.
+    small = bytearray(source)
+    for _ in range(8):
+        small[rnd.randrange(len(small))] ^= 0xff
+
+    # New feature: code inserted in the middle, shifting the rest.
+    pos = len(source) // 2
+    inserted = source[:pos] + bytes(rnd.getrandbits(8) for _ in range(2048)) + source[pos:]
+
+    # Unrelated image.
+    unrelated = bytes(rnd.getrandbits(8) for _ in range(len(source)))
+
+    for name, target, max_ratio in (('small fix', bytes(small), 0.01),
+                                    ('inserted code', inserted, 0.03),
+                                    ('unrelated image', unrelated, 1.01)):
+        d = delta(source, target)
+        assert apply(source, d) == target, "Reconstruction failed: " + name
+        ratio = len(d) / len(target)
+        print("%s: full image %d bytes, delta %d bytes (%.1f%%)" % (name, len(target), len(d), ratio * 100))
+        assert ratio <= max_ratio, "Delta too big: " + name
+
+    print("All tests passed!")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        args = parse_args()
+        source = open(args.source, 'rb').read()
+        target = open(args.target, 'rb').read()
+        open(args.outfile, 'wb').write(delta(source, target))
+    else:
+        print("No input, running tests.")
+        test()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+
+import hashlib
+import struct
+import argparse
+
+
+MANIFEST_MAGIC = 0x4d544f46  # "FOTM"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Generate the block checksum manifest of a FOTA image, for use with "
+                    "fota_download_start_with_manifest().",
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+
+    parser.add_argument("--infile", "-i", "--in", "-in", required=True,
+                        help="Binary image that is downloaded, for example app_update.bin.")
+    parser.add_argument("--outfile", "-o", "--out", "-out", required=True,
+                        help="Manifest file to write.")
+    parser.add_argument("--block-size", type=int, default=4096,
+                        help="Size of the verified blocks. Must not exceed "
+                             "CONFIG_FOTA_DOWNLOAD_MANIFEST_BLOCK_SIZE_MAX.")
+    return parser.parse_args()
+
+
+def manifest(image, block_size):
+    blocks = [image[i:i + block_size] for i in range(0, len(image), block_size)]
+    return struct.pack('<III', MANIFEST_MAGIC, block_size, len(image)) + \
+        hashlib.sha256(image).digest() + \
+        b''.join(hashlib.sha256(block).digest() for block in blocks)
+
+
+if __name__ == "__main__":
+    args = parse_args()
+
+    if args.block_size <= 0:
+        raise RuntimeError("Block size must be positive")
+
+    image = open(args.infile, 'rb').read()
+    open(args.outfile, 'wb').write(manifest(image, args.block_size))
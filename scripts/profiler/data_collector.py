@@ -4,6 +4,7 @@
 # SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
 
 from rtt_nordic_profiler_host import RttNordicProfilerHost
+from trace_file import TRACE_FILE_SUFFIX
 import sys
 import argparse
 import logging
@@ -17,6 +18,8 @@ def main():
     parser.add_argument('time', type=int, help='Time of collecting data [s]')
     parser.add_argument('dataset_name', help='Name of dataset')
     parser.add_argument('--log', help='Log level')
+    parser.add_argument('--trace', action='store_true',
+                        help='Save data to binary trace file')
     args = parser.parse_args()
 
     if args.log is not None:
@@ -30,11 +33,17 @@ def main():
     signal.signal(signal.SIGINT, sigint_handler)
     end_ev = threading.Event()
 
-    profiler = RttNordicProfilerHost(
-                event_filename=args.dataset_name + ".csv",
-                finish_event=end_ev,
-                event_types_filename=args.dataset_name + ".json",
-                log_lvl=log_lvl_number)
+    if args.trace:
+        profiler = RttNordicProfilerHost(
+                    finish_event=end_ev,
+                    trace_filename=args.dataset_name + TRACE_FILE_SUFFIX,
+                    log_lvl=log_lvl_number)
+    else:
+        profiler = RttNordicProfilerHost(
+                    event_filename=args.dataset_name + ".csv",
+                    finish_event=end_ev,
+                    event_types_filename=args.dataset_name + ".json",
+                    log_lvl=log_lvl_number)
     profiler.get_events_descriptions()
     profiler.read_events_rtt(args.time)
 
@@ -10,6 +10,7 @@ import sys
 from enum import Enum
 from rtt_nordic_config import RttNordicConfig
 from events import Event, EventType, EventsData
+from trace_file import TraceFileWriter
 import logging
 
 class Command(Enum):
@@ -19,17 +20,26 @@ class Command(Enum):
 
 
 class RttNordicProfilerHost:
+    DROPPED_EVENTS_TYPE_NAME = '_dropped_events'
 
     def __init__(self, config=RttNordicConfig, finish_event=None,
                  queue=None, event_filename=None,
-                 event_types_filename=None, log_lvl=logging.WARNING):
+                 event_types_filename=None, log_lvl=logging.WARNING,
+                 trace_filename=None):
         self.event_filename = event_filename
         self.event_types_filename = event_types_filename
         self.config = config
         self.finish_event = finish_event
         self.queue = queue
         self.received_events = EventsData([], {})
+        # Events written to trace file are not kept in memory
+        self.trace_writer = None
+        if trace_filename is not None:
+            self.trace_writer = TraceFileWriter(trace_filename)
         self.timestamp_overflows = 0
+        self.dropped_events_cnt = 0
+        self.compact_format = False
+        self.last_timestamp_raw = 0
         self.after_half = False
 
         self.desc_buf = ""
@@ -91,6 +101,8 @@ class RttNordicProfilerHost:
     def shutdown(self):
         self.disconnect()
         self._read_remaining_events()
+        if self.trace_writer is not None:
+            self.trace_writer.close()
         if self.event_filename and self.event_types_filename:
             self.received_events.write_data_to_files(self.event_filename,
                                                      self.event_types_filename)
@@ -205,6 +217,12 @@ class RttNordicProfilerHost:
 
         desc_fields = desc.split(',')
 
+        # Lines starting with '#' describe the data format
+        if desc_fields[0] == '#format':
+            self.compact_format = (desc_fields[1] == 'compact')
+            self.logger.info("Data format: " + desc_fields[1])
+            return self._read_single_event_description()
+
         name = desc_fields[0]
         id = int(desc_fields[1])
         data_type = []
@@ -221,6 +239,8 @@ class RttNordicProfilerHost:
             if (id is None or et is None):
                 break
             self.received_events.registered_events_types[id] = et
+            if self.trace_writer is not None:
+                self.trace_writer.write_event_type(id, et)
 
     def get_events_descriptions(self):
         self._send_command(Command.INFO)
@@ -230,7 +250,42 @@ class RttNordicProfilerHost:
         self.logger.info("Received events descriptions")
         self.logger.info("Ready to start logging events")
 
-    def _read_single_event_rtt(self):
+    def _read_varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self._read_bytes(1)[0]
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    @staticmethod
+    def _zigzag_decode(value):
+        return (value >> 1) ^ -(value & 1)
+
+    def _read_single_event_compact(self):
+        header = self._read_varint()
+        id = header >> 1
+        et = self.received_events.registered_events_types[id]
+
+        if header & 1:
+            timestamp_raw = self._read_varint()
+        else:
+            delta = self._zigzag_decode(self._read_varint())
+            timestamp_raw = (self.last_timestamp_raw + delta) % \
+                self.config['timestamp_raw_max']
+        self.last_timestamp_raw = timestamp_raw
+
+        data = []
+        for i in et.data_types:
+            value = self._read_varint()
+            if i[0] == 's':
+                value = self._zigzag_decode(value)
+            data.append(value)
+        return id, et, timestamp_raw, data
+
+    def _read_single_event_legacy(self):
         id = int.from_bytes(
             self._read_bytes(1),
             byteorder=self.config['byteorder'],
@@ -244,6 +299,22 @@ class RttNordicProfilerHost:
                 byteorder=self.config['byteorder'],
                 signed=False))
 
+        data = []
+        for i in et.data_types:
+            signum = False
+            if i[0] == 's':
+                signum = True
+            buf = self._read_bytes(4)
+            data.append(int.from_bytes(buf, byteorder=self.config['byteorder'],
+                                       signed=signum))
+        return id, et, timestamp_raw, data
+
+    def _read_single_event_rtt(self):
+        if self.compact_format:
+            id, et, timestamp_raw, data = self._read_single_event_compact()
+        else:
+            id, et, timestamp_raw, data = self._read_single_event_legacy()
+
         if self.after_half \
         and timestamp_raw < 0.2 * self.config['timestamp_raw_max']:
             self.timestamp_overflows += 1
@@ -255,23 +326,26 @@ class RttNordicProfilerHost:
 
         timestamp = self._calculate_timestamp_from_clock_ticks(timestamp_raw)
 
-        data = []
-        for i in et.data_types:
-            signum = False
-            if i[0] == 's':
-                signum = True
-            buf = self._read_bytes(4)
-            data.append(int.from_bytes(buf, byteorder=self.config['byteorder'],
-                                       signed=signum))
+        if et.name == self.DROPPED_EVENTS_TYPE_NAME:
+            self.dropped_events_cnt += data[0]
+            self.logger.warning("Device dropped {} events ({} in total)".format(
+                data[0], self.dropped_events_cnt))
+
         return Event(id, timestamp, data)
 
+    def _store_event(self, event):
+        if self.trace_writer is not None:
+            self.trace_writer.write_event(event)
+        else:
+            self.received_events.events.append(event)
+        if self.queue is not None:
+            self.queue.put(event)
+
     def _read_remaining_events(self):
         self.reading_data = False
         while self.bcnt != 0:
             event = self._read_single_event_rtt()
-            self.received_events.events.append(event)
-            if self.queue is not None:
-                self.queue.put(event)
+            self._store_event(event)
 
         # End of transmission
         if self.queue is not None:
@@ -284,9 +358,7 @@ class RttNordicProfilerHost:
         current_time = start_time
         while current_time - start_time < time_seconds or time_seconds < 0:
             event = self._read_single_event_rtt()
-            self.received_events.events.append(event)
-            if self.queue is not None:
-                self.queue.put(event)
+            self._store_event(event)
             current_time = time.time()
         self.logger.info("Real time transmission closed")
         self.shutdown()
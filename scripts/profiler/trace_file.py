@@ -0,0 +1,288 @@
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Binary trace file format for Nordic profiler captures.
+
+The trace file is append-only, so events can be written while they are
+received and a capture that was interrupted is still readable.
+All values are little-endian.
+
+File header:
+    magic       8 bytes   b'NPTRACE\\0'
+    version     u16       TRACE_FILE_VERSION
+
+The header is followed by records. Every record starts with a one-byte
+record type:
+
+    'T' - event type description:
+        type_id     u16
+        length      u16
+        description length bytes of UTF-8 encoded JSON object with the
+                    "name", "data_types" and "data_descriptions" keys
+
+    'E' - event:
+        type_id     u16
+        timestamp   f64       time in seconds
+        data        s32 or u32 for every data field of the event type
+
+An event type description is always written before the first event of
+the given type. Events are expected to be written in timestamp order.
+
+Index file (trace file name with the '.idx' suffix) is written next to
+the trace file. It contains copies of the event type description records
+and index records:
+
+    'I' - index entry:
+        timestamp   f64       timestamp of the indexed event
+        offset      u64       offset of the indexed event record in
+                              the trace file
+
+Every INDEX_INTERVAL-th event is indexed. The index is flushed together
+with the trace file, so it never refers to data that was not written.
+The index is only used to speed up seeking and it is rebuilt if it is
+missing or truncated.
+"""
+
+import json
+import os
+import struct
+
+from events import Event, EventType
+
+
+TRACE_FILE_MAGIC = b'NPTRACE\0'
+TRACE_FILE_VERSION = 1
+TRACE_FILE_SUFFIX = '.nptrace'
+INDEX_FILE_SUFFIX = '.idx'
+INDEX_INTERVAL = 4096
+
+RECORD_EVENT_TYPE = b'T'
+RECORD_EVENT = b'E'
+RECORD_INDEX = b'I'
+
+_HEADER = struct.Struct('<8sH')
+_EVENT_TYPE_HEADER = struct.Struct('<HH')
+_EVENT_HEADER = struct.Struct('<Hd')
+_INDEX_ENTRY = struct.Struct('<dQ')
+
+
+def _data_struct(event_type):
+    fmt = '<' + ''.join('i' if t[0] == 's' else 'I'
+                        for t in event_type.data_types)
+    return struct.Struct(fmt)
+
+
+class TraceFileError(Exception):
+    pass
+
+
+class TraceFileWriter():
+    def __init__(self, filename):
+        self.file = open(filename, 'wb')
+        self.index_file = open(filename + INDEX_FILE_SUFFIX, 'wb')
+        self.file.write(_HEADER.pack(TRACE_FILE_MAGIC, TRACE_FILE_VERSION))
+        self.data_structs = {}
+        self.event_cnt = 0
+
+    def write_event_type(self, type_id, event_type):
+        if type_id in self.data_structs:
+            return
+
+        descr = json.dumps(event_type.serialize()).encode('utf-8')
+        record = RECORD_EVENT_TYPE + \
+                 _EVENT_TYPE_HEADER.pack(type_id, len(descr)) + descr
+        self.file.write(record)
+        self.index_file.write(record)
+        self.data_structs[type_id] = _data_struct(event_type)
+        self.flush()
+
+    def write_event(self, event):
+        if self.event_cnt % INDEX_INTERVAL == 0:
+            # Events written so far are stored before they are indexed
+            self.flush()
+            self.index_file.write(RECORD_INDEX)
+            self.index_file.write(_INDEX_ENTRY.pack(event.timestamp,
+                                                    self.file.tell()))
+        self.event_cnt += 1
+
+        self.file.write(RECORD_EVENT)
+        self.file.write(_EVENT_HEADER.pack(event.type_id, event.timestamp))
+        self.file.write(self.data_structs[event.type_id].pack(*event.data))
+
+    def flush(self):
+        # Trace file goes first, so the index does not refer to lost data
+        self.file.flush()
+        self.index_file.flush()
+
+    def close(self):
+        self.flush()
+        self.file.close()
+        self.index_file.close()
+
+
+class TraceFileReader():
+    """Streaming reader of the trace file.
+
+    Only event type descriptions and the index are kept in memory, events
+    are decoded one by one while iterating.
+    """
+
+    READ_CHUNK_SIZE = 1 << 20
+
+    def __init__(self, filename):
+        self.filename = filename
+        self.file = open(filename, 'rb')
+        header = self.file.read(_HEADER.size)
+        if len(header) < _HEADER.size:
+            raise TraceFileError("Trace file is too short")
+
+        magic, version = _HEADER.unpack(header)
+        if magic != TRACE_FILE_MAGIC:
+            raise TraceFileError("Not a trace file: " + filename)
+        if version != TRACE_FILE_VERSION:
+            raise TraceFileError("Unsupported trace file version: {}"
+                                 .format(version))
+
+        self.data_start = self.file.tell()
+        self.registered_events_types = {}
+        self.data_structs = {}
+        self.index = None
+
+    def close(self):
+        self.file.close()
+
+    def _add_event_type(self, type_id, descr):
+        event_type = EventType.deserialize(json.loads(descr.decode('utf-8')))
+        self.registered_events_types[type_id] = event_type
+        self.data_structs[type_id] = _data_struct(event_type)
+
+    def _records(self, offset):
+        """Yield (offset, event) tuples starting from given file offset.
+
+        Event type descriptions found on the way are registered and are
+        not yielded.
+        """
+        self.file.seek(offset)
+        buf = b''
+        pos = 0
+        buf_offset = offset
+        eof = False
+
+        while True:
+            if not eof and len(buf) - pos < self.READ_CHUNK_SIZE // 2:
+                chunk = self.file.read(self.READ_CHUNK_SIZE)
+                eof = len(chunk) < self.READ_CHUNK_SIZE
+                buf_offset += pos
+                buf = buf[pos:] + chunk
+                pos = 0
+
+            if pos >= len(buf):
+                return
+
+            record_offset = buf_offset + pos
+            record_type = buf[pos:pos + 1]
+
+            if record_type == RECORD_EVENT_TYPE:
+                hdr_end = pos + 1 + _EVENT_TYPE_HEADER.size
+                if hdr_end > len(buf):
+                    return
+                type_id, length = _EVENT_TYPE_HEADER.unpack_from(buf, pos + 1)
+                if hdr_end + length > len(buf):
+                    return
+                self._add_event_type(type_id, buf[hdr_end:hdr_end + length])
+                pos = hdr_end + length
+
+            elif record_type == RECORD_EVENT:
+                hdr_end = pos + 1 + _EVENT_HEADER.size
+                if hdr_end > len(buf):
+                    return
+                type_id, timestamp = _EVENT_HEADER.unpack_from(buf, pos + 1)
+                data_struct = self.data_structs[type_id]
+                if hdr_end + data_struct.size > len(buf):
+                    # Last record was not fully written
+                    return
+                data = list(data_struct.unpack_from(buf, hdr_end))
+                pos = hdr_end + data_struct.size
+                yield record_offset, Event(type_id, timestamp, data)
+
+            else:
+                raise TraceFileError("Invalid record at offset {}"
+                                     .format(record_offset))
+
+    def _parse_index(self, buf):
+        index = []
+        pos = 0
+        while pos < len(buf):
+            record_type = buf[pos:pos + 1]
+            if record_type == RECORD_EVENT_TYPE:
+                hdr_end = pos + 1 + _EVENT_TYPE_HEADER.size
+                if hdr_end > len(buf):
+                    raise TraceFileError("Truncated index file")
+                type_id, length = _EVENT_TYPE_HEADER.unpack_from(buf, pos + 1)
+                if hdr_end + length > len(buf):
+                    raise TraceFileError("Truncated index file")
+                self._add_event_type(type_id, buf[hdr_end:hdr_end + length])
+                pos = hdr_end + length
+            elif record_type == RECORD_INDEX:
+                if pos + 1 + _INDEX_ENTRY.size > len(buf):
+                    raise TraceFileError("Truncated index file")
+                index.append(_INDEX_ENTRY.unpack_from(buf, pos + 1))
+                pos += 1 + _INDEX_ENTRY.size
+            else:
+                raise TraceFileError("Invalid index file")
+        return index
+
+    def _build_index(self, index_filename):
+        index = []
+        with open(index_filename, 'wb') as f:
+            for cnt, (offset, ev) in enumerate(self._records(self.data_start)):
+                if cnt % INDEX_INTERVAL == 0:
+                    index.append((ev.timestamp, offset))
+            # Event types are known after the whole file is read
+            for type_id, event_type in self.registered_events_types.items():
+                descr = json.dumps(event_type.serialize()).encode('utf-8')
+                f.write(RECORD_EVENT_TYPE)
+                f.write(_EVENT_TYPE_HEADER.pack(type_id, len(descr)))
+                f.write(descr)
+            for entry in index:
+                f.write(RECORD_INDEX)
+                f.write(_INDEX_ENTRY.pack(*entry))
+        return index
+
+    def read_index(self):
+        """Read the index and all event type descriptions."""
+        if self.index is not None:
+            return self.index
+
+        index_filename = self.filename + INDEX_FILE_SUFFIX
+        if os.path.exists(index_filename):
+            try:
+                with open(index_filename, 'rb') as f:
+                    self.index = self._parse_index(f.read())
+            except TraceFileError:
+                # Capture was interrupted while the index was written
+                self.index = None
+
+        if self.index is None:
+            self.index = self._build_index(index_filename)
+        return self.index
+
+    def events(self, start_time=0, end_time=float('inf')):
+        """Yield events with timestamps in range [start_time, end_time)."""
+        offset = self.data_start
+        if start_time > 0:
+            # Index also provides descriptions of all event types, which
+            # may be placed before the seek position.
+            for timestamp, entry_offset in self.read_index():
+                if timestamp > start_time:
+                    break
+                offset = entry_offset
+
+        for _, ev in self._records(offset):
+            if ev.timestamp < start_time:
+                continue
+            if ev.timestamp >= end_time:
+                return
+            yield ev
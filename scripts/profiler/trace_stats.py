@@ -0,0 +1,261 @@
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from trace_file import TraceFileReader, TRACE_FILE_SUFFIX
+
+import argparse
+import csv
+import logging
+import math
+import sys
+
+
+PERCENTILES = (50, 90, 99, 99.9)
+
+# Limit of events waiting for processing start or end. Events that were
+# submitted but never reported as processed are forgotten when exceeded.
+MAX_PENDING_EVENTS = 1 << 16
+
+# Event type used by the profiler host to report events dropped by
+# the device, see RttNordicProfilerHost.
+DROPPED_EVENTS_TYPE_NAME = '_dropped_events'
+
+
+class LogHistogram():
+    """Histogram with logarithmic buckets.
+
+    Memory usage does not depend on the number of samples and percentiles
+    are calculated with the relative error given by resolution.
+    """
+
+    MIN_VALUE = 1e-7
+
+    def __init__(self, resolution=0.01):
+        self.log_base = math.log(1 + resolution)
+        self.buckets = {}
+        self.count = 0
+        self.sum = 0
+        self.min = float('inf')
+        self.max = 0
+
+    def add(self, value):
+        if value < self.MIN_VALUE:
+            idx = 0
+        else:
+            idx = int(math.log(value / self.MIN_VALUE) / self.log_base) + 1
+        self.buckets[idx] = self.buckets.get(idx, 0) + 1
+        self.count += 1
+        self.sum += value
+        self.min = min(self.min, value)
+        self.max = max(self.max, value)
+
+    def _bucket_value(self, idx):
+        if idx == 0:
+            return 0
+        # Geometric middle of the bucket
+        return self.MIN_VALUE * math.exp((idx - 0.5) * self.log_base)
+
+    def percentile(self, p):
+        if self.count == 0:
+            return None
+        threshold = self.count * p / 100
+        cnt = 0
+        for idx in sorted(self.buckets):
+            cnt += self.buckets[idx]
+            if cnt >= threshold:
+                return min(max(self._bucket_value(idx), self.min), self.max)
+        return self.max
+
+    def mean(self):
+        if self.count == 0:
+            return None
+        return self.sum / self.count
+
+
+class EventTypeStats():
+    METRICS = ('submit_to_start', 'processing', 'submit_to_end')
+
+    def __init__(self, name):
+        self.name = name
+        self.count = 0
+        self.first_timestamp = None
+        self.last_timestamp = None
+        self.hists = dict((m, LogHistogram()) for m in self.METRICS)
+
+    def add_submit(self, timestamp):
+        if self.first_timestamp is None:
+            self.first_timestamp = timestamp
+        self.last_timestamp = timestamp
+        self.count += 1
+
+    def rate(self):
+        if self.count < 2 or self.last_timestamp == self.first_timestamp:
+            return None
+        return (self.count - 1) / (self.last_timestamp - self.first_timestamp)
+
+
+class TraceStats():
+    def __init__(self, reader, log_lvl=logging.INFO):
+        self.reader = reader
+        self.stats = {}
+
+        self.logger = logging.getLogger('Trace Stats')
+        self.logger_console = logging.StreamHandler()
+        self.logger.setLevel(log_lvl)
+        self.log_format = logging.Formatter(
+            '[%(levelname)s] %(name)s: %(message)s')
+        self.logger_console.setFormatter(self.log_format)
+        self.logger.addHandler(self.logger_console)
+
+    def _type_id(self, name):
+        for type_id, et in self.reader.registered_events_types.items():
+            if et.name == name:
+                return type_id
+        return None
+
+    @staticmethod
+    def _put_pending(pending, key, value):
+        if len(pending) >= MAX_PENDING_EVENTS:
+            del pending[next(iter(pending))]
+        pending[key] = value
+
+    def _get_stats(self, type_id):
+        if type_id not in self.stats:
+            name = self.reader.registered_events_types[type_id].name
+            self.stats[type_id] = EventTypeStats(name)
+        return self.stats[type_id]
+
+    def calculate(self, start_time=0, end_time=float('inf')):
+        # Submitted events (by memory address) waiting for processing start
+        submitted = {}
+        # Events (by memory address) waiting for processing end
+        processing = {}
+        start_id = None
+        end_id = None
+        dropped_id = None
+        dropped_cnt = 0
+        types_cnt = 0
+        cnt = 0
+
+        for ev in self.reader.events(start_time, end_time):
+            if types_cnt != len(self.reader.registered_events_types):
+                # Event types may be described in the middle of the trace
+                types_cnt = len(self.reader.registered_events_types)
+                start_id = self._type_id('event_processing_start')
+                end_id = self._type_id('event_processing_end')
+                dropped_id = self._type_id(DROPPED_EVENTS_TYPE_NAME)
+
+            cnt += 1
+            if ev.type_id == dropped_id:
+                # Not an application event, data holds the dropped count
+                dropped_cnt += ev.data[0]
+
+            elif ev.type_id == start_id:
+                submit = submitted.pop(ev.data[0], None)
+                if submit is None:
+                    continue
+                stats, submit_time = submit
+                stats.hists['submit_to_start'].add(ev.timestamp - submit_time)
+                self._put_pending(processing, ev.data[0],
+                                  (stats, submit_time, ev.timestamp))
+
+            elif ev.type_id == end_id:
+                proc = processing.pop(ev.data[0], None)
+                if proc is None:
+                    continue
+                stats, submit_time, proc_start_time = proc
+                stats.hists['processing'].add(ev.timestamp - proc_start_time)
+                stats.hists['submit_to_end'].add(ev.timestamp - submit_time)
+
+            else:
+                stats = self._get_stats(ev.type_id)
+                stats.add_submit(ev.timestamp)
+                # First data field of tracked events is memory address
+                if start_id is not None and len(ev.data) > 0:
+                    self._put_pending(submitted, ev.data[0],
+                                      (stats, ev.timestamp))
+
+        self.logger.info("Processed {} events".format(cnt))
+        if dropped_cnt > 0:
+            self.logger.warning("Device dropped {} events, statistics are "
+                                "incomplete".format(dropped_cnt))
+
+    def rows(self):
+        for stats in sorted(self.stats.values(), key=lambda s: s.name):
+            row = {'event': stats.name, 'count': stats.count,
+                   'rate': stats.rate()}
+            for metric, hist in stats.hists.items():
+                row[metric + '_mean'] = hist.mean()
+                for p in PERCENTILES:
+                    row['{}_p{}'.format(metric, p)] = hist.percentile(p)
+                row[metric + '_max'] = hist.max if hist.count else None
+            yield row
+
+    @staticmethod
+    def _fmt_ms(value):
+        if value is None:
+            return '-'
+        return '{0:.3f}'.format(value * 1000)
+
+    def print_stats(self):
+        for row in self.rows():
+            rate = '-' if row['rate'] is None else \
+                   '{0:.1f}'.format(row['rate'])
+            print("{}: {} events, {}/s".format(row['event'], row['count'],
+                                               rate))
+            for metric in EventTypeStats.METRICS:
+                if row[metric + '_mean'] is None:
+                    continue
+                values = ["mean {}".format(self._fmt_ms(row[metric + '_mean']))]
+                values += ["p{} {}".format(p, self._fmt_ms(
+                                row['{}_p{}'.format(metric, p)]))
+                           for p in PERCENTILES]
+                values.append("max {}".format(
+                                self._fmt_ms(row[metric + '_max'])))
+                print("\t{} [ms]: {}".format(metric, ", ".join(values)))
+
+    def write_csv(self, filename):
+        rows = list(self.rows())
+        if len(rows) == 0:
+            return
+        try:
+            with open(filename, 'w', newline='') as csvfile:
+                wr = csv.DictWriter(csvfile, fieldnames=list(rows[0].keys()))
+                wr.writeheader()
+                for row in rows:
+                    wr.writerow(row)
+        except IOError:
+            self.logger.error("Problem with accessing file: " + filename)
+            sys.exit()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Calculating event latency statistics from binary trace file.')
+    parser.add_argument('dataset_name', help='Name of dataset')
+    parser.add_argument('--start_time', type=float, default=0,
+                        help='Measurement start time[s]')
+    parser.add_argument('--end_time', type=float, default=float('inf'),
+                        help='Measurement end time[s]')
+    parser.add_argument('--csv', help='Save statistics to given csv file')
+    parser.add_argument('--log', help='Log level')
+    args = parser.parse_args()
+
+    if args.log is not None:
+        log_lvl_number = int(getattr(logging, args.log.upper(), None))
+    else:
+        log_lvl_number = logging.INFO
+
+    reader = TraceFileReader(args.dataset_name + TRACE_FILE_SUFFIX)
+    ts = TraceStats(reader, log_lvl_number)
+    ts.calculate(args.start_time, args.end_time)
+    reader.close()
+
+    ts.print_stats()
+    if args.csv is not None:
+        ts.write_csv(args.csv)
+
+if __name__ == "__main__":
+    main()
@@ -5,8 +5,11 @@
  */
 
 #include <inttypes.h>
+#include <stdio.h>
 #include <zephyr.h>
 #include <logging/log.h>
+#include <settings/settings.h>
+#include <sys/byteorder.h>
 
 #include <bluetooth/gatt_dm.h>
 
@@ -22,6 +25,50 @@ LOG_MODULE_REGISTER(bt_gatt_dm, CONFIG_BT_GATT_DM_LOG_LEVEL);
 BUILD_ASSERT(sizeof(struct bt_gatt_service_val) % DATA_ALIGN == 0);
 BUILD_ASSERT(sizeof(struct bt_gatt_chrc) % DATA_ALIGN == 0);
 
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+#define DB_HASH_SIZE 16
+#define CACHE_VERSION 1
+/* "bt/dm/" + address + "/" + record identifier */
+#define CACHE_KEY_LEN (6 + 2 * sizeof(bt_addr_le_t) + 1 + 8 + 1)
+/* Record key relative to "bt/dm" */
+#define CACHE_NAME_LEN (2 * sizeof(bt_addr_le_t) + 1 + 8 + 1)
+/* Records removed at a time by bt_gatt_dm_cache_clear */
+#define CACHE_CLEAR_BATCH 8
+
+/* Stored discovery record header. The header is followed by the
+ * attributes, each stored as struct cache_attr and its UUID. Service and
+ * characteristic declarations are followed by their value and its UUID.
+ * A UUID is stored as its type followed by its value.
+ */
+struct cache_hdr {
+	u8_t version;
+	/* Sizes of the stored values, to reject records of other builds */
+	u8_t service_val_size;
+	u8_t chrc_size;
+	u16_t attr_cnt;
+	/* End handle of the discovered service */
+	u16_t end_handle;
+	u8_t db_hash[DB_HASH_SIZE];
+} __packed;
+
+struct cache_attr {
+	u16_t handle;
+	u8_t perm;
+} __packed;
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+/* An attribute in the UUID index. The index is sorted by key, and by
+ * attribute position for equal keys.
+ */
+struct uuid_index_entry {
+	u32_t key;
+	u16_t attr_id;
+	/* Characteristic declaration the attribute belongs to */
+	u16_t chrc_id;
+};
+#endif /* CONFIG_BT_GATT_DM_UUID_INDEX */
+
 /* Flags for parsed attribute array state */
 enum {
 	STATE_ATTRS_LOCKED,
@@ -60,6 +107,28 @@ struct bt_gatt_dm {
 
 	/* The pointer to callback structure */
 	const struct bt_gatt_dm_cb *callback;
+
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	/* Characteristics by their value UUID, followed by the other
+	 * attributes that follow a characteristic declaration
+	 */
+	struct uuid_index_entry uuid_index[CONFIG_BT_GATT_DM_MAX_ATTRS];
+	size_t chrc_index_cnt;
+	size_t desc_index_cnt;
+	bool indexed;
+#endif
+
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+	/* The Database Hash read parameters */
+	struct bt_gatt_read_params read_params;
+	/* Database Hash of the peer, if db_hash_valid is set */
+	u8_t db_hash[DB_HASH_SIZE];
+	bool db_hash_valid;
+	/* Set if the attributes were loaded from the cache */
+	bool cached;
+	/* Identifies the searched service and start handle in the cache */
+	u32_t cache_id;
+#endif
 };
 
 /* Currently only one instance is supported */
@@ -113,6 +182,9 @@ static void svc_attr_memory_release(struct bt_gatt_dm *dm)
 
 	/* Clear attributes */
 	dm->cur_attr_id = 0;
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	dm->indexed = false;
+#endif
 
 	/* Release dynamic memory data chunks */
 	while (!sys_slist_is_empty(&dm->chunk_list)) {
@@ -198,6 +270,10 @@ static struct bt_uuid *uuid_store(struct bt_gatt_dm *dm,
 	size_t size = get_uuid_size(uuid);
 	void *buffer = user_data_alloc(dm, size);
 
+	if (!buffer) {
+		return NULL;
+	}
+
 	memcpy(buffer, uuid, size);
 
 	return (struct bt_uuid *)buffer;
@@ -231,9 +307,624 @@ static struct bt_gatt_dm_attr *attr_find_by_handle(
 	return NULL;
 }
 
+#if defined(CONFIG_BT_GATT_DM_CACHE) || defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+#define DATA_HASH_INIT 2166136261U
+
+/* 32-bit FNV-1a. */
+static u32_t data_hash(u32_t hash, const void *data, size_t len)
+{
+	const u8_t *byte = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= byte[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+#endif
+
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+/* UUIDs based on the Bluetooth Base UUID get the key of their 16 or 32-bit
+ * form, as bt_uuid_cmp considers them equal.
+ */
+static u32_t uuid_index_key(const struct bt_uuid *uuid)
+{
+	static const u8_t base_uuid[12] = {
+		0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+		0x00, 0x10, 0x00, 0x00,
+	};
+	const u8_t *uuid_128;
+
+	switch (uuid->type) {
+	case BT_UUID_TYPE_16:
+		return BT_UUID_16(uuid)->val;
+	case BT_UUID_TYPE_32:
+		return BT_UUID_32(uuid)->val;
+	case BT_UUID_TYPE_128:
+		uuid_128 = BT_UUID_128(uuid)->val;
+		if (memcmp(uuid_128, base_uuid, sizeof(base_uuid))) {
+			return data_hash(DATA_HASH_INIT, uuid_128, 16);
+		}
+		return sys_get_le32(&uuid_128[sizeof(base_uuid)]);
+	default:
+		return 0;
+	}
+}
+
+static bool uuid_index_entry_less(const struct uuid_index_entry *a,
+				  const struct uuid_index_entry *b)
+{
+	return (a->key < b->key) ||
+	       ((a->key == b->key) && (a->attr_id < b->attr_id));
+}
+
+static void uuid_index_sort(struct uuid_index_entry *entries, size_t cnt)
+{
+	/* Insertion sort, the entries are few and mostly added in order */
+	for (size_t i = 1; i < cnt; i++) {
+		struct uuid_index_entry entry = entries[i];
+		size_t j = i;
+
+		while ((j > 0) &&
+		       uuid_index_entry_less(&entry, &entries[j - 1])) {
+			entries[j] = entries[j - 1];
+			j--;
+		}
+		entries[j] = entry;
+	}
+}
+
+/* Returns the position of the first entry not less than the given key and
+ * attribute position.
+ */
+static size_t uuid_index_find(const struct uuid_index_entry *entries,
+			      size_t cnt, u32_t key, u16_t attr_id)
+{
+	const struct uuid_index_entry entry = {
+		.key = key,
+		.attr_id = attr_id,
+	};
+	size_t lower = 0;
+	size_t upper = cnt;
+
+	while (lower < upper) {
+		size_t mid = lower + (upper - lower) / 2;
+
+		if (uuid_index_entry_less(&entries[mid], &entry)) {
+			lower = mid + 1;
+		} else {
+			upper = mid;
+		}
+	}
+
+	return lower;
+}
+
+static void uuid_index_build(struct bt_gatt_dm *dm)
+{
+	struct uuid_index_entry *chrc_entry = dm->uuid_index;
+	struct uuid_index_entry *desc_entry;
+	size_t chrc_cnt = 0;
+	u16_t chrc_id = 0;
+	bool in_chrc = false;
+
+	for (size_t i = 0; i < dm->cur_attr_id; i++) {
+		if (bt_gatt_dm_attr_chrc_val(&dm->attrs[i])) {
+			chrc_cnt++;
+		}
+	}
+
+	desc_entry = &dm->uuid_index[chrc_cnt];
+
+	/* Same grouping as bt_gatt_dm_desc_next: every attribute after
+	 * a characteristic declaration belongs to it.
+	 */
+	for (size_t i = 0; i < dm->cur_attr_id; i++) {
+		const struct bt_gatt_dm_attr *attr = &dm->attrs[i];
+		struct bt_gatt_chrc *chrc = bt_gatt_dm_attr_chrc_val(attr);
+
+		if (chrc) {
+			chrc_id = i;
+			in_chrc = true;
+			chrc_entry->key = uuid_index_key(chrc->uuid);
+			chrc_entry->attr_id = i;
+			chrc_entry->chrc_id = i;
+			chrc_entry++;
+		} else if (in_chrc) {
+			desc_entry->key = uuid_index_key(attr->uuid);
+			desc_entry->attr_id = i;
+			desc_entry->chrc_id = chrc_id;
+			desc_entry++;
+		}
+	}
+
+	dm->chrc_index_cnt = chrc_cnt;
+	dm->desc_index_cnt = desc_entry - &dm->uuid_index[chrc_cnt];
+
+	uuid_index_sort(dm->uuid_index, dm->chrc_index_cnt);
+	uuid_index_sort(&dm->uuid_index[chrc_cnt], dm->desc_index_cnt);
+
+	dm->indexed = true;
+}
+
+static const struct bt_gatt_dm_attr *uuid_index_char_find(
+	const struct bt_gatt_dm *dm,
+	const struct bt_gatt_dm_attr *prev,
+	const struct bt_uuid *uuid)
+{
+	const struct uuid_index_entry *entries = dm->uuid_index;
+	u32_t key = uuid_index_key(uuid);
+	u16_t attr_id = prev ? (prev - dm->attrs) + 1 : 0;
+
+	for (size_t i = uuid_index_find(entries, dm->chrc_index_cnt, key,
+					attr_id);
+	     (i < dm->chrc_index_cnt) && (entries[i].key == key); i++) {
+		const struct bt_gatt_dm_attr *attr =
+			&dm->attrs[entries[i].attr_id];
+
+		if (!bt_uuid_cmp(uuid, bt_gatt_dm_attr_chrc_val(attr)->uuid)) {
+			return attr;
+		}
+	}
+
+	return NULL;
+}
+
+static const struct bt_gatt_dm_attr *uuid_index_desc_find(
+	const struct bt_gatt_dm *dm,
+	u16_t chrc_id,
+	const struct bt_uuid *uuid)
+{
+	const struct uuid_index_entry *entries =
+		&dm->uuid_index[dm->chrc_index_cnt];
+	u32_t key = uuid_index_key(uuid);
+
+	for (size_t i = uuid_index_find(entries, dm->desc_index_cnt, key,
+					chrc_id + 1);
+	     (i < dm->desc_index_cnt) && (entries[i].key == key) &&
+	     (entries[i].chrc_id == chrc_id); i++) {
+		const struct bt_gatt_dm_attr *attr =
+			&dm->attrs[entries[i].attr_id];
+
+		if (!bt_uuid_cmp(uuid, attr->uuid)) {
+			return attr;
+		}
+	}
+
+	return NULL;
+}
+#endif /* CONFIG_BT_GATT_DM_UUID_INDEX */
+
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+/* Buffer for one stored discovery record */
+static u8_t cache_buf[CONFIG_BT_GATT_DM_CACHE_SIZE];
+
+static void cache_peer_key(const bt_addr_le_t *addr, char *key, size_t len)
+{
+	const u8_t *a = addr->a.val;
+
+	snprintf(key, len, "bt/dm/%02x%02x%02x%02x%02x%02x%02x",
+		 a[5], a[4], a[3], a[2], a[1], a[0], addr->type);
+}
+
+static void cache_key(const struct bt_gatt_dm *dm, char *key)
+{
+	size_t len;
+
+	cache_peer_key(bt_conn_get_dst(dm->conn), key, CACHE_KEY_LEN);
+	len = strlen(key);
+	snprintf(&key[len], CACHE_KEY_LEN - len, "/%08x", dm->cache_id);
+}
+
+static bool cache_peer_bonded(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	if (bt_conn_get_info(conn, &info)) {
+		return false;
+	}
+
+	return bt_addr_le_is_bonded(info.id, bt_conn_get_dst(conn));
+}
+
+static size_t cache_uuid_len(u8_t type)
+{
+	switch (type) {
+	case BT_UUID_TYPE_16:
+		return sizeof(u16_t);
+	case BT_UUID_TYPE_32:
+		return sizeof(u32_t);
+	case BT_UUID_TYPE_128:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+/* The UUID value without the padding of its structure */
+static const void *cache_uuid_val(const struct bt_uuid *uuid)
+{
+	switch (uuid->type) {
+	case BT_UUID_TYPE_16:
+		return &BT_UUID_16(uuid)->val;
+	case BT_UUID_TYPE_32:
+		return &BT_UUID_32(uuid)->val;
+	default:
+		return BT_UUID_128(uuid)->val;
+	}
+}
+
+/* The service UUID and start handle identify the discovery. */
+static u32_t cache_id_get(const struct bt_gatt_dm *dm)
+{
+	const struct bt_uuid *uuid = dm->discover_params.uuid;
+	u32_t id = DATA_HASH_INIT;
+
+	if (uuid) {
+		id = data_hash(id, &uuid->type, sizeof(uuid->type));
+		id = data_hash(id, cache_uuid_val(uuid),
+			       cache_uuid_len(uuid->type));
+	}
+
+	return data_hash(id, &dm->discover_params.start_handle,
+			  sizeof(dm->discover_params.start_handle));
+}
+
+static int cache_put(size_t *off, const void *data, size_t len)
+{
+	if (*off + len > sizeof(cache_buf)) {
+		return -ENOMEM;
+	}
+
+	memcpy(&cache_buf[*off], data, len);
+	*off += len;
+
+	return 0;
+}
+
+static int cache_put_uuid(size_t *off, const struct bt_uuid *uuid)
+{
+	int err = cache_put(off, &uuid->type, sizeof(uuid->type));
+
+	if (err) {
+		return err;
+	}
+
+	if (!cache_uuid_len(uuid->type)) {
+		return -EINVAL;
+	}
+
+	return cache_put(off, cache_uuid_val(uuid),
+			 cache_uuid_len(uuid->type));
+}
+
+static void cache_store(struct bt_gatt_dm *dm)
+{
+	struct cache_hdr hdr = {
+		.version = CACHE_VERSION,
+		.service_val_size = sizeof(struct bt_gatt_service_val),
+		.chrc_size = sizeof(struct bt_gatt_chrc),
+		.attr_cnt = sys_cpu_to_le16(dm->cur_attr_id),
+		.end_handle = sys_cpu_to_le16(dm->discover_params.end_handle),
+	};
+	char key[CACHE_KEY_LEN];
+	size_t off = 0;
+	int err;
+
+	memcpy(hdr.db_hash, dm->db_hash, sizeof(hdr.db_hash));
+	err = cache_put(&off, &hdr, sizeof(hdr));
+
+	for (size_t i = 0; !err && (i < dm->cur_attr_id); i++) {
+		const struct bt_gatt_dm_attr *attr = &dm->attrs[i];
+		struct bt_gatt_service_val *service_val =
+			bt_gatt_dm_attr_service_val(attr);
+		struct bt_gatt_chrc *chrc = bt_gatt_dm_attr_chrc_val(attr);
+		struct cache_attr cattr = {
+			.handle = sys_cpu_to_le16(attr->handle),
+			.perm = attr->perm,
+		};
+
+		err = cache_put(&off, &cattr, sizeof(cattr));
+		if (!err) {
+			err = cache_put_uuid(&off, attr->uuid);
+		}
+
+		/* The value is stored without the UUID pointer. */
+		if (!err && service_val) {
+			struct bt_gatt_service_val val = *service_val;
+
+			val.uuid = NULL;
+			err = cache_put(&off, &val, sizeof(val));
+			if (!err) {
+				err = cache_put_uuid(&off, service_val->uuid);
+			}
+		} else if (!err && chrc) {
+			struct bt_gatt_chrc val = *chrc;
+
+			val.uuid = NULL;
+			err = cache_put(&off, &val, sizeof(val));
+			if (!err) {
+				err = cache_put_uuid(&off, chrc->uuid);
+			}
+		}
+	}
+
+	if (err) {
+		LOG_WRN("Discovery not cached, too many attributes");
+		return;
+	}
+
+	cache_key(dm, key);
+	err = settings_save_one(key, cache_buf, off);
+	if (err) {
+		LOG_ERR("Cannot store discovery (err %d)", err);
+	} else {
+		LOG_DBG("Discovery stored, %zu bytes", off);
+	}
+}
+
+static const u8_t *cache_get(const u8_t *buf, size_t len, size_t *off,
+			     size_t size)
+{
+	const u8_t *data = &buf[*off];
+
+	if (*off + size > len) {
+		return NULL;
+	}
+
+	*off += size;
+
+	return data;
+}
+
+static int cache_get_uuid(const u8_t *buf, size_t len, size_t *off,
+			  struct bt_uuid_128 *uuid)
+{
+	const u8_t *type = cache_get(buf, len, off, sizeof(*type));
+	size_t uuid_len = type ? cache_uuid_len(*type) : 0;
+	const u8_t *val = cache_get(buf, len, off, uuid_len);
+
+	if (!uuid_len || !val) {
+		return -EINVAL;
+	}
+
+	uuid->uuid.type = *type;
+
+	switch (*type) {
+	case BT_UUID_TYPE_16:
+		memcpy(&BT_UUID_16(&uuid->uuid)->val, val, uuid_len);
+		break;
+	case BT_UUID_TYPE_32:
+		memcpy(&BT_UUID_32(&uuid->uuid)->val, val, uuid_len);
+		break;
+	default:
+		memcpy(uuid->val, val, uuid_len);
+		break;
+	}
+
+	return 0;
+}
+
+/* Walk a stored record. Attributes are stored in the instance only if
+ * store is set, so the record can be checked before anything is stored.
+ */
+static int cache_parse(struct bt_gatt_dm *dm, const u8_t *buf, size_t len,
+		       bool store)
+{
+	const struct cache_hdr *hdr = (const void *)buf;
+	size_t off = sizeof(*hdr);
+	size_t attr_cnt;
+
+	if (len < sizeof(*hdr)) {
+		return -EINVAL;
+	}
+
+	attr_cnt = sys_le16_to_cpu(hdr->attr_cnt);
+
+	if ((hdr->version != CACHE_VERSION) ||
+	    (hdr->service_val_size != sizeof(struct bt_gatt_service_val)) ||
+	    (hdr->chrc_size != sizeof(struct bt_gatt_chrc)) ||
+	    (attr_cnt == 0) || (attr_cnt > ARRAY_SIZE(dm->attrs))) {
+		return -EINVAL;
+	}
+
+	if (memcmp(hdr->db_hash, dm->db_hash, sizeof(hdr->db_hash))) {
+		LOG_DBG("Database Hash changed");
+		return -ESTALE;
+	}
+
+	for (size_t i = 0; i < attr_cnt; i++) {
+		const struct cache_attr *cattr;
+		struct bt_uuid_128 uuid;
+		struct bt_uuid_128 val_uuid;
+		struct bt_gatt_attr attr;
+		struct bt_gatt_dm_attr *cur_attr;
+		struct bt_gatt_service_val *service_val;
+		struct bt_gatt_chrc *chrc;
+		const void *val = NULL;
+		size_t val_size = 0;
+
+		cattr = (const void *)cache_get(buf, len, &off, sizeof(*cattr));
+		if (!cattr || cache_get_uuid(buf, len, &off, &uuid)) {
+			return -EINVAL;
+		}
+
+		if (!bt_uuid_cmp(&uuid.uuid, BT_UUID_GATT_PRIMARY) ||
+		    !bt_uuid_cmp(&uuid.uuid, BT_UUID_GATT_SECONDARY)) {
+			val_size = sizeof(struct bt_gatt_service_val);
+		} else if (!bt_uuid_cmp(&uuid.uuid, BT_UUID_GATT_CHRC)) {
+			val_size = sizeof(struct bt_gatt_chrc);
+		}
+
+		if (val_size) {
+			val = cache_get(buf, len, &off, val_size);
+			if (!val ||
+			    cache_get_uuid(buf, len, &off, &val_uuid)) {
+				return -EINVAL;
+			}
+		}
+
+		if (!store) {
+			continue;
+		}
+
+		memset(&attr, 0, sizeof(attr));
+		attr.uuid = &uuid.uuid;
+		attr.handle = sys_le16_to_cpu(cattr->handle);
+		attr.perm = cattr->perm;
+
+		cur_attr = attr_store(dm, &attr, val_size);
+		if (!cur_attr) {
+			return -ENOMEM;
+		}
+
+		service_val = bt_gatt_dm_attr_service_val(cur_attr);
+		chrc = bt_gatt_dm_attr_chrc_val(cur_attr);
+
+		if (service_val) {
+			memcpy(service_val, val, val_size);
+			service_val->uuid = uuid_store(dm, &val_uuid.uuid);
+			if (!service_val->uuid) {
+				return -ENOMEM;
+			}
+		} else if (chrc) {
+			memcpy(chrc, val, val_size);
+			chrc->uuid = uuid_store(dm, &val_uuid.uuid);
+			if (!chrc->uuid) {
+				return -ENOMEM;
+			}
+		}
+	}
+
+	if (off != len) {
+		return -EINVAL;
+	}
+
+	if (store) {
+		dm->discover_params.end_handle =
+			sys_le16_to_cpu(hdr->end_handle);
+	}
+
+	return 0;
+}
+
+static int cache_read_cb(const char *key, size_t len, settings_read_cb read_cb,
+			 void *cb_arg, void *param)
+{
+	ssize_t *read_len = param;
+
+	/* Only the record itself, not the keys below it */
+	if (settings_name_next(key, NULL) != 0) {
+		return 0;
+	}
+
+	*read_len = read_cb(cb_arg, cache_buf, sizeof(cache_buf));
+
+	return 0;
+}
+
+/* Loads the attributes from the cache if the peer database did not change. */
+static int cache_load(struct bt_gatt_dm *dm)
+{
+	char key[CACHE_KEY_LEN];
+	ssize_t len = 0;
+	int err;
+
+	cache_key(dm, key);
+	err = settings_load_subtree_direct(key, cache_read_cb, &len);
+	if (err) {
+		return err;
+	}
+
+	if (len <= 0) {
+		return -ENOENT;
+	}
+
+	err = cache_parse(dm, cache_buf, len, false);
+	if (err) {
+		return err;
+	}
+
+	return cache_parse(dm, cache_buf, len, true);
+}
+
+static int cache_clear_cb(const char *key, size_t len,
+			  settings_read_cb read_cb, void *cb_arg, void *param)
+{
+	char (*names)[CACHE_NAME_LEN] = param;
+
+	for (size_t i = 0; i < CACHE_CLEAR_BATCH; i++) {
+		if (!names[i][0]) {
+			strncpy(names[i], key, sizeof(names[i]) - 1);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int bt_gatt_dm_cache_clear(const bt_addr_le_t *addr)
+{
+	char peer_key[CACHE_KEY_LEN];
+	char key[CACHE_KEY_LEN + CACHE_NAME_LEN];
+	char names[CACHE_CLEAR_BATCH][CACHE_NAME_LEN];
+	size_t cnt;
+	int err;
+
+	if (!addr || !bt_addr_le_cmp(addr, BT_ADDR_LE_ANY)) {
+		strcpy(peer_key, "bt/dm");
+	} else {
+		cache_peer_key(addr, peer_key, sizeof(peer_key));
+	}
+
+	/* Keys cannot be deleted while the subtree is loaded. */
+	do {
+		memset(names, 0, sizeof(names));
+		err = settings_load_subtree_direct(peer_key, cache_clear_cb,
+						   names);
+		if (err) {
+			return err;
+		}
+
+		for (cnt = 0; (cnt < CACHE_CLEAR_BATCH) && names[cnt][0];
+		     cnt++) {
+			snprintf(key, sizeof(key), "%s/%s", peer_key,
+				 names[cnt]);
+			err = settings_delete(key);
+			if (err) {
+				return err;
+			}
+		}
+	} while (cnt == CACHE_CLEAR_BATCH);
+
+	return 0;
+}
+
+/* Records are read when a discovery starts, so nothing is loaded at boot.
+ * The handler keeps the "bt" handler from rejecting the records.
+ */
+static int cache_set(const char *key, size_t len, settings_read_cb read_cb,
+		     void *cb_arg)
+{
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(bt_gatt_dm, "bt/dm", NULL, cache_set, NULL,
+			       NULL);
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
 static void discovery_complete(struct bt_gatt_dm *dm)
 {
 	LOG_DBG("Discovery complete.");
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+	if (dm->db_hash_valid && !dm->cached) {
+		cache_store(dm);
+	}
+#endif
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	uuid_index_build(dm);
+#endif
 	atomic_set_bit(dm->state_flags, STATE_ATTRS_RELEASE_PENDING);
 	if (dm->callback->completed) {
 		dm->callback->completed(dm, dm->context);
@@ -499,7 +1190,21 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_char_by_uuid(
 	const struct bt_gatt_dm *dm,
 	const struct bt_uuid *uuid)
 {
-	const struct bt_gatt_dm_attr *curr = NULL;
+	return bt_gatt_dm_char_next_by_uuid(dm, NULL, uuid);
+}
+
+const struct bt_gatt_dm_attr *bt_gatt_dm_char_next_by_uuid(
+	const struct bt_gatt_dm *dm,
+	const struct bt_gatt_dm_attr *prev,
+	const struct bt_uuid *uuid)
+{
+	const struct bt_gatt_dm_attr *curr = prev;
+
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	if (dm->indexed) {
+		return uuid_index_char_find(dm, prev, uuid);
+	}
+#endif
 
 	while ((curr = bt_gatt_dm_char_next(dm, curr)) != NULL) {
 		struct bt_gatt_chrc *chrc = bt_gatt_dm_attr_chrc_val(curr);
@@ -546,6 +1251,12 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_desc_by_uuid(
 {
 	const struct bt_gatt_dm_attr *curr = attr_chrc;
 
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	if (dm->indexed && bt_gatt_dm_attr_chrc_val(attr_chrc)) {
+		return uuid_index_desc_find(dm, attr_chrc - dm->attrs, uuid);
+	}
+#endif
+
 	while ((curr = bt_gatt_dm_desc_next(dm, curr)) != NULL) {
 		if (!bt_uuid_cmp(uuid, curr->uuid)) {
 			break;
@@ -555,6 +1266,34 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_desc_by_uuid(
 	return curr;
 }
 
+int bt_gatt_dm_handles_assign(const struct bt_gatt_dm *dm,
+			      const struct bt_gatt_dm_handle_req *reqs,
+			      size_t cnt)
+{
+	int err = 0;
+
+	for (size_t i = 0; i < cnt; i++) {
+		const struct bt_gatt_dm_handle_req *req = &reqs[i];
+		const struct bt_gatt_dm_attr *attr;
+
+		attr = bt_gatt_dm_char_by_uuid(dm, req->uuid);
+		if (attr) {
+			attr = bt_gatt_dm_desc_by_uuid(dm, attr,
+				req->desc_uuid ? req->desc_uuid : req->uuid);
+		}
+
+		if (attr) {
+			*req->handle = attr->handle;
+		} else {
+			LOG_DBG("No attribute for request %zu", i);
+			*req->handle = 0;
+			err = -ENOENT;
+		}
+	}
+
+	return err;
+}
+
 const struct bt_gatt_dm_attr *bt_gatt_dm_desc_next(
 	const struct bt_gatt_dm *dm,
 	const struct bt_gatt_dm_attr *prev)
@@ -568,6 +1307,77 @@ const struct bt_gatt_dm_attr *bt_gatt_dm_desc_next(
 	return curr;
 }
 
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+static u8_t db_hash_read_cb(struct bt_conn *conn, u8_t err,
+			    struct bt_gatt_read_params *params,
+			    const void *data, u16_t length)
+{
+	struct bt_gatt_dm *dm = &bt_gatt_dm_inst;
+	int ret;
+
+	if (!err && data && (length == sizeof(dm->db_hash))) {
+		memcpy(dm->db_hash, data, sizeof(dm->db_hash));
+		dm->db_hash_valid = true;
+	} else {
+		LOG_DBG("No Database Hash (err %u), discovery not cached", err);
+	}
+
+	if (dm->db_hash_valid) {
+		ret = cache_load(dm);
+		if (!ret) {
+			LOG_DBG("Discovery loaded from cache");
+			dm->cached = true;
+			discovery_complete(dm);
+			return BT_GATT_ITER_STOP;
+		}
+
+		if (ret == -ENOMEM) {
+			discovery_complete_error(dm, ret);
+			return BT_GATT_ITER_STOP;
+		}
+	}
+
+	ret = bt_gatt_discover(dm->conn, &dm->discover_params);
+	if (ret) {
+		LOG_ERR("Discover failed, error: %d.", ret);
+		discovery_complete_error(dm, ret);
+	}
+
+	return BT_GATT_ITER_STOP;
+}
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
+/* Start the discovery set in dm->discover_params. The attributes of a bonded
+ * peer are loaded from the cache if its Database Hash is unchanged.
+ */
+static int discovery_start(struct bt_gatt_dm *dm)
+{
+#if defined(CONFIG_BT_GATT_DM_CACHE)
+	dm->db_hash_valid = false;
+	dm->cached = false;
+
+	if (cache_peer_bonded(dm->conn)) {
+		int err;
+
+		dm->cache_id = cache_id_get(dm);
+		dm->read_params.func = db_hash_read_cb;
+		dm->read_params.handle_count = 0;
+		dm->read_params.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+		dm->read_params.by_uuid.start_handle = 0x0001;
+		dm->read_params.by_uuid.end_handle = 0xffff;
+
+		err = bt_gatt_read(dm->conn, &dm->read_params);
+		if (!err) {
+			return 0;
+		}
+
+		LOG_WRN("Database Hash read failed (err %d)", err);
+	}
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
+	return bt_gatt_discover(dm->conn, &dm->discover_params);
+}
+
 int bt_gatt_dm_start(struct bt_conn *conn,
 		     const struct bt_uuid *svc_uuid,
 		     const struct bt_gatt_dm_cb *cb,
@@ -596,6 +1406,9 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 	dm->context = context;
 	dm->callback = cb;
 	dm->cur_attr_id = 0;
+#if defined(CONFIG_BT_GATT_DM_UUID_INDEX)
+	dm->indexed = false;
+#endif
 	sys_slist_init(&dm->chunk_list);
 	dm->cur_chunk_len = 0;
 
@@ -605,7 +1418,7 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 	dm->discover_params.end_handle = 0xffff;
 	dm->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
 
-	err = bt_gatt_discover(conn, &dm->discover_params);
+	err = discovery_start(dm);
 	if (err) {
 		LOG_ERR("Discover failed, error: %d.", err);
 		atomic_clear_bit(dm->state_flags, STATE_ATTRS_LOCKED);
@@ -646,7 +1459,7 @@ int bt_gatt_dm_continue(struct bt_gatt_dm *dm, void *context)
 	dm->discover_params.end_handle = 0xffff;
 	dm->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
 
-	err = bt_gatt_discover(dm->conn, &dm->discover_params);
+	err = discovery_start(dm);
 	if (err) {
 		LOG_ERR("Discover failed, error: %d.", err);
 		atomic_clear_bit(dm->state_flags, STATE_ATTRS_LOCKED);
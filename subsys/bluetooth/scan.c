@@ -21,6 +21,22 @@ LOG_MODULE_REGISTER(nrf_bt_scan, CONFIG_BT_SCAN_LOG_LEVEL);
 /* Scan filter add mutex. */
 K_MUTEX_DEFINE(scan_add_mutex);
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+BUILD_ASSERT_MSG((CONFIG_BT_SCAN_FILTER_INDEX_BITS &
+		  (CONFIG_BT_SCAN_FILTER_INDEX_BITS - 1)) == 0,
+		 "Filter index size must be a power of two");
+
+#define INDEX_WORDS (CONFIG_BT_SCAN_FILTER_INDEX_BITS / 32)
+
+/* Bloom filter over the values of one filter type. A clear bit proves that
+ * the value is not among the filters, so most advertising reports are
+ * rejected without comparing them against every filter.
+ */
+struct bt_scan_filter_index {
+	u32_t bits[INDEX_WORDS];
+};
+#endif /* CONFIG_BT_SCAN_FILTER_INDEX */
+
 /* Scanning control structure used to
  * compare matching filters, their mode and event generation.
  */
@@ -89,6 +105,11 @@ struct bt_scan_addr_filter {
 	/* Addresses advertised by the peripherals. */
 	bt_addr_le_t target_addr[CONFIG_BT_SCAN_ADDRESS_CNT];
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	/* Index of the addresses. */
+	struct bt_scan_filter_index index;
+#endif
+
 	/* Address filter counter. */
 	u8_t cnt;
 
@@ -120,6 +141,11 @@ struct bt_scan_uuid_filter {
 	 */
 	struct bt_scan_uuid uuid[CONFIG_BT_SCAN_UUID_CNT];
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	/* Index of the UUID values. */
+	struct bt_scan_filter_index index;
+#endif
+
 	/* UUID filter counter. */
 	u8_t cnt;
 
@@ -155,6 +181,14 @@ struct bt_scan_manufacturer_data_filter {
 		u8_t data_len;
 	} manufacturer_data[CONFIG_BT_SCAN_MANUFACTURER_DATA_CNT];
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	/* Index of the first index_len bytes of the manufacturer data,
+	 * where index_len is the length of the shortest filter.
+	 */
+	struct bt_scan_filter_index index;
+	u8_t index_len;
+#endif
+
 	/* Name filter counter. */
 	u8_t cnt;
 
@@ -194,6 +228,9 @@ struct bt_scan_filters {
 	 * matched to generate an event.
 	 */
 	bool all_mode;
+
+	/* Number of enabled filter types. */
+	u8_t enabled_cnt;
 };
 
 /* Scan module instance. Options for the different scanning modes.
@@ -223,6 +260,40 @@ static struct bt_scan {
 
 } bt_scan;
 
+#if defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+/* Advertiser recently reported to the application. */
+struct bt_scan_dup_entry {
+	/* Address and advertising type of the report. Scan responses are
+	 * kept apart from the advertising data of the same device.
+	 */
+	bt_addr_le_t addr;
+	u8_t adv_type;
+
+	/* Set if the entry holds a report. */
+	bool used;
+
+	/* Number of reports suppressed since the last reported one. */
+	u16_t dup_cnt;
+
+	/* Sum of the RSSI of the suppressed reports. */
+	s32_t rssi_sum;
+
+	/* Hash of the reported advertising data. */
+	u32_t data_hash;
+
+	/* Uptime when the entry was last reported to the application. */
+	u32_t reported;
+
+	/* Sequence number of the last received report, to find the least
+	 * recently used entry.
+	 */
+	u32_t seen;
+};
+
+static struct bt_scan_dup_entry dup_cache[CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT];
+static u32_t dup_seq;
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
 static sys_slist_t callback_list;
 
 void bt_scan_cb_register(struct bt_scan_cb *cb)
@@ -313,6 +384,93 @@ static void scan_connect_with_target(struct bt_scan_control *control,
 	}
 }
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX) || \
+	defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+/* 32-bit FNV-1a. */
+static u32_t data_hash(const void *data, size_t len)
+{
+	const u8_t *byte = data;
+	u32_t hash = 2166136261U;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= byte[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+#endif
+
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+
+/* Two bits per value are taken from the two halves of the hash. */
+static void index_add(struct bt_scan_filter_index *index, u32_t hash)
+{
+	u32_t bit1 = hash % CONFIG_BT_SCAN_FILTER_INDEX_BITS;
+	u32_t bit2 = (hash >> 16) % CONFIG_BT_SCAN_FILTER_INDEX_BITS;
+
+	index->bits[bit1 / 32] |= BIT(bit1 % 32);
+	index->bits[bit2 / 32] |= BIT(bit2 % 32);
+}
+
+static bool index_test(const struct bt_scan_filter_index *index, u32_t hash)
+{
+	u32_t bit1 = hash % CONFIG_BT_SCAN_FILTER_INDEX_BITS;
+	u32_t bit2 = (hash >> 16) % CONFIG_BT_SCAN_FILTER_INDEX_BITS;
+
+	return (index->bits[bit1 / 32] & BIT(bit1 % 32)) &&
+	       (index->bits[bit2 / 32] & BIT(bit2 % 32));
+}
+
+/* UUIDs of different sizes compare equal when they have the same value,
+ * so the index is built from the value based on the Bluetooth Base UUID.
+ */
+static u32_t uuid_index_hash(const struct bt_uuid *uuid)
+{
+	static const u8_t base_uuid[12] = {
+		0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+		0x00, 0x10, 0x00, 0x00,
+	};
+	const u8_t *uuid_128;
+	u8_t value[sizeof(u32_t)];
+
+	switch (uuid->type) {
+	case BT_UUID_TYPE_16:
+		sys_put_le32(BT_UUID_16(uuid)->val, value);
+		break;
+
+	case BT_UUID_TYPE_32:
+		sys_put_le32(BT_UUID_32(uuid)->val, value);
+		break;
+
+	case BT_UUID_TYPE_128:
+		uuid_128 = BT_UUID_128(uuid)->val;
+
+		if (memcmp(uuid_128, base_uuid, sizeof(base_uuid)) != 0) {
+			return data_hash(uuid_128, BT_SCAN_UUID_128_SIZE);
+		}
+
+		memcpy(value, &uuid_128[sizeof(base_uuid)], sizeof(value));
+		break;
+
+	default:
+		return 0;
+	}
+
+	return data_hash(value, sizeof(value));
+}
+#endif /* CONFIG_BT_SCAN_FILTER_INDEX */
+
+static bool addr_index_test(const bt_addr_le_t *addr)
+{
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	return index_test(&bt_scan.scan_filters.addr.index,
+			  data_hash(addr, sizeof(*addr)));
+#else
+	return true;
+#endif
+}
+
 static bool adv_addr_compare(const bt_addr_le_t *target_addr,
 			     struct bt_scan_control *control)
 {
@@ -320,6 +478,10 @@ static bool adv_addr_compare(const bt_addr_le_t *target_addr,
 			bt_scan.scan_filters.addr.target_addr;
 	u8_t counter = bt_scan.scan_filters.addr.cnt;
 
+	if (!addr_index_test(target_addr)) {
+		return false;
+	}
+
 	for (size_t i = 0; i < counter; i++) {
 		if (bt_addr_le_cmp(target_addr, &addr[i]) == 0) {
 			control->filter_status.addr.addr = &addr[i];
@@ -372,6 +534,11 @@ static int scan_addr_filter_add(const bt_addr_le_t *target_addr)
 	/* Add target address to filter. */
 	bt_addr_le_copy(&addr_filter[counter], target_addr);
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	index_add(&bt_scan.scan_filters.addr.index,
+		  data_hash(target_addr, sizeof(*target_addr)));
+#endif
+
 	LOG_DBG("Filter set on address type %i",
 		addr_filter[counter].type);
 
@@ -571,27 +738,60 @@ static int scan_short_name_filter_add(const struct bt_scan_short_name *short_nam
 	return 0;
 }
 
-static bool find_uuid(const u8_t *data,
-		      u8_t data_len,
-		      u8_t uuid_type,
-		      const struct bt_scan_uuid *target_uuid)
+static u8_t uuid_len_get(u8_t uuid_type)
 {
-	u8_t uuid_len;
-
 	switch (uuid_type) {
 	case BT_UUID_TYPE_16:
-		uuid_len = sizeof(u16_t);
-		break;
+		return sizeof(u16_t);
 
 	case BT_UUID_TYPE_32:
-		uuid_len = sizeof(u32_t);
-		break;
+		return sizeof(u32_t);
 
 	case BT_UUID_TYPE_128:
-		uuid_len = BT_SCAN_UUID_128_SIZE * sizeof(u8_t);
-		break;
+		return BT_SCAN_UUID_128_SIZE * sizeof(u8_t);
 
 	default:
+		return 0;
+	}
+}
+
+/* Check if any of the advertised UUIDs can be among the filters. */
+static bool uuid_index_test(const u8_t *data, u8_t data_len, u8_t uuid_type)
+{
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	u8_t uuid_len = uuid_len_get(uuid_type);
+
+	if (uuid_len == 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i + uuid_len <= data_len; i += uuid_len) {
+		struct bt_uuid_128 uuid;
+
+		if (!bt_uuid_create(&uuid.uuid, &data[i], uuid_len)) {
+			return false;
+		}
+
+		if (index_test(&bt_scan.scan_filters.uuid.index,
+			       uuid_index_hash(&uuid.uuid))) {
+			return true;
+		}
+	}
+
+	return false;
+#else
+	return true;
+#endif
+}
+
+static bool find_uuid(const u8_t *data,
+		      u8_t data_len,
+		      u8_t uuid_type,
+		      const struct bt_scan_uuid *target_uuid)
+{
+	u8_t uuid_len = uuid_len_get(uuid_type);
+
+	if (uuid_len == 0) {
 		return false;
 	}
 
@@ -620,6 +820,12 @@ static bool adv_uuid_compare(const struct bt_data *data, u8_t uuid_type,
 	u8_t data_len = data->data_len;
 	u8_t uuid_match_cnt = 0;
 
+	/* No filter can match if none of the advertised UUIDs is indexed. */
+	if ((counter > 0) && !uuid_index_test(data->data, data_len, uuid_type)) {
+		control->filter_status.uuid.count = 0;
+		return false;
+	}
+
 	for (size_t i = 0; i < counter; i++) {
 
 		if (find_uuid(data->data, data_len, uuid_type,
@@ -724,6 +930,10 @@ static int scan_uuid_filter_add(struct bt_uuid *uuid)
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	index_add(&bt_scan.scan_filters.uuid.index, uuid_index_hash(uuid));
+#endif
+
 	bt_scan.scan_filters.uuid.cnt++;
 	LOG_DBG("Added filter on UUID type %x", uuid->type);
 
@@ -836,6 +1046,47 @@ static bool adv_manufacturer_data_cmp(const u8_t *data,
 	return true;
 }
 
+static bool manufacturer_data_index_test(const u8_t *data, u8_t data_len)
+{
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	const struct bt_scan_manufacturer_data_filter *md_filter =
+		&bt_scan.scan_filters.manufacturer_data;
+
+	/* Shorter than every filter. */
+	if (data_len < md_filter->index_len) {
+		return false;
+	}
+
+	return index_test(&md_filter->index,
+			  data_hash(data, md_filter->index_len));
+#else
+	return true;
+#endif
+}
+
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+static void manufacturer_data_index_build(void)
+{
+	struct bt_scan_manufacturer_data_filter *md_filter =
+		&bt_scan.scan_filters.manufacturer_data;
+	u8_t index_len = CONFIG_BT_SCAN_MANUFACTURER_DATA_MAX_LEN;
+
+	for (size_t i = 0; i < md_filter->cnt; i++) {
+		index_len = MIN(index_len,
+				md_filter->manufacturer_data[i].data_len);
+	}
+
+	memset(&md_filter->index, 0, sizeof(md_filter->index));
+	md_filter->index_len = index_len;
+
+	for (size_t i = 0; i < md_filter->cnt; i++) {
+		index_add(&md_filter->index,
+			  data_hash(md_filter->manufacturer_data[i].data,
+				     index_len));
+	}
+}
+#endif /* CONFIG_BT_SCAN_FILTER_INDEX */
+
 static bool adv_manufacturer_data_compare(const struct bt_data *data,
 					  struct bt_scan_control *control)
 {
@@ -843,6 +1094,10 @@ static bool adv_manufacturer_data_compare(const struct bt_data *data,
 		&bt_scan.scan_filters.manufacturer_data;
 	u8_t counter = bt_scan.scan_filters.manufacturer_data.cnt;
 
+	if (!manufacturer_data_index_test(data->data, data->data_len)) {
+		return false;
+	}
+
 	/* Compare the name found with the name filter. */
 	for (size_t i = 0; i < counter; i++) {
 		if (adv_manufacturer_data_cmp(data->data,
@@ -917,11 +1172,96 @@ static int scan_manufacturer_data_filter_add(const struct bt_scan_manufacturer_d
 
 	bt_scan.scan_filters.manufacturer_data.cnt++;
 
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	/* A shorter filter changes the indexed length, so rebuild. */
+	manufacturer_data_index_build();
+#endif
+
 	LOG_DBG("Adding filter on manufacturer data");
 
 	return 0;
 }
 
+static void duplicate_filter_clear(void)
+{
+#if defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+	memset(dup_cache, 0, sizeof(dup_cache));
+#endif
+}
+
+#if defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+static struct bt_scan_dup_entry *dup_entry_get(const bt_addr_le_t *addr,
+					       u8_t adv_type)
+{
+	struct bt_scan_dup_entry *lru = &dup_cache[0];
+
+	for (size_t i = 0; i < ARRAY_SIZE(dup_cache); i++) {
+		struct bt_scan_dup_entry *entry = &dup_cache[i];
+
+		if (!entry->used) {
+			lru = entry;
+			continue;
+		}
+
+		if ((entry->adv_type == adv_type) &&
+		    (bt_addr_le_cmp(&entry->addr, addr) == 0)) {
+			return entry;
+		}
+
+		if (lru->used && ((s32_t)(entry->seen - lru->seen) < 0)) {
+			lru = entry;
+		}
+	}
+
+	/* Replace the least recently used entry. */
+	memset(lru, 0, sizeof(*lru));
+	bt_addr_le_copy(&lru->addr, addr);
+	lru->adv_type = adv_type;
+
+	return lru;
+}
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+/* Check if the report repeats one that was reported within the duplicate
+ * filter timeout. If it does not, fill in the summary of the suppressed
+ * reports.
+ */
+static bool duplicate_check(const bt_addr_le_t *addr, u8_t adv_type,
+			    const struct net_buf_simple *ad,
+			    struct bt_scan_adv_info *adv_info)
+{
+#if defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+	struct bt_scan_dup_entry *entry = dup_entry_get(addr, adv_type);
+	u32_t hash = data_hash(ad->data, ad->len);
+	u32_t now = k_uptime_get_32();
+
+	entry->seen = ++dup_seq;
+
+	if (entry->used && (entry->data_hash == hash) &&
+	    ((now - entry->reported) <
+	     CONFIG_BT_SCAN_DUPLICATE_FILTER_TIMEOUT)) {
+		if (entry->dup_cnt < UINT16_MAX) {
+			entry->rssi_sum += adv_info->rssi;
+			entry->dup_cnt++;
+		}
+
+		return true;
+	}
+
+	adv_info->duplicate_cnt = entry->dup_cnt;
+	adv_info->rssi = (entry->rssi_sum + adv_info->rssi) /
+			 (entry->dup_cnt + 1);
+
+	entry->used = true;
+	entry->data_hash = hash;
+	entry->reported = now;
+	entry->rssi_sum = 0;
+	entry->dup_cnt = 0;
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+	return false;
+}
+
 static bool check_filter_mode(u8_t mode)
 {
 	return (mode & MODE_CHECK) != 0;
@@ -996,6 +1336,9 @@ int bt_scan_filter_add(enum bt_scan_filter_type type,
 		break;
 	}
 
+	/* Reports may match differently now. */
+	duplicate_filter_clear();
+
 	k_mutex_unlock(&scan_add_mutex);
 
 	return err;
@@ -1029,6 +1372,15 @@ void bt_scan_filter_remove_all(void)
 		&bt_scan.scan_filters.manufacturer_data;
 	manufacturer_data_filter->cnt = 0;
 
+	duplicate_filter_clear();
+
+#if defined(CONFIG_BT_SCAN_FILTER_INDEX)
+	memset(&addr_filter->index, 0, sizeof(addr_filter->index));
+	memset(&uuid_filter->index, 0, sizeof(uuid_filter->index));
+	memset(&manufacturer_data_filter->index, 0,
+	       sizeof(manufacturer_data_filter->index));
+#endif
+
 	k_mutex_unlock(&scan_add_mutex);
 }
 
@@ -1041,6 +1393,10 @@ void bt_scan_filter_disable(void)
 	bt_scan.scan_filters.uuid.enabled = false;
 	bt_scan.scan_filters.appearance.enabled = false;
 	bt_scan.scan_filters.manufacturer_data.enabled = false;
+
+	bt_scan.scan_filters.enabled_cnt = 0;
+
+	duplicate_filter_clear();
 }
 
 int bt_scan_filter_enable(u8_t mode, bool match_all)
@@ -1083,6 +1439,9 @@ int bt_scan_filter_enable(u8_t mode, bool match_all)
 	/* Select the filter mode. */
 	filters->all_mode = match_all;
 
+	/* Count the enabled filters once, not for every report. */
+	filters->enabled_cnt = popcount(mode & MODE_CHECK);
+
 	return 0;
 }
 
@@ -1120,6 +1479,7 @@ void bt_scan_init(const struct bt_scan_init_param *init)
 {
 	/* Disable all scanning filters. */
 	memset(&bt_scan.scan_filters, 0, sizeof(bt_scan.scan_filters));
+	duplicate_filter_clear();
 
 	/* If the pointer to the initialization structure exist,
 	 * use it to scan the configuration.
@@ -1154,35 +1514,6 @@ void bt_scan_update_init_conn_params(struct bt_le_conn_param *new_conn_param)
 	bt_scan.conn_param = *new_conn_param;
 }
 
-static void check_enabled_filters(struct bt_scan_control *control)
-{
-	control->filter_cnt = 0;
-
-	if (is_addr_filter_enabled()) {
-		control->filter_cnt++;
-	}
-
-	if (is_name_filter_enabled()) {
-		control->filter_cnt++;
-	}
-
-	if (is_short_name_filter_enabled()) {
-		control->filter_cnt++;
-	}
-
-	if (is_uuid_filter_enabled()) {
-		control->filter_cnt++;
-	}
-
-	if (is_appearance_filter_enabled()) {
-		control->filter_cnt++;
-	}
-
-	if (is_manufacturer_data_filter_enabled()) {
-		control->filter_cnt++;
-	}
-}
-
 static bool adv_data_found(struct bt_data *data, void *user_data)
 {
 	struct bt_scan_control *scan_control =
@@ -1233,21 +1564,25 @@ static bool adv_data_found(struct bt_data *data, void *user_data)
 	return true;
 }
 
-static void filter_state_check(struct bt_scan_control *control,
-			       const bt_addr_le_t *addr)
+static bool is_filter_matched(const struct bt_scan_control *control)
 {
-	if (control->all_mode &&
-	    (control->filter_match_cnt == control->filter_cnt)) {
-		notify_filter_matched(&control->device_info,
-				      &control->filter_status,
-				      control->connectable);
-		scan_connect_with_target(control, addr);
+	/* In the multifilter mode, the number of the active filters must equal
+	 * the number of the filters matched.
+	 */
+	if (control->all_mode) {
+		return control->filter_match_cnt == control->filter_cnt;
 	}
 
 	/* In the normal filter mode, only one filter match is
 	 * needed to generate the notification to the main application.
 	 */
-	else if ((!control->all_mode) && control->filter_match) {
+	return control->filter_match;
+}
+
+static void filter_state_check(struct bt_scan_control *control,
+			       const bt_addr_le_t *addr, bool match)
+{
+	if (match) {
 		notify_filter_matched(&control->device_info,
 				      &control->filter_status,
 				      control->connectable);
@@ -1266,9 +1601,11 @@ static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
 
 	memset(&scan_control, 0, sizeof(scan_control));
 
-	scan_control.all_mode = bt_scan.scan_filters.all_mode;
+	scan_control.device_info.adv_info.adv_type = type;
+	scan_control.device_info.adv_info.rssi = rssi;
 
-	check_enabled_filters(&scan_control);
+	scan_control.all_mode = bt_scan.scan_filters.all_mode;
+	scan_control.filter_cnt = bt_scan.scan_filters.enabled_cnt;
 
 	/* Check id device is connectable. */
 	if (type == BT_LE_ADV_IND ||
@@ -1279,24 +1616,37 @@ static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
 	/* Check the address filter. */
 	check_addr(&scan_control, addr);
 
-	/* Save advertising buffer state to transfer it
-	 * data to application if futher processing is needed.
+	/* In the multifilter mode, a device with a wrong address cannot
+	 * match, so its advertising data does not have to be parsed.
 	 */
-	net_buf_simple_save(ad, &state);
-	bt_data_parse(ad, adv_data_found, (void *)&scan_control);
-	net_buf_simple_restore(ad, &state);
+	if (!scan_control.all_mode || !is_addr_filter_enabled() ||
+	    scan_control.filter_status.addr.match) {
+		/* Save advertising buffer state to transfer it
+		 * data to application if futher processing is needed.
+		 */
+		net_buf_simple_save(ad, &state);
+		bt_data_parse(ad, adv_data_found, (void *)&scan_control);
+		net_buf_simple_restore(ad, &state);
+	}
+
+	bool match = is_filter_matched(&scan_control);
+
+	/* Drop reports that repeat a recent one. When filters are enabled,
+	 * only the matching devices are tracked, so that other devices
+	 * cannot evict them from the cache.
+	 */
+	if ((match || (scan_control.filter_cnt == 0)) &&
+	    duplicate_check(addr, type, ad,
+			    &scan_control.device_info.adv_info)) {
+		return;
+	}
 
 	scan_control.device_info.addr = addr;
 	scan_control.device_info.conn_param = &bt_scan.conn_param;
-	scan_control.device_info.adv_info.adv_type = type;
-	scan_control.device_info.adv_info.rssi = rssi;
 	scan_control.device_info.adv_data = ad;
 
-	/* In the multifilter mode, the number of the active filters must equal
-	 * the number of the filters matched to generate the notification.
-	 * If the event handler is not NULL, notify the main application.
-	 */
-	filter_state_check(&scan_control, addr);
+	/* If the event handler is not NULL, notify the main application. */
+	filter_state_check(&scan_control, addr, match);
 }
 
 int bt_scan_start(enum bt_scan_type scan_type)
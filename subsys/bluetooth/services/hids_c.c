@@ -204,39 +204,6 @@ static void repptr_array_free(struct bt_gatt_hids_c_rep_info **repp)
 	k_free(repp);
 }
 
-/**
- * @brief Get characteristic value handle by its UUID
- *
- * Function searches for characteristic with selected UUID
- * and then the value inside this characteristic.
- *
- * It is used only for required characteristic.
- *
- * @param dm     Discovery object.
- * @param hids_c HIDS client object.
- * @param uuid   UUID of the characteristic.
- *
- * @return Handle of the characteristic value of 0 if it cannot be found.
- */
-static u16_t chrc_value_handle_by_uuid(struct bt_gatt_dm *dm,
-				       struct bt_gatt_hids_c *hids_c,
-				       const struct bt_uuid *uuid)
-{
-	const struct bt_gatt_dm_attr *gatt_chrc;
-	const struct bt_gatt_dm_attr *gatt_desc;
-
-	gatt_chrc = bt_gatt_dm_char_by_uuid(dm, uuid);
-	if (!gatt_chrc) {
-		return 0;
-	}
-	gatt_desc = bt_gatt_dm_desc_by_uuid(dm, gatt_chrc, uuid);
-	if (!gatt_desc) {
-		LOG_ERR("No characteristic value found.");
-		return 0;
-	}
-	return gatt_desc->handle;
-}
-
 /**
  * @brief Mark hids ready to work
  *
@@ -595,7 +562,6 @@ static int handles_assign_internal(struct bt_gatt_dm *dm,
 	const struct bt_gatt_service_val *gatt_service =
 			bt_gatt_dm_attr_service_val(gatt_service_attr);
 	const struct bt_gatt_dm_attr *gatt_chrc;
-	u16_t handle;
 	bool boot_protocol_required;
 	int ret;
 
@@ -606,35 +572,35 @@ static int handles_assign_internal(struct bt_gatt_dm *dm,
 	}
 	LOG_DBG("Getting handles from HID service.");
 
-	/* Control Point Characteristic (Mandatory) */
-	handle = chrc_value_handle_by_uuid(dm, hids_c,
-					   BT_UUID_HIDS_CTRL_POINT);
-	if (handle == 0) {
-		LOG_ERR("Missing HIDS CP characteristic.");
-		return -EINVAL;
-	}
-	LOG_DBG("Found handle for HIDS CP characteristic: 0x%x.", handle);
-	hids_c->handlers.cp = handle;
-
-	/* HID Information Characteristic (Mandatory) */
-	handle = chrc_value_handle_by_uuid(dm, hids_c,
-					   BT_UUID_HIDS_INFO);
-	if (handle == 0) {
-		LOG_ERR("Missing HIDS Info characteristic.");
-		return -EINVAL;
-	}
-	LOG_DBG("Found handle for HIDS Info characteristic: 0x%x.", handle);
-	hids_c->handlers.info = handle;
-
-	/* HID Report Map Characteristic (Mandatory)  */
-	handle = chrc_value_handle_by_uuid(dm, hids_c,
-					   BT_UUID_HIDS_REPORT_MAP);
-	if (handle == 0) {
-		LOG_ERR("Missing Report Map characteristic.");
+	/* Control Point, HID Information and Report Map Characteristics
+	 * (Mandatory)
+	 */
+	const struct bt_gatt_dm_handle_req mandatory[] = {
+		{
+			.uuid = BT_UUID_HIDS_CTRL_POINT,
+			.handle = &hids_c->handlers.cp,
+		},
+		{
+			.uuid = BT_UUID_HIDS_INFO,
+			.handle = &hids_c->handlers.info,
+		},
+		{
+			.uuid = BT_UUID_HIDS_REPORT_MAP,
+			.handle = &hids_c->handlers.rep_map,
+		},
+	};
+
+	ret = bt_gatt_dm_handles_assign(dm, mandatory, ARRAY_SIZE(mandatory));
+	if (ret) {
+		LOG_ERR("Missing mandatory characteristic, CP: 0x%x, "
+			"Info: 0x%x, Report Map: 0x%x.",
+			hids_c->handlers.cp, hids_c->handlers.info,
+			hids_c->handlers.rep_map);
 		return -EINVAL;
 	}
-	LOG_DBG("Found handle for Report Map characteristic: 0x%x.", handle);
-	hids_c->handlers.rep_map = handle;
+	LOG_DBG("Found handles for CP: 0x%x, Info: 0x%x, Report Map: 0x%x.",
+		hids_c->handlers.cp, hids_c->handlers.info,
+		hids_c->handlers.rep_map);
 
 	/* If we have any of the boot report - protocol mode is mandatory,
 	 * otherwise optional, but it does not make any sense to keep it
@@ -690,15 +656,17 @@ static int handles_assign_internal(struct bt_gatt_dm *dm,
 
 	/* HID Protocol Mode (Optional) */
 	if (boot_protocol_required) {
+		const struct bt_gatt_dm_handle_req pm = {
+			.uuid = BT_UUID_HIDS_PROTOCOL_MODE,
+			.handle = &hids_c->handlers.pm,
+		};
+
 		LOG_DBG("HIDS Protocol Mode characteristic required.");
-		handle = chrc_value_handle_by_uuid(dm, hids_c,
-						   BT_UUID_HIDS_PROTOCOL_MODE);
-		if (handle == 0) {
+		if (bt_gatt_dm_handles_assign(dm, &pm, 1)) {
 			LOG_ERR("Missing Protocol Mode characteristic.");
 			return -EINVAL;
 		}
 		LOG_DBG("Found handle for Protocol Mode characteristic.");
-		hids_c->handlers.pm = handle;
 	} else {
 		LOG_DBG("HIDS Protocol Mode characteristic ignored.");
 		hids_c->handlers.pm = 0;
@@ -708,12 +676,9 @@ static int handles_assign_internal(struct bt_gatt_dm *dm,
 	size_t rep_cnt = 0;
 
 	gatt_chrc = NULL;
-	while (NULL != (gatt_chrc = bt_gatt_dm_char_next(dm, gatt_chrc))) {
-		struct bt_gatt_chrc *chrc_val =
-				bt_gatt_dm_attr_chrc_val(gatt_chrc);
-		if (!bt_uuid_cmp(chrc_val->uuid, BT_UUID_HIDS_REPORT)) {
-			++rep_cnt;
-		}
+	while (NULL != (gatt_chrc = bt_gatt_dm_char_next_by_uuid(dm, gatt_chrc,
+						BT_UUID_HIDS_REPORT))) {
+		++rep_cnt;
 	}
 	LOG_DBG("%u report(s) found", rep_cnt);
 	if (rep_cnt > UINT8_MAX) {
@@ -731,22 +696,19 @@ static int handles_assign_internal(struct bt_gatt_dm *dm,
 	/* Process all the records */
 	rep_cnt = 0;
 	gatt_chrc = NULL;
-	while (NULL != (gatt_chrc = bt_gatt_dm_char_next(dm, gatt_chrc))) {
-		struct bt_gatt_chrc *chrc_val =
-				bt_gatt_dm_attr_chrc_val(gatt_chrc);
-		if (!bt_uuid_cmp(chrc_val->uuid, BT_UUID_HIDS_REPORT)) {
-			LOG_DBG("Creating report at index %u, handle: 0x%.4x",
-				rep_cnt, gatt_chrc->handle);
-			ret = rep_new(hids_c,
-				      &(hids_c->rep_info[rep_cnt]),
-				      dm,
-				      gatt_chrc);
-			if (ret) {
-				LOG_ERR("Cannot create report, error: %d", ret);
-				return ret;
-			}
-			++rep_cnt;
+	while (NULL != (gatt_chrc = bt_gatt_dm_char_next_by_uuid(dm, gatt_chrc,
+						BT_UUID_HIDS_REPORT))) {
+		LOG_DBG("Creating report at index %u, handle: 0x%.4x",
+			rep_cnt, gatt_chrc->handle);
+		ret = rep_new(hids_c,
+			      &(hids_c->rep_info[rep_cnt]),
+			      dm,
+			      gatt_chrc);
+		if (ret) {
+			LOG_ERR("Cannot create report, error: %d", ret);
+			return ret;
 		}
+		++rep_cnt;
 	}
 
 	LOG_DBG("Report memory allocated, entities used: %u",
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/** @file dfu_target_mcuboot_delta.h
+ *
+ * @defgroup dfu_target_mcuboot_delta MCUBoot delta DFU Target
+ * @{
+ * @brief DFU Target for MCUBoot upgrades received as a delta against the
+ *	  running image.
+ *
+ * The delta file starts with a header, followed by a sequence of operations
+ * that reconstruct the new image. All values are little-endian.
+ *
+ * Header:
+ *  - u32 magic (DFU_TARGET_MCUBOOT_DELTA_MAGIC)
+ *  - u32 size of the source image (the image in the primary slot)
+ *  - u32 size of the new image
+ *  - u8[32] SHA-256 hash of the source image
+ *
+ * Operations:
+ *  - DELTA_OP_COPY (0x01), u32 offset, u32 length: copy from the source image.
+ *  - DELTA_OP_INSERT (0x02), u32 length, followed by length bytes of data.
+ *
+ * The delta file is generated by scripts/bootloader/delta.py.
+ */
+
+#ifndef DFU_TARGET_MCUBOOT_DELTA_H__
+#define DFU_TARGET_MCUBOOT_DELTA_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic word at the beginning of a delta file, "NDLT". */
+#define DFU_TARGET_MCUBOOT_DELTA_MAGIC 0x544c444e
+
+/**
+ * @brief See if data in buf indicates a delta upgrade.
+ *
+ * @retval true if data matches, false otherwise.
+ */
+bool dfu_target_mcuboot_delta_identify(const void *const buf);
+
+/**
+ * @brief Initialize dfu target, perform steps necessary to receive firmware.
+ *
+ * A partially reconstructed image cannot be resumed after a reset, because
+ * the decoder state is kept in RAM. The progress of the MCUBoot target is
+ * discarded in that case.
+ *
+ * @param[in] file_size Size of the delta file being downloaded.
+ * @param[in] cb Callback for signaling events(unused).
+ *
+ * @retval 0 If successful, negative errno otherwise.
+ */
+int dfu_target_mcuboot_delta_init(size_t file_size, dfu_target_callback_t cb);
+
+/**
+ * @brief Get offset of the delta file.
+ *
+ * @param[out] offset Returns the number of bytes of the delta file that have
+ *		      been processed.
+ *
+ * @return 0 if success, otherwise negative value if unable to get the offset
+ */
+int dfu_target_mcuboot_delta_offset_get(size_t *offset);
+
+/**
+ * @brief Write delta data.
+ *
+ * The new image is reconstructed while the delta is received, and written to
+ * the secondary slot through the MCUBoot target.
+ *
+ * @param[in] buf Pointer to data that should be written.
+ * @param[in] len Length of data to write.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+int dfu_target_mcuboot_delta_write(const void *const buf, size_t len);
+
+/**
+ * @brief Deinitialize resources and finalize firmware upgrade if successful.
+ *
+ * @param[in] successful Indicate whether the firmware was successfully
+ *			 received.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+int dfu_target_mcuboot_delta_done(bool successful);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DFU_TARGET_MCUBOOT_DELTA_H__ */
+
+/**@} */
@@ -7,6 +7,10 @@
 #include <logging/log.h>
 #include <dfu/mcuboot.h>
 #include <dfu/dfu_target.h>
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+#include <tinycrypt/sha256.h>
+#include <tinycrypt/constants.h>
+#endif
 
 #define DEF_DFU_TARGET(name) \
 static const struct dfu_target dfu_target_ ## name  = { \
@@ -24,6 +28,10 @@ DEF_DFU_TARGET(modem);
 #include "dfu_target_mcuboot.h"
 DEF_DFU_TARGET(mcuboot);
 #endif
+#ifdef CONFIG_DFU_TARGET_MCUBOOT_DELTA
+#include "dfu_target_mcuboot_delta.h"
+DEF_DFU_TARGET(mcuboot_delta);
+#endif
 
 #define MIN_SIZE_IDENTIFY_BUF 32
 
@@ -31,6 +39,47 @@ LOG_MODULE_REGISTER(dfu_target, CONFIG_DFU_TARGET_LOG_LEVEL);
 
 static const struct dfu_target *current_target;
 
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+static struct tc_sha256_state_struct hash_ctx;
+/* Number of bytes covered by hash_ctx */
+static size_t hash_len;
+/* Whether hash_ctx covers all data written to the target */
+static bool hash_valid;
+
+/**
+ * @brief Start or continue hashing, depending on the offset of the target.
+ *
+ * The hash state is kept in RAM only, so an image resumed from a non-zero
+ * offset after a reset has no hash.
+ *
+ * @param[in] resumed Whether the target was already initialized.
+ */
+static void hash_sync(bool resumed)
+{
+	size_t offset;
+
+	if (current_target->offset_get(&offset) != 0) {
+		hash_valid = false;
+	} else if (offset == 0) {
+		hash_valid = (tc_sha256_init(&hash_ctx) == TC_CRYPTO_SUCCESS);
+		hash_len = 0;
+	} else if (!resumed || !hash_valid || offset != hash_len) {
+		LOG_WRN("Resuming at offset %d, image hash not available",
+			offset);
+		hash_valid = false;
+	}
+}
+
+static void hash_update(const void *const buf, size_t len)
+{
+	if (hash_valid) {
+		hash_valid = (tc_sha256_update(&hash_ctx, buf, len) ==
+			      TC_CRYPTO_SUCCESS);
+		hash_len += len;
+	}
+}
+#endif /* CONFIG_DFU_TARGET_STREAM_HASH */
+
 int dfu_target_img_type(const void *const buf, size_t len)
 {
 #ifdef CONFIG_DFU_TARGET_MCUBOOT
@@ -38,6 +87,11 @@ int dfu_target_img_type(const void *const buf, size_t len)
 		return DFU_TARGET_IMAGE_TYPE_MCUBOOT;
 	}
 #endif
+#ifdef CONFIG_DFU_TARGET_MCUBOOT_DELTA
+	if (dfu_target_mcuboot_delta_identify(buf)) {
+		return DFU_TARGET_IMAGE_TYPE_MCUBOOT_DELTA;
+	}
+#endif
 #ifdef CONFIG_DFU_TARGET_MODEM
 	if (dfu_target_modem_identify(buf)) {
 		return DFU_TARGET_IMAGE_TYPE_MODEM_DELTA;
@@ -60,6 +114,11 @@ int dfu_target_init(int img_type, size_t file_size, dfu_target_callback_t cb)
 		new_target = &dfu_target_mcuboot;
 	}
 #endif
+#ifdef CONFIG_DFU_TARGET_MCUBOOT_DELTA
+	if (img_type == DFU_TARGET_IMAGE_TYPE_MCUBOOT_DELTA) {
+		new_target = &dfu_target_mcuboot_delta;
+	}
+#endif
 #ifdef CONFIG_DFU_TARGET_MODEM
 	if (img_type == DFU_TARGET_IMAGE_TYPE_MODEM_DELTA) {
 		new_target = &dfu_target_modem;
@@ -77,12 +136,23 @@ int dfu_target_init(int img_type, size_t file_size, dfu_target_callback_t cb)
 	 */
 	if (new_target == current_target
 	   && img_type != DFU_TARGET_IMAGE_TYPE_MODEM_DELTA) {
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+		hash_sync(true);
+#endif
 		return 0;
 	}
 
 	current_target = new_target;
 
-	return current_target->init(file_size, cb);
+	int err = current_target->init(file_size, cb);
+
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+	if (err == 0) {
+		hash_sync(false);
+	}
+#endif
+
+	return err;
 }
 
 int dfu_target_offset_get(size_t *offset)
@@ -100,7 +170,19 @@ int dfu_target_write(const void *const buf, size_t len)
 		return -EACCES;
 	}
 
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+	int err = current_target->write(buf, len);
+
+	if (err == 0) {
+		hash_update(buf, len);
+	} else {
+		hash_valid = false;
+	}
+
+	return err;
+#else
 	return current_target->write(buf, len);
+#endif
 }
 
 int dfu_target_done(bool successful)
@@ -123,3 +205,26 @@ int dfu_target_done(bool successful)
 
 	return 0;
 }
+
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+int dfu_target_hash_get(u8_t *hash)
+{
+	struct tc_sha256_state_struct ctx;
+
+	if (hash == NULL) {
+		return -EINVAL;
+	}
+
+	if (!hash_valid) {
+		return -ENODATA;
+	}
+
+	/* Finalize a copy, so that hashing can continue */
+	ctx = hash_ctx;
+	if (tc_sha256_final(hash, &ctx) != TC_CRYPTO_SUCCESS) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+#endif
@@ -32,6 +32,10 @@ LOG_MODULE_REGISTER(dfu_target_mcuboot, CONFIG_DFU_TARGET_LOG_LEVEL);
 
 static struct flash_img_context flash_img;
 
+/* Write progress stored by the last checkpoint */
+static size_t checkpoint_offset;
+static s64_t checkpoint_time;
+
 int dfu_ctx_mcuboot_set_b1_file(const char *file, bool s0_active,
 				const char **update)
 {
@@ -84,11 +88,46 @@ static int store_flash_img_context(void)
 			LOG_ERR("Problem storing offset (err %d)", err);
 			return err;
 		}
+
+		checkpoint_offset = flash_img.bytes_written;
+		checkpoint_time = k_uptime_get();
 	}
 
 	return 0;
 }
 
+/**
+ * @brief Check if the write progress should be stored, according to the
+ *	  configured checkpoint policy.
+ */
+static bool checkpoint_due(void)
+{
+	size_t written = flash_img.bytes_written;
+
+	if (!IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS)) {
+		return false;
+	}
+
+	/* Progress only changes when the image buffer is written to flash */
+	if (written == checkpoint_offset) {
+		return false;
+	}
+
+	if (written < checkpoint_offset) {
+		return true;
+	}
+
+#if defined(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_BYTES)
+	return (written - checkpoint_offset) >=
+	       CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_BYTES_INTERVAL;
+#elif defined(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_TIME)
+	return (k_uptime_get() - checkpoint_time) >=
+	       CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_TIME_INTERVAL;
+#else
+	return true;
+#endif
+}
+
 /**
  * @brief Function used by settings_load() to restore the flash_img variable.
  *	  See the Zephyr documentation of the settings subsystem for more
@@ -155,6 +194,9 @@ int dfu_target_mcuboot_init(size_t file_size, dfu_target_callback_t cb)
 			LOG_ERR("Cannot load settings (err %d)", err);
 			return err;
 		}
+
+		checkpoint_offset = flash_img.bytes_written;
+		checkpoint_time = k_uptime_get();
 	}
 
 	return 0;
@@ -175,6 +217,10 @@ int dfu_target_mcuboot_write(const void *const buf, size_t len)
 		return err;
 	}
 
+	if (!checkpoint_due()) {
+		return 0;
+	}
+
 	err = store_flash_img_context();
 	if (err != 0) {
 		/* Failing to store progress is not a critical error you'll just
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <pm_config.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <storage/flash_map.h>
+#include <dfu/dfu_target.h>
+#include <tinycrypt/sha256.h>
+#include <tinycrypt/constants.h>
+
+#include "dfu_target_mcuboot.h"
+#include "dfu_target_mcuboot_delta.h"
+
+LOG_MODULE_REGISTER(dfu_target_mcuboot_delta, CONFIG_DFU_TARGET_LOG_LEVEL);
+
+#define DELTA_OP_COPY	0x01
+#define DELTA_OP_INSERT	0x02
+
+#define DELTA_HASH_LEN	32
+
+struct __packed delta_header {
+	u32_t magic;
+	u32_t source_size;
+	u32_t target_size;
+	u8_t source_hash[DELTA_HASH_LEN];
+};
+
+struct __packed delta_op {
+	u8_t type;
+	u32_t arg[2];
+};
+
+enum delta_state {
+	DELTA_STATE_HEADER,
+	DELTA_STATE_OP,
+	DELTA_STATE_INSERT,
+	DELTA_STATE_END,
+};
+
+static struct {
+	enum delta_state state;
+	/* Header or operation being received */
+	union {
+		struct delta_header hdr;
+		struct delta_op op;
+		u8_t raw[sizeof(struct delta_header)];
+	} buf;
+	size_t buf_len;
+	/* Bytes of data left in the current insert operation */
+	size_t insert_left;
+	/* Bytes of the delta file processed */
+	size_t in_offset;
+	/* Bytes of the new image written */
+	size_t out_offset;
+	size_t source_size;
+	size_t target_size;
+} delta;
+
+static const struct flash_area *source_fa;
+
+/* Buffer for copying from the source image */
+static u8_t copy_buf[CONFIG_DFU_TARGET_MCUBOOT_DELTA_COPY_BUF_SIZE];
+
+static void delta_reset(void)
+{
+	memset(&delta, 0, sizeof(delta));
+	delta.state = DELTA_STATE_HEADER;
+}
+
+static size_t op_len(u8_t type)
+{
+	switch (type) {
+	case DELTA_OP_COPY:
+		return 1 + 2 * sizeof(u32_t);
+	case DELTA_OP_INSERT:
+		return 1 + sizeof(u32_t);
+	default:
+		return 0;
+	}
+}
+
+static int source_hash_check(const u8_t *expected)
+{
+	struct tc_sha256_state_struct sha;
+	u8_t hash[DELTA_HASH_LEN];
+	int err;
+
+	if (tc_sha256_init(&sha) != TC_CRYPTO_SUCCESS) {
+		return -EINVAL;
+	}
+
+	for (size_t off = 0; off < delta.source_size; off += sizeof(copy_buf)) {
+		size_t len = MIN(sizeof(copy_buf), delta.source_size - off);
+
+		err = flash_area_read(source_fa, off, copy_buf, len);
+		if (err) {
+			LOG_ERR("flash_area_read error %d", err);
+			return err;
+		}
+
+		if (tc_sha256_update(&sha, copy_buf, len) !=
+		    TC_CRYPTO_SUCCESS) {
+			return -EINVAL;
+		}
+	}
+
+	if (tc_sha256_final(hash, &sha) != TC_CRYPTO_SUCCESS) {
+		return -EINVAL;
+	}
+
+	if (memcmp(hash, expected, sizeof(hash))) {
+		LOG_ERR("Delta does not apply to the running image");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int header_process(void)
+{
+	const struct delta_header *hdr = &delta.buf.hdr;
+
+	if (sys_le32_to_cpu(hdr->magic) != DFU_TARGET_MCUBOOT_DELTA_MAGIC) {
+		LOG_ERR("Invalid delta magic");
+		return -EINVAL;
+	}
+
+	delta.source_size = sys_le32_to_cpu(hdr->source_size);
+	delta.target_size = sys_le32_to_cpu(hdr->target_size);
+
+	if (delta.source_size > source_fa->fa_size) {
+		LOG_ERR("Delta source too big %zu > 0x%x", delta.source_size,
+			source_fa->fa_size);
+		return -EFBIG;
+	}
+
+	if (delta.target_size > PM_MCUBOOT_SECONDARY_SIZE) {
+		LOG_ERR("Requested file too big to fit in flash %zu > 0x%x",
+			delta.target_size, PM_MCUBOOT_SECONDARY_SIZE);
+		return -EFBIG;
+	}
+
+	LOG_INF("Delta from %zu to %zu bytes", delta.source_size,
+		delta.target_size);
+
+	return source_hash_check(hdr->source_hash);
+}
+
+static int copy_process(size_t off, size_t len)
+{
+	int err;
+
+	if ((off > delta.source_size) || (len > delta.source_size - off)) {
+		LOG_ERR("Copy outside of the source image");
+		return -EINVAL;
+	}
+
+	while (len > 0) {
+		size_t chunk = MIN(len, sizeof(copy_buf));
+
+		err = flash_area_read(source_fa, off, copy_buf, chunk);
+		if (err) {
+			LOG_ERR("flash_area_read error %d", err);
+			return err;
+		}
+
+		err = dfu_target_mcuboot_write(copy_buf, chunk);
+		if (err) {
+			return err;
+		}
+
+		off += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static int op_process(void)
+{
+	const struct delta_op *op = &delta.buf.op;
+	size_t len;
+	int err;
+
+	/* Length is the last argument of both operations */
+	if (op->type == DELTA_OP_COPY) {
+		len = sys_le32_to_cpu(op->arg[1]);
+	} else {
+		len = sys_le32_to_cpu(op->arg[0]);
+	}
+
+	if (len > delta.target_size - delta.out_offset) {
+		LOG_ERR("Operation exceeds the image size");
+		return -EINVAL;
+	}
+
+	if (op->type == DELTA_OP_COPY) {
+		err = copy_process(sys_le32_to_cpu(op->arg[0]), len);
+		if (err) {
+			return err;
+		}
+		delta.out_offset += len;
+	} else if (len > 0) {
+		delta.insert_left = len;
+		delta.state = DELTA_STATE_INSERT;
+	}
+
+	return 0;
+}
+
+static void state_next(void)
+{
+	delta.buf_len = 0;
+	if (delta.state != DELTA_STATE_INSERT) {
+		delta.state = (delta.out_offset == delta.target_size) ?
+			      DELTA_STATE_END : DELTA_STATE_OP;
+	}
+}
+
+/* Returns the number of bytes consumed, or a negative error code. */
+static int delta_feed(const u8_t *buf, size_t len)
+{
+	size_t needed;
+	size_t chunk;
+	int err;
+
+	switch (delta.state) {
+	case DELTA_STATE_HEADER:
+		needed = sizeof(struct delta_header);
+		break;
+	case DELTA_STATE_OP:
+		needed = op_len(delta.buf_len ? delta.buf.op.type : buf[0]);
+		if (needed == 0) {
+			LOG_ERR("Invalid delta operation 0x%02x", buf[0]);
+			return -EINVAL;
+		}
+		break;
+	case DELTA_STATE_INSERT:
+		chunk = MIN(len, delta.insert_left);
+		err = dfu_target_mcuboot_write(buf, chunk);
+		if (err) {
+			return err;
+		}
+		delta.insert_left -= chunk;
+		delta.out_offset += chunk;
+		if (delta.insert_left == 0) {
+			delta.state = DELTA_STATE_OP;
+			state_next();
+		}
+		return chunk;
+	default:
+		LOG_ERR("Data after the end of the delta");
+		return -EINVAL;
+	}
+
+	chunk = MIN(len, needed - delta.buf_len);
+	memcpy(&delta.buf.raw[delta.buf_len], buf, chunk);
+	delta.buf_len += chunk;
+
+	if (delta.buf_len < needed) {
+		return chunk;
+	}
+
+	err = (delta.state == DELTA_STATE_HEADER) ? header_process() :
+						    op_process();
+	if (err) {
+		return err;
+	}
+
+	state_next();
+
+	return chunk;
+}
+
+bool dfu_target_mcuboot_delta_identify(const void *const buf)
+{
+	return sys_get_le32(buf) == DFU_TARGET_MCUBOOT_DELTA_MAGIC;
+}
+
+int dfu_target_mcuboot_delta_init(size_t file_size, dfu_target_callback_t cb)
+{
+	size_t offset;
+	int err;
+
+	err = flash_area_open(PM_MCUBOOT_PRIMARY_ID, &source_fa);
+	if (err) {
+		LOG_ERR("Cannot open source flash area (err %d)", err);
+		return err;
+	}
+
+	err = dfu_target_mcuboot_init(0, cb);
+	if (err) {
+		return err;
+	}
+
+	/* The decoder state is lost on reset, so a partially reconstructed
+	 * image cannot be continued.
+	 */
+	err = dfu_target_mcuboot_offset_get(&offset);
+	if (!err && offset != 0) {
+		LOG_INF("Discarding partial image of %zu bytes", offset);
+		err = dfu_target_mcuboot_done(false);
+	}
+
+	delta_reset();
+
+	return err;
+}
+
+int dfu_target_mcuboot_delta_offset_get(size_t *out)
+{
+	*out = delta.in_offset;
+	return 0;
+}
+
+int dfu_target_mcuboot_delta_write(const void *const buf, size_t len)
+{
+	const u8_t *data = buf;
+	int ret;
+
+	while (len > 0) {
+		ret = delta_feed(data, len);
+		if (ret < 0) {
+			return ret;
+		}
+
+		data += ret;
+		len -= ret;
+		delta.in_offset += ret;
+	}
+
+	return 0;
+}
+
+int dfu_target_mcuboot_delta_done(bool successful)
+{
+	int err;
+
+	if (successful && (delta.state != DELTA_STATE_END)) {
+		LOG_ERR("Delta incomplete, %zu/%zu bytes reconstructed",
+			delta.out_offset, delta.target_size);
+		successful = false;
+		err = -EINVAL;
+	} else {
+		err = 0;
+	}
+
+	/* The MCUBoot target discards its progress in both cases */
+	delta_reset();
+
+	int done_err = dfu_target_mcuboot_done(successful);
+
+	return err ? err : done_err;
+}
@@ -5,9 +5,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <zephyr.h>
 #include <spinlock.h>
 #include <sys/slist.h>
+#include <sys/atomic.h>
 #include <event_manager.h>
 #include <logging/log.h>
 
@@ -17,28 +19,384 @@ LOG_MODULE_REGISTER(event_manager, CONFIG_DESKTOP_EVENT_MANAGER_LOG_LEVEL);
 static void event_processor_fn(struct k_work *work);
 
 
+/* Two additional IDs are used to trace the event execution. */
 #if CONFIG_DESKTOP_EVENT_MANAGER_PROFILER_ENABLED
-#define IDS_COUNT CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT
+#define IDS_COUNT (CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT + 2)
 #else
 #define IDS_COUNT 0
 #endif
 
 #ifdef CONFIG_SHELL
-extern u32_t event_manager_displayed_events;
+extern atomic_t event_manager_displayed_events[];
 #else
-static u32_t event_manager_displayed_events;
+static ATOMIC_DEFINE(event_manager_displayed_events,
+		     CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT);
 #endif
 
+struct event_queue {
+	sys_slist_t list;
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS
+	u32_t depth;
+	u32_t max_depth;
+	u32_t processed_cnt;
+	u32_t max_wait_time;
+	u64_t total_wait_time;
+#endif
+};
+
 static u16_t profiler_event_ids[IDS_COUNT];
 static K_WORK_DEFINE(event_processor, event_processor_fn);
-static sys_slist_t eventq = SYS_SLIST_STATIC_INIT(&eventq);
+static struct event_queue eventq[EVENT_DISPATCH_CLASS_COUNT];
 static struct k_spinlock lock;
 
+/* Order in which queues of dispatch classes are drained. */
+static const u8_t dispatch_order[] = {
+	EVENT_DISPATCH_CLASS_HIGH,
+	EVENT_DISPATCH_CLASS_NORMAL,
+	EVENT_DISPATCH_CLASS_LOW,
+};
+
+BUILD_ASSERT_MSG(ARRAY_SIZE(dispatch_order) == EVENT_DISPATCH_CLASS_COUNT,
+		 "Invalid dispatch order");
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD
+static void event_processor_high_fn(struct k_work *work);
+
+#define HIGH_PRIO_STACK_SIZE \
+	CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD_STACK_SIZE
+
+static K_THREAD_STACK_DEFINE(high_prio_stack, HIGH_PRIO_STACK_SIZE);
+static struct k_work_q high_prio_work_q;
+static K_WORK_DEFINE(event_processor_high, event_processor_high_fn);
+#endif
+
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL
+/* Free blocks hold a pointer to the next one, events start with a header. */
+#define POOL_BLOCK_ALIGN MAX(__alignof__(struct event_header), sizeof(void *))
+
+BUILD_ASSERT_MSG((CONFIG_DESKTOP_EVENT_MANAGER_POOL_SMALL_BLOCK_SIZE %
+		  POOL_BLOCK_ALIGN) == 0,
+		 "Small pool block size must be a multiple of "
+		 "the block alignment");
+BUILD_ASSERT_MSG((CONFIG_DESKTOP_EVENT_MANAGER_POOL_MEDIUM_BLOCK_SIZE %
+		  POOL_BLOCK_ALIGN) == 0,
+		 "Medium pool block size must be a multiple of "
+		 "the block alignment");
+BUILD_ASSERT_MSG((CONFIG_DESKTOP_EVENT_MANAGER_POOL_LARGE_BLOCK_SIZE %
+		  POOL_BLOCK_ALIGN) == 0,
+		 "Large pool block size must be a multiple of "
+		 "the block alignment");
+BUILD_ASSERT_MSG((CONFIG_DESKTOP_EVENT_MANAGER_POOL_SMALL_BLOCK_SIZE <
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_MEDIUM_BLOCK_SIZE) &&
+		 (CONFIG_DESKTOP_EVENT_MANAGER_POOL_MEDIUM_BLOCK_SIZE <
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_LARGE_BLOCK_SIZE),
+		 "Pool block sizes must be in ascending order");
+
+K_MEM_SLAB_DEFINE(event_pool_small,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_SMALL_BLOCK_SIZE,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_SMALL_BLOCK_COUNT,
+		  POOL_BLOCK_ALIGN);
+K_MEM_SLAB_DEFINE(event_pool_medium,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_MEDIUM_BLOCK_SIZE,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_MEDIUM_BLOCK_COUNT,
+		  POOL_BLOCK_ALIGN);
+K_MEM_SLAB_DEFINE(event_pool_large,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_LARGE_BLOCK_SIZE,
+		  CONFIG_DESKTOP_EVENT_MANAGER_POOL_LARGE_BLOCK_COUNT,
+		  POOL_BLOCK_ALIGN);
+
+struct event_pool {
+	struct k_mem_slab *slab;
+	u32_t max_used;
+};
+
+/* Pools must be sorted by block size. */
+static struct event_pool event_pools[] = {
+	{.slab = &event_pool_small},
+	{.slab = &event_pool_medium},
+	{.slab = &event_pool_large},
+};
+#endif /* CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL */
+
+static u32_t heap_alloc_cnt;
+
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_STATS
+#define HIST_BUCKET_CNT CONFIG_DESKTOP_EVENT_MANAGER_STATS_HIST_BUCKET_CNT
+#define EVENT_STATS_CNT CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT
+#define LISTENER_STATS_CNT CONFIG_DESKTOP_EVENT_MANAGER_STATS_MAX_LISTENER_CNT
+
+struct hist {
+	atomic_t bucket[HIST_BUCKET_CNT];
+};
+
+struct event_stats {
+	atomic_t submit_cnt;
+	struct hist wait_time;
+};
+
+struct listener_stats {
+	struct hist exec_time;
+};
+
+static struct event_stats event_stats[EVENT_STATS_CNT];
+static struct listener_stats listener_stats[LISTENER_STATS_CNT];
+static s64_t stats_reset_time;
+#endif /* CONFIG_DESKTOP_EVENT_MANAGER_STATS */
+
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL
+static void *pool_alloc(size_t size)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(event_pools); i++) {
+		struct event_pool *pool = &event_pools[i];
+		void *addr;
+
+		if (size > pool->slab->block_size) {
+			continue;
+		}
+
+		if (k_mem_slab_alloc(pool->slab, &addr, K_NO_WAIT)) {
+			continue;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&lock);
+		u32_t used = k_mem_slab_num_used_get(pool->slab);
+
+		if (used > pool->max_used) {
+			pool->max_used = used;
+		}
+		k_spin_unlock(&lock, key);
+
+		return addr;
+	}
+
+	return NULL;
+}
+
+static bool pool_free(void *addr)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(event_pools); i++) {
+		struct k_mem_slab *slab = event_pools[i].slab;
+		const char *start = slab->buffer;
+		const char *end = start + slab->block_size * slab->num_blocks;
+
+		if (((const char *)addr >= start) && ((const char *)addr < end)) {
+			k_mem_slab_free(slab, &addr);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int _event_manager_pool_stats_get(size_t idx,
+				  struct event_manager_pool_stats *stats)
+{
+	if (idx >= ARRAY_SIZE(event_pools)) {
+		return -ENOENT;
+	}
+
+	const struct event_pool *pool = &event_pools[idx];
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	stats->block_size = pool->slab->block_size;
+	stats->block_cnt = pool->slab->num_blocks;
+	stats->used = k_mem_slab_num_used_get(pool->slab);
+	stats->max_used = pool->max_used;
+
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+#else
+static void *pool_alloc(size_t size)
+{
+	return NULL;
+}
+
+static bool pool_free(void *addr)
+{
+	return false;
+}
+
+int _event_manager_pool_stats_get(size_t idx,
+				  struct event_manager_pool_stats *stats)
+{
+	return -ENOENT;
+}
+#endif /* CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL */
+
+u32_t _event_manager_heap_alloc_cnt_get(void)
+{
+	return heap_alloc_cnt;
+}
+
+void *event_manager_alloc(size_t size)
+{
+	void *event;
+
+	if (IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL)) {
+		event = pool_alloc(size);
+
+		if (!event &&
+		    IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_POOL_HEAP_FALLBACK)) {
+			event = k_malloc(size);
+
+			if (event) {
+				k_spinlock_key_t key = k_spin_lock(&lock);
+
+				heap_alloc_cnt++;
+				k_spin_unlock(&lock, key);
+			}
+		}
+	} else {
+		event = k_malloc(size);
+	}
+
+	if (unlikely(!event)) {
+		printk("Event Manager OOM error\n");
+		LOG_PANIC();
+		__ASSERT_NO_MSG(false);
+		sys_reboot(SYS_REBOOT_WARM);
+		return NULL;
+	}
+
+	return event;
+}
+
+void event_manager_free(void *addr)
+{
+	if (!pool_free(addr)) {
+		k_free(addr);
+	}
+}
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_STATS
+static void hist_add(struct hist *hist, u32_t cycles)
+{
+	size_t idx = (cycles == 0) ? 0 : (32 - __builtin_clz(cycles));
+
+	atomic_inc(&hist->bucket[MIN(idx, HIST_BUCKET_CNT - 1)]);
+}
+
+static void hist_copy(struct event_manager_hist *dst, struct hist *src)
+{
+	BUILD_ASSERT_MSG(ARRAY_SIZE(dst->bucket) == ARRAY_SIZE(src->bucket),
+			 "Histogram size mismatch");
+
+	for (size_t i = 0; i < ARRAY_SIZE(src->bucket); i++) {
+		dst->bucket[i] = atomic_get(&src->bucket[i]);
+	}
+}
+
+static void stats_submit_record(const struct event_header *eh)
+{
+	atomic_inc(&event_stats[eh->type_id - __start_event_types].submit_cnt);
+}
+
+static void stats_wait_time_record(const struct event_header *eh)
+{
+	hist_add(&event_stats[eh->type_id - __start_event_types].wait_time,
+		 k_cycle_get_32() - eh->timestamp);
+}
+
+static u32_t stats_exec_start(void)
+{
+	return k_cycle_get_32();
+}
+
+static void stats_exec_time_record(const struct event_listener *el,
+				   u32_t start)
+{
+	hist_add(&listener_stats[el - __start_event_listeners].exec_time,
+		 k_cycle_get_32() - start);
+}
+
+int _event_manager_event_stats_get(size_t idx,
+				   struct event_manager_event_stats *stats)
+{
+	if (idx >= __stop_event_types - __start_event_types) {
+		return -ENOENT;
+	}
+
+	stats->submit_cnt = atomic_get(&event_stats[idx].submit_cnt);
+	hist_copy(&stats->wait_time, &event_stats[idx].wait_time);
+
+	return 0;
+}
+
+int _event_manager_listener_stats_get(size_t idx,
+				      struct event_manager_listener_stats *stats)
+{
+	if (idx >= __stop_event_listeners - __start_event_listeners) {
+		return -ENOENT;
+	}
+
+	hist_copy(&stats->exec_time, &listener_stats[idx].exec_time);
+
+	return 0;
+}
+
+u32_t _event_manager_stats_period_get(void)
+{
+	return k_uptime_get() - stats_reset_time;
+}
+
+void _event_manager_stats_reset(void)
+{
+	/* Statistics updated while resetting may be partially lost. */
+	memset(event_stats, 0, sizeof(event_stats));
+	memset(listener_stats, 0, sizeof(listener_stats));
+	stats_reset_time = k_uptime_get();
+}
+#else
+static void stats_submit_record(const struct event_header *eh)
+{
+}
+
+static void stats_wait_time_record(const struct event_header *eh)
+{
+}
+
+static u32_t stats_exec_start(void)
+{
+	return 0;
+}
+
+static void stats_exec_time_record(const struct event_listener *el,
+				   u32_t start)
+{
+}
+
+int _event_manager_event_stats_get(size_t idx,
+				   struct event_manager_event_stats *stats)
+{
+	return -ENOENT;
+}
+
+int _event_manager_listener_stats_get(size_t idx,
+				      struct event_manager_listener_stats *stats)
+{
+	return -ENOENT;
+}
+
+u32_t _event_manager_stats_period_get(void)
+{
+	return 0;
+}
+
+void _event_manager_stats_reset(void)
+{
+}
+#endif /* CONFIG_DESKTOP_EVENT_MANAGER_STATS */
 
 static bool log_is_event_displayed(const struct event_type *et)
 {
-	u32_t event_mask = BIT(et - __start_event_types);
-	return event_manager_displayed_events & event_mask;
+	return atomic_test_bit(event_manager_displayed_events,
+			       et - __start_event_types);
 }
 
 static void log_event(const struct event_header *eh)
@@ -102,8 +460,8 @@ static void log_event_init(void)
 	     (et != NULL) && (et != __stop_event_types);
 	     et++) {
 		if (et->init_log_enable) {
-			u32_t event_mask = BIT(et - __start_event_types);
-			event_manager_displayed_events |= event_mask;
+			atomic_set_bit(event_manager_displayed_events,
+				       et - __start_event_types);
 		}
 	}
 }
@@ -217,69 +575,147 @@ static int trace_event_init(void)
 	return 0;
 }
 
-static void event_processor_fn(struct k_work *work)
+static void queue_stats_update(struct event_queue *q,
+			       const struct event_header *eh)
 {
-	sys_slist_t events = SYS_SLIST_STATIC_INIT(&events);
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS
+	u32_t wait_time = k_cycle_get_32() - eh->timestamp;
+
+	q->depth--;
+	q->processed_cnt++;
+	q->total_wait_time += wait_time;
+	if (wait_time > q->max_wait_time) {
+		q->max_wait_time = wait_time;
+	}
+#endif
+}
 
-	/* Make current event list local. */
+static struct event_header *eventq_get(size_t order_start, size_t order_end)
+{
+	struct event_header *eh = NULL;
 	k_spinlock_key_t key = k_spin_lock(&lock);
 
-	if (sys_slist_is_empty(&eventq)) {
-		k_spin_unlock(&lock, key);
-		return;
-	}
+	for (size_t i = order_start; (i < order_end) && !eh; i++) {
+		struct event_queue *q = &eventq[dispatch_order[i]];
+		sys_snode_t *node = sys_slist_get(&q->list);
 
-	sys_slist_merge_slist(&events, &eventq);
+		if (node) {
+			eh = CONTAINER_OF(node, struct event_header, node);
+			queue_stats_update(q, eh);
+
+			/* Event that is being processed can no longer be
+			 * merged with newly submitted events.
+			 */
+			struct event_merge_state *state =
+				eh->type_id->merge_state;
+
+			if (state && (state->pending == eh)) {
+				state->pending = NULL;
+			}
+		}
+	}
 
 	k_spin_unlock(&lock, key);
 
+	return eh;
+}
 
-	/* Traverse the list of events. */
-	sys_snode_t *node;
-	while (NULL != (node = sys_slist_get(&events))) {
-		struct event_header *eh = CONTAINER_OF(node,
-						       struct event_header,
-						       node);
+static void event_process(struct event_header *eh)
+{
+	ASSERT_EVENT_ID(eh->type_id);
 
-		ASSERT_EVENT_ID(eh->type_id);
+	const struct event_type *et = eh->type_id;
 
-		const struct event_type *et = eh->type_id;
+	stats_wait_time_record(eh);
 
-		trace_event_execution(eh, true);
+	trace_event_execution(eh, true);
 
-		log_event(eh);
+	log_event(eh);
 
-		bool consumed = false;
+	/* Subscribers are sorted by priority at link time. */
+	for (const struct event_subscriber *es = et->subs_start;
+	     es != et->subs_stop;
+	     es++) {
 
-		for (size_t prio = SUBS_PRIO_MIN;
-		     (prio <= SUBS_PRIO_MAX) && !consumed;
-		     prio++) {
-			for (const struct event_subscriber *es =
-					et->subs_start[prio];
-			     (es != et->subs_stop[prio]) && !consumed;
-			     es++) {
+		__ASSERT_NO_MSG(es != NULL);
 
-				__ASSERT_NO_MSG(es != NULL);
+		const struct event_listener *el = es->listener;
 
-				const struct event_listener *el = es->listener;
+		__ASSERT_NO_MSG(el != NULL);
+		__ASSERT_NO_MSG(el->notification != NULL);
 
-				__ASSERT_NO_MSG(el != NULL);
-				__ASSERT_NO_MSG(el->notification != NULL);
+		log_event_progress(et, el);
 
-				log_event_progress(et, el);
+		u32_t exec_start = stats_exec_start();
+		bool consumed = el->notification(eh);
 
-				consumed = el->notification(eh);
+		stats_exec_time_record(el, exec_start);
 
-				if (consumed) {
-					log_event_consumed(et);
-				}
-			}
+		if (consumed) {
+			log_event_consumed(et);
+			break;
 		}
+	}
+
+	trace_event_execution(eh, false);
+
+	event_manager_free(eh);
+}
+
+static void event_processor_fn(struct k_work *work)
+{
+	/* Events of the high class are handled by a dedicated thread
+	 * if it is enabled.
+	 */
+	size_t order_start =
+		IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD) ?
+		1 : 0;
+	struct event_header *eh;
+
+	/* Queues are checked again after every event, so that an event of
+	 * a higher class submitted in the meantime is handled first.
+	 */
+	while (NULL != (eh = eventq_get(order_start,
+					ARRAY_SIZE(dispatch_order)))) {
+		event_process(eh);
+	}
+}
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD
+static void event_processor_high_fn(struct k_work *work)
+{
+	struct event_header *eh;
+
+	while (NULL != (eh = eventq_get(0, 1))) {
+		event_process(eh);
+	}
+}
+#endif
+
+static bool event_merge(const struct event_header *eh)
+{
+	const struct event_type *et = eh->type_id;
+	struct event_merge_state *state = et->merge_state;
+	struct event_queue *q = &eventq[et->dispatch_class];
+	bool merged = false;
+
+	__ASSERT_NO_MSG(state != NULL);
 
-		trace_event_execution(eh, false);
+	k_spinlock_key_t key = k_spin_lock(&lock);
 
-		k_free(eh);
+	/* Merging into an event queued before other events would deliver
+	 * the new data ahead of them. Only the last queued event is used.
+	 */
+	if (state->pending &&
+	    (sys_slist_peek_tail(&q->list) == &state->pending->node) &&
+	    et->merge(state->pending, eh)) {
+		state->merged_cnt++;
+		merged = true;
 	}
+
+	k_spin_unlock(&lock, key);
+
+	return merged;
 }
 
 void _event_submit(struct event_header *eh)
@@ -287,17 +723,129 @@ void _event_submit(struct event_header *eh)
 	__ASSERT_NO_MSG(eh);
 	ASSERT_EVENT_ID(eh->type_id);
 
+	const struct event_type *et = eh->type_id;
+
+	__ASSERT_NO_MSG(et->dispatch_class < EVENT_DISPATCH_CLASS_COUNT);
+
+	struct event_queue *q = &eventq[et->dispatch_class];
+
+	stats_submit_record(eh);
+
+	/* Merged event is never processed, hence it is not traced. */
+	if (et->merge && event_merge(eh)) {
+		event_manager_free(eh);
+		return;
+	}
+
 	trace_event_submission(eh);
 
 	k_spinlock_key_t key = k_spin_lock(&lock);
-	sys_slist_append(&eventq, &eh->node);
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_EVENT_TIMESTAMP
+	eh->timestamp = k_cycle_get_32();
+#endif
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS
+	q->depth++;
+	if (q->depth > q->max_depth) {
+		q->max_depth = q->depth;
+	}
+#endif
+	sys_slist_append(&q->list, &eh->node);
+	if (et->merge_state) {
+		et->merge_state->pending = eh;
+	}
 	k_spin_unlock(&lock, key);
 
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD
+	if (et->dispatch_class == EVENT_DISPATCH_CLASS_HIGH) {
+		k_work_submit_to_queue(&high_prio_work_q,
+				       &event_processor_high);
+		return;
+	}
+#endif
+
 	k_work_submit(&event_processor);
 }
 
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS
+int _event_manager_queue_stats_get(size_t dispatch_class,
+				   struct event_manager_queue_stats *stats)
+{
+	if (dispatch_class >= ARRAY_SIZE(eventq)) {
+		return -ENOENT;
+	}
+
+	const struct event_queue *q = &eventq[dispatch_class];
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	stats->depth = q->depth;
+	stats->max_depth = q->max_depth;
+	stats->processed_cnt = q->processed_cnt;
+	stats->max_wait_time_us = k_cyc_to_us_floor32(q->max_wait_time);
+	stats->avg_wait_time_us = (q->processed_cnt > 0) ?
+		k_cyc_to_us_floor32(q->total_wait_time / q->processed_cnt) : 0;
+
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+
+void _event_manager_queue_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(eventq); i++) {
+		struct event_queue *q = &eventq[i];
+
+		q->max_depth = q->depth;
+		q->processed_cnt = 0;
+		q->max_wait_time = 0;
+		q->total_wait_time = 0;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+#else
+int _event_manager_queue_stats_get(size_t dispatch_class,
+				   struct event_manager_queue_stats *stats)
+{
+	return -ENOENT;
+}
+
+void _event_manager_queue_stats_reset(void)
+{
+}
+#endif /* CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS */
+
 int event_manager_init(void)
 {
+	size_t event_cnt = __stop_event_types - __start_event_types;
+
+	if (event_cnt > CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT) {
+		LOG_ERR("Too many event types: %d (max %d)", (int)event_cnt,
+			CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT);
+		return -ENOMEM;
+	}
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_STATS
+	size_t listener_cnt = __stop_event_listeners - __start_event_listeners;
+
+	if (listener_cnt > LISTENER_STATS_CNT) {
+		LOG_ERR("Too many listeners: %d (max %d)", (int)listener_cnt,
+			LISTENER_STATS_CNT);
+		return -ENOMEM;
+	}
+
+	_event_manager_stats_reset();
+#endif
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD
+	k_work_q_start(&high_prio_work_q, high_prio_stack,
+		       K_THREAD_STACK_SIZEOF(high_prio_stack),
+		       CONFIG_DESKTOP_EVENT_MANAGER_HIGH_PRIO_THREAD_PRIORITY);
+	k_thread_name_set(&high_prio_work_q.thread, "event_manager_high");
+#endif
+
 	log_event_init();
 
 	return trace_event_init();
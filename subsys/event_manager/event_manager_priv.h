@@ -26,48 +26,50 @@ extern "C" {
 #define _SUBS_PRIO_FINAL  2
 
 
-/* Convenience macros generating section names. */
-
-#define _SUBS_PRIO_ID(level) _CONCAT(_CONCAT(_prio, level), _)
-
-#define _EVENT_SUBSCRIBERS_SECTION_PREFIX(ename, prio)	_CONCAT(_CONCAT(event_subscribers_, ename), prio)
+/* Subscribers of an event type are placed in sections named
+ * event_subscribers_<ename>.<suffix>. The linker sorts these sections by name
+ * (see event_manager.ld), so that subscribers of every event type form one
+ * contiguous array ordered by priority and enclosed by start and stop markers:
+ *
+ *   event_subscribers_<ename>.0	- start marker
+ *   event_subscribers_<ename>.10	- subscribers of _SUBS_PRIO_FIRST
+ *   event_subscribers_<ename>.11	- subscribers of _SUBS_PRIO_NORMAL
+ *   event_subscribers_<ename>.12	- subscribers of _SUBS_PRIO_FINAL
+ *   event_subscribers_<ename>.2	- stop marker
+ *
+ * The '.' separator sorts before any character allowed in an event name,
+ * hence arrays of different event types never interleave.
+ */
 
-#define _EVENT_SUBSCRIBERS_SECTION_NAME(ename, prio)	STRINGIFY(_EVENT_SUBSCRIBERS_SECTION_PREFIX(ename, prio))
+#define _SUBS_START_ID 0
+#define _SUBS_STOP_ID  2
 
+#define _SUBS_PRIO_ID(level) _CONCAT(1, level)
 
-/* Declare a zero-length subscriber. */
-#define _EVENT_SUBSCRIBERS_EMPTY(ename, prio)								\
-	const struct {} _CONCAT(_EVENT_SUBSCRIBERS_SECTION_PREFIX(ename, prio), empty)			\
-	__attribute__((__section__(STRINGIFY(_EVENT_SUBSCRIBERS_SECTION_NAME(ename, prio))))) = {};
+#define _EVENT_SUBSCRIBERS_SECTION_NAME(ename, id) \
+	STRINGIFY(_CONCAT(event_subscribers_, ename)) "." STRINGIFY(id)
 
 
-/* Convenience macros generating section start and stop markers. */
+/* Convenience macros generating start and stop markers. */
 
-#define _EVENT_SUBSCRIBERS_START(ename, prio)	_CONCAT(__start_, _EVENT_SUBSCRIBERS_SECTION_PREFIX(ename, prio))
+#define _EVENT_SUBSCRIBERS_START(ename)	_CONCAT(__event_subscribers_start_, ename)
 
-#define _EVENT_SUBSCRIBERS_STOP(ename, prio)	_CONCAT(__stop_,  _EVENT_SUBSCRIBERS_SECTION_PREFIX(ename, prio))
+#define _EVENT_SUBSCRIBERS_STOP(ename)	_CONCAT(__event_subscribers_stop_, ename)
 
 
-#define _EVENT_SUBSCRIBERS_DECLARE(ename)										\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FIRST))[];	\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_STOP(ename,  _SUBS_PRIO_ID(_SUBS_PRIO_FIRST))[];	\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_NORMAL))[];	\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_STOP(ename,  _SUBS_PRIO_ID(_SUBS_PRIO_NORMAL))[];	\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FINAL))[];	\
-	extern const struct event_subscriber _EVENT_SUBSCRIBERS_STOP(ename,  _SUBS_PRIO_ID(_SUBS_PRIO_FINAL))[];
+#define _EVENT_SUBSCRIBERS_DECLARE(ename)					\
+	extern const struct event_subscriber _EVENT_SUBSCRIBERS_START(ename)[];	\
+	extern const struct event_subscriber _EVENT_SUBSCRIBERS_STOP(ename)[]
 
 
-/* Macro defining empty subscribers on each priority level.
- * Each event type keeps an array of subscribers for every priority level.
- * It can happen that for a given priority no subscriber will be registered.
- * This macro declares zero-length subscriber that will cause required section
- * to be generated by the linker. If no subscriber is registered at this
- * level section will remain empty.
+/* Macro defining zero-length start and stop markers of the subscriber array
+ * of an event type.
  */
-#define _EVENT_SUBSCRIBERS_DEFINE(ename)					\
-	_EVENT_SUBSCRIBERS_EMPTY(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FIRST))	\
-	_EVENT_SUBSCRIBERS_EMPTY(ename, _SUBS_PRIO_ID(_SUBS_PRIO_NORMAL))	\
-	_EVENT_SUBSCRIBERS_EMPTY(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FINAL))
+#define _EVENT_SUBSCRIBERS_DEFINE(ename)							\
+	const struct event_subscriber _EVENT_SUBSCRIBERS_START(ename)[0] __used			\
+	__attribute__((__section__(_EVENT_SUBSCRIBERS_SECTION_NAME(ename, _SUBS_START_ID)))) = {};	\
+	const struct event_subscriber _EVENT_SUBSCRIBERS_STOP(ename)[0] __used			\
+	__attribute__((__section__(_EVENT_SUBSCRIBERS_SECTION_NAME(ename, _SUBS_STOP_ID)))) = {}
 
 
 /* Subscribe a listener to an event. */
@@ -89,14 +91,11 @@ extern "C" {
 #define _EVENT_ALLOCATOR_FN(ename)					\
 	static inline struct ename *_CONCAT(new_, ename)(void)		\
 	{								\
-		struct ename *event = k_malloc(sizeof(*event));		\
+		struct ename *event =					\
+			event_manager_alloc(sizeof(*event));		\
 		BUILD_ASSERT_MSG(offsetof(struct ename, header) == 0,	\
 				 "");					\
 		if (unlikely(!event)) {					\
-			printk("Event Manager OOM error\n");		\
-			LOG_PANIC();					\
-			__ASSERT_NO_MSG(false);				\
-			sys_reboot(SYS_REBOOT_WARM);			\
 			return NULL;					\
 		}							\
 		event->header.type_id = _EVENT_ID(ename);		\
@@ -111,17 +110,14 @@ extern "C" {
 #define _EVENT_ALLOCATOR_DYNDATA_FN(ename)				\
 	static inline struct ename *_CONCAT(new_, ename)(size_t size)	\
 	{								\
-		struct ename *event = k_malloc(sizeof(*event) + size);	\
+		struct ename *event =					\
+			event_manager_alloc(sizeof(*event) + size);	\
 		BUILD_ASSERT_MSG((offsetof(struct ename, dyndata) +	\
 				  sizeof(event->dyndata.size)) ==	\
 				 sizeof(*event), "");			\
 		BUILD_ASSERT_MSG(offsetof(struct ename, header) == 0,	\
 				 "");					\
 		if (unlikely(!event)) {					\
-			printk("Event Manager OOM error\n");		\
-			LOG_PANIC();					\
-			__ASSERT_NO_MSG(false);				\
-			sys_reboot(SYS_REBOOT_WARM);			\
 			return NULL;					\
 		}							\
 		event->header.type_id = _EVENT_ID(ename);		\
@@ -156,6 +152,96 @@ extern "C" {
 	}
 
 
+/* Statistics of an event memory pool.
+ * Used internally by the Event Manager shell.
+ */
+struct event_manager_pool_stats {
+	size_t block_size;
+	u32_t block_cnt;
+	u32_t used;
+	u32_t max_used;
+};
+
+/* Get statistics of the event memory pool of the given index.
+ * Returns -ENOENT if there is no pool of this index.
+ */
+int _event_manager_pool_stats_get(size_t idx,
+				  struct event_manager_pool_stats *stats);
+
+/* Get number of events that did not fit in the pools and were allocated
+ * from the heap.
+ */
+u32_t _event_manager_heap_alloc_cnt_get(void);
+
+/* Statistics of an event queue.
+ * Used internally by the Event Manager shell.
+ */
+struct event_manager_queue_stats {
+	u32_t depth;
+	u32_t max_depth;
+	u32_t processed_cnt;
+	u32_t avg_wait_time_us;
+	u32_t max_wait_time_us;
+};
+
+/* Get statistics of the queue of the given dispatch class.
+ * Returns -ENOENT if there is no such dispatch class.
+ */
+int _event_manager_queue_stats_get(size_t dispatch_class,
+				   struct event_manager_queue_stats *stats);
+
+/* Reset statistics of all event queues. */
+void _event_manager_queue_stats_reset(void);
+
+#ifdef CONFIG_DESKTOP_EVENT_MANAGER_STATS
+#define _EVENT_MANAGER_HIST_BUCKET_CNT \
+	CONFIG_DESKTOP_EVENT_MANAGER_STATS_HIST_BUCKET_CNT
+#else
+#define _EVENT_MANAGER_HIST_BUCKET_CNT 1
+#endif
+
+/* Histogram with log2 buckets of values in cycles.
+ * Bucket 0 counts zero values, bucket n counts values from 2^(n-1)
+ * to 2^n - 1. The last bucket counts also all bigger values.
+ */
+struct event_manager_hist {
+	u32_t bucket[_EVENT_MANAGER_HIST_BUCKET_CNT];
+};
+
+/* Statistics of an event type.
+ * Used internally by the Event Manager shell.
+ */
+struct event_manager_event_stats {
+	u32_t submit_cnt;
+	struct event_manager_hist wait_time;
+};
+
+/* Statistics of an event listener.
+ * Used internally by the Event Manager shell.
+ */
+struct event_manager_listener_stats {
+	struct event_manager_hist exec_time;
+};
+
+/* Get statistics of the event type of the given index.
+ * Returns -ENOENT if there is no such event type or statistics are disabled.
+ */
+int _event_manager_event_stats_get(size_t idx,
+				   struct event_manager_event_stats *stats);
+
+/* Get statistics of the event listener of the given index.
+ * Returns -ENOENT if there is no such listener or statistics are disabled.
+ */
+int _event_manager_listener_stats_get(size_t idx,
+				      struct event_manager_listener_stats *stats);
+
+/* Get time since the statistics were reset in milliseconds. */
+u32_t _event_manager_stats_period_get(void);
+
+/* Reset event processing statistics. */
+void _event_manager_stats_reset(void);
+
+
 /* Wrappers used for defining event infos */
 #ifdef CONFIG_DESKTOP_EVENT_MANAGER_TRACE_EVENT_EXECUTION
 #define MEM_ADDRESS_LABEL "mem_address",
@@ -221,24 +307,27 @@ extern "C" {
 	_EVENT_ALLOCATOR_DYNDATA_FN(ename)
 
 
-#define _EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct)							\
+#define _EVENT_ATTR_DISPATCH_CLASS(dclass) .dispatch_class = (dclass)
+
+/* Merge state is kept in a compound literal, which has static storage
+ * duration when used at file scope.
+ */
+#define _EVENT_ATTR_MERGE(merge_fn)					\
+	.merge = (merge_fn),						\
+	.merge_state = &(struct event_merge_state){0}
+
+
+#define _EVENT_TYPE_DEFINE(ename, init_log_en, log_fn, ev_info_struct, ...)						\
 	_EVENT_SUBSCRIBERS_DEFINE(ename);										\
 	const struct event_type _CONCAT(__event_type_, ename) __used							\
 	__attribute__((__section__("event_types"))) = {									\
 		.name				= STRINGIFY(ename),							\
-		.subs_start	= {											\
-			[_SUBS_PRIO_FIRST]	= _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FIRST)),	\
-			[_SUBS_PRIO_NORMAL]	= _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_NORMAL)),	\
-			[_SUBS_PRIO_FINAL]	= _EVENT_SUBSCRIBERS_START(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FINAL)),	\
-		},													\
-		.subs_stop	= {											\
-			[_SUBS_PRIO_FIRST]	= _EVENT_SUBSCRIBERS_STOP(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FIRST)),	\
-			[_SUBS_PRIO_NORMAL]	= _EVENT_SUBSCRIBERS_STOP(ename, _SUBS_PRIO_ID(_SUBS_PRIO_NORMAL)),	\
-			[_SUBS_PRIO_FINAL]	= _EVENT_SUBSCRIBERS_STOP(ename, _SUBS_PRIO_ID(_SUBS_PRIO_FINAL)),	\
-		},													\
+		.subs_start			= _EVENT_SUBSCRIBERS_START(ename),					\
+		.subs_stop			= _EVENT_SUBSCRIBERS_STOP(ename),					\
 		.init_log_enable		= init_log_en,								\
 		.log_event			= log_fn,								\
 		.ev_info			= ev_info_struct,							\
+		__VA_ARGS__												\
 	}
 
 
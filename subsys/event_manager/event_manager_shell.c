@@ -6,9 +6,11 @@
 
 #include <stdlib.h>
 #include <shell/shell.h>
+#include <sys/atomic.h>
 #include <event_manager.h>
 
-u32_t event_manager_displayed_events;
+ATOMIC_DEFINE(event_manager_displayed_events,
+	      CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT);
 
 static int show_events(const struct shell *shell, size_t argc,
 		char **argv)
@@ -23,11 +25,17 @@ static int show_events(const struct shell *shell, size_t argc,
 
 		shell_fprintf(shell,
 			      SHELL_NORMAL,
-			      "%c %d:\t%s\n",
-			      (event_manager_displayed_events & BIT(ev_id)) ?
-				'E' : 'D',
+			      "%c %zu:\t%s",
+			      atomic_test_bit(event_manager_displayed_events,
+					      ev_id) ? 'E' : 'D',
 			      ev_id,
 			      et->name);
+
+		if (et->merge_state) {
+			shell_fprintf(shell, SHELL_NORMAL, "\t(merged: %zu)",
+				      et->merge_state->merged_cnt);
+		}
+		shell_fprintf(shell, SHELL_NORMAL, "\n");
 	}
 
 	return 0;
@@ -56,29 +64,21 @@ static int show_subscribers(const struct shell *shell, size_t argc,
 	     (et != NULL) && (et != __stop_event_types);
 	     et++) {
 
-		bool is_subscribed = false;
-
-		for (size_t prio = SUBS_PRIO_MIN;
-		     prio <= SUBS_PRIO_MAX;
-		     prio++) {
-			for (const struct event_subscriber *es =
-					et->subs_start[prio];
-			     es != et->subs_stop[prio];
-			     es++) {
+		/* Subscribers are listed in the order of notification. */
+		for (const struct event_subscriber *es = et->subs_start;
+		     es != et->subs_stop;
+		     es++) {
 
-				__ASSERT_NO_MSG(es != NULL);
-				const struct event_listener *el = es->listener;
+			__ASSERT_NO_MSG(es != NULL);
+			const struct event_listener *el = es->listener;
 
-				__ASSERT_NO_MSG(el != NULL);
-				shell_fprintf(shell, SHELL_NORMAL,
-					      "|\tprio:%u\t[E:%s] -> [L:%s]\n",
-					      prio, et->name, el->name);
-
-				is_subscribed = true;
-			}
+			__ASSERT_NO_MSG(el != NULL);
+			shell_fprintf(shell, SHELL_NORMAL,
+				      "|\t%zu:\t[E:%s] -> [L:%s]\n",
+				      (size_t)(es - et->subs_start), et->name, el->name);
 		}
 
-		if (!is_subscribed) {
+		if (et->subs_start == et->subs_stop) {
 			shell_fprintf(shell, SHELL_NORMAL,
 				      "|\t[E:%s] has no subscribers\n",
 				      et->name);
@@ -89,20 +89,152 @@ static int show_subscribers(const struct shell *shell, size_t argc,
 	return 0;
 }
 
+static int show_pools(const struct shell *shell, size_t argc,
+		      char **argv)
+{
+	struct event_manager_pool_stats stats;
+
+	shell_fprintf(shell, SHELL_NORMAL, "Event pools:\n");
+	for (size_t i = 0; !_event_manager_pool_stats_get(i, &stats); i++) {
+		shell_fprintf(shell, SHELL_NORMAL,
+			      "|\tblock size:%zu\tused:%u/%u\tmax used:%u\n",
+			      stats.block_size, stats.used, stats.block_cnt,
+			      stats.max_used);
+	}
+	shell_fprintf(shell, SHELL_NORMAL, "Events allocated from heap: %u\n",
+		      _event_manager_heap_alloc_cnt_get());
+
+	return 0;
+}
+
+static int show_queues(const struct shell *shell, size_t argc,
+		       char **argv)
+{
+	static const char * const class_name[] = {
+		[EVENT_DISPATCH_CLASS_NORMAL] = "normal",
+		[EVENT_DISPATCH_CLASS_HIGH] = "high",
+		[EVENT_DISPATCH_CLASS_LOW] = "low",
+	};
+	struct event_manager_queue_stats stats;
+
+	BUILD_ASSERT_MSG(ARRAY_SIZE(class_name) == EVENT_DISPATCH_CLASS_COUNT,
+			 "Invalid number of dispatch class names");
+
+	shell_fprintf(shell, SHELL_NORMAL, "Event queues:\n");
+	for (size_t i = 0; !_event_manager_queue_stats_get(i, &stats); i++) {
+		shell_fprintf(shell, SHELL_NORMAL,
+			      "|\t%s:\tdepth:%u\tmax depth:%u\tprocessed:%u"
+			      "\twait avg:%uus\twait max:%uus\n",
+			      class_name[i], stats.depth, stats.max_depth,
+			      stats.processed_cnt, stats.avg_wait_time_us,
+			      stats.max_wait_time_us);
+	}
+
+	return 0;
+}
+
+static int reset_queues(const struct shell *shell, size_t argc,
+			char **argv)
+{
+	_event_manager_queue_stats_reset();
+	shell_fprintf(shell, SHELL_NORMAL, "Event queue statistics reset\n");
+
+	return 0;
+}
+
+static void print_hist(const struct shell *shell, const char *name,
+		       const struct event_manager_hist *hist)
+{
+	u32_t total = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(hist->bucket); i++) {
+		total += hist->bucket[i];
+	}
+
+	shell_fprintf(shell, SHELL_NORMAL, "|\t\t%s (%u):", name, total);
+
+	/* Print only non-empty buckets, described by their upper bound. */
+	for (size_t i = 0; i < ARRAY_SIZE(hist->bucket); i++) {
+		if (hist->bucket[i] == 0) {
+			continue;
+		}
+
+		if (i == ARRAY_SIZE(hist->bucket) - 1) {
+			shell_fprintf(shell, SHELL_NORMAL, " >=%uus:%u",
+				      k_cyc_to_us_floor32(BIT(i - 1)),
+				      hist->bucket[i]);
+		} else {
+			shell_fprintf(shell, SHELL_NORMAL, " <%uus:%u",
+				      k_cyc_to_us_ceil32(BIT(i)),
+				      hist->bucket[i]);
+		}
+	}
+
+	shell_fprintf(shell, SHELL_NORMAL, "\n");
+}
+
+static int show_stats(const struct shell *shell, size_t argc,
+		      char **argv)
+{
+	struct event_manager_event_stats ev_stats;
+	struct event_manager_listener_stats el_stats;
+	u32_t period = _event_manager_stats_period_get();
+
+	shell_fprintf(shell, SHELL_NORMAL, "Statistics collected for %u ms\n",
+		      period);
+
+	shell_fprintf(shell, SHELL_NORMAL, "Events:\n");
+	for (size_t i = 0; !_event_manager_event_stats_get(i, &ev_stats); i++) {
+		const struct event_type *et = __start_event_types + i;
+		u32_t rate = (period > 0) ?
+			((u64_t)ev_stats.submit_cnt * MSEC_PER_SEC / period) : 0;
+
+		shell_fprintf(shell, SHELL_NORMAL,
+			      "|\t[E:%s] submitted:%u (%u/s)\n",
+			      et->name, ev_stats.submit_cnt, rate);
+		print_hist(shell, "wait time", &ev_stats.wait_time);
+	}
+
+	shell_fprintf(shell, SHELL_NORMAL, "Listeners:\n");
+	for (size_t i = 0;
+	     !_event_manager_listener_stats_get(i, &el_stats);
+	     i++) {
+		const struct event_listener *el = __start_event_listeners + i;
+
+		shell_fprintf(shell, SHELL_NORMAL, "|\t[L:%s]\n", el->name);
+		print_hist(shell, "execution time", &el_stats.exec_time);
+	}
+
+	return 0;
+}
+
+static int reset_stats(const struct shell *shell, size_t argc,
+		       char **argv)
+{
+	_event_manager_stats_reset();
+	shell_fprintf(shell, SHELL_NORMAL, "Statistics reset\n");
+
+	return 0;
+}
+
+static void set_event_displayed(size_t ev_id, bool enable)
+{
+	if (enable) {
+		atomic_set_bit(event_manager_displayed_events, ev_id);
+	} else {
+		atomic_clear_bit(event_manager_displayed_events, ev_id);
+	}
+}
+
 static void set_event_displaying(const struct shell *shell, size_t argc,
 				 char **argv, bool enable)
 {
-	u32_t evt_mask = 0;
+	size_t event_cnt = __stop_event_types - __start_event_types;
 
 	/* If no IDs specified, all registered events are affected */
 	if (argc == 1) {
-		for (const struct event_type *et = __start_event_types;
-		     (et != NULL) && (et != __stop_event_types);
-		     et++) {
-
-			size_t ev_id = et - __start_event_types;
-
-			evt_mask |= BIT(ev_id);
+		for (size_t ev_id = 0; ev_id < event_cnt; ev_id++) {
+			set_event_displayed(ev_id, enable);
 		}
 
 		shell_fprintf(shell,
@@ -118,7 +250,7 @@ static void set_event_displaying(const struct shell *shell, size_t argc,
 			event_indexes[i] = strtol(argv[i + 1], &end, 10);
 
 			if ((event_indexes[i] < 0)
-			    || (event_indexes[i] >= __stop_event_types - __start_event_types)
+			    || (event_indexes[i] >= event_cnt)
 			    || (*end != '\0')) {
 
 				shell_error(shell, "Invalid event ID: %s",
@@ -128,7 +260,7 @@ static void set_event_displaying(const struct shell *shell, size_t argc,
 		}
 
 		for (size_t i = 0; i < ARRAY_SIZE(event_indexes); i++) {
-			evt_mask |= BIT(event_indexes[i]);
+			set_event_displayed(event_indexes[i], enable);
 			const struct event_type *et =
 				__start_event_types + event_indexes[i];
 			const char *event_name = et->name;
@@ -140,11 +272,6 @@ static void set_event_displaying(const struct shell *shell, size_t argc,
 				      enable ? "en":"dis");
 		}
 	}
-	if (enable) {
-		event_manager_displayed_events |= evt_mask;
-	} else {
-		event_manager_displayed_events &= ~evt_mask;
-	}
 }
 
 static int enable_event_displaying(const struct shell *shell, size_t argc,
@@ -168,12 +295,27 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_event_manager,
 	SHELL_CMD_ARG(show_subscribers, NULL, "Show subscribers",
 		      show_subscribers, 0, 0),
 	SHELL_CMD_ARG(show_events, NULL, "Show events", show_events, 0, 0),
+	SHELL_COND_CMD_ARG(CONFIG_DESKTOP_EVENT_MANAGER_EVENT_POOL,
+			   show_pools, NULL, "Show event pool statistics",
+			   show_pools, 0, 0),
+	SHELL_COND_CMD_ARG(CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS,
+			   show_queues, NULL, "Show event queue statistics",
+			   show_queues, 0, 0),
+	SHELL_COND_CMD_ARG(CONFIG_DESKTOP_EVENT_MANAGER_QUEUE_STATS,
+			   reset_queues, NULL, "Reset event queue statistics",
+			   reset_queues, 0, 0),
+	SHELL_COND_CMD_ARG(CONFIG_DESKTOP_EVENT_MANAGER_STATS,
+			   show_stats, NULL, "Show event processing statistics",
+			   show_stats, 0, 0),
+	SHELL_COND_CMD_ARG(CONFIG_DESKTOP_EVENT_MANAGER_STATS,
+			   reset_stats, NULL, "Reset event processing statistics",
+			   reset_stats, 0, 0),
 	SHELL_CMD_ARG(disable, NULL, "Disable displaying event with given ID",
 		      disable_event_displaying, 0,
-		      sizeof(event_manager_displayed_events) * 8 - 1),
+		      CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT),
 	SHELL_CMD_ARG(enable, NULL, "Enable displaying event with given ID",
 		      enable_event_displaying, 0,
-		      sizeof(event_manager_displayed_events) * 8 - 1),
+		      CONFIG_DESKTOP_EVENT_MANAGER_MAX_EVENT_CNT),
 	SHELL_SUBCMD_SET_END
 );
 
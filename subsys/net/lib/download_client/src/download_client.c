@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <zephyr.h>
 #include <zephyr/types.h>
 #include <toolchain/common.h>
@@ -231,7 +232,7 @@ static int socket_send(const struct download_client *client, size_t len)
 	size_t off = 0;
 
 	while (len) {
-		sent = send(client->fd, client->buf + off, len, 0);
+		sent = send(client->fd, client->req_buf + off, len, 0);
 		if (sent <= 0) {
 			return -EIO;
 		}
@@ -254,24 +255,24 @@ static int get_request_send(struct download_client *client)
 	__ASSERT_NO_MSG(client->file);
 
 	/* Offset of last byte in range (Content-Range) */
-	off = client->progress + client->fragment_size - 1;
+	off = client->request_offset + client->fragment_size - 1;
 
 	if (client->file_size != 0) {
 		/* Don't request bytes past the end of file */
-		off = MIN(off, client->file_size);
+		off = MIN(off, client->file_size - 1);
 	}
 
-	len = snprintf(client->buf, CONFIG_DOWNLOAD_CLIENT_MAX_RESPONSE_SIZE,
+	len = snprintf(client->req_buf, sizeof(client->req_buf),
 		       GET_TEMPLATE, client->file, client->host,
-		       client->progress, off);
+		       client->request_offset, off);
 
-	if (len < 0 || len > CONFIG_DOWNLOAD_CLIENT_MAX_RESPONSE_SIZE) {
+	if (len < 0 || len >= sizeof(client->req_buf)) {
 		LOG_ERR("Cannot create GET request, buffer too small");
 		return -ENOMEM;
 	}
 
 	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
-		LOG_HEXDUMP_DBG(client->buf, len, "HTTP request");
+		LOG_HEXDUMP_DBG(client->req_buf, len, "HTTP request");
 	}
 
 	LOG_DBG("Sending HTTP request");
@@ -281,102 +282,218 @@ static int get_request_send(struct download_client *client)
 		return err;
 	}
 
+	client->request_offset = off + 1;
+	client->pending_requests++;
+
 	return 0;
 }
 
-/* Returns:
- *  1 while the header is being received
- *  0 if the header has been fully received
- * -1 on error
+/* Send requests for the next fragments, until the configured number of
+ * requests is pending or the whole file has been requested.
  */
-static int header_parse(struct download_client *client)
+static int pipeline_fill(struct download_client *client)
 {
-	char *p;
-	size_t hdr;
+	int err;
 
-	p = strstr(client->buf, "\r\n\r\n");
-	if (!p) {
-		/* Awaiting full GET response */
-		LOG_DBG("Awaiting full header in response");
-		return 1;
+	while (client->pending_requests <
+	       CONFIG_DOWNLOAD_CLIENT_PIPELINE_DEPTH) {
+		if (client->file_size == 0) {
+			/* The file size is not known until the first response
+			 * is received, so only one request can be sent.
+			 */
+			if (client->pending_requests > 0) {
+				break;
+			}
+		} else if (client->request_offset >= client->file_size) {
+			break;
+		}
+
+		err = get_request_send(client);
+		if (err) {
+			return err;
+		}
 	}
 
-	/* Offset of the end of the HTTP header in the buffer */
-	hdr = p + strlen("\r\n\r\n") - client->buf;
+	return 0;
+}
 
-	__ASSERT(hdr < sizeof(client->buf), "Buffer overflow");
+/* Reset the request pipeline, to request again
+ * all the bytes that were not received yet.
+ */
+static void pipeline_reset(struct download_client *client)
+{
+	client->offset = 0;
+	client->has_header = false;
+	client->hdr_parsed = 0;
+	client->hdr_line = 0;
+	client->request_offset = client->progress;
+	client->pending_requests = 0;
+}
 
-	LOG_DBG("GET header size: %u", hdr);
+/* Returns true if the header line starts with the given field name.
+ * Field names are case-insensitive.
+ */
+static bool header_field_match(const char *line, size_t len,
+			       const char *field)
+{
+	const size_t field_len = strlen(field);
 
-	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
-		LOG_HEXDUMP_DBG(client->buf, hdr, "GET");
-	}
+	return (len > field_len) && !strncasecmp(line, field, field_len);
+}
 
-	/* If file size is not known, read it from the header */
-	if (client->file_size == 0) {
-		p = strstr(client->buf, "Content-Range: bytes");
-		if (!p) {
-			/* Cannot continue */
-			LOG_ERR("Server did not send "
-				"\"Content-Range\" in response");
+/* Parse one header line, terminated by '\n'.
+ * Returns zero on success, -1 on error.
+ */
+static int header_line_parse(struct download_client *client, const char *line,
+			     size_t len)
+{
+	const char *p;
+
+	if (line == client->buf) {
+		/* Status line, e.g. "HTTP/1.1 206 Partial Content" */
+		if (!header_field_match(line, len, "HTTP/1.") ||
+		    (len < sizeof("HTTP/1.1 200") - 1) ||
+		    (line[sizeof("HTTP/1.1 ") - 1] != '2')) {
+			LOG_ERR("Unexpected HTTP response status");
 			return -1;
 		}
-		p = strstr(p, "/");
+		return 0;
+	}
+
+	if (header_field_match(line, len, "Content-Range:")) {
+		if (client->file_size != 0) {
+			/* File size is already known */
+			return 0;
+		}
+
+		p = memchr(line, '/', len);
 		if (!p) {
 			/* Cannot continue */
 			LOG_ERR("Server did not send file size in response");
 			return -1;
 		}
 
+		/* The line is terminated, so atoi() stops at its end */
 		client->file_size = atoi(p + 1);
 
 		LOG_DBG("File size = %d", client->file_size);
-	}
-
-	p = strstr(client->buf, "Connection: close");
-	if (p) {
+	} else if (header_field_match(line, len, "Connection: close")) {
 		LOG_WRN("Peer closed connection, will attempt to re-connect");
 		client->connection_close = true;
 	}
 
-	if (client->offset != hdr) {
-		/* The current buffer contains some payload bytes.
-		 * Copy them at the beginning of the buffer
-		 * then update the offset.
-		 */
-		LOG_WRN("Copying %u payload bytes", client->offset - hdr);
-		memcpy(client->buf, client->buf + hdr, client->offset - hdr);
+	return 0;
+}
 
-		client->offset -= hdr;
+/* Parse the header bytes received since the last call.
+ * Each byte is processed once and each line is parsed when its end has
+ * been received, so the header is never searched again from the start.
+ *
+ * Returns:
+ *  1 while the header is being received
+ *  0 if the header has been fully received
+ * -1 on error
+ */
+static int header_parse(struct download_client *client)
+{
+	size_t hdr;
+	char *line;
+	size_t len;
+
+	while (true) {
+		if (client->hdr_parsed == client->offset) {
+			/* Awaiting full GET response */
+			LOG_DBG("Awaiting full header in response");
+			return 1;
+		}
+
+		if (client->buf[client->hdr_parsed++] != '\n') {
+			continue;
+		}
+
+		line = client->buf + client->hdr_line;
+		len = client->hdr_parsed - client->hdr_line;
+		client->hdr_line = client->hdr_parsed;
+
+		/* An empty line ends the header */
+		if ((len <= sizeof("\r\n") - 1) && (line != client->buf)) {
+			break;
+		}
+
+		if (header_line_parse(client, line, len)) {
+			return -1;
+		}
+	}
+
+	/* Offset of the end of the HTTP header in the buffer */
+	hdr = client->hdr_parsed;
+
+	LOG_DBG("GET header size: %u", hdr);
+
+	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
+		LOG_HEXDUMP_DBG(client->buf, hdr, "GET");
+	}
+
+	if (client->file_size == 0) {
+		/* Cannot continue */
+		LOG_ERR("Server did not send "
+			"\"Content-Range\" in response");
+		return -1;
+	}
+
+	/* Responses are received in the order of the requests,
+	 * so this is the response for the first byte not received yet.
+	 */
+	client->fragment_len = MIN(client->fragment_size,
+				   client->file_size - client->progress);
+
+	if (hdr + client->fragment_len <= sizeof(client->buf)) {
+		/* The fragment fits after the header, so the payload
+		 * is received and delivered in place.
+		 */
+		client->fragment_offset = hdr;
 	} else {
-		/* Reset the offset.
-		 * The payload is received in an empty buffer.
+		/* Not enough room after the header. Copy the payload bytes
+		 * received so far at the beginning of the buffer.
 		 */
-		client->offset = 0;
+		LOG_DBG("Copying %u payload bytes", client->offset - hdr);
+		memmove(client->buf, client->buf + hdr, client->offset - hdr);
+
+		client->offset -= hdr;
+		client->fragment_offset = 0;
 	}
 
 	return 0;
 }
 
-static int fragment_evt_send(const struct download_client *client)
+static int fragment_evt_send(const struct download_client *client,
+			     size_t len)
 {
-	__ASSERT(client->offset <= client->fragment_size,
-		 "Fragment overflow!");
-
-	__ASSERT(client->offset <= CONFIG_DOWNLOAD_CLIENT_MAX_RESPONSE_SIZE,
+	__ASSERT(client->fragment_offset + len <= sizeof(client->buf),
 		 "Buffer overflow!");
 
+	__ASSERT(len <= client->fragment_size, "Fragment overflow!");
+
 	const struct download_client_evt evt = {
 		.id = DOWNLOAD_CLIENT_EVT_FRAGMENT,
 		.fragment = {
-			.buf = client->buf,
-			.len = client->offset,
+			.buf = client->buf + client->fragment_offset,
+			.len = len,
 		}
 	};
 
 	return client->callback(&evt);
 }
 
+static void throughput_log(const struct download_client *client)
+{
+	u32_t ms = (u32_t)(k_uptime_get() - client->start_time);
+	size_t bytes = client->progress - client->start_progress;
+
+	LOG_INF("Downloaded %u bytes in %u ms (%u B/s)", bytes, ms,
+		ms ? (u32_t)(((u64_t)bytes * MSEC_PER_SEC) / ms) : 0);
+}
+
 static int error_evt_send(const struct download_client *dl, int error)
 {
 	/* Error will be sent as negative. */
@@ -408,6 +525,110 @@ static int reconnect(struct download_client *dl)
 	return 0;
 }
 
+/* Process the received data.
+ *
+ * Returns:
+ *  0 while the download is in progress
+ *  1 if the download has completed or has been stopped
+ */
+static int data_process(struct download_client *dl)
+{
+	int rc;
+
+	/* With pipelining, the buffer can contain the end of one response
+	 * followed by the beginning of the next one.
+	 */
+	while (true) {
+		if (!dl->has_header) {
+			rc = header_parse(dl);
+			if (rc > 0) {
+				/* Wait for payload */
+				return 0;
+			}
+			if (rc < 0) {
+				/* Something was wrong with the header.
+				 * Restart and suspend, no point in retrying.
+				 */
+				error_evt_send(dl, EBADMSG);
+				return 1;
+			}
+
+			dl->has_header = true;
+
+			/* The file size is known now */
+			rc = pipeline_fill(dl);
+			if (rc) {
+				return rc;
+			}
+		}
+
+		/* Have we received a whole fragment? */
+		if (dl->offset - dl->fragment_offset < dl->fragment_len) {
+			LOG_DBG("Awaiting full fragment (%u)",
+				dl->offset - dl->fragment_offset);
+			return 0;
+		}
+
+		dl->progress += dl->fragment_len;
+		dl->pending_requests--;
+
+		LOG_INF("Downloaded %u/%u bytes (%d%%)", dl->progress,
+			dl->file_size, (dl->progress * 100) / dl->file_size);
+
+		/* Send fragment to application.
+		 * If the application callback returns non-zero, stop.
+		 */
+		rc = fragment_evt_send(dl, dl->fragment_len);
+		if (rc) {
+			/* Restart and suspend */
+			LOG_INF("Fragment refused, download stopped.");
+			return 1;
+		}
+
+		if (dl->progress == dl->file_size) {
+			LOG_INF("Download complete");
+			throughput_log(dl);
+			const struct download_client_evt evt = {
+				.id = DOWNLOAD_CLIENT_EVT_DONE,
+			};
+			dl->callback(&evt);
+			/* Restart and suspend */
+			return 1;
+		}
+
+		/* Attempt to reconnect if the connection was closed.
+		 * Pipelined requests are lost and have to be sent again.
+		 */
+		if (dl->connection_close) {
+			dl->connection_close = false;
+			reconnect(dl);
+			pipeline_reset(dl);
+			return pipeline_fill(dl);
+		}
+
+		/* Keep the bytes of the next response, if any.
+		 * The payload is received up to the end of the fragment,
+		 * so this only happens when the header and the whole
+		 * fragment were received at once.
+		 */
+		dl->offset -= dl->fragment_offset + dl->fragment_len;
+		if (dl->offset) {
+			memmove(dl->buf,
+				dl->buf + dl->fragment_offset + dl->fragment_len,
+				dl->offset);
+		}
+		dl->has_header = false;
+		dl->hdr_parsed = 0;
+		dl->hdr_line = 0;
+
+		/* Request next fragment */
+		rc = pipeline_fill(dl);
+		if (rc) {
+			return rc;
+		}
+	}
+}
+
 void download_thread(void *client, void *a, void *b)
 {
 	int rc;
@@ -420,21 +641,36 @@ restart_and_suspend:
 	while (true) {
 		__ASSERT(dl->offset < sizeof(dl->buf), "Buffer overflow");
 
+		len = sizeof(dl->buf) - dl->offset;
+		if (dl->has_header) {
+			/* Receive up to the end of the fragment only, so that
+			 * the next response is received in an empty buffer.
+			 */
+			len = MIN(len, dl->fragment_offset + dl->fragment_len -
+				       dl->offset);
+		}
+
 		LOG_DBG("Receiving up to %d bytes at %p...",
-			(sizeof(dl->buf) - dl->offset), (dl->buf + dl->offset));
+			len, (dl->buf + dl->offset));
 
-		len = recv(dl->fd, dl->buf + dl->offset,
-			   sizeof(dl->buf) - dl->offset, 0);
+		len = recv(dl->fd, dl->buf + dl->offset, len, 0);
 
 		if ((len == 0) || (len == -1)) {
 			/* We just had an unexpected socket error or closure */
 
 			/* If there is a partial data payload in our buffer,
-			 * and it has been accounted in our progress, we have
-			 * to hand it to the application before discarding it.
+			 * we have to hand it to the application and account
+			 * it in our progress before discarding it.
+			 * There is none if only the header was received.
 			 */
-			if ((dl->offset > 0) && (dl->has_header)) {
-				rc = fragment_evt_send(dl);
+			if (dl->has_header &&
+			    (dl->offset > dl->fragment_offset)) {
+				const size_t partial =
+					MIN(dl->offset - dl->fragment_offset,
+					    dl->fragment_len);
+
+				dl->progress += partial;
+				rc = fragment_evt_send(dl, partial);
 				if (rc) {
 					/* Restart and suspend */
 					LOG_INF("Fragment refused, download "
@@ -466,79 +702,28 @@ restart_and_suspend:
 		/* Accumulate buffer offset */
 		dl->offset += len;
 
-		if (!dl->has_header) {
-			rc = header_parse(dl);
-			if (rc > 0) {
-				/* Wait for payload */
-				continue;
-			}
-			if (rc < 0) {
-				/* Something was wrong with the header.
-				 * Restart and suspend, no point in retrying.
-				 */
-				error_evt_send(dl, EBADMSG);
-				break;
-			}
-
-			dl->has_header = true;
-		}
-
-		/* Accumulate overall file progress.
-		 *
-		 * If the last recv() call read an HTTP header,
-		 * the offset has been moved to the end of the header in
-		 * header_parse(). Thus, we accumulate the offset
-		 * to the progress.
-		 *
-		 * If the last recv() call received only a HTTP message body,
-		 * then we accumulate 'len'.
-		 *
-		 */
-		dl->progress += MIN(dl->offset, len);
-
-		/* Have we received a whole fragment or the whole file? */
-		if ((dl->offset < dl->fragment_size) &&
-		    (dl->progress != dl->file_size)) {
-			LOG_DBG("Awaiting full fragment (%u)", dl->offset);
+		rc = data_process(dl);
+		if (rc == 0) {
 			continue;
 		}
-
-		LOG_INF("Downloaded %u/%u bytes (%d%%)", dl->progress,
-			dl->file_size, (dl->progress * 100) / dl->file_size);
-
-		/* Send fragment to application.
-		 * If the application callback returns non-zero, stop.
-		 */
-		rc = fragment_evt_send(dl);
-		if (rc) {
+		if (rc > 0) {
 			/* Restart and suspend */
-			LOG_INF("Fragment refused, download stopped.");
 			break;
 		}
 
-		if (dl->progress == dl->file_size) {
-			LOG_INF("Download complete");
-			const struct download_client_evt evt = {
-				.id = DOWNLOAD_CLIENT_EVT_DONE,
-			};
-			dl->callback(&evt);
+		/* Failed to send the request */
+		rc = error_evt_send(dl, ECONNRESET);
+		if (rc) {
 			/* Restart and suspend */
 			break;
 		}
+		reconnect(dl);
 
-		/* Attempt to reconnect if the connection was closed */
-		if (dl->connection_close) {
-			dl->connection_close = false;
-			reconnect(dl);
-		}
-
-		/* Request next fragment */
 		/* Send a GET request for the next bytes */
 send_again:
-		dl->offset = 0;
-		dl->has_header = false;
+		pipeline_reset(dl);
 
-		rc = get_request_send(dl);
+		rc = pipeline_fill(dl);
 		if (rc) {
 			rc = error_evt_send(dl, ECONNRESET);
 			if (rc) {
@@ -563,6 +748,7 @@ int download_client_init(struct download_client *const client,
 
 	client->fd = -1;
 	client->callback = callback;
+	client->pending_requests = 0;
 
 	/* The thread is spawned now, but it will suspend itself;
 	 * it is resumed when the download is started via the API.
@@ -664,13 +850,26 @@ int download_client_start(struct download_client *client, const char *file,
 	client->file_size = 0;
 	client->progress = from;
 
-	client->offset = 0;
-	client->has_header = false;
+	client->start_progress = from;
+	client->start_time = k_uptime_get();
+
+	if (client->pending_requests > 0) {
+		/* The previous download was stopped with requests pending.
+		 * Their responses would be received before the responses
+		 * to the new requests, so drop them by reconnecting.
+		 */
+		err = reconnect(client);
+		if (err) {
+			return err;
+		}
+	}
+
+	pipeline_reset(client);
 
 	LOG_INF("Downloading: %s [%u]", log_strdup(client->file),
 		client->progress);
 
-	err = get_request_send(client);
+	err = pipeline_fill(client);
 	if (err) {
 		return err;
 	}
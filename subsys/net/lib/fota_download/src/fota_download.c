@@ -5,12 +5,20 @@
  */
 
 #include <zephyr.h>
+#include <string.h>
 #include <logging/log.h>
 #include <net/fota_download.h>
 #include <net/download_client.h>
 #include <dfu/dfu_target.h>
 #include <pm_config.h>
 
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+#include "fota_download_manifest.h"
+
+BUILD_ASSERT_MSG(FOTA_MANIFEST_HASH_SIZE == FOTA_DOWNLOAD_HASH_SIZE,
+		 "Manifest and download image hash sizes differ");
+#endif
+
 #ifdef PM_S1_ADDRESS
 /* MCUBoot support is required */
 #include <fw_info.h>
@@ -24,6 +32,14 @@ static fota_download_callback_t callback;
 static struct download_client   dlc;
 static struct k_delayed_work    dlc_with_offset_work;
 static int socket_retries_left;
+static const char *image_file;
+
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+static bool manifest_downloading;
+static int block_retries_left;
+/* Image offset of the last corrupted block, retries are counted per block */
+static size_t bad_block_offset;
+#endif
 
 static void send_evt(enum fota_download_evt_id id)
 {
@@ -57,6 +73,17 @@ static void dfu_target_callback_handler(enum dfu_target_evt_id evt)
 	}
 }
 
+static int image_write(const void *buf, size_t len)
+{
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+	if (fota_manifest_valid()) {
+		/* Blocks are written to the DFU target once verified */
+		return fota_manifest_image_write(buf, len);
+	}
+#endif
+	return dfu_target_write(buf, len);
+}
+
 static int download_client_callback(const struct download_client_evt *event)
 {
 	static bool first_fragment = true;
@@ -70,6 +97,19 @@ static int download_client_callback(const struct download_client_evt *event)
 
 	switch (event->id) {
 	case DOWNLOAD_CLIENT_EVT_FRAGMENT: {
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+		if (manifest_downloading) {
+			err = fota_manifest_write(event->fragment.buf,
+						  event->fragment.len);
+			if (err != 0) {
+				manifest_downloading = false;
+				(void) download_client_disconnect(&dlc);
+				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
+				return err;
+			}
+			break;
+		}
+#endif
 		if (first_fragment) {
 			err = download_client_file_size_get(&dlc, &file_size);
 			if (err != 0) {
@@ -78,6 +118,16 @@ static int download_client_callback(const struct download_client_evt *event)
 				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
 				return err;
 			}
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+			if (fota_manifest_valid() &&
+			    (file_size != fota_manifest_image_size())) {
+				LOG_ERR("File size %d does not match manifest",
+					file_size);
+				(void) download_client_disconnect(&dlc);
+				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
+				return -EBADMSG;
+			}
+#endif
 			first_fragment = false;
 			int img_type = dfu_target_img_type(event->fragment.buf,
 							event->fragment.len);
@@ -107,8 +157,28 @@ static int download_client_callback(const struct download_client_evt *event)
 			}
 		}
 
-		err = dfu_target_write(event->fragment.buf,
-				       event->fragment.len);
+		err = image_write(event->fragment.buf, event->fragment.len);
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+		/* Only verified blocks have been written, so the
+		 * DFU target offset is the start of the bad block.
+		 */
+		if ((err == -EBADMSG) &&
+		    (dfu_target_offset_get(&offset) == 0) &&
+		    (offset != bad_block_offset)) {
+			bad_block_offset = offset;
+			block_retries_left =
+				CONFIG_FOTA_DOWNLOAD_MANIFEST_BLOCK_RETRIES;
+		}
+
+		if ((err == -EBADMSG) && (block_retries_left > 0)) {
+			block_retries_left--;
+			LOG_WRN("Corrupted block, %d retries left...",
+				block_retries_left);
+			k_delayed_work_submit(&dlc_with_offset_work,
+					      K_SECONDS(1));
+			return -1;
+		}
+#endif
 		if (err != 0) {
 			LOG_ERR("dfu_target_write error %d", err);
 			(void) download_client_disconnect(&dlc);
@@ -139,6 +209,47 @@ static int download_client_callback(const struct download_client_evt *event)
 	}
 
 	case DOWNLOAD_CLIENT_EVT_DONE:
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+		if (manifest_downloading) {
+			manifest_downloading = false;
+			err = fota_manifest_finalize();
+			if (err != 0) {
+				(void) download_client_disconnect(&dlc);
+				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
+				return err;
+			}
+
+			/* The download client is suspended after this event,
+			 * so start the image download from the work queue.
+			 */
+			k_delayed_work_submit(&dlc_with_offset_work,
+					      K_SECONDS(1));
+			break;
+		}
+
+		if (fota_manifest_valid()) {
+			err = fota_manifest_image_done();
+			if (err != 0) {
+				LOG_ERR("Image not verified, err: %d", err);
+				(void) download_client_disconnect(&dlc);
+				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
+				return err;
+			}
+#ifdef CONFIG_DFU_TARGET_STREAM_HASH
+			u8_t hash[DFU_TARGET_HASH_SIZE];
+
+			/* Not available if the image was resumed after reset */
+			if ((dfu_target_hash_get(hash) == 0) &&
+			    memcmp(hash, fota_manifest_image_hash(),
+				   sizeof(hash))) {
+				LOG_ERR("Image hash does not match manifest");
+				(void) download_client_disconnect(&dlc);
+				send_evt(FOTA_DOWNLOAD_EVT_ERROR);
+				return -EBADMSG;
+			}
+#endif
+		}
+#endif
 		err = dfu_target_done(true);
 		if (err != 0) {
 			LOG_ERR("dfu_target_done error: %d", err);
@@ -170,6 +281,9 @@ static int download_client_callback(const struct download_client_evt *event)
 		} else {
 			download_client_disconnect(&dlc);
 			LOG_ERR("Download client error");
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+			manifest_downloading = false;
+#endif
 			err = dfu_target_done(false);
 			if (err == -EACCES) {
 				LOG_DBG("No DFU target was initialized");
@@ -192,10 +306,21 @@ static int download_client_callback(const struct download_client_evt *event)
 
 static void download_with_offset(struct k_work *unused)
 {
-	int offset;
+	size_t offset;
 	int err = dfu_target_offset_get(&offset);
 
-	err = download_client_start(&dlc, dlc.file, offset);
+	if (err != 0) {
+		/* DFU target is not initialized yet */
+		offset = 0;
+	}
+
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+	if (fota_manifest_valid()) {
+		fota_manifest_image_offset_set(offset);
+	}
+#endif
+
+	err = download_client_start(&dlc, image_file, offset);
 
 	LOG_INF("Downloading from offset: 0x%x", offset);
 	if (err != 0) {
@@ -203,7 +328,8 @@ static void download_with_offset(struct k_work *unused)
 	}
 }
 
-int fota_download_start(const char *host, const char *file, int sec_tag)
+static int download_start(const char *host, const char *file,
+			  const char *manifest, int sec_tag)
 {
 	int err = -1;
 
@@ -216,6 +342,12 @@ int fota_download_start(const char *host, const char *file, int sec_tag)
 	}
 
 	socket_retries_left = CONFIG_FOTA_SOCKET_RETRIES;
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+	block_retries_left = CONFIG_FOTA_DOWNLOAD_MANIFEST_BLOCK_RETRIES;
+	bad_block_offset = 0;
+	fota_manifest_reset();
+	manifest_downloading = (manifest != NULL);
+#endif
 
 #ifdef PM_S1_ADDRESS
 	/* B1 upgrade is supported, check what B1 slot is active,
@@ -254,8 +386,14 @@ int fota_download_start(const char *host, const char *file, int sec_tag)
 		return err;
 	}
 
-	err = download_client_start(&dlc, file, 0);
+	image_file = file;
+
+	/* The image is downloaded once the manifest has been received */
+	err = download_client_start(&dlc, manifest ? manifest : file, 0);
 	if (err != 0) {
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+		manifest_downloading = false;
+#endif
 		download_client_disconnect(&dlc);
 		return err;
 	}
@@ -263,6 +401,38 @@ int fota_download_start(const char *host, const char *file, int sec_tag)
 	return 0;
 }
 
+int fota_download_start(const char *host, const char *file, int sec_tag)
+{
+	return download_start(host, file, NULL, sec_tag);
+}
+
+#ifdef CONFIG_FOTA_DOWNLOAD_MANIFEST
+int fota_download_start_with_manifest(const char *host, const char *file,
+				      const char *manifest, int sec_tag)
+{
+	if (manifest == NULL) {
+		return -EINVAL;
+	}
+
+	return download_start(host, file, manifest, sec_tag);
+}
+
+int fota_download_image_hash_get(u8_t *hash)
+{
+	if (hash == NULL) {
+		return -EINVAL;
+	}
+
+	if (!fota_manifest_valid()) {
+		return -ENODATA;
+	}
+
+	memcpy(hash, fota_manifest_image_hash(), FOTA_MANIFEST_HASH_SIZE);
+
+	return 0;
+}
+#endif /* CONFIG_FOTA_DOWNLOAD_MANIFEST */
+
 int fota_download_init(fota_download_callback_t client_callback)
 {
 	if (client_callback == NULL) {
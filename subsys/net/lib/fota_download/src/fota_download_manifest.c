@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <logging/log.h>
+#include <dfu/dfu_target.h>
+#include <tinycrypt/sha256.h>
+#include <tinycrypt/constants.h>
+
+#include "fota_download_manifest.h"
+
+LOG_MODULE_DECLARE(fota_download, CONFIG_FOTA_DOWNLOAD_LOG_LEVEL);
+
+#define MANIFEST_MAX_SIZE (sizeof(struct fota_manifest_header) + \
+	CONFIG_FOTA_DOWNLOAD_MANIFEST_MAX_BLOCKS * FOTA_MANIFEST_HASH_SIZE)
+
+static struct {
+	struct fota_manifest_header hdr;
+	u8_t block_hash[CONFIG_FOTA_DOWNLOAD_MANIFEST_MAX_BLOCKS]
+		       [FOTA_MANIFEST_HASH_SIZE];
+} __packed manifest;
+
+BUILD_ASSERT_MSG(sizeof(manifest) == MANIFEST_MAX_SIZE,
+		 "Unexpected manifest layout");
+
+static size_t manifest_len;
+static bool manifest_valid;
+
+/* Block of the image being received */
+static u8_t block_buf[CONFIG_FOTA_DOWNLOAD_MANIFEST_BLOCK_SIZE_MAX];
+static size_t block_len;
+static size_t block_idx;
+/* Bytes at the beginning of the block that were written before resuming */
+static size_t block_skip;
+static bool block_verify;
+/* Offset of the first image byte that has not been received */
+static size_t image_offset;
+
+void fota_manifest_reset(void)
+{
+	manifest_len = 0;
+	manifest_valid = false;
+}
+
+int fota_manifest_write(const void *buf, size_t len)
+{
+	if (len > sizeof(manifest) - manifest_len) {
+		LOG_ERR("Manifest too big");
+		return -EFBIG;
+	}
+
+	memcpy((u8_t *)&manifest + manifest_len, buf, len);
+	manifest_len += len;
+
+	return 0;
+}
+
+int fota_manifest_finalize(void)
+{
+	struct fota_manifest_header *hdr = &manifest.hdr;
+	size_t blocks;
+
+	if (manifest_len < sizeof(*hdr)) {
+		LOG_ERR("Manifest too short");
+		return -EBADMSG;
+	}
+
+	hdr->magic = sys_le32_to_cpu(hdr->magic);
+	hdr->block_size = sys_le32_to_cpu(hdr->block_size);
+	hdr->image_size = sys_le32_to_cpu(hdr->image_size);
+
+	if (hdr->magic != FOTA_MANIFEST_MAGIC) {
+		LOG_ERR("Invalid manifest magic 0x%08x", hdr->magic);
+		return -EBADMSG;
+	}
+
+	if ((hdr->block_size == 0) ||
+	    (hdr->block_size > sizeof(block_buf))) {
+		LOG_ERR("Unsupported manifest block size %u", hdr->block_size);
+		return -EBADMSG;
+	}
+
+	blocks = ceiling_fraction(hdr->image_size, hdr->block_size);
+	if ((blocks == 0) ||
+	    (blocks > CONFIG_FOTA_DOWNLOAD_MANIFEST_MAX_BLOCKS)) {
+		LOG_ERR("Unsupported number of manifest blocks %zu", blocks);
+		return -EBADMSG;
+	}
+
+	if (manifest_len != sizeof(*hdr) + blocks * FOTA_MANIFEST_HASH_SIZE) {
+		LOG_ERR("Manifest size does not match %zu blocks", blocks);
+		return -EBADMSG;
+	}
+
+	LOG_INF("Manifest: %u bytes in %zu blocks", hdr->image_size, blocks);
+
+	manifest_valid = true;
+	fota_manifest_image_offset_set(0);
+
+	return 0;
+}
+
+bool fota_manifest_valid(void)
+{
+	return manifest_valid;
+}
+
+size_t fota_manifest_image_size(void)
+{
+	return manifest.hdr.image_size;
+}
+
+void fota_manifest_image_offset_set(size_t offset)
+{
+	const size_t block_size = manifest.hdr.block_size;
+
+	block_idx = offset / block_size;
+	block_len = offset % block_size;
+	block_skip = block_len;
+	image_offset = offset;
+
+	/* When resuming in the middle of a block, the beginning of the block
+	 * has already been written and the block cannot be verified.
+	 */
+	block_verify = (block_len == 0);
+	if (!block_verify) {
+		LOG_WRN("Resuming in the middle of block %zu, "
+			"block will not be verified", block_idx);
+	}
+}
+
+static int block_complete(void)
+{
+	struct tc_sha256_state_struct sha;
+	u8_t hash[FOTA_MANIFEST_HASH_SIZE];
+	const size_t block_start = block_idx * manifest.hdr.block_size;
+	const u8_t *data = block_buf;
+	size_t len = block_len;
+	int err;
+
+	if (block_verify) {
+		if ((tc_sha256_init(&sha) != TC_CRYPTO_SUCCESS) ||
+		    (tc_sha256_update(&sha, block_buf, block_len) !=
+		     TC_CRYPTO_SUCCESS) ||
+		    (tc_sha256_final(hash, &sha) != TC_CRYPTO_SUCCESS)) {
+			return -EINVAL;
+		}
+
+		if (memcmp(hash, manifest.block_hash[block_idx],
+			   sizeof(hash))) {
+			LOG_WRN("Block %zu hash mismatch", block_idx);
+			/* Download the block again */
+			fota_manifest_image_offset_set(block_start);
+			return -EBADMSG;
+		}
+	} else {
+		/* Only the end of the block is in the buffer */
+		data += block_skip;
+		len -= block_skip;
+	}
+
+	err = dfu_target_write(data, len);
+	if (err) {
+		return err;
+	}
+
+	block_idx++;
+	block_len = 0;
+	block_skip = 0;
+	block_verify = true;
+
+	return 0;
+}
+
+int fota_manifest_image_write(const void *buf, size_t len)
+{
+	const size_t block_size = manifest.hdr.block_size;
+	const u8_t *data = buf;
+	int err;
+
+	if (len > manifest.hdr.image_size - image_offset) {
+		LOG_ERR("Image data exceeds manifest image size");
+		return -EFBIG;
+	}
+
+	while (len > 0) {
+		size_t chunk = MIN(len, block_size - block_len);
+
+		memcpy(&block_buf[block_len], data, chunk);
+		block_len += chunk;
+		image_offset += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if ((block_len == block_size) ||
+		    (image_offset == manifest.hdr.image_size)) {
+			err = block_complete();
+			if (err) {
+				return err;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int fota_manifest_image_done(void)
+{
+	if (image_offset != manifest.hdr.image_size || block_len != 0) {
+		return -ENODATA;
+	}
+
+	return 0;
+}
+
+const u8_t *fota_manifest_image_hash(void)
+{
+	return manifest.hdr.image_hash;
+}
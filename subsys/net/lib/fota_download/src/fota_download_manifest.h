@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef FOTA_DOWNLOAD_MANIFEST_H_
+#define FOTA_DOWNLOAD_MANIFEST_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <toolchain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic value at the beginning of the manifest, "FOTM". */
+#define FOTA_MANIFEST_MAGIC 0x4d544f46
+
+/** Size of the SHA-256 hashes in the manifest. */
+#define FOTA_MANIFEST_HASH_SIZE 32
+
+/**
+ * @brief Manifest header.
+ *
+ * The header is followed by one SHA-256 hash for every block of the image.
+ * The last block can be shorter than the block size. All values are
+ * little-endian.
+ */
+struct fota_manifest_header {
+	/** Must be FOTA_MANIFEST_MAGIC. */
+	u32_t magic;
+	/** Size of the blocks, in bytes. */
+	u32_t block_size;
+	/** Size of the image, in bytes. */
+	u32_t image_size;
+	/** SHA-256 hash of the whole image. */
+	u8_t image_hash[FOTA_MANIFEST_HASH_SIZE];
+} __packed;
+
+/**
+ * @brief Discard the current manifest, before downloading a new one.
+ */
+void fota_manifest_reset(void);
+
+/**
+ * @brief Store a fragment of the manifest file.
+ *
+ * @retval 0 On success.
+ * @retval -EFBIG If the manifest is larger than supported.
+ */
+int fota_manifest_write(const void *buf, size_t len);
+
+/**
+ * @brief Validate the downloaded manifest.
+ *
+ * @retval 0 If the manifest is valid.
+ * @retval -EBADMSG If the manifest is invalid or not supported.
+ */
+int fota_manifest_finalize(void);
+
+/**
+ * @brief Check if a valid manifest has been downloaded.
+ */
+bool fota_manifest_valid(void);
+
+/**
+ * @brief Get the size of the image described by the manifest.
+ */
+size_t fota_manifest_image_size(void);
+
+/**
+ * @brief Set the image offset from which the image is downloaded.
+ *
+ * The data received so far for the current block is discarded.
+ * The offset is expected to be aligned to the block size. Otherwise, the
+ * first block cannot be verified.
+ */
+void fota_manifest_image_offset_set(size_t offset);
+
+/**
+ * @brief Pass image data for verification.
+ *
+ * The data is stored until a whole block has been received. The block is
+ * then verified and written to the DFU target.
+ *
+ * @retval 0 On success.
+ * @retval -EBADMSG If the hash of a block does not match the manifest.
+ *                  The data of the block is discarded and the image must be
+ *                  downloaded again from the offset of the block.
+ * @retval -EFBIG If the data exceeds the image size.
+ *         Otherwise, the error returned by @ref dfu_target_write.
+ */
+int fota_manifest_image_write(const void *buf, size_t len);
+
+/**
+ * @brief Check that the whole image has been received and verified.
+ *
+ * @retval 0 If all blocks have been received.
+ * @retval -ENODATA If the image is not complete.
+ */
+int fota_manifest_image_done(void);
+
+/**
+ * @brief Get the SHA-256 hash of the image described by the manifest.
+ */
+const u8_t *fota_manifest_image_hash(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOTA_DOWNLOAD_MANIFEST_H_ */
@@ -13,15 +13,70 @@
 #include <SEGGER_RTT.h>
 #include <profiler.h>
 #include <string.h>
+#include <limits.h>
 
 
 /* By default, when there is no shell, all events are profiled. */
 #ifndef CONFIG_SHELL
-u32_t profiler_enabled_events = 0xffffffff;
+ATOMIC_DEFINE(profiler_enabled_events, CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS);
 #endif
 
 
+#define PROFILER_NORDIC_DROPPED_EVENT_NAME "_dropped_events"
+
+/* Period of polling for host commands (in ms). */
+#define COMMAND_POLL_PERIOD 500
+
+#define RING_BUF_SIZE CONFIG_PROFILER_NORDIC_RING_BUFFER_SIZE
+#define RING_BUF_MASK (RING_BUF_SIZE - 1)
+
+BUILD_ASSERT_MSG((RING_BUF_SIZE & RING_BUF_MASK) == 0,
+		 "Ring buffer size must be a power of two");
+BUILD_ASSERT_MSG(CONFIG_PROFILER_CUSTOM_EVENT_BUF_LEN <= UCHAR_MAX,
+		 "Event length must fit in the record header");
+
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+#define EVENT_TYPE_ID_SIZE	sizeof(u16_t)
+#define EVENT_TYPE_ID_MAX	USHRT_MAX
+#else
+#define EVENT_TYPE_ID_SIZE	sizeof(u8_t)
+#define EVENT_TYPE_ID_MAX	UCHAR_MAX
+#endif
+
+/* Varint encoding of a 32-bit value takes up to 5 bytes. */
+#define VARINT_MAX_LEN		5
+#define COMPACT_BUF_LEN		(VARINT_MAX_LEN * \
+				 (CONFIG_PROFILER_CUSTOM_EVENT_BUF_LEN / \
+				  sizeof(u32_t) + 1))
+
+/* Events are stored in the ring buffer as records made of a single byte
+ * header holding the event length followed by the event data. Producers
+ * reserve space by moving the write index with compare-and-swap, copy the
+ * event data and then commit the record by writing its header. A zero
+ * header marks a record that is reserved but not yet committed.
+ * The only consumer is the profiler thread, which moves the events to RTT
+ * and zeroes the consumed space before releasing it.
+ */
+struct event_ring_buf {
+	u8_t data[RING_BUF_SIZE];
+	atomic_t wr_idx;
+	atomic_t rd_idx;
+	atomic_t dropped_cnt;
+};
+
+static struct event_ring_buf ring_buf;
+static u32_t reported_dropped_cnt;
+static u16_t dropped_event_id;
+
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+/* Bitmask of signed arguments for every registered event type. */
+static u16_t signed_args[CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS];
+static u32_t last_timestamp;
+static bool timestamp_sync;
+#endif
+
 static K_SEM_DEFINE(profiler_sem, 0, 1);
+static K_SEM_DEFINE(drain_sem, 0, 1);
 static bool protocol_running;
 static bool sending_events;
 
@@ -44,7 +99,7 @@ static char *arg_types_encodings[] = {
 					"t"    /* time */
 				     };
 
-u8_t profiler_num_events;
+u16_t profiler_num_events;
 
 static u8_t buffer_data[CONFIG_PROFILER_NORDIC_DATA_BUFFER_SIZE];
 static u8_t buffer_info[CONFIG_PROFILER_NORDIC_INFO_BUFFER_SIZE];
@@ -63,11 +118,21 @@ static void send_system_description(void)
 	/* Memory barrier to make sure that data is visible
 	 * before being accessed
 	 */
-	u8_t ne = profiler_num_events;
+	u16_t ne = profiler_num_events;
 
 	__DMB();
 	char end_line = '\n';
 
+	if (IS_ENABLED(CONFIG_PROFILER_NORDIC_COMPACT_FORMAT)) {
+		static const char format_descr[] = "#format,compact\n";
+
+		num_bytes_send = SEGGER_RTT_WriteNoLock(
+				  CONFIG_PROFILER_NORDIC_RTT_CHANNEL_INFO,
+				  format_descr,
+				  strlen(format_descr));
+		__ASSERT_NO_MSG(num_bytes_send > 0);
+	}
+
 	for (size_t t = 0; t < ne; t++) {
 		num_bytes_send = SEGGER_RTT_WriteNoLock(
 				  CONFIG_PROFILER_NORDIC_RTT_CHANNEL_INFO,
@@ -87,6 +152,194 @@ static void send_system_description(void)
 	__ASSERT_NO_MSG(num_bytes_send > 0);
 }
 
+static void put_event_type_id(struct log_event_buf *buf, u16_t event_type_id)
+{
+	__ASSERT_NO_MSG(event_type_id <= EVENT_TYPE_ID_MAX);
+
+	if (EVENT_TYPE_ID_SIZE == sizeof(u16_t)) {
+		sys_put_le16(event_type_id, buf->payload_start);
+	} else {
+		buf->payload_start[0] = event_type_id;
+	}
+}
+
+static bool ring_buf_is_empty(void)
+{
+	return atomic_get(&ring_buf.wr_idx) == atomic_get(&ring_buf.rd_idx);
+}
+
+static bool ring_buf_put(const u8_t *data, u8_t len)
+{
+	u32_t wr_idx;
+	u32_t used;
+	u32_t rec_len = len + sizeof(u8_t);
+
+	do {
+		wr_idx = atomic_get(&ring_buf.wr_idx);
+		used = wr_idx - (u32_t)atomic_get(&ring_buf.rd_idx);
+
+		if (used + rec_len > RING_BUF_SIZE) {
+			return false;
+		}
+	} while (!atomic_cas(&ring_buf.wr_idx, wr_idx, wr_idx + rec_len));
+
+	for (size_t i = 0; i < len; i++) {
+		ring_buf.data[(wr_idx + sizeof(u8_t) + i) & RING_BUF_MASK] =
+			data[i];
+	}
+
+	/* Make sure that data is visible before the record is committed. */
+	__DMB();
+	ring_buf.data[wr_idx & RING_BUF_MASK] = len;
+
+	if (used == 0) {
+		/* Wake up the thread waiting for events. */
+		k_sem_give(&drain_sem);
+	}
+
+	return true;
+}
+
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+static size_t varint_encode(u8_t *buf, u32_t value)
+{
+	size_t len = 0;
+
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+
+	return len;
+}
+
+static u32_t zigzag_encode(s32_t value)
+{
+	return ((u32_t)value << 1) ^ (u32_t)(value >> 31);
+}
+
+/* Compact record consists of varints only:
+ * - event type ID shifted left by one, with the lowest bit set if
+ *   the record carries an absolute timestamp,
+ * - timestamp, either absolute or zigzag encoded difference from
+ *   the timestamp of the previous record,
+ * - arguments, signed ones zigzag encoded.
+ */
+static size_t compact_encode(u8_t *out, const u8_t *rec, size_t len)
+{
+	u16_t type_id = sys_get_le16(rec);
+	u32_t timestamp = sys_get_le32(rec + EVENT_TYPE_ID_SIZE);
+	bool absolute = !timestamp_sync;
+	size_t out_len = 0;
+
+	out_len += varint_encode(&out[out_len], (type_id << 1) | absolute);
+	if (absolute) {
+		out_len += varint_encode(&out[out_len], timestamp);
+		timestamp_sync = true;
+	} else {
+		out_len += varint_encode(&out[out_len],
+				zigzag_encode(timestamp - last_timestamp));
+	}
+	last_timestamp = timestamp;
+
+	size_t arg_idx = 0;
+
+	for (size_t pos = EVENT_TYPE_ID_SIZE + sizeof(timestamp);
+	     pos + sizeof(u32_t) <= len;
+	     pos += sizeof(u32_t), arg_idx++) {
+		u32_t arg = sys_get_le32(rec + pos);
+
+		if (signed_args[type_id] & BIT(arg_idx)) {
+			arg = zigzag_encode(arg);
+		}
+		out_len += varint_encode(&out[out_len], arg);
+	}
+
+	return out_len;
+}
+#endif /* CONFIG_PROFILER_NORDIC_COMPACT_FORMAT */
+
+static bool send_event(const u8_t *rec, size_t len)
+{
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+	u8_t out[COMPACT_BUF_LEN];
+	u32_t prev_timestamp = last_timestamp;
+	bool prev_sync = timestamp_sync;
+
+	len = compact_encode(out, rec, len);
+	rec = out;
+#endif
+
+	if (SEGGER_RTT_WriteNoLock(CONFIG_PROFILER_NORDIC_RTT_CHANNEL_DATA,
+				   rec, len) > 0) {
+		return true;
+	}
+
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+	/* Next record must refer to the last record received by host. */
+	last_timestamp = prev_timestamp;
+	timestamp_sync = prev_sync;
+#endif
+	return false;
+}
+
+static void ring_buf_drain(void)
+{
+	u8_t buf[CONFIG_PROFILER_CUSTOM_EVENT_BUF_LEN];
+	u32_t rd_idx = atomic_get(&ring_buf.rd_idx);
+
+	while (rd_idx != (u32_t)atomic_get(&ring_buf.wr_idx)) {
+		volatile u8_t *hdr = &ring_buf.data[rd_idx & RING_BUF_MASK];
+		u8_t len = *hdr;
+
+		if (len == 0) {
+			/* Producer was preempted before commit. */
+			break;
+		}
+
+		/* Make sure that data is read after the header. */
+		__DMB();
+		*hdr = 0;
+		for (size_t i = 0; i < len; i++) {
+			size_t idx = (rd_idx + sizeof(u8_t) + i) &
+				     RING_BUF_MASK;
+
+			buf[i] = ring_buf.data[idx];
+			ring_buf.data[idx] = 0;
+		}
+
+		if (!send_event(buf, len)) {
+			atomic_inc(&ring_buf.dropped_cnt);
+		}
+
+		/* Make sure that space is zeroed before it is released. */
+		__DMB();
+		rd_idx += len + sizeof(u8_t);
+		atomic_set(&ring_buf.rd_idx, rd_idx);
+	}
+}
+
+static void report_dropped_events(void)
+{
+	u32_t dropped_cnt = atomic_get(&ring_buf.dropped_cnt);
+
+	if (!sending_events || (dropped_cnt == reported_dropped_cnt)) {
+		return;
+	}
+
+	struct log_event_buf buf;
+
+	profiler_log_start(&buf);
+	profiler_log_encode_u32(&buf, dropped_cnt - reported_dropped_cnt);
+	put_event_type_id(&buf, dropped_event_id);
+
+	/* Report is sent directly as the thread is the only RTT writer. */
+	if (send_event(buf.payload_start, buf.payload - buf.payload_start)) {
+		reported_dropped_cnt = dropped_cnt;
+	}
+}
+
 static void profiler_nordic_thread_fn(void)
 {
 	while (protocol_running) {
@@ -99,6 +352,9 @@ static void profiler_nordic_thread_fn(void)
 			command = (enum nordic_command)read_data;
 			switch (command) {
 			case NORDIC_COMMAND_START:
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+				timestamp_sync = false;
+#endif
 				sending_events = true;
 				break;
 			case NORDIC_COMMAND_STOP:
@@ -112,13 +368,28 @@ static void profiler_nordic_thread_fn(void)
 				break;
 			}
 		}
-		k_sleep(500);
+		ring_buf_drain();
+		report_dropped_events();
+
+		/* Sleep until an event is profiled, polling host commands
+		 * periodically. Then let more events gather before draining.
+		 */
+		if (!ring_buf_is_empty() ||
+		    !k_sem_take(&drain_sem, COMMAND_POLL_PERIOD)) {
+			k_sleep(CONFIG_PROFILER_NORDIC_DRAIN_PERIOD);
+		}
 	}
 	k_sem_give(&profiler_sem);
 }
 
 int profiler_init(void)
 {
+#ifndef CONFIG_SHELL
+	for (size_t i = 0; i < CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS; i++) {
+		atomic_set_bit(profiler_enabled_events, i);
+	}
+#endif
+
 	protocol_running = true;
 	if (IS_ENABLED(CONFIG_PROFILER_NORDIC_START_LOGGING_ON_SYSTEM_START)) {
 		sending_events = true;
@@ -149,6 +420,14 @@ int profiler_init(void)
 		SEGGER_RTT_MODE_NO_BLOCK_SKIP);
 	__ASSERT_NO_MSG(ret >= 0);
 
+	static const char * const dropped_labels[] = {"count"};
+	static const enum profiler_arg dropped_types[] = {PROFILER_ARG_U32};
+
+	dropped_event_id = profiler_register_event_type(
+				PROFILER_NORDIC_DROPPED_EVENT_NAME,
+				(const char **)dropped_labels, dropped_types,
+				ARRAY_SIZE(dropped_types));
+
 	protocol_thread_id =  k_thread_create(&profiler_nordic_thread,
 			profiler_nordic_stack,
 			K_THREAD_STACK_SIZEOF(profiler_nordic_stack),
@@ -162,6 +441,7 @@ void profiler_term(void)
 {
 	sending_events = false;
 	protocol_running = false;
+	k_sem_give(&drain_sem);
 	k_wakeup(protocol_thread_id);
 	k_sem_take(&profiler_sem, K_FOREVER);
 }
@@ -179,7 +459,20 @@ u16_t profiler_register_event_type(const char *name, const char **args,
 	 * from multiple threads
 	 */
 	k_sched_lock();
-	u8_t ne = profiler_num_events;
+	u16_t ne = profiler_num_events;
+
+#ifdef CONFIG_PROFILER_NORDIC_COMPACT_FORMAT
+	__ASSERT_NO_MSG(arg_cnt <= 16);
+	signed_args[ne] = 0;
+	for (size_t t = 0; t < arg_cnt; t++) {
+		if ((arg_types[t] == PROFILER_ARG_S8) ||
+		    (arg_types[t] == PROFILER_ARG_S16) ||
+		    (arg_types[t] == PROFILER_ARG_S32)) {
+			signed_args[ne] |= BIT(t);
+		}
+	}
+#endif
+
 	size_t temp = snprintf(descr[ne],
 			CONFIG_MAX_LENGTH_OF_CUSTOM_EVENTS_DESCRIPTIONS,
 			"%s,%d", name, ne);
@@ -219,9 +512,10 @@ u16_t profiler_register_event_type(const char *name, const char **args,
 
 void profiler_log_start(struct log_event_buf *buf)
 {
-	/* Adding one to pointer to make space for event type ID */
-	__ASSERT_NO_MSG(sizeof(u8_t) <= CONFIG_PROFILER_CUSTOM_EVENT_BUF_LEN);
-	buf->payload = buf->payload_start + sizeof(u8_t);
+	/* Moving pointer to make space for event type ID */
+	__ASSERT_NO_MSG(EVENT_TYPE_ID_SIZE <=
+			CONFIG_PROFILER_CUSTOM_EVENT_BUF_LEN);
+	buf->payload = buf->payload_start + EVENT_TYPE_ID_SIZE;
 	profiler_log_encode_u32(buf, k_cycle_get_32());
 }
 
@@ -241,19 +535,12 @@ void profiler_log_add_mem_address(struct log_event_buf *buf,
 
 void profiler_log_send(struct log_event_buf *buf, u16_t event_type_id)
 {
-	__ASSERT_NO_MSG(event_type_id <= UCHAR_MAX);
 	if (sending_events) {
-		u8_t type_id = event_type_id & UCHAR_MAX;
+		put_event_type_id(buf, event_type_id);
 
-		buf->payload_start[0] = type_id;
-		int key = irq_lock();
-
-		u8_t num_bytes_send = SEGGER_RTT_WriteNoLock(
-				CONFIG_PROFILER_NORDIC_RTT_CHANNEL_DATA,
-				buf->payload_start,
-				buf->payload - buf->payload_start);
-		ARG_UNUSED(num_bytes_send);
-		irq_unlock(key);
-		__ASSERT_NO_MSG(num_bytes_send > 0);
+		if (!ring_buf_put(buf->payload_start,
+				  buf->payload - buf->payload_start)) {
+			atomic_inc(&ring_buf.dropped_cnt);
+		}
 	}
 }
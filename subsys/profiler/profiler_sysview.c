@@ -11,13 +11,13 @@
 
 /* By default, when there is no shell, all events are profiled. */
 #ifndef CONFIG_SHELL
-u32_t profiler_enabled_events = 0xffffffff;
+ATOMIC_DEFINE(profiler_enabled_events, CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS);
 #endif
 
 static char descr[CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS]
 		 [CONFIG_MAX_LENGTH_OF_CUSTOM_EVENTS_DESCRIPTIONS];
 
-u8_t profiler_num_events;
+u16_t profiler_num_events;
 
 static char *arg_types_encodings[] = {
 					"%u",	/* u8_t */
@@ -66,6 +66,12 @@ static u32_t shorten_mem_address(const void *event_mem_address)
 
 int profiler_init(void)
 {
+#ifndef CONFIG_SHELL
+	for (size_t i = 0; i < CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS; i++) {
+		atomic_set_bit(profiler_enabled_events, i);
+	}
+#endif
+
 	SEGGER_SYSVIEW_RegisterModule(&events);
 	return 0;
 }
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "gpio_pins.h"
+
+/* This configuration file is included only once from button module and holds
+ * information about pins forming keyboard matrix.
+ */
+
+/* This structure enforces the header file is included only once in the build.
+ * Violating this requirement triggers a multiple definition error at link time.
+ */
+const struct {} buttons_def_include_once;
+
+/* The test filters the matrix state directly, the pins are not used. */
+static const struct gpio_pin col[] = {
+	{ .port = 0, .pin = 2 },
+	{ .port = 0, .pin = 21 },
+	{ .port = 0, .pin = 20 },
+	{ .port = 0, .pin = 19 },
+};
+
+static const struct gpio_pin row[] = {
+	{ .port = 0, .pin = 29 },
+	{ .port = 0, .pin = 31 },
+	{ .port = 0, .pin = 22 },
+	{ .port = 0, .pin = 24 },
+};
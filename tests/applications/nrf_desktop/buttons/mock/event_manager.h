@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _EVENT_MANAGER_H_
+#define _EVENT_MANAGER_H_
+
+/* Event manager mock. Events are not queued, the test receives every
+ * submitted event through event_manager_mock_submit().
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <toolchain/common.h>
+#include <sys/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct event_type {
+	const char *name;
+};
+
+struct event_header {
+	const struct event_type *type_id;
+};
+
+struct event_dyndata {
+	size_t size;
+	u8_t data[0];
+};
+
+struct event_listener {
+	const char *name;
+	bool (*notification)(const struct event_header *eh);
+};
+
+void event_manager_mock_submit(struct event_header *eh);
+
+#define EVENT_SUBMIT(event) event_manager_mock_submit(&event->header)
+
+#define _EVENT_TYPE_DECLARE_COMMON(ename)					\
+	extern const struct event_type _CONCAT(__event_type_, ename);		\
+	static inline bool _CONCAT(is_, ename)(const struct event_header *eh)	\
+	{									\
+		return (eh->type_id == &_CONCAT(__event_type_, ename));		\
+	}									\
+	static inline struct ename *_CONCAT(cast_, ename)(			\
+			const struct event_header *eh)				\
+	{									\
+		return CONTAINER_OF(eh, struct ename, header);			\
+	}
+
+#define EVENT_TYPE_DECLARE(ename)						\
+	_EVENT_TYPE_DECLARE_COMMON(ename)					\
+	struct ename *_CONCAT(new_, ename)(void)
+
+#define EVENT_TYPE_DYNDATA_DECLARE(ename)					\
+	_EVENT_TYPE_DECLARE_COMMON(ename)					\
+	struct ename *_CONCAT(new_, ename)(size_t size)
+
+#define EVENT_TYPE_DEFINE(ename)						\
+	const struct event_type _CONCAT(__event_type_, ename) = {		\
+		.name = STRINGIFY(ename),					\
+	}
+
+#define EVENT_LISTENER(lname, cb_fn)						\
+	const struct event_listener _CONCAT(__event_listener_, lname) = {	\
+		.name = STRINGIFY(lname),					\
+		.notification = (cb_fn),					\
+	}
+
+#define EVENT_SUBSCRIBE(lname, ename)						\
+	extern const struct event_type _CONCAT(__event_type_, ename)
+
+#define EVENT_SUBSCRIBE_EARLY(lname, ename) EVENT_SUBSCRIBE(lname, ename)
+
+#define EVENT_SUBSCRIBE_FINAL(lname, ename) EVENT_SUBSCRIBE(lname, ename)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EVENT_MANAGER_H_ */
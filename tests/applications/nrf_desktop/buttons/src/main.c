@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+/* The module is included to test its internal functions. */
+#include "buttons.c"
+
+#define ROWS		ARRAY_SIZE(row)
+#define MATRIX_STATES	BIT(COLUMNS * ROWS)
+
+EVENT_TYPE_DEFINE(button_event);
+EVENT_TYPE_DEFINE(power_down_event);
+EVENT_TYPE_DEFINE(wake_up_event);
+EVENT_TYPE_DEFINE(module_state_event);
+
+const void * const __module_main = "main";
+
+/* The matrix is not scanned, no events are expected. */
+static union {
+	struct button_event button;
+	struct wake_up_event wake_up;
+	struct module_state_event module_state;
+} event;
+
+struct button_event *new_button_event(void)
+{
+	return &event.button;
+}
+
+struct wake_up_event *new_wake_up_event(void)
+{
+	return &event.wake_up;
+}
+
+struct module_state_event *new_module_state_event(void)
+{
+	return &event.module_state;
+}
+
+void event_manager_mock_submit(struct event_header *eh)
+{
+	zassert_unreachable("Unexpected event");
+}
+
+/* Ghosting filter as it was implemented before, checking the rows used by
+ * every other column separately.
+ */
+static void legacy_filter_ghosting(const u32_t *raw_state, u32_t *cur_state)
+{
+	for (size_t i = 0; i < COLUMNS; i++) {
+		u32_t blocking_mask = 0;
+
+		for (size_t j = 0; j < COLUMNS; j++) {
+			if (i == j) {
+				continue;
+			}
+			blocking_mask |= raw_state[j];
+		}
+		blocking_mask ^= raw_state[i];
+		cur_state[i] = raw_state[i];
+		if (!is_power_of_two(raw_state[i])) {
+			cur_state[i] &= blocking_mask;
+		}
+	}
+}
+
+static void test_ghosting_equivalence(void)
+{
+	BUILD_ASSERT_MSG(COLUMNS * ROWS < 32, "Matrix too big to test");
+
+	/* Every combination of pressed keys. */
+	for (u32_t keys = 0; keys < MATRIX_STATES; keys++) {
+		u32_t raw_state[COLUMNS];
+		u32_t cur_state[COLUMNS];
+		u32_t expected[COLUMNS];
+
+		for (size_t i = 0; i < COLUMNS; i++) {
+			raw_state[i] = (keys >> (i * ROWS)) & BIT_MASK(ROWS);
+		}
+
+		filter_ghosting(raw_state, cur_state);
+		legacy_filter_ghosting(raw_state, expected);
+
+		zassert_equal(memcmp(cur_state, expected, sizeof(expected)), 0,
+			      "Different result for keys 0x%x", keys);
+	}
+}
+
+static void test_ghosting(void)
+{
+	/* Keys at (0, 0), (0, 1) and (1, 0). The key at (1, 1) would be
+	 * reported as pressed by the matrix as well.
+	 */
+	u32_t raw_state[COLUMNS] = { BIT(0) | BIT(1), BIT(0) | BIT(1) };
+	u32_t cur_state[COLUMNS];
+
+	filter_ghosting(raw_state, cur_state);
+
+	zassert_equal(cur_state[0], 0, "Ghost key not filtered");
+	zassert_equal(cur_state[1], 0, "Ghost key not filtered");
+
+	/* Single key in a column is always reported. */
+	raw_state[1] = BIT(0);
+	filter_ghosting(raw_state, cur_state);
+
+	zassert_equal(cur_state[0], BIT(1), "Wrong keys in column 0");
+	zassert_equal(cur_state[1], BIT(0), "Wrong keys in column 1");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(buttons,
+			 ztest_unit_test(test_ghosting),
+			 ztest_unit_test(test_ghosting_equivalence)
+			 );
+
+	ztest_run_test_suite(buttons);
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _BLE_EVENT_H_
+#define _BLE_EVENT_H_
+
+/* Bluetooth peer event without the Bluetooth stack dependencies. */
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum peer_state {
+	PEER_STATE_DISCONNECTED,
+	PEER_STATE_DISCONNECTING,
+	PEER_STATE_CONNECTED,
+	PEER_STATE_SECURED,
+	PEER_STATE_CONN_FAILED,
+	PEER_STATE_COUNT
+};
+
+struct ble_peer_event {
+	struct event_header header;
+
+	enum peer_state state;
+	void *id;
+};
+
+EVENT_TYPE_DECLARE(ble_peer_event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLE_EVENT_H_ */
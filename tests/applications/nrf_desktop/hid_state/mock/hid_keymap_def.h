@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "hid_keymap.h"
+#include "key_id.h"
+
+/* This configuration file is included only once from hid_state module and holds
+ * information about mapping between buttons and generated reports.
+ */
+
+/* This structure enforces the header file is included only once in the build.
+ * Violating this requirement triggers a multiple definition error at link time.
+ */
+const struct {} hid_keymap_def_include_once;
+
+/* The test updates the report items directly, the keymap is not used. */
+static const struct hid_keymap hid_keymap[] = {
+	{ KEY_ID(0, 0), 0x01, REPORT_ID_MOUSE }, /* Left Mouse Button */
+	{ KEY_ID(0, 1), 0x04, REPORT_ID_KEYBOARD_KEYS }, /* A */
+	{ KEY_ID(0, 2), 0x00E9, REPORT_ID_CONSUMER_CTRL }, /* Volume up */
+};
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _HID_REPORT_DESC_H_
+#define _HID_REPORT_DESC_H_
+
+/* HID report definitions of nrf_desktop with the keyboard rollover set by
+ * KEYBOARD_REPORT_KEY_COUNT_MAX, see CMakeLists.txt.
+ */
+
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <toolchain/common.h>
+#include <sys/util.h>
+
+#include "hid_report_mouse.h"
+#include "hid_report_system_ctrl.h"
+#include "hid_report_consumer_ctrl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPORT_SIZE_KEYBOARD_KEYS	(KEYBOARD_REPORT_KEY_COUNT_MAX + 2)
+
+#define KEYBOARD_REPORT_LAST_KEY	0x65 /* Keyboard Application */
+#define KEYBOARD_REPORT_FIRST_MODIFIER	0xE0 /* Keyboard Left Ctrl */
+#define KEYBOARD_REPORT_LAST_MODIFIER	0xE7 /* Keyboard Right GUI */
+
+enum report_id {
+	REPORT_ID_RESERVED,
+
+	REPORT_ID_MOUSE,
+	REPORT_ID_KEYBOARD_KEYS,
+	REPORT_ID_SYSTEM_CTRL,
+	REPORT_ID_CONSUMER_CTRL,
+
+	REPORT_ID_KEYBOARD_LEDS,
+
+	REPORT_ID_USER_CONFIG,
+
+	REPORT_ID_VENDOR_IN,
+	REPORT_ID_VENDOR_OUT,
+
+	REPORT_ID_BOOT_MOUSE,
+	REPORT_ID_BOOT_KEYBOARD,
+
+	REPORT_ID_COUNT
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_REPORT_DESC_H_ */
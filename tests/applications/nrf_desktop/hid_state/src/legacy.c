@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/util.h>
+#include <sys/__assert.h>
+#include <sys/slist.h>
+
+#include "hid_report_desc.h"
+#include "legacy.h"
+#include "test_clock.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(hid_state_legacy, CONFIG_DESKTOP_HID_STATE_LOG_LEVEL);
+
+#define ITEM_COUNT MAX(MAX(MOUSE_REPORT_BUTTON_COUNT_MAX,	\
+			   KEYBOARD_REPORT_KEY_COUNT_MAX),	\
+		       MAX(SYSTEM_CTRL_REPORT_KEY_COUNT_MAX,	\
+			   CONSUMER_CTRL_REPORT_KEY_COUNT_MAX))
+
+
+/**@brief HID state item. */
+struct item {
+	u16_t usage_id; /**< HID usage ID. */
+	s16_t value; /**< HID value. */
+};
+
+/**@brief Structure keeping state for a single target HID report. */
+struct items {
+	u8_t item_count_max; /**< Maximal numer of items in this set. */
+	u8_t item_count; /**< Current number of items in this set. */
+	struct item item[ITEM_COUNT]; /**< Items set. Browse from the end. */
+};
+
+/**@brief Enqueued HID state item. */
+struct item_event {
+	sys_snode_t node; /**< Event queue linked list node. */
+	struct item item; /**< HID state item which has been enqueued. */
+	u32_t timestamp; /**< HID event timestamp. */
+};
+
+/**@brief Event queue. */
+struct eventq {
+	sys_slist_t root;
+	size_t len;
+};
+
+
+static struct items legacy_items;
+static struct eventq legacy_eventq = {
+	.root = SYS_SLIST_STATIC_INIT(&legacy_eventq.root),
+};
+
+
+/**@brief Binary search. Input array must be already sorted. */
+static void *bsearch(const void *key, const u8_t *base,
+			 size_t elem_num, size_t elem_size,
+			 int (*compare)(const void *, const void *))
+{
+	__ASSERT_NO_MSG(base);
+	__ASSERT_NO_MSG(compare);
+	__ASSERT_NO_MSG(elem_num <= SSIZE_MAX);
+
+	if (!elem_num) {
+		return NULL;
+	}
+
+	ssize_t lower = 0;
+	ssize_t upper = elem_num - 1;
+
+	while (upper >= lower) {
+		ssize_t m = (lower + upper) / 2;
+		int cmp = compare(key, base + (elem_size * m));
+
+		if (cmp == 0) {
+			return (void *)(base + (elem_size * m));
+		} else if (cmp < 0) {
+			upper = m - 1;
+		} else {
+			lower = m + 1;
+		}
+	}
+
+	/* key not found */
+	return NULL;
+}
+
+/**@brief Compare Usage ID in HID items. */
+static int usage_id_compare(const void *a, const void *b)
+{
+	const struct item *p_a = a;
+	const struct item *p_b = b;
+
+	return (p_a->usage_id - p_b->usage_id);
+}
+
+static void eventq_reset(struct eventq *eventq)
+{
+	struct item_event *event;
+	struct item_event *tmp;
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
+		sys_slist_remove(&eventq->root, NULL, &event->node);
+
+		k_free(event);
+	}
+
+	sys_slist_init(&eventq->root);
+	eventq->len = 0;
+}
+
+static struct item_event *eventq_get(struct eventq *eventq)
+{
+	sys_snode_t *node = sys_slist_get(&eventq->root);
+
+	if (!node) {
+		return NULL;
+	}
+
+	eventq->len--;
+
+	return CONTAINER_OF(node, struct item_event, node);
+}
+
+static void eventq_append(struct eventq *eventq, u16_t usage_id, s16_t value)
+{
+	struct item_event *hid_event = k_malloc(sizeof(*hid_event));
+
+	if (!hid_event) {
+		LOG_WRN("Failed to allocate HID event");
+		return;
+	}
+
+	hid_event->item.usage_id = usage_id;
+	hid_event->item.value = value;
+	hid_event->timestamp = K_MSEC(k_uptime_get());
+
+	/* Add a new event to the queue. */
+	sys_slist_append(&eventq->root, &hid_event->node);
+
+	eventq->len++;
+}
+
+static void eventq_region_purge(struct eventq *eventq,
+				sys_snode_t *last_to_purge)
+{
+	sys_snode_t *tmp;
+	sys_snode_t *tmp_safe;
+	size_t cnt = 0;
+
+	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
+		sys_slist_remove(&eventq->root, NULL, tmp);
+
+		k_free(CONTAINER_OF(tmp, struct item_event, node));
+		cnt++;
+
+		if (tmp == last_to_purge) {
+			break;
+		}
+	}
+
+	eventq->len -= cnt;
+
+	LOG_WRN("%u stale events removed from the queue!", cnt);
+}
+
+
+static void eventq_cleanup(struct eventq *eventq, u32_t timestamp)
+{
+	/* Find timed out events. */
+
+	sys_snode_t *first_valid;
+
+	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
+		u32_t diff = timestamp - CONTAINER_OF(
+			first_valid, struct item_event, node)->timestamp;
+
+		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
+			break;
+		}
+	}
+
+	/* Remove events but only if key up was generated for each removed
+	 * key down.
+	 */
+
+	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
+	size_t maxfound_pos = 0;
+
+	sys_snode_t *cur;
+	size_t cur_pos = 0;
+
+	sys_snode_t *tmp_safe;
+
+	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
+		const struct item cur_item =
+			CONTAINER_OF(cur, struct item_event, node)->item;
+
+		if (cur_item.value > 0) {
+			/* Every key down must be paired with key up.
+			 * Set hit count to value as we just detected
+			 * first key down for this usage.
+			 */
+
+			unsigned int hit_count = cur_item.value;
+			sys_snode_t *j = cur;
+			size_t j_pos = cur_pos;
+
+			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
+				j_pos++;
+				if (j == first_valid) {
+					break;
+				}
+
+				const struct item item =
+					CONTAINER_OF(j,
+						     struct item_event,
+						     node)->item;
+
+				if (cur_item.usage_id == item.usage_id) {
+					hit_count += item.value;
+
+					if (hit_count == 0) {
+						/* All events with this usage
+						 * are paired.
+						 */
+						break;
+					}
+				}
+			}
+
+			if (j == first_valid) {
+				/* Pair not found. */
+				break;
+			}
+
+			if (j_pos > maxfound_pos) {
+				maxfound = j;
+				maxfound_pos = j_pos;
+			}
+		}
+
+
+		if (cur == first_valid) {
+			break;
+		}
+
+		if (cur == maxfound) {
+			/* All events up to this point have pairs and can
+			 * be deleted.
+			 */
+			eventq_region_purge(eventq, maxfound);
+		}
+
+		cur_pos++;
+	}
+}
+
+static void sort_by_usage_id(struct item items[], size_t array_size)
+{
+	for (size_t k = 0; k < array_size; k++) {
+		size_t id = k;
+
+		for (size_t l = k + 1; l < array_size; l++) {
+			if (items[l].usage_id < items[id].usage_id) {
+				id = l;
+			}
+		}
+		if (id != k) {
+			struct item tmp = items[k];
+
+			items[k] = items[id];
+			items[id] = tmp;
+		}
+	}
+}
+
+static void clear_items(struct items *items)
+{
+	memset(items->item, 0, sizeof(items->item));
+	items->item_count = 0;
+}
+
+static bool key_value_set(struct items *items, u16_t usage_id, s16_t value)
+{
+	const u8_t prev_item_count = items->item_count;
+
+	bool update_needed = false;
+	struct item *p_item;
+
+	__ASSERT_NO_MSG(usage_id != 0);
+	__ASSERT_NO_MSG(items->item_count_max > 0);
+
+	/* Report equal to zero brings no change. This should never happen. */
+	__ASSERT_NO_MSG(value != 0);
+
+	p_item = bsearch(&usage_id,
+			 (u8_t *)items->item,
+			 ARRAY_SIZE(items->item),
+			 sizeof(items->item[0]),
+			 usage_id_compare);
+
+	if (p_item) {
+		/* Item is present in the array - update its value. */
+		p_item->value += value;
+		if (p_item->value == 0) {
+			__ASSERT_NO_MSG(items->item_count != 0);
+			items->item_count -= 1;
+			p_item->usage_id = 0;
+		}
+
+		update_needed = true;
+	} else if (value < 0) {
+		/* For items with absolute value, the value is used as
+		 * a reference counter and must not fall below zero. This
+		 * could happen if a key up event is lost and the state
+		 * receives an unpaired key down event.
+		 */
+	} else if (prev_item_count >= items->item_count_max) {
+		/* Configuration should allow the HID module to hold data
+		 * about the maximum number of simultaneously pressed keys.
+		 * Generate a warning if an item cannot be recorded.
+		 */
+		LOG_WRN("No place on the list to store HID item!");
+	} else {
+		/* After sort operation, free slots (zeros) are stored
+		 * at the beginning of the array.
+		 */
+		size_t const idx = ARRAY_SIZE(items->item) - prev_item_count - 1;
+
+		__ASSERT_NO_MSG(items->item[idx].usage_id == 0);
+
+		/* Record this value change. */
+		items->item[idx].usage_id = usage_id;
+		items->item[idx].value = value;
+		items->item_count += 1;
+
+		update_needed = true;
+	}
+
+	if (prev_item_count != items->item_count) {
+		/* Sort elements on the list. Use simple algorithm
+		 * with small footprint.
+		 */
+		sort_by_usage_id(items->item, ARRAY_SIZE(items->item));
+	}
+
+	return update_needed;
+}
+
+void legacy_items_reset(u8_t item_count_max)
+{
+	clear_items(&legacy_items);
+	legacy_items.item_count_max = item_count_max;
+}
+
+bool legacy_key_value_set(u16_t usage_id, s16_t value)
+{
+	return key_value_set(&legacy_items, usage_id, value);
+}
+
+void legacy_keyboard_encode(u8_t *data)
+{
+	const struct items *items = &legacy_items;
+
+	data[1] = 0; /* Reserved byte */
+
+	u8_t modifier_bm = 0;
+	u8_t *keys = &data[2];
+
+	const size_t max = ARRAY_SIZE(items->item);
+	size_t cnt = 0;
+	for (size_t i = 0; (i < max) && (cnt < KEYBOARD_REPORT_KEY_COUNT_MAX); i++) {
+		struct item item = items->item[max - i - 1];
+
+		if (item.usage_id) {
+			__ASSERT_NO_MSG(item.value > 0);
+			if (item.usage_id <= KEYBOARD_REPORT_LAST_KEY) {
+				__ASSERT_NO_MSG(item.usage_id <= UINT8_MAX);
+				keys[cnt] = item.usage_id;
+				cnt++;
+			} else if ((item.usage_id >= KEYBOARD_REPORT_FIRST_MODIFIER) &&
+				   (item.usage_id <= KEYBOARD_REPORT_LAST_MODIFIER)) {
+				modifier_bm |= BIT(item.usage_id - KEYBOARD_REPORT_FIRST_MODIFIER);
+			} else {
+				LOG_WRN("Undefined usage 0x%x", item.usage_id);
+			}
+		} else {
+			break;
+		}
+	}
+
+	/* Fill the rest of report with zeros. */
+	for (; cnt < KEYBOARD_REPORT_KEY_COUNT_MAX; cnt++) {
+		keys[cnt] = 0;
+	}
+
+	data[0] = modifier_bm;
+}
+
+u8_t legacy_mouse_buttons_get(void)
+{
+	const struct items *items = &legacy_items;
+
+	/* Traverse pressed keys and build mouse buttons bitmask */
+	u8_t button_bm = 0;
+	for (size_t i = 0; i < ARRAY_SIZE(items->item); i++) {
+		struct item item = items->item[i];
+
+		if (item.usage_id) {
+			__ASSERT_NO_MSG(item.usage_id <= 8);
+			__ASSERT_NO_MSG(item.value > 0);
+
+			u8_t mask = 1 << (item.usage_id - 1);
+
+			button_bm |= mask;
+		}
+	}
+
+	return button_bm;
+}
+
+u16_t legacy_ctrl_usage_get(void)
+{
+	const size_t idx = ARRAY_SIZE(legacy_items.item) - 1;
+
+	return legacy_items.item[idx].usage_id;
+}
+
+void legacy_eventq_reset(void)
+{
+	eventq_reset(&legacy_eventq);
+}
+
+void legacy_eventq_append(u16_t usage_id, s16_t value)
+{
+	eventq_append(&legacy_eventq, usage_id, value);
+}
+
+void legacy_eventq_cleanup(u32_t timestamp)
+{
+	eventq_cleanup(&legacy_eventq, timestamp);
+}
+
+size_t legacy_eventq_len(void)
+{
+	return legacy_eventq.len;
+}
+
+void legacy_eventq_peek(size_t pos, u16_t *usage_id, s16_t *value,
+			u32_t *timestamp)
+{
+	sys_snode_t *node;
+
+	__ASSERT_NO_MSG(pos < legacy_eventq.len);
+
+	SYS_SLIST_FOR_EACH_NODE(&legacy_eventq.root, node) {
+		if (pos == 0) {
+			break;
+		}
+		pos--;
+	}
+
+	struct item_event *event = CONTAINER_OF(node, struct item_event, node);
+
+	*usage_id = event->item.usage_id;
+	*value = event->item.value;
+	*timestamp = event->timestamp;
+}
+
+void legacy_eventq_get(u16_t *usage_id, s16_t *value)
+{
+	struct item_event *event = eventq_get(&legacy_eventq);
+
+	__ASSERT_NO_MSG(event);
+
+	*usage_id = event->item.usage_id;
+	*value = event->item.value;
+
+	k_free(event);
+}
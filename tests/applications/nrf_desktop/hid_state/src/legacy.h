@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _LEGACY_H_
+#define _LEGACY_H_
+
+/* Reference implementation of the HID state report items and event queue,
+ * as they were handled before the hash table, the usage ID bitmap and the
+ * ring buffer were introduced. It is used to verify that the current
+ * implementation behaves the same and to compare the performance of both.
+ */
+
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Clear all items and set the maximal number of items. */
+void legacy_items_reset(u8_t item_count_max);
+
+/** Update the value of a usage. Returns true if the report has changed. */
+bool legacy_key_value_set(u16_t usage_id, s16_t value);
+
+/** Encode a keyboard report without the report ID: modifiers, reserved byte
+ *  and KEYBOARD_REPORT_KEY_COUNT_MAX keys.
+ */
+void legacy_keyboard_encode(u8_t *data);
+
+/** Get the mouse buttons bitmask. */
+u8_t legacy_mouse_buttons_get(void);
+
+/** Get the usage ID reported in a system or consumer control report. */
+u16_t legacy_ctrl_usage_get(void);
+
+/** Remove all events from the queue. */
+void legacy_eventq_reset(void);
+
+/** Append an event with the timestamp of the test clock. */
+void legacy_eventq_append(u16_t usage_id, s16_t value);
+
+/** Remove stale events older than the timestamp. */
+void legacy_eventq_cleanup(u32_t timestamp);
+
+/** Get the number of queued events. */
+size_t legacy_eventq_len(void);
+
+/** Get a queued event without removing it. The oldest event is at zero. */
+void legacy_eventq_peek(size_t pos, u16_t *usage_id, s16_t *value,
+			u32_t *timestamp);
+
+/** Remove the oldest event from the queue. */
+void legacy_eventq_get(u16_t *usage_id, s16_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LEGACY_H_ */
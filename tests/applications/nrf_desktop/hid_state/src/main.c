@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <kernel.h>
+
+#include "legacy.h"
+#include "test_clock.h"
+
+/* The module is included to test its internal functions. */
+#include "hid_state.c"
+
+#define ROUND_COUNT		200
+#define ROUND_EVENT_COUNT	100
+#define BENCHMARK_BURST_COUNT	100
+
+#define USAGE_ID_MAX		0x3FF
+#define REPORT_MAX_SIZE		(sizeof(u8_t) + MAX(REPORT_SIZE_KEYBOARD_KEYS, \
+						    REPORT_SIZE_MOUSE))
+
+EVENT_TYPE_DEFINE(button_event);
+EVENT_TYPE_DEFINE(motion_event);
+EVENT_TYPE_DEFINE(wheel_event);
+EVENT_TYPE_DEFINE(hid_report_event);
+EVENT_TYPE_DEFINE(hid_report_sent_event);
+EVENT_TYPE_DEFINE(hid_report_subscription_event);
+EVENT_TYPE_DEFINE(ble_peer_event);
+EVENT_TYPE_DEFINE(usb_state_event);
+EVENT_TYPE_DEFINE(module_state_event);
+
+const void * const __module_main = "main";
+
+s64_t test_uptime;
+
+/* The last report submitted by the module. */
+static union {
+	struct hid_report_event event;
+	u8_t buf[sizeof(struct hid_report_event) + REPORT_MAX_SIZE];
+} report;
+
+struct hid_report_event *new_hid_report_event(size_t size)
+{
+	zassert_true(size <= REPORT_MAX_SIZE, "Report too long");
+
+	memset(&report, 0, sizeof(report));
+	report.event.header.type_id = &__event_type_hid_report_event;
+	report.event.dyndata.size = size;
+
+	return &report.event;
+}
+
+void event_manager_mock_submit(struct event_header *eh)
+{
+	zassert_true(is_hid_report_event(eh), "Unexpected event");
+}
+
+static u32_t rand_state = 1;
+
+/* Pseudo-random sequence, the same in every run. */
+static u32_t rand_get(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+/* Press or release a usage. Some releases are not paired with a press. */
+static s16_t value_get(u8_t *pressed, u16_t usage_id)
+{
+	bool release = (pressed[usage_id] > 0) ? (rand_get() % 2) :
+						 ((rand_get() % 8) == 0);
+
+	if (release) {
+		if (pressed[usage_id] > 0) {
+			pressed[usage_id]--;
+		}
+		return -1;
+	}
+
+	pressed[usage_id]++;
+	return 1;
+}
+
+static u16_t keyboard_usage_get(void)
+{
+	/* One in ten keys is a modifier. Other keys are taken from a set
+	 * twice as big as the rollover, so that the report often gets full.
+	 */
+	if ((rand_get() % 10) == 0) {
+		return KEYBOARD_REPORT_FIRST_MODIFIER + rand_get() % 8;
+	}
+
+	return 1 + rand_get() % MIN(2 * KEYBOARD_REPORT_KEY_COUNT_MAX,
+				    KEYBOARD_REPORT_LAST_KEY);
+}
+
+static void hid_state_init(void)
+{
+	struct module_state_event event = {
+		.header.type_id = &__event_type_module_state_event,
+		.module_id = MODULE_ID(main),
+		.state = MODULE_STATE_READY,
+	};
+
+	__event_listener_hid_state.notification(&event.header);
+
+	/* Reports are encoded for the first subscriber. */
+	state.selected = &state.subscriber[0];
+}
+
+static void test_keyboard_equivalence(void)
+{
+	struct report_data *rd = get_report_data(REPORT_ID_KEYBOARD_KEYS);
+	static u8_t pressed[USAGE_ID_MAX + 1];
+	u8_t expected[REPORT_SIZE_KEYBOARD_KEYS];
+
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		clear_items(&rd->items);
+		legacy_items_reset(rd->items.item_count_max);
+		memset(pressed, 0, sizeof(pressed));
+
+		for (size_t i = 0; i < ROUND_EVENT_COUNT; i++) {
+			u16_t usage_id = keyboard_usage_get();
+			s16_t value = value_get(pressed, usage_id);
+
+			zassert_equal(key_value_set(&rd->items, usage_id, value),
+				      legacy_key_value_set(usage_id, value),
+				      "Different update");
+
+			send_report_keyboard(REPORT_ID_KEYBOARD_KEYS, rd);
+			legacy_keyboard_encode(expected);
+
+			zassert_equal(report.event.dyndata.data[0],
+				      REPORT_ID_KEYBOARD_KEYS, "Wrong report ID");
+			zassert_equal(memcmp(&report.event.dyndata.data[1],
+					     expected, sizeof(expected)), 0,
+				      "Different keyboard report");
+		}
+	}
+}
+
+static void test_mouse_equivalence(void)
+{
+	struct report_data *rd = get_report_data(REPORT_ID_MOUSE);
+	static u8_t pressed[USAGE_ID_MAX + 1];
+
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		clear_items(&rd->items);
+		legacy_items_reset(rd->items.item_count_max);
+		memset(pressed, 0, sizeof(pressed));
+
+		for (size_t i = 0; i < ROUND_EVENT_COUNT; i++) {
+			/* Button usage IDs start from 1 */
+			u16_t usage_id = 1 + rand_get() %
+					 MOUSE_REPORT_BUTTON_COUNT_MAX;
+			s16_t value = value_get(pressed, usage_id);
+
+			zassert_equal(key_value_set(&rd->items, usage_id, value),
+				      legacy_key_value_set(usage_id, value),
+				      "Different update");
+
+			send_report_mouse(REPORT_ID_MOUSE, rd);
+
+			zassert_equal(report.event.dyndata.data[1],
+				      legacy_mouse_buttons_get(),
+				      "Different mouse buttons");
+		}
+	}
+}
+
+static void test_ctrl_equivalence(void)
+{
+	struct report_data *rd = get_report_data(REPORT_ID_CONSUMER_CTRL);
+	static u8_t pressed[USAGE_ID_MAX + 1];
+
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		clear_items(&rd->items);
+		legacy_items_reset(rd->items.item_count_max);
+		memset(pressed, 0, sizeof(pressed));
+
+		for (size_t i = 0; i < ROUND_EVENT_COUNT; i++) {
+			/* Usage IDs both within and above the usage bitmap */
+			u16_t usage_id = 1 + (rand_get() % 8) * 0x80;
+			s16_t value = value_get(pressed, usage_id);
+
+			zassert_equal(key_value_set(&rd->items, usage_id, value),
+				      legacy_key_value_set(usage_id, value),
+				      "Different update");
+
+			send_report_ctrl(REPORT_ID_CONSUMER_CTRL, rd);
+
+			zassert_equal(sys_get_le16(&report.event.dyndata.data[1]),
+				      legacy_ctrl_usage_get(),
+				      "Different control usage");
+		}
+	}
+}
+
+static void eventq_compare(struct eventq *eventq)
+{
+	zassert_equal(eventq->len, legacy_eventq_len(), "Different length");
+
+	for (size_t i = 0; i < eventq->len; i++) {
+		const struct item_event *event = eventq_at(eventq, i);
+		u16_t usage_id;
+		s16_t value;
+		u32_t timestamp;
+
+		legacy_eventq_peek(i, &usage_id, &value, &timestamp);
+
+		zassert_equal(event->item.usage_id, usage_id, "Different usage");
+		zassert_equal(event->item.value, value, "Different value");
+		zassert_equal(event->timestamp, timestamp,
+			      "Different timestamp");
+	}
+}
+
+static void eventq_get_compare(struct eventq *eventq)
+{
+	struct item item = eventq_get(eventq);
+	u16_t usage_id;
+	s16_t value;
+
+	legacy_eventq_get(&usage_id, &value);
+
+	zassert_equal(item.usage_id, usage_id, "Different usage");
+	zassert_equal(item.value, value, "Different value");
+}
+
+static void eventq_append_compare(struct eventq *eventq, u8_t *pressed,
+				  u32_t timestamp)
+{
+	/* Few usages, so that presses get paired */
+	u16_t usage_id = 1 + rand_get() % 6;
+	s16_t value = value_get(pressed, usage_id);
+
+	eventq_cleanup(eventq, timestamp);
+	legacy_eventq_cleanup(timestamp);
+
+	if (eventq_is_full(eventq)) {
+		eventq_get_compare(eventq);
+	}
+
+	eventq_append(eventq, usage_id, value);
+	legacy_eventq_append(usage_id, value);
+}
+
+static void test_eventq_equivalence(void)
+{
+	static struct eventq eventq;
+	static u8_t pressed[USAGE_ID_MAX + 1];
+
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		eventq_reset(&eventq);
+		legacy_eventq_reset();
+		memset(pressed, 0, sizeof(pressed));
+
+		for (size_t i = 0; i < ROUND_EVENT_COUNT; i++) {
+			/* Events expire after a few steps on average. */
+			test_uptime += rand_get() %
+				       (CONFIG_DESKTOP_HID_REPORT_EXPIRATION / 4);
+
+			u32_t timestamp = K_MSEC(k_uptime_get());
+
+			switch (rand_get() % 8) {
+			case 0:
+				if (!eventq_is_empty(&eventq)) {
+					eventq_get_compare(&eventq);
+				}
+				break;
+
+			case 1:
+				eventq_cleanup(&eventq, timestamp);
+				legacy_eventq_cleanup(timestamp);
+				break;
+
+			default:
+				eventq_append_compare(&eventq, pressed,
+						      timestamp);
+				break;
+			}
+
+			eventq_compare(&eventq);
+		}
+	}
+
+	legacy_eventq_reset();
+}
+
+static u16_t burst_usage_id(size_t burst, size_t key)
+{
+	return 1 + (burst + key) % KEYBOARD_REPORT_LAST_KEY;
+}
+
+/* Press all keys one by one and release them in the same order, encoding
+ * a keyboard report after every event.
+ */
+static void test_rollover_benchmark(void)
+{
+	struct report_data *rd = get_report_data(REPORT_ID_KEYBOARD_KEYS);
+	const size_t event_cnt = BENCHMARK_BURST_COUNT * 2 *
+				 KEYBOARD_REPORT_KEY_COUNT_MAX;
+	u32_t start_time;
+	u32_t legacy_time;
+	u32_t time;
+
+	start_time = k_cycle_get_32();
+	for (size_t burst = 0; burst < BENCHMARK_BURST_COUNT; burst++) {
+		legacy_items_reset(KEYBOARD_REPORT_KEY_COUNT_MAX);
+
+		for (s16_t value = 1; value >= -1; value -= 2) {
+			for (size_t i = 0; i < KEYBOARD_REPORT_KEY_COUNT_MAX; i++) {
+				struct hid_report_event *event =
+					new_hid_report_event(sizeof(u8_t) +
+						REPORT_SIZE_KEYBOARD_KEYS);
+
+				legacy_key_value_set(burst_usage_id(burst, i),
+						     value);
+
+				event->dyndata.data[0] = REPORT_ID_KEYBOARD_KEYS;
+				legacy_keyboard_encode(&event->dyndata.data[1]);
+				EVENT_SUBMIT(event);
+			}
+		}
+	}
+	legacy_time = k_cycle_get_32() - start_time;
+
+	start_time = k_cycle_get_32();
+	for (size_t burst = 0; burst < BENCHMARK_BURST_COUNT; burst++) {
+		clear_items(&rd->items);
+
+		for (s16_t value = 1; value >= -1; value -= 2) {
+			for (size_t i = 0; i < KEYBOARD_REPORT_KEY_COUNT_MAX; i++) {
+				key_value_set(&rd->items,
+					      burst_usage_id(burst, i), value);
+
+				send_report_keyboard(REPORT_ID_KEYBOARD_KEYS,
+						     rd);
+			}
+		}
+	}
+	time = k_cycle_get_32() - start_time;
+
+	zassert_equal(rd->items.item_count, 0, "Keys left pressed");
+
+	TC_PRINT("%u-key rollover, cycles per event: legacy %u, current %u\n",
+		 KEYBOARD_REPORT_KEY_COUNT_MAX,
+		 (u32_t)(legacy_time / event_cnt), (u32_t)(time / event_cnt));
+}
+
+void test_main(void)
+{
+	hid_state_init();
+
+	ztest_test_suite(hid_state,
+			 ztest_unit_test(test_keyboard_equivalence),
+			 ztest_unit_test(test_mouse_equivalence),
+			 ztest_unit_test(test_ctrl_equivalence),
+			 ztest_unit_test(test_eventq_equivalence),
+			 ztest_unit_test(test_rollover_benchmark)
+			 );
+
+	ztest_run_test_suite(hid_state);
+}
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _TEST_CLOCK_H_
+#define _TEST_CLOCK_H_
+
+#include <kernel.h>
+
+/* Event timestamps are taken from the test clock instead of the uptime,
+ * so that the test controls when the queued events expire.
+ */
+extern s64_t test_uptime;
+
+#define k_uptime_get() test_uptime
+
+#endif /* _TEST_CLOCK_H_ */
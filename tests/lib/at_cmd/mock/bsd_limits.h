@@ -0,0 +1,10 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef BSD_LIMITS_H__
+#define BSD_LIMITS_H__
+
+#endif /* BSD_LIMITS_H__ */
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Replaces the socket API for the AT command driver. The functions are
+ * implemented by the test, which plays the role of the modem.
+ */
+
+#ifndef MOCK_NET_SOCKET_H__
+#define MOCK_NET_SOCKET_H__
+
+#include <sys/types.h>
+#include <errno.h>
+
+#define AF_LTE     102
+#define SOCK_DGRAM 2
+#define NPROTO_AT  513
+
+int socket(int family, int type, int proto);
+int close(int sock);
+ssize_t send(int sock, const void *buf, size_t len, int flags);
+ssize_t recv(int sock, void *buf, size_t max_len, int flags);
+
+#endif /* MOCK_NET_SOCKET_H__ */
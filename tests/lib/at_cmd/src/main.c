@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <kernel.h>
+#include <net/socket.h>
+
+#include <modem/at_cmd.h>
+
+#define TIMEOUT      1000
+#define IDLE_TIMEOUT 100
+
+#define QUEUED_CMD_COUNT 16
+
+/* Socket mock, the test plays the role of the modem. Commands sent by the
+ * driver are put in tx_msgq and responses to be received by the driver are
+ * taken from rx_msgq.
+ */
+K_MSGQ_DEFINE(tx_msgq, sizeof(const char *), QUEUED_CMD_COUNT, 4);
+K_MSGQ_DEFINE(rx_msgq, sizeof(const char *), QUEUED_CMD_COUNT, 4);
+
+/* Number of upcoming send calls that fail. */
+static int send_fail_cnt;
+/* Response given automatically to every command that is sent. */
+static const char *auto_rsp;
+
+int socket(int family, int type, int proto)
+{
+	zassert_equal(family, AF_LTE, "Unexpected socket family");
+	zassert_equal(proto, NPROTO_AT, "Unexpected socket protocol");
+
+	return 1;
+}
+
+int close(int sock)
+{
+	return 0;
+}
+
+ssize_t send(int sock, const void *buf, size_t len, int flags)
+{
+	if (send_fail_cnt > 0) {
+		send_fail_cnt--;
+		errno = EIO;
+		return -1;
+	}
+
+	zassert_equal(k_msgq_put(&tx_msgq, &buf, K_NO_WAIT), 0,
+		      "Too many commands sent");
+
+	if (auto_rsp != NULL) {
+		k_msgq_put(&rx_msgq, &auto_rsp, K_NO_WAIT);
+	}
+
+	return len;
+}
+
+ssize_t recv(int sock, void *buf, size_t max_len, int flags)
+{
+	const char *rsp;
+	size_t len;
+
+	k_msgq_get(&rx_msgq, &rsp, K_FOREVER);
+
+	len = strlen(rsp) + 1;
+	zassert_true(len <= max_len, "Response does not fit");
+	memcpy(buf, rsp, len);
+
+	return len;
+}
+
+static void modem_respond(const char *rsp)
+{
+	k_msgq_put(&rx_msgq, &rsp, K_NO_WAIT);
+}
+
+static void assert_sent(const char *cmd)
+{
+	const char *sent;
+
+	zassert_equal(k_msgq_get(&tx_msgq, &sent, TIMEOUT), 0,
+		      "Command %s was not sent", cmd);
+	zassert_equal(strcmp(sent, cmd), 0,
+		      "Sent %s instead of %s", sent, cmd);
+}
+
+static void assert_nothing_sent(void)
+{
+	const char *sent;
+
+	zassert_equal(k_msgq_get(&tx_msgq, &sent, IDLE_TIMEOUT), -EAGAIN,
+		      "Command sent before the previous one was completed");
+}
+
+struct test_cmd {
+	struct at_cmd_async async;
+	char                response[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
+	bool                has_response;
+	enum at_cmd_state   state;
+	int                 code;
+	int                 order;
+};
+
+static K_SEM_DEFINE(cmd_completed, 0, QUEUED_CMD_COUNT);
+static int completed_cnt;
+
+static void test_cmd_handler(struct at_cmd_async *async,
+			     const char *response, size_t len,
+			     enum at_cmd_state state, int code)
+{
+	struct test_cmd *cmd = CONTAINER_OF(async, struct test_cmd, async);
+
+	cmd->has_response = (response != NULL);
+	if (response != NULL) {
+		zassert_equal(strlen(response), len, "Wrong response length");
+		strcpy(cmd->response, response);
+	}
+
+	cmd->state = state;
+	cmd->code  = code;
+	cmd->order = completed_cnt++;
+
+	k_sem_give(&cmd_completed);
+}
+
+static void test_cmd_init(struct test_cmd *cmd, const char *cmd_str)
+{
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->async.cmd     = cmd_str;
+	cmd->async.handler = test_cmd_handler;
+	cmd->order         = -1;
+}
+
+static void wait_completed(void)
+{
+	zassert_equal(k_sem_take(&cmd_completed, TIMEOUT), 0,
+		      "Command was not completed");
+}
+
+static void test_setup(void)
+{
+	k_msgq_purge(&tx_msgq);
+	k_msgq_purge(&rx_msgq);
+	k_sem_reset(&cmd_completed);
+	send_fail_cnt = 0;
+	auto_rsp      = NULL;
+	completed_cnt = 0;
+}
+
+static void test_teardown(void)
+{
+	zassert_equal(k_msgq_num_used_get(&tx_msgq), 0,
+		      "Unexpected command sent");
+}
+
+static void test_async_invalid(void)
+{
+	struct test_cmd cmd;
+
+	zassert_equal(at_cmd_write_async(NULL), -EINVAL,
+		      "NULL command accepted");
+
+	test_cmd_init(&cmd, NULL);
+	zassert_equal(at_cmd_write_async(&cmd.async), -EINVAL,
+		      "NULL command string accepted");
+
+	test_cmd_init(&cmd, "AT");
+	cmd.async.handler = NULL;
+	zassert_equal(at_cmd_write_async(&cmd.async), -EINVAL,
+		      "NULL handler accepted");
+}
+
+static void test_async_order(void)
+{
+	static const char * const cmd_str[] = {"AT+CFUN?", "AT+CEREG?", "AT"};
+	static const char * const rsp[] = {
+		"+CFUN: 1\r\nOK\r\n",
+		"+CEREG: 0,1\r\nOK\r\n",
+		"OK\r\n",
+	};
+	static const char * const payload[] = {
+		"+CFUN: 1\r\n",
+		"+CEREG: 0,1\r\n",
+		"",
+	};
+	struct test_cmd cmd[ARRAY_SIZE(cmd_str)];
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		test_cmd_init(&cmd[i], cmd_str[i]);
+		zassert_equal(at_cmd_write_async(&cmd[i].async), 0,
+			      "Command not queued");
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		/* Next command is sent only after the response
+		 * to the previous one.
+		 */
+		assert_sent(cmd_str[i]);
+		assert_nothing_sent();
+		zassert_equal(cmd[i].order, -1, "Completed before response");
+
+		modem_respond(rsp[i]);
+		wait_completed();
+
+		zassert_equal(cmd[i].order, i, "Completed out of order");
+		zassert_equal(cmd[i].state, AT_CMD_OK, "Wrong state");
+		zassert_equal(cmd[i].code, 0, "Wrong code");
+		zassert_true(cmd[i].has_response, "No response");
+		zassert_equal(strcmp(cmd[i].response, payload[i]), 0,
+			      "Wrong response %s", cmd[i].response);
+	}
+
+	assert_nothing_sent();
+}
+
+static void test_async_error_responses(void)
+{
+	static const char * const rsp[] = {
+		"ERROR\r\n",
+		"+CME ERROR: 10\r\n",
+		"+CMS ERROR: 304\r\n",
+	};
+	static const enum at_cmd_state state[] = {
+		AT_CMD_ERROR,
+		AT_CMD_ERROR_CME,
+		AT_CMD_ERROR_CMS,
+	};
+	static const int code[] = {-ENOEXEC, 10, 304};
+	struct test_cmd cmd[ARRAY_SIZE(rsp)];
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		test_cmd_init(&cmd[i], "AT+TEST");
+		zassert_equal(at_cmd_write_async(&cmd[i].async), 0,
+			      "Command not queued");
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		assert_sent("AT+TEST");
+		modem_respond(rsp[i]);
+		wait_completed();
+
+		zassert_equal(cmd[i].order, i, "Completed out of order");
+		zassert_equal(cmd[i].state, state[i], "Wrong state");
+		zassert_equal(cmd[i].code, code[i], "Wrong code %d",
+			      cmd[i].code);
+	}
+}
+
+static void test_async_send_failure(void)
+{
+	struct test_cmd cmd[3];
+
+	/* Command that cannot be sent right away is dropped and the error
+	 * is returned without calling the handler.
+	 */
+	send_fail_cnt = 1;
+	test_cmd_init(&cmd[0], "AT+FAIL");
+	zassert_equal(at_cmd_write_async(&cmd[0].async), -EIO,
+		      "Error not returned");
+	zassert_not_equal(k_sem_take(&cmd_completed, K_NO_WAIT), 0,
+			  "Handler called");
+
+	/* The driver is not blocked by the dropped command. */
+	test_cmd_init(&cmd[0], "AT+NEXT");
+	zassert_equal(at_cmd_write_async(&cmd[0].async), 0,
+		      "Command not queued");
+	assert_sent("AT+NEXT");
+	modem_respond("OK\r\n");
+	wait_completed();
+	zassert_equal(cmd[0].state, AT_CMD_OK, "Wrong state");
+
+	/* Queued command that cannot be sent is completed and
+	 * the next one is sent instead.
+	 */
+	completed_cnt = 0;
+	test_cmd_init(&cmd[0], "AT+FIRST");
+	test_cmd_init(&cmd[1], "AT+FAIL");
+	test_cmd_init(&cmd[2], "AT+LAST");
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		zassert_equal(at_cmd_write_async(&cmd[i].async), 0,
+			      "Command not queued");
+	}
+
+	assert_sent("AT+FIRST");
+	send_fail_cnt = 1;
+	modem_respond("OK\r\n");
+	wait_completed();
+	wait_completed();
+	assert_sent("AT+LAST");
+	modem_respond("OK\r\n");
+	wait_completed();
+
+	zassert_equal(cmd[0].state, AT_CMD_OK, "Wrong state");
+	zassert_equal(cmd[1].state, AT_CMD_ERROR, "Wrong state");
+	zassert_equal(cmd[1].code, -EIO, "Wrong code");
+	zassert_equal(cmd[2].state, AT_CMD_OK, "Wrong state");
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		zassert_equal(cmd[i].order, i, "Completed out of order");
+	}
+}
+
+static void test_async_many_queued(void)
+{
+	/* The queue is made of the structures provided by the callers,
+	 * so it has no fixed capacity.
+	 */
+	static struct test_cmd cmd[QUEUED_CMD_COUNT];
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		test_cmd_init(&cmd[i], "AT");
+		zassert_equal(at_cmd_write_async(&cmd[i].async), 0,
+			      "Command %d not queued", i);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(cmd); i++) {
+		assert_sent("AT");
+		modem_respond("OK\r\n");
+		wait_completed();
+		zassert_equal(cmd[i].order, i, "Completed out of order");
+	}
+
+	assert_nothing_sent();
+}
+
+static void test_sync_order_with_async(void)
+{
+	struct test_cmd cmd;
+	char buf[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
+	enum at_cmd_state state;
+	int err;
+
+	/* Synchronous command is sent after the queued one. */
+	test_cmd_init(&cmd, "AT+ASYNC");
+	zassert_equal(at_cmd_write_async(&cmd.async), 0, "Command not queued");
+	assert_sent("AT+ASYNC");
+
+	auto_rsp = "+SYNC: 1\r\nOK\r\n";
+	modem_respond("OK\r\n");
+
+	err = at_cmd_write("AT+SYNC", buf, sizeof(buf), &state);
+	zassert_equal(err, 0, "Command failed");
+	zassert_equal(state, AT_CMD_OK, "Wrong state");
+	zassert_equal(strcmp(buf, "+SYNC: 1\r\n"), 0, "Wrong response");
+	zassert_equal(cmd.order, 0, "Queued command not completed first");
+	assert_sent("AT+SYNC");
+}
+
+static void test_sync_error_responses(void)
+{
+	char buf[4];
+	enum at_cmd_state state;
+	int err;
+
+	auto_rsp = "+CME ERROR: 3\r\n";
+	err = at_cmd_write("AT+CME", NULL, 0, &state);
+	zassert_equal(err, 3, "Wrong code");
+	zassert_equal(state, AT_CMD_ERROR_CME, "Wrong state");
+	assert_sent("AT+CME");
+
+	auto_rsp = "ERROR\r\n";
+	err = at_cmd_write("AT+ERR", NULL, 0, &state);
+	zassert_equal(err, -ENOEXEC, "Wrong code");
+	zassert_equal(state, AT_CMD_ERROR, "Wrong state");
+	assert_sent("AT+ERR");
+
+	auto_rsp = "+LONG: 12345\r\nOK\r\n";
+	err = at_cmd_write("AT+LONG", buf, sizeof(buf), &state);
+	zassert_equal(err, -EMSGSIZE, "Small buffer not detected");
+	assert_sent("AT+LONG");
+
+	send_fail_cnt = 1;
+	err = at_cmd_write("AT+FAIL", NULL, 0, &state);
+	zassert_equal(err, -EIO, "Wrong code");
+	zassert_equal(state, AT_CMD_ERROR, "Wrong state");
+}
+
+static char nested_rsp[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
+static char handler_rsp[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
+static int nested_err;
+
+static void nested_cmd_handler(const char *response)
+{
+	strcpy(handler_rsp, response);
+
+	/* Handler runs in the calling thread, so it can send
+	 * another command.
+	 */
+	auto_rsp = "+SECOND\r\nOK\r\n";
+	nested_err = at_cmd_write("AT+SECOND", nested_rsp, sizeof(nested_rsp),
+				  NULL);
+}
+
+static void test_sync_callback_nested(void)
+{
+	int err;
+
+	auto_rsp = "+FIRST\r\nOK\r\n";
+	err = at_cmd_write_with_callback("AT+FIRST", nested_cmd_handler, NULL);
+
+	zassert_equal(err, 0, "First command failed");
+	zassert_equal(nested_err, 0, "Nested command failed");
+	zassert_equal(strcmp(handler_rsp, "+FIRST\r\n"), 0,
+		      "Wrong response to first command");
+	zassert_equal(strcmp(nested_rsp, "+SECOND\r\n"), 0,
+		      "Wrong response to nested command");
+	assert_sent("AT+FIRST");
+	assert_sent("AT+SECOND");
+}
+
+void test_main(void)
+{
+	zassert_equal(at_cmd_init(), 0, "Driver initialization failed");
+
+	ztest_test_suite(at_cmd,
+			 ztest_unit_test_setup_teardown(test_async_invalid,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(test_async_order,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_async_error_responses,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(test_async_send_failure,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(test_async_many_queued,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_sync_order_with_async,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_sync_error_responses,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_sync_callback_nested,
+				test_setup, test_teardown)
+			);
+
+	ztest_run_test_suite(at_cmd);
+}
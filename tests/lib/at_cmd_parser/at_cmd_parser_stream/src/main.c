@@ -0,0 +1,400 @@
+#include <ztest.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <kernel.h>
+
+#include <modem/at_cmd_parser.h>
+#include <modem/at_params.h>
+
+#define TEST_PARAMS  4
+#define TEST_PARAMS2 10
+
+#define BENCHMARK_ITERATIONS 1000
+
+static const char * const responses[] = {
+	"+CEREG: 2,\"76C1\",\"0102DA04\", 7\r\n",
+	"+CMT: \"12345678\", 24\r\n"
+	"06917429000171040A91747966543100009160402143708006C8329BFD0601\r\n",
+	"mfw_nrf9160_0.7.0-23.prealpha\r\n",
+	"+CPSMS: 1,,,\"10101111\",\"01101100\"\r\n",
+	"%CMNG: 12345678, 0, \"978C...02C4\","
+	"\"-----BEGIN CERTIFICATE-----"
+	"MIIBc464..."
+	"...bW9aAa4"
+	"-----END CERTIFICATE-----\"\r\n",
+	"+CGEQOSRDP: 2,4,,,1,65280000\r\n",
+	"%XCBAND: (1,2,3,4,13,66)\r\n",
+	"%XCBAND: ()\r\n",
+	"+TEST: 1,,,\r\n",
+	"+TEST: ,,,1\r\n",
+	"AT+CCLK=\"18/12/06,22:10:00+08\"",
+	"AT%XSYSTEMMODE=1,2,3,4",
+	"AT+CFUN=?",
+	"AT",
+};
+
+static struct at_param_list test_list;
+static struct at_param_list test_list2;
+
+static void assert_lists_equal(struct at_param_list *expected,
+			       struct at_param_list *actual)
+{
+	size_t count = at_params_valid_count_get(expected);
+
+	zassert_equal(count, at_params_valid_count_get(actual),
+		      "Valid count should be equal");
+
+	for (size_t i = 0; i < count; i++) {
+		enum at_param_type type = at_params_type_get(expected, i);
+		char exp_buf[128];
+		char act_buf[128];
+		size_t exp_len = sizeof(exp_buf);
+		size_t act_len = sizeof(act_buf);
+		u32_t exp_val;
+		u32_t act_val;
+
+		zassert_equal(type, at_params_type_get(actual, i),
+			      "Param type at index %d should be equal", i);
+
+		switch (type) {
+		case AT_PARAM_TYPE_NUM_SHORT:
+		case AT_PARAM_TYPE_NUM_INT:
+			zassert_equal(0, at_params_int_get(expected, i,
+							   &exp_val), NULL);
+			zassert_equal(0, at_params_int_get(actual, i,
+							   &act_val), NULL);
+			zassert_equal(exp_val, act_val,
+				      "Number at index %d should be equal", i);
+			break;
+		case AT_PARAM_TYPE_STRING:
+			zassert_equal(0, at_params_string_get(expected, i,
+							      exp_buf,
+							      &exp_len), NULL);
+			zassert_equal(0, at_params_string_get(actual, i,
+							      act_buf,
+							      &act_len), NULL);
+			zassert_equal(exp_len, act_len,
+				      "String at index %d should be equal", i);
+			zassert_equal(0, memcmp(exp_buf, act_buf, exp_len),
+				      "String at index %d should be equal", i);
+			break;
+		case AT_PARAM_TYPE_ARRAY:
+			zassert_equal(0, at_params_array_get(expected, i,
+							     (u32_t *)exp_buf,
+							     &exp_len), NULL);
+			zassert_equal(0, at_params_array_get(actual, i,
+							     (u32_t *)act_buf,
+							     &act_len), NULL);
+			zassert_equal(exp_len, act_len,
+				      "Array at index %d should be equal", i);
+			zassert_equal(0, memcmp(exp_buf, act_buf, exp_len),
+				      "Array at index %d should be equal", i);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void test_stream_setup(void)
+{
+	at_params_list_init(&test_list, TEST_PARAMS2);
+	at_params_list_init(&test_list2, TEST_PARAMS2);
+}
+
+static void test_stream_teardown(void)
+{
+	at_params_list_free(&test_list2);
+	at_params_list_free(&test_list);
+}
+
+static void test_stream_fail_on_invalid_input(void)
+{
+	struct at_parser parser;
+	static struct at_param_list uninitialized;
+
+	zassert_equal(-EINVAL, at_parser_stream_init(NULL, &test_list,
+						     TEST_PARAMS2), NULL);
+	zassert_equal(-EINVAL, at_parser_stream_init(&parser, NULL,
+						     TEST_PARAMS2), NULL);
+	zassert_equal(-EINVAL, at_parser_stream_init(&parser, &uninitialized,
+						     TEST_PARAMS2), NULL);
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(-EINVAL, at_parser_stream_feed(NULL, responses[0], 1),
+		      NULL);
+	zassert_equal(-EINVAL, at_parser_stream_feed(&parser, NULL, 1), NULL);
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list,
+					       TEST_PARAMS), NULL);
+	zassert_equal(-E2BIG, at_parser_stream_feed(&parser, responses[0],
+						    strlen(responses[0]) + 1),
+		      "Parser should return -E2BIG");
+	zassert_equal(TEST_PARAMS, at_params_valid_count_get(&test_list),
+		      "There should be TEST_PARAMS elements in the list");
+
+	static const char invalid[] = "+TEST: 1 2\r\n";
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(-EBADMSG, at_parser_stream_feed(&parser, invalid,
+						      sizeof(invalid)),
+		      "Parser should return -EBADMSG");
+}
+
+static void test_stream_same_as_parser(void)
+{
+	struct at_parser parser;
+
+	for (size_t i = 0; i < ARRAY_SIZE(responses); i++) {
+		size_t len = strlen(responses[i]) + 1;
+
+		zassert_equal(0, at_parser_params_from_str(responses[i], NULL,
+							   &test_list),
+			      "Parsing from string should return 0");
+
+		zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+						       TEST_PARAMS2), NULL);
+		zassert_equal(0, at_parser_stream_feed(&parser, responses[i],
+						       len),
+			      "Stream parsing should return 0");
+		zassert_equal(len - 1, parser.pos,
+			      "Whole string should be parsed");
+
+		assert_lists_equal(&test_list, &test_list2);
+	}
+}
+
+static void test_stream_partial_input(void)
+{
+	struct at_parser parser;
+
+	for (size_t i = 0; i < ARRAY_SIZE(responses); i++) {
+		size_t len = strlen(responses[i]) + 1;
+		int ret = -EAGAIN;
+
+		zassert_equal(0, at_parser_params_from_str(responses[i], NULL,
+							   &test_list), NULL);
+		zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+						       TEST_PARAMS2), NULL);
+
+		/* Feed one character at a time. */
+		for (size_t j = 1; j <= len; j++) {
+			ret = at_parser_stream_feed(&parser, responses[i], j);
+			if (ret != -EAGAIN) {
+				zassert_equal(len, j, "Parsing finished early");
+				break;
+			}
+		}
+
+		zassert_equal(0, ret, "Stream parsing should return 0");
+		assert_lists_equal(&test_list, &test_list2);
+	}
+}
+
+static void test_stream_multiple_notifications(void)
+{
+	struct at_parser parser;
+	char tmpbuf[32];
+	size_t tmpbuf_len;
+	u32_t tmpint;
+
+	static const char str[] = "%TEST:1,\"Hello World!\"\r\n"
+				  "+TEST: 2, \"FOOBAR\"\r\n";
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(0, at_parser_stream_feed(&parser, str, sizeof(str)),
+		      "Stream parsing should return 0");
+	zassert_equal('+', str[parser.pos],
+		      "Parser should stop at the next notification");
+	zassert_equal(3, at_params_valid_count_get(&test_list),
+		      "There should be 3 valid params in the string");
+
+	tmpbuf_len = sizeof(tmpbuf);
+	zassert_equal(0, at_params_string_get(&test_list, 2,
+					      tmpbuf, &tmpbuf_len),
+		      "Get string should not fail");
+	zassert_equal(0, memcmp("Hello World!", tmpbuf, tmpbuf_len),
+		      "The string in tmpbuf should equal to Hello World!");
+
+	const char *next = &str[parser.pos];
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(0, at_parser_stream_feed(&parser, next,
+					       sizeof(str) - (next - str)),
+		      "Stream parsing should return 0");
+	zassert_equal('\0', next[parser.pos],
+		      "Remainder should only contain 0 termination character");
+
+	zassert_equal(0, at_params_int_get(&test_list2, 1, &tmpint),
+		      "Get int should not fail");
+	zassert_equal(2, tmpint, "Integer should be 2");
+
+	tmpbuf_len = sizeof(tmpbuf);
+	zassert_equal(0, at_params_string_get(&test_list2, 2,
+					      tmpbuf, &tmpbuf_len),
+		      "Get string should not fail");
+	zassert_equal(0, memcmp("FOOBAR", tmpbuf, tmpbuf_len),
+		      "The string in tmpbuf should equal to FOOBAR");
+}
+
+static void test_stream_empty_array(void)
+{
+	struct at_parser parser;
+	u32_t array[4];
+	size_t array_len;
+
+	static const char str[] = "%XCBAND: ()\r\n";
+
+	/* Both parsers report an empty array as one element. */
+	zassert_equal(0, at_parser_params_from_str(str, NULL, &test_list),
+		      "Parsing from string should return 0");
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(0, at_parser_stream_feed(&parser, str, sizeof(str)),
+		      "Stream parsing should return 0");
+
+	for (size_t i = 0; i < 2; i++) {
+		struct at_param_list *list = (i == 0) ? &test_list :
+							&test_list2;
+
+		zassert_equal(AT_PARAM_TYPE_ARRAY, at_params_type_get(list, 1),
+			      "Param type at index 1 should be an array");
+		zassert_equal(0, at_params_size_get(list, 1, &array_len),
+			      "Get size should not fail");
+		zassert_equal(sizeof(u32_t), array_len,
+			      "Array size should be one element");
+
+		array_len = sizeof(array);
+		array[0] = UINT32_MAX;
+		zassert_equal(0, at_params_array_get(list, 1, array,
+						     &array_len),
+			      "Get array should not fail");
+		zassert_equal(sizeof(u32_t), array_len,
+			      "Array should have one element");
+		zassert_equal(0, array[0], "Array element should be 0");
+	}
+}
+
+static void test_stream_number_range(void)
+{
+	struct at_parser parser;
+	u32_t value;
+	u16_t short_value;
+
+	static const char str[] = "+TEST: 4294967295,-2147483648,65535,-1\r\n";
+	static const char * const invalid[] = {
+		"+TEST: 4294967296\r\n",
+		"+TEST: 1,99999999999\r\n",
+		"+TEST: -2147483649\r\n",
+	};
+	static const int err[] = {-E2BIG, -E2BIG, -EINVAL};
+
+	zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+					       TEST_PARAMS2), NULL);
+	zassert_equal(0, at_parser_stream_feed(&parser, str, sizeof(str)),
+		      "Stream parsing should return 0");
+
+	zassert_equal(AT_PARAM_TYPE_NUM_INT, at_params_type_get(&test_list2, 1),
+		      "Param type at index 1 should be an integer");
+	zassert_equal(0, at_params_int_get(&test_list2, 1, &value), NULL);
+	zassert_equal(UINT32_MAX, value, "Wrong value at index 1");
+
+	zassert_equal(AT_PARAM_TYPE_NUM_INT, at_params_type_get(&test_list2, 2),
+		      "Param type at index 2 should be an integer");
+	zassert_equal(0, at_params_int_get(&test_list2, 2, &value), NULL);
+	zassert_equal(INT32_MIN, (s32_t)value, "Wrong value at index 2");
+
+	zassert_equal(AT_PARAM_TYPE_NUM_SHORT,
+		      at_params_type_get(&test_list2, 3),
+		      "Param type at index 3 should be a short");
+	zassert_equal(0, at_params_short_get(&test_list2, 3, &short_value),
+		      NULL);
+	zassert_equal(USHRT_MAX, short_value, "Wrong value at index 3");
+
+	zassert_equal(AT_PARAM_TYPE_NUM_INT, at_params_type_get(&test_list2, 4),
+		      "Param type at index 4 should be an integer");
+	zassert_equal(0, at_params_int_get(&test_list2, 4, &value), NULL);
+	zassert_equal(-1, (s32_t)value, "Wrong value at index 4");
+
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		size_t len = strlen(invalid[i]) + 1;
+
+		zassert_equal(0, at_parser_stream_init(&parser, &test_list2,
+						       TEST_PARAMS2), NULL);
+		zassert_equal(err[i], at_parser_stream_feed(&parser, invalid[i],
+							    len),
+			      "Number out of range should not be accepted");
+	}
+}
+
+static void test_stream_benchmark(void)
+{
+	struct at_parser parser;
+	u32_t start;
+	u32_t parser_cycles;
+	u32_t stream_cycles;
+
+	for (size_t i = 0; i < ARRAY_SIZE(responses); i++) {
+		size_t len = strlen(responses[i]) + 1;
+
+		start = k_cycle_get_32();
+		for (size_t j = 0; j < BENCHMARK_ITERATIONS; j++) {
+			at_parser_params_from_str(responses[i], NULL,
+						  &test_list);
+		}
+		parser_cycles = k_cycle_get_32() - start;
+
+		start = k_cycle_get_32();
+		for (size_t j = 0; j < BENCHMARK_ITERATIONS; j++) {
+			at_parser_stream_init(&parser, &test_list2,
+					      TEST_PARAMS2);
+			at_parser_stream_feed(&parser, responses[i], len);
+		}
+		stream_cycles = k_cycle_get_32() - start;
+
+		TC_PRINT("Response %zu: parser %u cycles, stream %u cycles\n",
+			 i, parser_cycles / BENCHMARK_ITERATIONS,
+			 stream_cycles / BENCHMARK_ITERATIONS);
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(at_cmd_parser_stream,
+			 ztest_unit_test_setup_teardown(
+				test_stream_fail_on_invalid_input,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_same_as_parser,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_partial_input,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_multiple_notifications,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_empty_array,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_number_range,
+				test_stream_setup,
+				test_stream_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_stream_benchmark,
+				test_stream_setup,
+				test_stream_teardown)
+			);
+
+	ztest_run_test_suite(at_cmd_parser_stream);
+}
@@ -6,6 +6,7 @@
 #include <ztest.h>
 #include <kernel.h>
 #include <stddef.h>
+#include <string.h>
 #include <sys/util.h>
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt_dm.h>
@@ -14,6 +15,16 @@
 /* Timeout for the discovery in ms */
 #define SERVICE_DISCOVERY_TIMEOUT 2000
 
+#define BENCHMARK_ITERATIONS 100
+
+/* HID Report UUID in its 128-bit form */
+#define UUID_REPORT_128 BT_UUID_DECLARE_128(0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, \
+					    0x00, 0x80, 0x00, 0x10, 0x00, 0x00, \
+					    0x4d, 0x2a, 0x00, 0x00)
+#define UUID_VENDOR BT_UUID_DECLARE_128(0x01, 0x02, 0x03, 0x04, 0x05, 0x06, \
+					0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, \
+					0x0d, 0x0e, 0x0f, 0x10)
+
 static char dummy_conn;
 K_SEM_DEFINE(discovery_finished, 0, 1);
 
@@ -44,6 +55,68 @@ const struct bt_gatt_attr discover_sim[] = {
 	BT_GATT_DISCOVER_MOCK_DESC(16, BT_UUID_DIS_MANUFACTURER_NAME),
 };
 
+/* HIDS with characteristics and descriptors that share their UUIDs */
+const struct bt_gatt_attr discover_sim_dup[] = {
+	BT_GATT_DISCOVER_MOCK_SERV(1, BT_UUID_HIDS, 0xffff),
+	BT_GATT_DISCOVER_MOCK_CHRC(2, BT_UUID_HIDS_INFO, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(3, BT_UUID_HIDS_INFO),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(4, BT_UUID_HIDS_REPORT_MAP, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(5, BT_UUID_HIDS_REPORT_MAP),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(6, BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(7, BT_UUID_HIDS_REPORT),
+	BT_GATT_DISCOVER_MOCK_DESC(8, BT_UUID_GATT_CCC),
+	BT_GATT_DISCOVER_MOCK_DESC(9, BT_UUID_HIDS_REPORT_REF),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(10, BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE),
+	BT_GATT_DISCOVER_MOCK_DESC(11, BT_UUID_HIDS_REPORT),
+	BT_GATT_DISCOVER_MOCK_DESC(12, BT_UUID_HIDS_REPORT_REF),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(13, UUID_VENDOR, BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(14, UUID_VENDOR),
+	BT_GATT_DISCOVER_MOCK_DESC(15, BT_UUID_GATT_CCC),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(16, UUID_REPORT_128, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(17, UUID_REPORT_128),
+	BT_GATT_DISCOVER_MOCK_DESC(18, BT_UUID_GATT_CCC),
+	BT_GATT_DISCOVER_MOCK_DESC(19, BT_UUID_HIDS_REPORT_REF),
+	BT_GATT_DISCOVER_MOCK_DESC(20, BT_UUID_HIDS_REPORT_REF),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(21, UUID_VENDOR, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(22, UUID_VENDOR),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(23, BT_UUID_HIDS_BOOT_KB_IN_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(24, BT_UUID_HIDS_BOOT_KB_IN_REPORT),
+	BT_GATT_DISCOVER_MOCK_DESC(25, BT_UUID_GATT_CCC),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(26, BT_UUID_HIDS_CTRL_POINT, BT_GATT_CHRC_WRITE_WITHOUT_RESP),
+	BT_GATT_DISCOVER_MOCK_DESC(27, BT_UUID_HIDS_CTRL_POINT),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(28, BT_UUID_HIDS_PROTOCOL_MODE, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(29, BT_UUID_HIDS_PROTOCOL_MODE),
+
+	/* Characteristic without any value or descriptor */
+	BT_GATT_DISCOVER_MOCK_CHRC(30, BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ),
+};
+
+/* UUIDs looked up in discover_sim_dup */
+static const struct bt_uuid *const lookup_uuids[] = {
+	BT_UUID_HIDS_INFO,
+	BT_UUID_HIDS_REPORT_MAP,
+	BT_UUID_HIDS_REPORT,
+	UUID_REPORT_128,
+	BT_UUID_HIDS_REPORT_REF,
+	BT_UUID_GATT_CCC,
+	UUID_VENDOR,
+	BT_UUID_HIDS_BOOT_KB_IN_REPORT,
+	BT_UUID_HIDS_CTRL_POINT,
+	BT_UUID_HIDS_PROTOCOL_MODE,
+	BT_UUID_GATT_CHRC,
+	BT_UUID_HIDS,
+	BT_UUID_DIS_MODEL_NUMBER,
+};
+
 
 void test_cb_completed(struct bt_gatt_dm *dm, void *context)
 {
@@ -79,6 +152,13 @@ void test_setup(void)
 	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
 }
 
+void test_setup_dup(void)
+{
+	k_sem_reset(&discovery_finished);
+	bt_gatt_discover_mock_setup(discover_sim_dup,
+				    ARRAY_SIZE(discover_sim_dup));
+}
+
 struct bt_gatt_dm *run_dm(const struct bt_uuid *svc_uuid)
 {
 	struct bt_gatt_dm *dm;
@@ -376,6 +456,204 @@ void test_gatt_generic_serv(void)
 	/* No cleanup here - cleanup is done in run_dm_next */
 }
 
+/* Reference lookups, done by comparing the UUID of every attribute */
+static const struct bt_gatt_dm_attr *char_by_uuid_ref(
+	const struct bt_gatt_dm *dm,
+	const struct bt_gatt_dm_attr *prev,
+	const struct bt_uuid *uuid)
+{
+	const struct bt_gatt_dm_attr *attr = prev;
+
+	while ((attr = bt_gatt_dm_char_next(dm, attr)) != NULL) {
+		if (!bt_uuid_cmp(uuid, bt_gatt_dm_attr_chrc_val(attr)->uuid)) {
+			break;
+		}
+	}
+
+	return attr;
+}
+
+static const struct bt_gatt_dm_attr *desc_by_uuid_ref(
+	const struct bt_gatt_dm *dm,
+	const struct bt_gatt_dm_attr *attr_chrc,
+	const struct bt_uuid *uuid)
+{
+	const struct bt_gatt_dm_attr *attr = attr_chrc;
+
+	while ((attr = bt_gatt_dm_desc_next(dm, attr)) != NULL) {
+		if (!bt_uuid_cmp(uuid, attr->uuid)) {
+			break;
+		}
+	}
+
+	return attr;
+}
+
+void test_gatt_dup_uuid_lookup(void)
+{
+	struct bt_gatt_dm *dm;
+	const struct bt_gatt_dm_attr *attr_chrc;
+	const struct bt_gatt_dm_attr *attr_ref;
+	const struct bt_gatt_dm_attr *attr;
+	size_t cnt;
+
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	zassert_equal(ARRAY_SIZE(discover_sim_dup),
+		      bt_gatt_dm_attr_cnt(dm),
+		      "Unexpected number of attributes detected: %d",
+		      bt_gatt_dm_attr_cnt(dm));
+
+	for (size_t i = 0; i < ARRAY_SIZE(lookup_uuids); i++) {
+		const struct bt_uuid *uuid = lookup_uuids[i];
+
+		attr = bt_gatt_dm_char_by_uuid(dm, uuid);
+		attr_ref = char_by_uuid_ref(dm, NULL, uuid);
+		zassert_equal_ptr(attr_ref, attr, "UUID %zu: unexpected characteristic", i);
+
+		/* All the characteristics with the UUID, in handle order */
+		attr = NULL;
+		attr_ref = NULL;
+		do {
+			attr = bt_gatt_dm_char_next_by_uuid(dm, attr, uuid);
+			attr_ref = char_by_uuid_ref(dm, attr_ref, uuid);
+			zassert_equal_ptr(attr_ref, attr, "UUID %zu: unexpected characteristic", i);
+		} while (attr);
+
+		/* The descriptors with the UUID in every characteristic */
+		attr_chrc = NULL;
+		while ((attr_chrc = bt_gatt_dm_char_next(dm, attr_chrc)) != NULL) {
+			attr = bt_gatt_dm_desc_by_uuid(dm, attr_chrc, uuid);
+			attr_ref = desc_by_uuid_ref(dm, attr_chrc, uuid);
+			zassert_equal_ptr(attr_ref, attr,
+					  "UUID %zu: unexpected descriptor of characteristic %u",
+					  i, attr_chrc->handle);
+		}
+	}
+
+	/* Reports in their 16 and 128-bit forms */
+	cnt = 0;
+	attr = NULL;
+	while ((attr = bt_gatt_dm_char_next_by_uuid(dm, attr, BT_UUID_HIDS_REPORT)) != NULL) {
+		cnt++;
+	}
+	zassert_equal(4, cnt, "Unexpected number of reports: %zu", cnt);
+
+	attr = bt_gatt_dm_char_by_uuid(dm, UUID_VENDOR);
+	zassert_not_null(attr, "Unexpected NULL");
+	zassert_equal(13, attr->handle, "Unexpected handle: %d", attr->handle);
+	attr = bt_gatt_dm_char_next_by_uuid(dm, attr, UUID_VENDOR);
+	zassert_not_null(attr, "Unexpected NULL");
+	zassert_equal(21, attr->handle, "Unexpected handle: %d", attr->handle);
+	attr = bt_gatt_dm_char_next_by_uuid(dm, attr, UUID_VENDOR);
+	zassert_is_null(attr, "Expecting NULL");
+
+	/* The first of two descriptors with the same UUID */
+	attr_chrc = bt_gatt_dm_attr_by_handle(dm, 16);
+	attr = bt_gatt_dm_desc_by_uuid(dm, attr_chrc, BT_UUID_HIDS_REPORT_REF);
+	zassert_not_null(attr, "Unexpected NULL");
+	zassert_equal(19, attr->handle, "Unexpected handle: %d", attr->handle);
+
+	bt_gatt_dm_data_release(dm);
+	zassert_equal(0, bt_gatt_dm_attr_cnt(dm), "Parameter count after clearing: %d", bt_gatt_dm_attr_cnt(dm));
+}
+
+void test_gatt_dup_handles_assign(void)
+{
+	struct bt_gatt_dm *dm;
+	u16_t handles[6];
+	const struct bt_gatt_dm_handle_req reqs[] = {
+		{ .uuid = BT_UUID_HIDS_REPORT, .handle = &handles[0] },
+		{ .uuid = BT_UUID_HIDS_REPORT,
+		  .desc_uuid = BT_UUID_HIDS_REPORT_REF,
+		  .handle = &handles[1] },
+		{ .uuid = UUID_VENDOR,
+		  .desc_uuid = BT_UUID_GATT_CCC,
+		  .handle = &handles[2] },
+		{ .uuid = BT_UUID_HIDS_PROTOCOL_MODE, .handle = &handles[3] },
+		{ .uuid = BT_UUID_HIDS_INFO,
+		  .desc_uuid = BT_UUID_GATT_CCC,
+		  .handle = &handles[4] },
+		{ .uuid = BT_UUID_DIS_MODEL_NUMBER, .handle = &handles[5] },
+	};
+	int err;
+
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+
+	memset(handles, 0xff, sizeof(handles));
+	err = bt_gatt_dm_handles_assign(dm, reqs, ARRAY_SIZE(reqs));
+	zassert_equal(-ENOENT, err, "Unexpected error: %d", err);
+
+	for (size_t i = 0; i < ARRAY_SIZE(reqs); i++) {
+		const struct bt_gatt_dm_attr *attr;
+		u16_t handle = 0;
+
+		attr = char_by_uuid_ref(dm, NULL, reqs[i].uuid);
+		if (attr) {
+			attr = desc_by_uuid_ref(dm, attr,
+				reqs[i].desc_uuid ? reqs[i].desc_uuid : reqs[i].uuid);
+		}
+		if (attr) {
+			handle = attr->handle;
+		}
+		zassert_equal(handle, handles[i], "Request %zu: unexpected handle: %d", i, handles[i]);
+	}
+
+	zassert_equal(7, handles[0], "Unexpected handle: %d", handles[0]);
+	zassert_equal(9, handles[1], "Unexpected handle: %d", handles[1]);
+	zassert_equal(15, handles[2], "Unexpected handle: %d", handles[2]);
+	zassert_equal(29, handles[3], "Unexpected handle: %d", handles[3]);
+	zassert_equal(0, handles[4], "Unexpected handle: %d", handles[4]);
+	zassert_equal(0, handles[5], "Unexpected handle: %d", handles[5]);
+
+	err = bt_gatt_dm_handles_assign(dm, reqs, 4);
+	zassert_equal(0, err, "Unexpected error: %d", err);
+
+	bt_gatt_dm_data_release(dm);
+	zassert_equal(0, bt_gatt_dm_attr_cnt(dm), "Parameter count after clearing: %d", bt_gatt_dm_attr_cnt(dm));
+}
+
+void test_gatt_dup_lookup_benchmark(void)
+{
+	struct bt_gatt_dm *dm;
+	const struct bt_gatt_dm_attr *attr_chrc;
+	u32_t start;
+	u32_t ref_cycles;
+	u32_t lookup_cycles;
+
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+
+	start = k_cycle_get_32();
+	for (size_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(lookup_uuids); j++) {
+			attr_chrc = char_by_uuid_ref(dm, NULL, lookup_uuids[j]);
+			if (attr_chrc) {
+				(void)desc_by_uuid_ref(dm, attr_chrc, BT_UUID_GATT_CCC);
+			}
+		}
+	}
+	ref_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (size_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(lookup_uuids); j++) {
+			attr_chrc = bt_gatt_dm_char_by_uuid(dm, lookup_uuids[j]);
+			if (attr_chrc) {
+				(void)bt_gatt_dm_desc_by_uuid(dm, attr_chrc, BT_UUID_GATT_CCC);
+			}
+		}
+	}
+	lookup_cycles = k_cycle_get_32() - start;
+
+	TC_PRINT("UUID lookups: iterators %u cycles, bt_gatt_dm %u cycles\n",
+		 ref_cycles / BENCHMARK_ITERATIONS,
+		 lookup_cycles / BENCHMARK_ITERATIONS);
+
+	bt_gatt_dm_data_release(dm);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(
@@ -387,7 +665,10 @@ void test_main(void)
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_attr_by_handle, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_next_chrc_access, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_chrc_by_uuid, test_setup, unit_test_noop),
-		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop)
+		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_dup_uuid_lookup, test_setup_dup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_dup_handles_assign, test_setup_dup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_dup_lookup_benchmark, test_setup_dup, unit_test_noop)
 	);
 
 	ztest_run_test_suite(test_gatt);
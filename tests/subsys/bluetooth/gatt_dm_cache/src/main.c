@@ -0,0 +1,650 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <ztest.h>
+#include <kernel.h>
+#include <string.h>
+#include <sys/util.h>
+#include <sys/byteorder.h>
+#include <settings/settings.h>
+#include <bluetooth/att.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt_dm.h>
+#include "../../gatt_dm/mock/gatt_discover_mock.h"
+
+/* Timeout for the discovery in ms */
+#define SERVICE_DISCOVERY_TIMEOUT 2000
+
+/* Layout of the record stored by the discovery manager.
+ * The attribute count is a little-endian u16_t.
+ */
+#define RECORD_HDR_SIZE 23
+#define RECORD_ATTR_CNT_OFF 3
+#define RECORD_UUID_TYPE_OFF (RECORD_HDR_SIZE + 3)
+
+#define STORE_RECORD_CNT 16
+#define STORE_KEY_LEN 32
+
+/* Keys of the records of peer_addr and other_addr */
+#define PEER_KEY "bt/dm/c6554433221101"
+#define OTHER_KEY "bt/dm/c6aabbccddee01"
+
+static char dummy_conn;
+K_SEM_DEFINE(discovery_finished, 0, 1);
+
+static const bt_addr_le_t peer_addr = {
+	.type = BT_ADDR_LE_RANDOM,
+	.a = { { 0x11, 0x22, 0x33, 0x44, 0x55, 0xc6 } }
+};
+
+static const bt_addr_le_t other_addr = {
+	.type = BT_ADDR_LE_RANDOM,
+	.a = { { 0xee, 0xdd, 0xcc, 0xbb, 0xaa, 0xc6 } }
+};
+
+/* Defined by the Bluetooth host, which is not built */
+const bt_addr_le_t bt_addr_le_any = { 0, { { 0, 0, 0, 0, 0, 0 } } };
+
+const struct bt_gatt_attr discover_sim[] = {
+	/* HIDS */
+	BT_GATT_DISCOVER_MOCK_SERV(1, BT_UUID_HIDS, 11),
+	BT_GATT_DISCOVER_MOCK_CHRC(2, BT_UUID_HIDS_INFO, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(3, BT_UUID_HIDS_INFO),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(4, BT_UUID_HIDS_REPORT_MAP, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(5, BT_UUID_HIDS_REPORT_MAP),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(6, BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(7, BT_UUID_HIDS_REPORT),
+	BT_GATT_DISCOVER_MOCK_DESC(8, BT_UUID_GATT_CCC),
+	BT_GATT_DISCOVER_MOCK_DESC(9, BT_UUID_HIDS_REPORT_REF),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(10, BT_UUID_HIDS_CTRL_POINT, BT_GATT_CHRC_WRITE_WITHOUT_RESP),
+	BT_GATT_DISCOVER_MOCK_DESC(11, BT_UUID_HIDS_CTRL_POINT),
+
+	/* DIS */
+	BT_GATT_DISCOVER_MOCK_SERV(12, BT_UUID_DIS, 0xffff),
+	BT_GATT_DISCOVER_MOCK_CHRC(13, BT_UUID_DIS_MODEL_NUMBER, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(14, BT_UUID_DIS_MODEL_NUMBER),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(15, BT_UUID_DIS_MANUFACTURER_NAME, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(16, BT_UUID_DIS_MANUFACTURER_NAME),
+};
+
+/* Database of the peer after a change of its HIDS */
+const struct bt_gatt_attr discover_sim_changed[] = {
+	BT_GATT_DISCOVER_MOCK_SERV(1, BT_UUID_HIDS, 8),
+	BT_GATT_DISCOVER_MOCK_CHRC(2, BT_UUID_HIDS_INFO, BT_GATT_CHRC_READ),
+	BT_GATT_DISCOVER_MOCK_DESC(3, BT_UUID_HIDS_INFO),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(4, BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE),
+	BT_GATT_DISCOVER_MOCK_DESC(5, BT_UUID_HIDS_REPORT),
+	BT_GATT_DISCOVER_MOCK_DESC(6, BT_UUID_HIDS_REPORT_REF),
+
+	BT_GATT_DISCOVER_MOCK_CHRC(7, BT_UUID_HIDS_CTRL_POINT, BT_GATT_CHRC_WRITE_WITHOUT_RESP),
+	BT_GATT_DISCOVER_MOCK_DESC(8, BT_UUID_HIDS_CTRL_POINT),
+};
+
+/* Database used to detect a discovery that was not loaded from the cache */
+const struct bt_gatt_attr discover_sim_bas[] = {
+	BT_GATT_DISCOVER_MOCK_SERV(1, BT_UUID_BAS, 0xffff),
+	BT_GATT_DISCOVER_MOCK_CHRC(2, BT_UUID_BAS_BATTERY_LEVEL, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(3, BT_UUID_BAS_BATTERY_LEVEL),
+	BT_GATT_DISCOVER_MOCK_DESC(4, BT_UUID_GATT_CCC),
+};
+
+
+/* Mocked Bluetooth host */
+static bool peer_bonded;
+static bool db_hash_supported;
+static u8_t db_hash[16];
+static size_t db_hash_read_cnt;
+
+static struct {
+	struct bt_conn *conn;
+	struct bt_gatt_read_params *params;
+	struct k_delayed_work work;
+} db_hash_mock;
+
+int bt_conn_get_info(const struct bt_conn *conn, struct bt_conn_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	info->type = BT_CONN_TYPE_LE;
+	info->id = BT_ID_DEFAULT;
+
+	return 0;
+}
+
+const bt_addr_le_t *bt_conn_get_dst(const struct bt_conn *conn)
+{
+	return &peer_addr;
+}
+
+bool bt_addr_le_is_bonded(u8_t id, const bt_addr_le_t *addr)
+{
+	return peer_bonded;
+}
+
+static void db_hash_read_work(struct k_work *work)
+{
+	struct bt_gatt_read_params *params = db_hash_mock.params;
+
+	if (db_hash_supported) {
+		(void)params->func(db_hash_mock.conn, 0, params, db_hash,
+				   sizeof(db_hash));
+	} else {
+		(void)params->func(db_hash_mock.conn,
+				   BT_ATT_ERR_ATTRIBUTE_NOT_FOUND, params,
+				   NULL, 0);
+	}
+}
+
+int bt_gatt_read(struct bt_conn *conn, struct bt_gatt_read_params *params)
+{
+	zassert_equal(0, params->handle_count, "Database Hash not read by UUID");
+	zassert_true(!bt_uuid_cmp(BT_UUID_GATT_DB_HASH, params->by_uuid.uuid),
+		     "Unexpected UUID read");
+
+	db_hash_read_cnt++;
+	db_hash_mock.conn = conn;
+	db_hash_mock.params = params;
+
+	k_delayed_work_init(&db_hash_mock.work, db_hash_read_work);
+	k_delayed_work_submit(&db_hash_mock.work, K_MSEC(5));
+
+	return 0;
+}
+
+
+/* Mocked settings storage */
+static struct store_record {
+	char key[STORE_KEY_LEN];
+	u8_t data[CONFIG_BT_GATT_DM_CACHE_SIZE + 1];
+	size_t len;
+} store[STORE_RECORD_CNT];
+
+static bool store_loading;
+
+static struct store_record *store_find(const char *key)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(store); i++) {
+		if (!strcmp(store[i].key, key)) {
+			return &store[i];
+		}
+	}
+
+	return NULL;
+}
+
+static size_t store_cnt(const char *prefix)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(store); i++) {
+		if (store[i].key[0] &&
+		    !strncmp(store[i].key, prefix, strlen(prefix))) {
+			cnt++;
+		}
+	}
+
+	return cnt;
+}
+
+/* The only stored discovery record */
+static struct store_record *store_record_get(void)
+{
+	zassert_equal(1, store_cnt(PEER_KEY "/"), "Expected one record");
+
+	for (size_t i = 0; i < ARRAY_SIZE(store); i++) {
+		if (!strncmp(store[i].key, PEER_KEY "/",
+			     strlen(PEER_KEY "/"))) {
+			return &store[i];
+		}
+	}
+
+	return NULL;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+	struct store_record *record = store_find(name);
+
+	zassert_true(strlen(name) < STORE_KEY_LEN, "Key too long: %s", name);
+	zassert_true(val_len <= CONFIG_BT_GATT_DM_CACHE_SIZE,
+		     "Value too long: %zu", val_len);
+
+	if (!record) {
+		record = store_find("");
+		zassert_not_null(record, "Settings storage full");
+		strcpy(record->key, name);
+	}
+
+	memcpy(record->data, value, val_len);
+	record->len = val_len;
+
+	return 0;
+}
+
+int settings_delete(const char *name)
+{
+	struct store_record *record = store_find(name);
+
+	zassert_false(store_loading, "Key deleted while loading the subtree");
+
+	if (record) {
+		memset(record, 0, sizeof(*record));
+	}
+
+	return 0;
+}
+
+int settings_name_next(const char *name, const char **next)
+{
+	int rc = 0;
+
+	if (next) {
+		*next = NULL;
+	}
+
+	if (!name) {
+		return 0;
+	}
+
+	while (name[rc] && (name[rc] != '/')) {
+		rc++;
+	}
+
+	if ((name[rc] == '/') && next) {
+		*next = &name[rc + 1];
+	}
+
+	return rc;
+}
+
+static ssize_t store_read(void *cb_arg, void *data, size_t len)
+{
+	struct store_record *record = cb_arg;
+
+	len = MIN(len, record->len);
+	memcpy(data, record->data, len);
+
+	return len;
+}
+
+int settings_load_subtree_direct(const char *subtree,
+				 settings_load_direct_cb cb, void *param)
+{
+	size_t len = strlen(subtree);
+
+	store_loading = true;
+
+	for (size_t i = 0; i < ARRAY_SIZE(store); i++) {
+		struct store_record *record = &store[i];
+		const char *name;
+
+		if (!record->key[0] || strncmp(record->key, subtree, len)) {
+			continue;
+		}
+
+		if (record->key[len] == '\0') {
+			name = NULL;
+		} else if (record->key[len] == '/') {
+			name = &record->key[len + 1];
+		} else {
+			continue;
+		}
+
+		(void)cb(name, record->len, store_read, record, param);
+	}
+
+	store_loading = false;
+
+	return 0;
+}
+
+
+void test_cb_completed(struct bt_gatt_dm *dm, void *context)
+{
+	printk("%s\n", __func__);
+	/* Saving discovery manager instance and giving the semaphore */
+	*(struct bt_gatt_dm **)context = dm;
+	k_sem_give(&discovery_finished);
+}
+
+void test_cb_service_not_found(struct bt_conn *conn, void *context)
+{
+	printk("%s\n", __func__);
+	*(struct bt_gatt_dm **)context = NULL;
+	k_sem_give(&discovery_finished);
+}
+
+void test_cb_error_found(struct bt_conn *conn, int err, void *context)
+{
+	printk("%s\n", __func__);
+	zassert_unreachable("Discovery error: %d", err);
+}
+
+struct bt_gatt_dm_cb test_cb = {
+	.completed         = test_cb_completed,
+	.service_not_found = test_cb_service_not_found,
+	.error_found       = test_cb_error_found
+};
+
+void test_setup(void)
+{
+	k_sem_reset(&discovery_finished);
+	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
+	memset(store, 0, sizeof(store));
+	memset(db_hash, 0xa5, sizeof(db_hash));
+	peer_bonded = true;
+	db_hash_supported = true;
+	db_hash_read_cnt = 0;
+}
+
+struct bt_gatt_dm *run_dm(const struct bt_uuid *svc_uuid)
+{
+	struct bt_gatt_dm *dm;
+	int err;
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn,
+			       svc_uuid,
+			       &test_cb,
+			       &dm);
+	zassert_false(err, "bt_gatt_dm_start finished with error: %d", err);
+
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+
+	return dm;
+}
+
+struct bt_gatt_dm *run_dm_next(struct bt_gatt_dm *dm)
+{
+	int err;
+	struct bt_gatt_dm *dm_next;
+
+	bt_gatt_dm_data_release(dm);
+	bt_gatt_dm_continue(dm, &dm_next);
+
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+
+	return dm_next;
+}
+
+/* Compare the discovered attributes with the simulated database */
+static void check_attrs(struct bt_gatt_dm *dm,
+			const struct bt_gatt_attr *expected, size_t cnt)
+{
+	const struct bt_gatt_dm_attr *attr = bt_gatt_dm_service_get(dm);
+
+	zassert_equal(cnt, bt_gatt_dm_attr_cnt(dm),
+		      "Unexpected number of attributes detected: %zu",
+		      bt_gatt_dm_attr_cnt(dm));
+
+	for (size_t i = 0; i < cnt; i++) {
+		const struct bt_gatt_service_val *serv_val;
+		const struct bt_gatt_chrc *chrc_val;
+
+		zassert_not_null(attr, "Attr handle: %u", expected[i].handle);
+		zassert_equal(expected[i].handle, attr->handle,
+			      "Unexpected handle: %u", attr->handle);
+		zassert_true(!bt_uuid_cmp(expected[i].uuid, attr->uuid),
+			     "Unexpected UUID, handle: %u", attr->handle);
+
+		serv_val = bt_gatt_dm_attr_service_val(attr);
+		chrc_val = bt_gatt_dm_attr_chrc_val(attr);
+		if (serv_val) {
+			const struct bt_gatt_service_val *exp_val =
+				expected[i].user_data;
+
+			zassert_true(!bt_uuid_cmp(exp_val->uuid, serv_val->uuid),
+				     "Unexpected service UUID");
+			zassert_equal(exp_val->end_handle, serv_val->end_handle,
+				      "Unexpected end handle: %u",
+				      serv_val->end_handle);
+		} else if (chrc_val) {
+			const struct bt_gatt_chrc *exp_val =
+				expected[i].user_data;
+
+			zassert_true(!bt_uuid_cmp(exp_val->uuid, chrc_val->uuid),
+				     "Unexpected characteristic UUID, handle: %u",
+				     attr->handle);
+			zassert_equal(exp_val->properties, chrc_val->properties,
+				      "Unexpected properties, handle: %u",
+				      attr->handle);
+		}
+
+		attr = bt_gatt_dm_attr_next(dm, attr);
+	}
+
+	zassert_is_null(attr, "Unexpected attribute detected");
+}
+
+static void release(struct bt_gatt_dm *dm)
+{
+	bt_gatt_dm_data_release(dm);
+	zassert_equal(0, bt_gatt_dm_attr_cnt(dm), "Parameter count after clearing: %zu", bt_gatt_dm_attr_cnt(dm));
+}
+
+/* Discovery of HIDS that stores its record */
+static void store_hids(void)
+{
+	struct bt_gatt_dm *dm = run_dm(BT_UUID_HIDS);
+
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, discover_sim, 11);
+	release(dm);
+	zassert_not_null(store_record_get(), "Discovery not stored");
+}
+
+void test_cache_store_load(void)
+{
+	struct bt_gatt_dm *dm;
+
+	store_hids();
+	zassert_equal(1, db_hash_read_cnt, "Database Hash not read");
+
+	/* Loaded from the cache, the discovery would find BAS */
+	bt_gatt_discover_mock_setup(discover_sim_bas,
+				    ARRAY_SIZE(discover_sim_bas));
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "HIDS not loaded from the cache");
+	check_attrs(dm, discover_sim, 11);
+	release(dm);
+	zassert_equal(2, db_hash_read_cnt, "Database Hash not read");
+}
+
+void test_cache_generic_serv(void)
+{
+	struct bt_gatt_dm *dm;
+
+	/* Every service is stored in its own record */
+	dm = run_dm(NULL);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	dm = run_dm_next(dm);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	dm = run_dm_next(dm);
+	zassert_is_null(dm, "Unexpected service detected");
+	zassert_equal(2, store_cnt(PEER_KEY "/"), "Expected two records");
+
+	/* The end handle of the cached service gives the next start handle */
+	bt_gatt_discover_mock_setup(discover_sim_bas,
+				    ARRAY_SIZE(discover_sim_bas));
+	dm = run_dm(NULL);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, discover_sim, 11);
+
+	dm = run_dm_next(dm);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, &discover_sim[11], 5);
+
+	dm = run_dm_next(dm);
+	zassert_is_null(dm, "Unexpected service detected");
+}
+
+void test_cache_db_hash_changed(void)
+{
+	struct bt_gatt_dm *dm;
+
+	store_hids();
+
+	db_hash[0]++;
+	bt_gatt_discover_mock_setup(discover_sim_changed,
+				    ARRAY_SIZE(discover_sim_changed));
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, discover_sim_changed,
+		    ARRAY_SIZE(discover_sim_changed));
+	release(dm);
+
+	/* The record is replaced */
+	bt_gatt_discover_mock_setup(discover_sim_bas,
+				    ARRAY_SIZE(discover_sim_bas));
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "HIDS not loaded from the cache");
+	check_attrs(dm, discover_sim_changed,
+		    ARRAY_SIZE(discover_sim_changed));
+	release(dm);
+}
+
+void test_cache_invalid_record(void)
+{
+	static const struct {
+		const char *desc;
+		size_t off;
+		u8_t val;
+		int len_diff;
+	} corruptions[] = {
+		{ "version", 0, 0xff, 0 },
+		{ "service value size", 1, 0xff, 0 },
+		{ "characteristic size", 2, 0xff, 0 },
+		{ "no attributes", RECORD_ATTR_CNT_OFF, 0, 0 },
+		{ "missing attributes", RECORD_ATTR_CNT_OFF, 12, 0 },
+		{ "too many attributes", RECORD_ATTR_CNT_OFF, 0xff, 0 },
+		{ "attribute count high byte", RECORD_ATTR_CNT_OFF + 1, 1, 0 },
+		{ "UUID type", RECORD_UUID_TYPE_OFF, 0xff, 0 },
+		{ "truncated", 0, 0, -1 },
+		{ "trailing byte", 0, 0, 1 },
+	};
+	static struct store_record valid;
+	struct store_record *record;
+	struct bt_gatt_dm *dm;
+
+	store_hids();
+	record = store_record_get();
+	zassert_equal(11, sys_get_le16(&record->data[RECORD_ATTR_CNT_OFF]),
+		      "Unexpected record layout");
+	memcpy(&valid, record, sizeof(valid));
+
+	for (size_t i = 0; i < ARRAY_SIZE(corruptions); i++) {
+		printk("Record corruption: %s\n", corruptions[i].desc);
+
+		if (corruptions[i].len_diff) {
+			record->len += corruptions[i].len_diff;
+		} else {
+			record->data[corruptions[i].off] = corruptions[i].val;
+		}
+
+		/* The record is rejected and replaced by the discovery */
+		dm = run_dm(BT_UUID_HIDS);
+		zassert_not_null(dm, "Device Manager pointer not set");
+		check_attrs(dm, discover_sim, 11);
+		release(dm);
+
+		record = store_record_get();
+		zassert_equal(valid.len, record->len, "Record not replaced");
+		zassert_true(!memcmp(valid.data, record->data, valid.len),
+			     "Record not replaced");
+	}
+}
+
+void test_cache_not_bonded(void)
+{
+	struct bt_gatt_dm *dm;
+
+	peer_bonded = false;
+
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, discover_sim, 11);
+	release(dm);
+
+	zassert_equal(0, db_hash_read_cnt, "Database Hash read");
+	zassert_equal(0, store_cnt("bt/dm"), "Discovery stored");
+}
+
+void test_cache_no_db_hash(void)
+{
+	struct bt_gatt_dm *dm;
+
+	db_hash_supported = false;
+
+	dm = run_dm(BT_UUID_HIDS);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	check_attrs(dm, discover_sim, 11);
+	release(dm);
+
+	zassert_equal(1, db_hash_read_cnt, "Database Hash not read");
+	zassert_equal(0, store_cnt("bt/dm"), "Discovery stored");
+}
+
+void test_cache_clear(void)
+{
+	char key[STORE_KEY_LEN];
+	u8_t data = 0;
+	int err;
+
+	store_hids();
+	settings_save_one(OTHER_KEY "/00000001", &data, sizeof(data));
+	settings_save_one("bt/name", &data, sizeof(data));
+
+	err = bt_gatt_dm_cache_clear(&other_addr);
+	zassert_equal(0, err, "Clearing the cache failed: %d", err);
+	zassert_equal(0, store_cnt(OTHER_KEY), "Records not removed");
+	zassert_equal(1, store_cnt(PEER_KEY), "Record of other peer removed");
+
+	/* More records than are removed at a time */
+	for (size_t i = 0; i < 10; i++) {
+		snprintf(key, sizeof(key), PEER_KEY "/%08x", (unsigned int)i);
+		settings_save_one(key, &data, sizeof(data));
+	}
+
+	err = bt_gatt_dm_cache_clear(&peer_addr);
+	zassert_equal(0, err, "Clearing the cache failed: %d", err);
+	zassert_equal(0, store_cnt(PEER_KEY), "Records not removed");
+
+	store_hids();
+	settings_save_one(OTHER_KEY "/00000001", &data, sizeof(data));
+
+	err = bt_gatt_dm_cache_clear(BT_ADDR_LE_ANY);
+	zassert_equal(0, err, "Clearing the cache failed: %d", err);
+	zassert_equal(0, store_cnt("bt/dm"), "Records not removed");
+	zassert_not_null(store_find("bt/name"), "Other settings removed");
+
+	store_hids();
+
+	err = bt_gatt_dm_cache_clear(NULL);
+	zassert_equal(0, err, "Clearing the cache failed: %d", err);
+	zassert_equal(0, store_cnt("bt/dm"), "Records not removed");
+	zassert_not_null(store_find("bt/name"), "Other settings removed");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(
+		test_gatt_dm_cache,
+		ztest_unit_test_setup_teardown(test_cache_store_load, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_generic_serv, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_db_hash_changed, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_invalid_record, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_not_bonded, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_no_db_hash, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cache_clear, test_setup, unit_test_noop)
+	);
+
+	ztest_run_test_suite(test_gatt_dm_cache);
+}
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <sys/byteorder.h>
+#include <bluetooth/scan.h>
+
+#define ADDR_FILTERS CONFIG_BT_SCAN_ADDRESS_CNT
+/* One UUID filter is left for the test of UUID sizes. */
+#define UUID_FILTERS (CONFIG_BT_SCAN_UUID_CNT - 1)
+#define MD_FILTERS CONFIG_BT_SCAN_MANUFACTURER_DATA_CNT
+#define MD_LEN 4
+
+#define BENCHMARK_REPORTS 5000
+/* One of this many reports in the benchmark matches a filter. */
+#define BENCHMARK_MATCH_INTERVAL 100
+
+static u8_t ad_data[64];
+static struct net_buf_simple ad;
+
+static size_t match_cnt;
+static size_t no_match_cnt;
+static struct bt_scan_adv_info last_adv_info;
+
+/* Stubs and mocks */
+static bt_le_scan_cb_t *scan_cb;
+
+int bt_le_scan_start(const struct bt_le_scan_param *param,
+		     bt_le_scan_cb_t cb)
+{
+	scan_cb = cb;
+	return 0;
+}
+
+int bt_le_scan_stop(void)
+{
+	return 0;
+}
+
+struct bt_conn *bt_conn_create_le(const bt_addr_le_t *peer,
+				  const struct bt_le_conn_param *param)
+{
+	return NULL;
+}
+
+void bt_conn_unref(struct bt_conn *conn)
+{
+}
+
+void bt_data_parse(struct net_buf_simple *buf,
+		   bool (*func)(struct bt_data *data, void *user_data),
+		   void *user_data)
+{
+	size_t pos = 0;
+
+	while (pos + 2 <= buf->len) {
+		struct bt_data data = {
+			.type = buf->data[pos + 1],
+			.data_len = buf->data[pos] - 1,
+			.data = &buf->data[pos + 2],
+		};
+
+		if ((buf->data[pos] == 0) ||
+		    (pos + 1 + buf->data[pos] > buf->len) ||
+		    !func(&data, user_data)) {
+			return;
+		}
+
+		pos += 1 + buf->data[pos];
+	}
+}
+
+static void filter_match(struct bt_scan_device_info *device_info,
+			 struct bt_scan_filter_match *filter_match,
+			 bool connectable)
+{
+	match_cnt++;
+	last_adv_info = device_info->adv_info;
+}
+
+static void filter_no_match(struct bt_scan_device_info *device_info,
+			    bool connectable)
+{
+	no_match_cnt++;
+	last_adv_info = device_info->adv_info;
+}
+
+BT_SCAN_CB_INIT(scan_cb_data, filter_match, filter_no_match, NULL, NULL);
+
+static void ad_reset(void)
+{
+	net_buf_simple_init_with_data(&ad, ad_data, 0);
+}
+
+static void ad_add(u8_t type, const void *data, u8_t len)
+{
+	zassert_true(ad.len + 2 + len <= sizeof(ad_data), "AD too long");
+	ad_data[ad.len] = len + 1;
+	ad_data[ad.len + 1] = type;
+	memcpy(&ad_data[ad.len + 2], data, len);
+	ad.len += 2 + len;
+}
+
+static void addr_get(size_t n, bt_addr_le_t *addr)
+{
+	addr->type = BT_ADDR_LE_RANDOM;
+	sys_put_le32(n * 2654435761U, &addr->a.val[0]);
+	sys_put_le16(0xc000 | n, &addr->a.val[4]);
+}
+
+static void uuid_get(size_t n, struct bt_uuid_128 *uuid)
+{
+	uuid->uuid.type = BT_UUID_TYPE_128;
+	for (size_t i = 0; i < sizeof(uuid->val); i++) {
+		uuid->val[i] = i * 17;
+	}
+	sys_put_le16(n, uuid->val);
+}
+
+static void md_get(size_t n, u8_t *md)
+{
+	/* Company identifier followed by the device type. */
+	sys_put_le16(0x0059, md);
+	sys_put_le16(n, &md[2]);
+}
+
+static void report_rssi(size_t n, const bt_addr_le_t *addr, s8_t rssi)
+{
+	struct bt_uuid_128 uuid;
+	u8_t md[MD_LEN];
+
+	ad_reset();
+	uuid_get(n, &uuid);
+	ad_add(BT_DATA_UUID128_ALL, uuid.val, sizeof(uuid.val));
+	md_get(n, md);
+	ad_add(BT_DATA_MANUFACTURER_DATA, md, sizeof(md));
+
+	scan_cb(addr, rssi, BT_LE_ADV_IND, &ad);
+}
+
+static void report(size_t n, const bt_addr_le_t *addr)
+{
+	report_rssi(n, addr, -50);
+}
+
+static void filters_setup(void)
+{
+	bt_addr_le_t addr;
+	struct bt_uuid_128 uuid;
+	u8_t md[MD_LEN];
+	struct bt_scan_manufacturer_data md_filter = {
+		.data = md,
+		.data_len = sizeof(md),
+	};
+
+	bt_scan_init(NULL);
+
+	for (size_t i = 0; i < ADDR_FILTERS; i++) {
+		addr_get(i, &addr);
+		zassert_equal(0, bt_scan_filter_add(BT_SCAN_FILTER_TYPE_ADDR,
+						    &addr), NULL);
+	}
+
+	for (size_t i = 0; i < UUID_FILTERS; i++) {
+		uuid_get(i, &uuid);
+		zassert_equal(0, bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID,
+						    &uuid), NULL);
+	}
+
+	for (size_t i = 0; i < MD_FILTERS; i++) {
+		md_get(i, md);
+		zassert_equal(0, bt_scan_filter_add(
+				BT_SCAN_FILTER_TYPE_MANUFACTURER_DATA,
+				&md_filter), NULL);
+	}
+
+	zassert_equal(0, bt_scan_start(BT_SCAN_TYPE_SCAN_PASSIVE), NULL);
+
+	match_cnt = 0;
+	no_match_cnt = 0;
+}
+
+static void test_addr_filter(void)
+{
+	bt_addr_le_t addr;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_enable(BT_SCAN_ADDR_FILTER, false),
+		      NULL);
+
+	for (size_t i = 0; i < ADDR_FILTERS; i++) {
+		addr_get(i, &addr);
+		report(1000, &addr);
+	}
+	zassert_equal(ADDR_FILTERS, match_cnt, "All addresses should match");
+
+	addr_get(ADDR_FILTERS, &addr);
+	report(1000, &addr);
+	zassert_equal(1, no_match_cnt, NULL);
+}
+
+static void test_uuid_filter(void)
+{
+	struct bt_uuid_16 uuid_16 = BT_UUID_INIT_16(0x1812);
+	struct bt_uuid_128 uuid_128 = BT_UUID_INIT_128(
+		0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+		0x00, 0x10, 0x00, 0x00, 0x12, 0x18, 0x00, 0x00);
+	u8_t uuid_16_data[2];
+	bt_addr_le_t addr;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID,
+					    &uuid_16.uuid), NULL);
+	zassert_equal(0, bt_scan_filter_enable(BT_SCAN_UUID_FILTER, false),
+		      NULL);
+
+	addr_get(ADDR_FILTERS, &addr);
+	report(UUID_FILTERS - 1, &addr);
+	zassert_equal(1, match_cnt, "128-bit UUID should match");
+
+	/* 16-bit filter advertised as a 128-bit UUID */
+	ad_reset();
+	ad_add(BT_DATA_UUID128_SOME, uuid_128.val, sizeof(uuid_128.val));
+	scan_cb(&addr, -50, BT_LE_ADV_IND, &ad);
+	zassert_equal(2, match_cnt, "UUID value should match in any size");
+
+	ad_reset();
+	sys_put_le16(0x1812, uuid_16_data);
+	ad_add(BT_DATA_UUID16_ALL, uuid_16_data, sizeof(uuid_16_data));
+	scan_cb(&addr, -50, BT_LE_ADV_IND, &ad);
+	zassert_equal(3, match_cnt, NULL);
+
+	report(UUID_FILTERS, &addr);
+	zassert_equal(1, no_match_cnt, NULL);
+}
+
+static void test_manufacturer_data_filter(void)
+{
+	u8_t company[] = {0x59, 0x00};
+	struct bt_scan_manufacturer_data md_filter = {
+		.data = company,
+		.data_len = sizeof(company),
+	};
+	u8_t md[MD_LEN];
+	bt_addr_le_t addr;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_enable(
+		BT_SCAN_MANUFACTURER_DATA_FILTER, false), NULL);
+	addr_get(ADDR_FILTERS, &addr);
+
+	report(MD_FILTERS - 1, &addr);
+	zassert_equal(1, match_cnt, NULL);
+	report(MD_FILTERS, &addr);
+	zassert_equal(1, no_match_cnt, NULL);
+
+	/* Shorter filter matching all devices of the company */
+	bt_scan_filter_remove_all();
+	zassert_equal(0, bt_scan_filter_add(
+		BT_SCAN_FILTER_TYPE_MANUFACTURER_DATA, &md_filter), NULL);
+	report(MD_FILTERS, &addr);
+	zassert_equal(2, match_cnt, "Data prefix should match");
+
+	ad_reset();
+	md_get(0, md);
+	ad_add(BT_DATA_MANUFACTURER_DATA, md, 1);
+	scan_cb(&addr, -50, BT_LE_ADV_IND, &ad);
+	zassert_equal(2, no_match_cnt, "Too short data should not match");
+}
+
+static void test_all_mode(void)
+{
+	bt_addr_le_t addr;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_enable(BT_SCAN_ADDR_FILTER |
+		BT_SCAN_MANUFACTURER_DATA_FILTER, true), NULL);
+
+	addr_get(0, &addr);
+	report(0, &addr);
+	zassert_equal(1, match_cnt, NULL);
+
+	report(MD_FILTERS, &addr);
+	zassert_equal(1, no_match_cnt, "Both filters should have to match");
+
+	addr_get(ADDR_FILTERS, &addr);
+	report(0, &addr);
+	zassert_equal(2, no_match_cnt, "Both filters should have to match");
+}
+
+static void test_benchmark(void)
+{
+	bt_addr_le_t addr;
+	u32_t start;
+	u32_t cycles;
+	u64_t rate;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_enable(BT_SCAN_ADDR_FILTER |
+		BT_SCAN_UUID_FILTER | BT_SCAN_MANUFACTURER_DATA_FILTER, false),
+		NULL);
+
+	start = k_cycle_get_32();
+
+	for (size_t i = 0; i < BENCHMARK_REPORTS; i++) {
+		if ((i % BENCHMARK_MATCH_INTERVAL) == 0) {
+			addr_get(i % ADDR_FILTERS, &addr);
+		} else {
+			addr_get(ADDR_FILTERS + i, &addr);
+		}
+
+		/* Neither UUID nor manufacturer data is among the filters */
+		report(MAX(UUID_FILTERS, MD_FILTERS) + i, &addr);
+	}
+
+	cycles = MAX(k_cycle_get_32() - start, 1);
+	rate = ((u64_t)BENCHMARK_REPORTS * sys_clock_hw_cycles_per_sec()) /
+	       cycles;
+
+	TC_PRINT("%d reports with %d address, %d UUID and %d manufacturer "
+		 "data filters: %u cycles, %u reports/s\n", BENCHMARK_REPORTS,
+		 ADDR_FILTERS, UUID_FILTERS, MD_FILTERS, cycles, (u32_t)rate);
+
+	zassert_equal(BENCHMARK_REPORTS / BENCHMARK_MATCH_INTERVAL, match_cnt,
+		      "Index should not hide matching devices");
+	zassert_equal(BENCHMARK_REPORTS - match_cnt, no_match_cnt, NULL);
+}
+
+#if defined(CONFIG_BT_SCAN_DUPLICATE_FILTER)
+static void test_duplicate_filter(void)
+{
+	bt_addr_le_t addr;
+
+	filters_setup();
+	addr_get(0, &addr);
+
+	report_rssi(0, &addr, -40);
+	zassert_equal(1, no_match_cnt, NULL);
+	zassert_equal(0, last_adv_info.duplicate_cnt, NULL);
+	zassert_equal(-40, last_adv_info.rssi, NULL);
+
+	report_rssi(0, &addr, -50);
+	report_rssi(0, &addr, -60);
+	zassert_equal(1, no_match_cnt, "Same data should be suppressed");
+
+	scan_cb(&addr, -50, BT_LE_SCAN_RSP, &ad);
+	zassert_equal(2, no_match_cnt, "Scan response should be tracked apart");
+
+	report(1, &addr);
+	zassert_equal(3, no_match_cnt, "Changed data should be reported");
+	report(1, &addr);
+	zassert_equal(3, no_match_cnt, NULL);
+
+	k_sleep(CONFIG_BT_SCAN_DUPLICATE_FILTER_TIMEOUT);
+
+	report_rssi(1, &addr, -70);
+	zassert_equal(4, no_match_cnt, "Data should be reported after timeout");
+	zassert_equal(1, last_adv_info.duplicate_cnt, NULL);
+	zassert_equal(-60, last_adv_info.rssi, "RSSI should be averaged");
+}
+
+static void test_duplicate_filter_lru(void)
+{
+	bt_addr_le_t addr;
+
+	filters_setup();
+
+	for (size_t i = 0; i <= CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT; i++) {
+		addr_get(i, &addr);
+		report(0, &addr);
+	}
+	zassert_equal(CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT + 1, no_match_cnt,
+		      NULL);
+
+	/* The first device was forgotten, the last one is remembered. */
+	addr_get(0, &addr);
+	report(0, &addr);
+	zassert_equal(CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT + 2, no_match_cnt,
+		      NULL);
+	addr_get(CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT, &addr);
+	report(0, &addr);
+	zassert_equal(CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT + 2, no_match_cnt,
+		      NULL);
+}
+
+static void test_duplicate_filter_match(void)
+{
+	bt_addr_le_t addr;
+
+	filters_setup();
+	zassert_equal(0, bt_scan_filter_enable(BT_SCAN_ADDR_FILTER, false),
+		      NULL);
+
+	addr_get(0, &addr);
+	report(0, &addr);
+	report(0, &addr);
+	zassert_equal(1, match_cnt, "Same data should be suppressed");
+
+	/* Devices that do not match are neither suppressed nor tracked. */
+	for (size_t i = 0; i <= CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT; i++) {
+		addr_get(ADDR_FILTERS + i, &addr);
+		report(0, &addr);
+		report(0, &addr);
+	}
+	zassert_equal(2 * (CONFIG_BT_SCAN_DUPLICATE_FILTER_CNT + 1),
+		      no_match_cnt, "Devices not matching should be reported");
+
+	addr_get(0, &addr);
+	report(0, &addr);
+	zassert_equal(1, match_cnt, "Matching device should be remembered");
+}
+#else
+/* Duplicate filter is disabled in this build. */
+static void test_duplicate_filter(void)
+{
+}
+
+static void test_duplicate_filter_lru(void)
+{
+}
+
+static void test_duplicate_filter_match(void)
+{
+}
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+void test_main(void)
+{
+	bt_scan_cb_register(&scan_cb_data);
+
+	ztest_test_suite(bt_scan,
+			 ztest_unit_test(test_addr_filter),
+			 ztest_unit_test(test_uuid_filter),
+			 ztest_unit_test(test_manufacturer_data_filter),
+			 ztest_unit_test(test_all_mode),
+			 ztest_unit_test(test_duplicate_filter),
+			 ztest_unit_test(test_duplicate_filter_lru),
+			 ztest_unit_test(test_duplicate_filter_match),
+			 ztest_unit_test(test_benchmark)
+			 );
+
+	ztest_run_test_suite(bt_scan);
+}
@@ -179,13 +179,69 @@ static void test_write(void)
 	zassert_true(err < 0, "Did not get error when writing uninitialized");
 }
 
+static void test_hash(void)
+{
+	/* SHA-256 of "abc" */
+	static const u8_t expected[DFU_TARGET_HASH_SIZE] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	u8_t hash[DFU_TARGET_HASH_SIZE];
+	int err;
+
+	done();
+	init_retval = 0;
+	done_retval = 0;
+	write_retval = 0;
+	offset_get_retval = 0;
+	offset_get_out_param = 0;
+	init();
+
+	err = dfu_target_write("a", 1);
+	zassert_equal(err, 0, NULL);
+	err = dfu_target_write("bc", 2);
+	zassert_equal(err, 0, NULL);
+
+	err = dfu_target_hash_get(hash);
+	zassert_equal(err, 0, "Hash should be available");
+	zassert_mem_equal(hash, expected, sizeof(hash), "Wrong hash");
+
+	err = dfu_target_done(true);
+	zassert_equal(err, 0, NULL);
+	err = dfu_target_hash_get(hash);
+	zassert_equal(err, 0, "Hash should be available after done");
+	zassert_mem_equal(hash, expected, sizeof(hash), "Wrong hash");
+
+	/* Resuming from a non-zero offset after reset, no hash */
+	offset_get_out_param = 3;
+	init();
+	err = dfu_target_hash_get(hash);
+	zassert_equal(err, -ENODATA, "Hash should not be available");
+
+	/* Failed write invalidates the hash */
+	done();
+	offset_get_out_param = 0;
+	init();
+	write_retval = -42;
+	err = dfu_target_write("a", 1);
+	zassert_equal(err, -42, NULL);
+	err = dfu_target_hash_get(hash);
+	zassert_equal(err, -ENODATA, "Hash should not be available");
+
+	write_retval = 0;
+	done();
+}
+
 void test_main(void)
 {
 	ztest_test_suite(dfu_target_test,
 			 ztest_unit_test(test_write),
 			 ztest_unit_test(test_offset_get),
 			 ztest_unit_test(test_done),
-			 ztest_unit_test(test_init)
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_hash)
 			 );
 
 	ztest_run_test_suite(dfu_target_test);
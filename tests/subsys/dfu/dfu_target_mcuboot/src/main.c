@@ -9,6 +9,10 @@
 #include <ztest.h>
 #include <dfu_target.h>
 #include <dfu_target_mcuboot.h>
+#include <dfu/flash_img.h>
+#include <dfu/mcuboot.h>
+#include <settings/settings.h>
+#include <pm_config.h>
 
 /* Create buffer which we will fill with strings to test with.
  * This is needed since 'dfu_ctx_Mcuboot_set_b1_file` will modify its
@@ -20,6 +24,85 @@ char buf[1024];
 #define S0_S1 "s0 s1"
 #define NO_SPACE "s0s1"
 
+#define FRAGMENT_SIZE 512
+
+#define BYTES_INTERVAL CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_BYTES_INTERVAL
+#define TIME_INTERVAL CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_TIME_INTERVAL
+
+/* Stubs and mocks */
+static u8_t fragment[FRAGMENT_SIZE];
+static size_t settings_save_count;
+static size_t saved_offset;
+/* Bytes written to flash, not reset by flash_img_init() */
+static size_t flash_bytes;
+
+int flash_img_init(struct flash_img_context *ctx)
+{
+	ctx->bytes_written = 0;
+	ctx->buf_bytes = 0;
+	return 0;
+}
+
+size_t flash_img_bytes_written(struct flash_img_context *ctx)
+{
+	return ctx->bytes_written + ctx->buf_bytes;
+}
+
+int flash_img_buffered_write(struct flash_img_context *ctx, const u8_t *data,
+			     size_t len, bool flush)
+{
+	while (len > 0) {
+		size_t chunk = MIN(len, sizeof(ctx->buf) - ctx->buf_bytes);
+
+		memcpy(&ctx->buf[ctx->buf_bytes], data, chunk);
+		ctx->buf_bytes += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if (ctx->buf_bytes == sizeof(ctx->buf)) {
+			ctx->bytes_written += ctx->buf_bytes;
+			flash_bytes += ctx->buf_bytes;
+			ctx->buf_bytes = 0;
+		}
+	}
+
+	if (flush) {
+		ctx->bytes_written += ctx->buf_bytes;
+		flash_bytes += ctx->buf_bytes;
+		ctx->buf_bytes = 0;
+	}
+
+	return 0;
+}
+
+int boot_request_upgrade(int permanent)
+{
+	return 0;
+}
+
+int settings_subsys_init(void)
+{
+	return 0;
+}
+
+int settings_register(struct settings_handler *cf)
+{
+	return 0;
+}
+
+int settings_load(void)
+{
+	return 0;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+	zassert_equal(sizeof(size_t), val_len, NULL);
+	memcpy(&saved_offset, value, val_len);
+	settings_save_count++;
+	return 0;
+}
+
 static void test_dfu_ctx_mcuboot_set_b1_file(void)
 {
 	int err;
@@ -89,6 +172,206 @@ static void test_dfu_ctx_mcuboot_set_b1_file__empty(void)
 	zassert_true(update == NULL, "update should not be set");
 }
 
+static void write_buffers(size_t count)
+{
+	for (size_t i = 0; i < count * CONFIG_IMG_BLOCK_BUF_SIZE;
+	     i += FRAGMENT_SIZE) {
+		int err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+
+		zassert_equal(err, 0, NULL);
+	}
+}
+
+static void checkpoint_init(void)
+{
+	int err = dfu_target_mcuboot_init(PM_MCUBOOT_SECONDARY_SIZE, NULL);
+
+	zassert_equal(err, 0, NULL);
+	settings_save_count = 0;
+	flash_bytes = 0;
+}
+
+static void checkpoint_flush_check(void)
+{
+	size_t offset;
+	int err;
+
+	/* Progress is not stored until the image buffer is flushed */
+	for (size_t i = 0; i < CONFIG_IMG_BLOCK_BUF_SIZE / FRAGMENT_SIZE - 1;
+	     i++) {
+		err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+		zassert_equal(err, 0, NULL);
+	}
+	zassert_equal(settings_save_count, 0, "No checkpoint expected");
+
+	err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(settings_save_count, 1, "One checkpoint expected");
+	zassert_equal(saved_offset, CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+
+	err = dfu_target_mcuboot_offset_get(&offset);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(offset, CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+}
+
+static void checkpoint_bytes_check(void)
+{
+	const size_t buffers = BYTES_INTERVAL / CONFIG_IMG_BLOCK_BUF_SIZE;
+
+	/* Flushed image buffers are not stored until the interval is
+	 * reached.
+	 */
+	write_buffers(buffers - 1);
+	zassert_equal(flash_bytes, (buffers - 1) * CONFIG_IMG_BLOCK_BUF_SIZE,
+		      NULL);
+	zassert_equal(settings_save_count, 0, "No checkpoint expected");
+
+	write_buffers(1);
+	zassert_equal(settings_save_count, 1, "One checkpoint expected");
+	zassert_equal(saved_offset, BYTES_INTERVAL, NULL);
+
+	write_buffers(buffers - 1);
+	zassert_equal(settings_save_count, 1, "No new checkpoint expected");
+}
+
+static void checkpoint_time_check(void)
+{
+	int err;
+
+	/* Flushed image buffer is not stored until the interval passes */
+	write_buffers(1);
+	zassert_equal(flash_bytes, CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+	zassert_equal(settings_save_count, 0, "No checkpoint expected");
+
+	k_sleep(K_MSEC(TIME_INTERVAL));
+
+	/* Next write stores the progress flushed before */
+	err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(settings_save_count, 1, "One checkpoint expected");
+	zassert_equal(saved_offset, CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+
+	k_sleep(K_MSEC(TIME_INTERVAL));
+
+	/* Interval passed, but nothing new was flushed */
+	err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(settings_save_count, 1, "No new checkpoint expected");
+
+	write_buffers(1);
+	zassert_equal(settings_save_count, 2, "New checkpoint expected");
+	zassert_equal(saved_offset, 2 * CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+
+	/* Interval did not pass since the last checkpoint */
+	write_buffers(1);
+	zassert_equal(flash_bytes, 3 * CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+	zassert_equal(settings_save_count, 2, "No new checkpoint expected");
+}
+
+static void test_dfu_target_mcuboot_checkpoint(void)
+{
+	int err;
+
+	checkpoint_init();
+
+	if (IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_BYTES)) {
+		checkpoint_bytes_check();
+	} else if (IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_TIME)) {
+		checkpoint_time_check();
+	} else {
+		checkpoint_flush_check();
+	}
+
+	err = dfu_target_mcuboot_done(false);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(saved_offset, 0, "Progress should be reset");
+}
+
+static void test_dfu_target_mcuboot_done_flush(void)
+{
+	const size_t len = CONFIG_IMG_BLOCK_BUF_SIZE + FRAGMENT_SIZE;
+	size_t count;
+	int err;
+
+	/* Data that is not stored by a checkpoint yet is written to flash
+	 * when the update is completed.
+	 */
+	checkpoint_init();
+	write_buffers(1);
+	err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(flash_bytes, CONFIG_IMG_BLOCK_BUF_SIZE, NULL);
+	count = settings_save_count;
+
+	err = dfu_target_mcuboot_done(true);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(flash_bytes, len, "Image buffer should be flushed");
+	zassert_equal(settings_save_count, count + 1,
+		      "Progress should be reset once");
+	zassert_equal(saved_offset, 0, "Progress should be reset");
+
+	/* Aborted update is not flushed */
+	checkpoint_init();
+	err = dfu_target_mcuboot_write(fragment, FRAGMENT_SIZE);
+	zassert_equal(err, 0, NULL);
+
+	err = dfu_target_mcuboot_done(false);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(flash_bytes, 0, "Image buffer should not be flushed");
+	zassert_equal(saved_offset, 0, "Progress should be reset");
+}
+
+static void test_dfu_target_mcuboot_write_benchmark(void)
+{
+	const size_t image_size = PM_MCUBOOT_SECONDARY_SIZE;
+	u32_t start;
+	u32_t cycles;
+	int err;
+
+	err = dfu_target_mcuboot_init(image_size, NULL);
+	zassert_equal(err, 0, NULL);
+	settings_save_count = 0;
+
+	start = k_cycle_get_32();
+	for (size_t i = 0; i < image_size; i += FRAGMENT_SIZE) {
+		err = dfu_target_mcuboot_write(fragment,
+					       MIN(FRAGMENT_SIZE,
+						   image_size - i));
+		zassert_equal(err, 0, NULL);
+	}
+	err = dfu_target_mcuboot_done(true);
+	cycles = k_cycle_get_32() - start;
+	zassert_equal(err, 0, NULL);
+
+	TC_PRINT("%zu bytes in %u fragments: %u cycles, "
+		 "%u bytes/s, %zu checkpoints\n",
+		 image_size, ceiling_fraction(image_size, FRAGMENT_SIZE),
+		 cycles,
+		 (u32_t)(((u64_t)image_size * sys_clock_hw_cycles_per_sec()) /
+			 MAX(cycles, 1)),
+		 settings_save_count);
+
+	/* One checkpoint per image buffer, and one to reset the progress */
+	size_t max_count = ceiling_fraction(image_size,
+					    CONFIG_IMG_BLOCK_BUF_SIZE) + 1;
+
+	if (IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_BYTES)) {
+		/* Full image buffers written before the final flush */
+		size_t written = image_size -
+				 (image_size % CONFIG_IMG_BLOCK_BUF_SIZE);
+
+		zassert_equal(settings_save_count,
+			      written / BYTES_INTERVAL + 1,
+			      "Unexpected number of checkpoints");
+	} else if (IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_TIME)) {
+		zassert_true(settings_save_count <= max_count,
+			     "Unexpected number of checkpoints");
+	} else {
+		zassert_equal(settings_save_count, max_count,
+			      "Unexpected number of checkpoints");
+	}
+}
+
 void test_main(void)
 {
 	ztest_test_suite(lib_dfu_target_mcuboot_test,
@@ -96,7 +379,10 @@ void test_main(void)
 	     ztest_unit_test(test_dfu_ctx_mcuboot_set_b1_file__null),
 	     ztest_unit_test(test_dfu_ctx_mcuboot_set_b1_file__not_terminated),
 	     ztest_unit_test(test_dfu_ctx_mcuboot_set_b1_file__empty),
-	     ztest_unit_test(test_dfu_ctx_mcuboot_set_b1_file)
+	     ztest_unit_test(test_dfu_ctx_mcuboot_set_b1_file),
+	     ztest_unit_test(test_dfu_target_mcuboot_checkpoint),
+	     ztest_unit_test(test_dfu_target_mcuboot_done_flush),
+	     ztest_unit_test(test_dfu_target_mcuboot_write_benchmark)
 	 );
 
 	ztest_run_test_suite(lib_dfu_target_mcuboot_test);
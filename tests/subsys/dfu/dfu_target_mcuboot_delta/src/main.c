@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <sys/byteorder.h>
+#include <storage/flash_map.h>
+#include <tinycrypt/sha256.h>
+#include <tinycrypt/constants.h>
+#include <dfu/dfu_target.h>
+#include <dfu_target_mcuboot.h>
+#include <dfu_target_mcuboot_delta.h>
+
+#define SOURCE_SIZE 4096
+#define PATCH_OFFSET 1000
+#define PATCH_SIZE 16
+#define INSERT_OFFSET 2000
+#define INSERT_SIZE 32
+#define TARGET_SIZE (SOURCE_SIZE + INSERT_SIZE)
+/* Odd size to split headers and operations between fragments */
+#define FRAGMENT_SIZE 7
+
+#define OP_COPY 0x01
+#define OP_INSERT 0x02
+
+static u8_t source[SOURCE_SIZE];
+static u8_t target[TARGET_SIZE];
+static u8_t delta[256];
+static size_t delta_len;
+
+/* Stubs and mocks */
+static struct flash_area source_fa = {
+	.fa_size = SOURCE_SIZE,
+};
+static u8_t written[TARGET_SIZE];
+static size_t written_len;
+static bool done_successful;
+
+int flash_area_open(u8_t id, const struct flash_area **fa)
+{
+	*fa = &source_fa;
+	return 0;
+}
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len)
+{
+	zassert_true(off + len <= SOURCE_SIZE, "Read outside of the source");
+	memcpy(dst, &source[off], len);
+	return 0;
+}
+
+int dfu_target_mcuboot_init(size_t file_size, dfu_target_callback_t cb)
+{
+	return 0;
+}
+
+int dfu_target_mcuboot_offset_get(size_t *offset)
+{
+	*offset = written_len;
+	return 0;
+}
+
+int dfu_target_mcuboot_write(const void *const buf, size_t len)
+{
+	zassert_true(written_len + len <= sizeof(written), "Too much data");
+	memcpy(&written[written_len], buf, len);
+	written_len += len;
+	return 0;
+}
+
+int dfu_target_mcuboot_done(bool successful)
+{
+	done_successful = successful;
+	written_len = 0;
+	return 0;
+}
+
+static void delta_put(const void *data, size_t len)
+{
+	zassert_true(delta_len + len <= sizeof(delta), "Delta too big");
+	memcpy(&delta[delta_len], data, len);
+	delta_len += len;
+}
+
+static void delta_put_u32(u32_t val)
+{
+	u8_t le[sizeof(val)];
+
+	sys_put_le32(val, le);
+	delta_put(le, sizeof(le));
+}
+
+static void delta_copy(u32_t off, u32_t len)
+{
+	u8_t op = OP_COPY;
+
+	delta_put(&op, 1);
+	delta_put_u32(off);
+	delta_put_u32(len);
+}
+
+static void delta_insert(const u8_t *data, u32_t len)
+{
+	u8_t op = OP_INSERT;
+
+	delta_put(&op, 1);
+	delta_put_u32(len);
+	delta_put(data, len);
+}
+
+static void delta_header(void)
+{
+	struct tc_sha256_state_struct sha;
+	u8_t hash[32];
+
+	zassert_equal(TC_CRYPTO_SUCCESS, tc_sha256_init(&sha), NULL);
+	zassert_equal(TC_CRYPTO_SUCCESS,
+		      tc_sha256_update(&sha, source, SOURCE_SIZE), NULL);
+	zassert_equal(TC_CRYPTO_SUCCESS, tc_sha256_final(hash, &sha), NULL);
+
+	delta_len = 0;
+	delta_put_u32(DFU_TARGET_MCUBOOT_DELTA_MAGIC);
+	delta_put_u32(SOURCE_SIZE);
+	delta_put_u32(TARGET_SIZE);
+	delta_put(hash, sizeof(hash));
+}
+
+/* Target is the source with a few bytes changed and some data inserted, as
+ * generated by scripts/bootloader/delta.py.
+ */
+static void init(void)
+{
+	for (size_t i = 0; i < SOURCE_SIZE; i++) {
+		source[i] = i * 7 + (i >> 8);
+	}
+
+	memcpy(target, source, INSERT_OFFSET);
+	for (size_t i = 0; i < PATCH_SIZE; i++) {
+		target[PATCH_OFFSET + i] ^= 0x5a;
+	}
+	for (size_t i = 0; i < INSERT_SIZE; i++) {
+		target[INSERT_OFFSET + i] = 0xa0 + i;
+	}
+	memcpy(&target[INSERT_OFFSET + INSERT_SIZE], &source[INSERT_OFFSET],
+	       SOURCE_SIZE - INSERT_OFFSET);
+
+	delta_header();
+	delta_copy(0, PATCH_OFFSET);
+	delta_insert(&target[PATCH_OFFSET], PATCH_SIZE);
+	delta_copy(PATCH_OFFSET + PATCH_SIZE,
+		   INSERT_OFFSET - PATCH_OFFSET - PATCH_SIZE);
+	delta_insert(&target[INSERT_OFFSET], INSERT_SIZE);
+	delta_copy(INSERT_OFFSET, SOURCE_SIZE - INSERT_OFFSET);
+
+	written_len = 0;
+	done_successful = false;
+	zassert_equal(0, dfu_target_mcuboot_delta_init(delta_len, NULL), NULL);
+}
+
+static int delta_write(void)
+{
+	int err;
+
+	for (size_t i = 0; i < delta_len; i += FRAGMENT_SIZE) {
+		err = dfu_target_mcuboot_delta_write(&delta[i],
+					MIN(FRAGMENT_SIZE, delta_len - i));
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static void test_identify(void)
+{
+	init();
+
+	zassert_true(dfu_target_mcuboot_delta_identify(delta), NULL);
+	zassert_false(dfu_target_mcuboot_delta_identify(source), NULL);
+}
+
+static void test_apply(void)
+{
+	size_t offset;
+
+	init();
+
+	zassert_equal(0, delta_write(), NULL);
+	zassert_equal(0, dfu_target_mcuboot_delta_offset_get(&offset), NULL);
+	zassert_equal(delta_len, offset, "All of the delta should be consumed");
+	zassert_equal(TARGET_SIZE, written_len, NULL);
+	zassert_mem_equal(target, written, TARGET_SIZE, NULL);
+
+	TC_PRINT("Transferred %zu bytes instead of %d (%zu%%)\n", delta_len,
+		 TARGET_SIZE, (100 * delta_len) / TARGET_SIZE);
+	zassert_true(delta_len < TARGET_SIZE / 10,
+		     "Delta should be a fraction of the image");
+
+	zassert_equal(0, dfu_target_mcuboot_delta_done(true), NULL);
+	zassert_true(done_successful, NULL);
+}
+
+static void test_wrong_source(void)
+{
+	init();
+
+	source[SOURCE_SIZE - 1] ^= 1;
+	zassert_equal(-EINVAL, delta_write(),
+		      "Delta against another image should be rejected");
+	zassert_equal(0, written_len, NULL);
+}
+
+static void test_copy_outside_source(void)
+{
+	init();
+
+	delta_header();
+	delta_copy(SOURCE_SIZE - 10, 20);
+	zassert_equal(-EINVAL, delta_write(), NULL);
+}
+
+static void test_incomplete(void)
+{
+	init();
+
+	delta_len -= 1;
+	zassert_equal(0, delta_write(), NULL);
+	zassert_equal(-EINVAL, dfu_target_mcuboot_delta_done(true),
+		      "Incomplete image should be rejected");
+	zassert_false(done_successful, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lib_dfu_target_mcuboot_delta,
+	     ztest_unit_test(test_identify),
+	     ztest_unit_test(test_apply),
+	     ztest_unit_test(test_wrong_source),
+	     ztest_unit_test(test_copy_outside_source),
+	     ztest_unit_test(test_incomplete)
+	 );
+
+	ztest_run_test_suite(lib_dfu_target_mcuboot_delta);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "dispatch_event.h"
+
+
+EVENT_TYPE_DEFINE_EXT(dispatch_high_event,
+		      true,
+		      NULL,
+		      NULL,
+		      EVENT_ATTR_DISPATCH_CLASS(EVENT_DISPATCH_CLASS_HIGH));
+
+EVENT_TYPE_DEFINE_EXT(dispatch_low_event,
+		      true,
+		      NULL,
+		      NULL,
+		      EVENT_ATTR_DISPATCH_CLASS(EVENT_DISPATCH_CLASS_LOW));
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _DISPATCH_EVENT_H_
+#define _DISPATCH_EVENT_H_
+
+/**
+ * @brief Dispatch Class Events
+ * @defgroup dispatch_event Dispatch Class Events
+ * @{
+ */
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dispatch_high_event {
+	struct event_header header;
+};
+
+EVENT_TYPE_DECLARE(dispatch_high_event);
+
+struct dispatch_low_event {
+	struct event_header header;
+};
+
+EVENT_TYPE_DECLARE(dispatch_low_event);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _DISPATCH_EVENT_H_ */
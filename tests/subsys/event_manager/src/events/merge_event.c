@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "merge_event.h"
+
+
+static bool merge_merge_event(struct event_header *queued,
+			      const struct event_header *eh)
+{
+	struct merge_event *queued_event = cast_merge_event(queued);
+	const struct merge_event *event = cast_merge_event(eh);
+
+	queued_event->val += event->val;
+
+	return true;
+}
+
+EVENT_TYPE_DEFINE_EXT(merge_event,
+		      true,
+		      NULL,
+		      NULL,
+		      EVENT_ATTR_MERGE(merge_merge_event));
+
+EVENT_TYPE_DEFINE(merge_barrier_event,
+		  true,
+		  NULL,
+		  NULL);
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _MERGE_EVENT_H_
+#define _MERGE_EVENT_H_
+
+/**
+ * @brief Merge Event
+ * @defgroup merge_event Merge Event
+ * @{
+ */
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct merge_event {
+	struct event_header header;
+
+	int val;
+};
+
+EVENT_TYPE_DECLARE(merge_event);
+
+struct merge_barrier_event {
+	struct event_header header;
+};
+
+EVENT_TYPE_DECLARE(merge_barrier_event);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _MERGE_EVENT_H_ */
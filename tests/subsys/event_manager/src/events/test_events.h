@@ -27,6 +27,9 @@ enum test_id {
 	TEST_SUBSCRIBER_ORDER,
 	TEST_OOM_RESET,
 	TEST_MULTICONTEXT,
+	TEST_DISPATCH_CLASS,
+	TEST_MERGE,
+	TEST_MERGE_ORDER,
 
 	TEST_CNT
 };
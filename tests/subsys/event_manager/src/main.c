@@ -59,6 +59,21 @@ static void test_multicontext(void)
 	test_start(TEST_MULTICONTEXT);
 }
 
+static void test_dispatch_class(void)
+{
+	test_start(TEST_DISPATCH_CLASS);
+}
+
+static void test_merge(void)
+{
+	test_start(TEST_MERGE);
+}
+
+static void test_merge_order(void)
+{
+	test_start(TEST_MERGE_ORDER);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(event_manager_tests,
@@ -68,7 +83,10 @@ void test_main(void)
 			 ztest_unit_test(test_event_order),
 			 ztest_unit_test(test_subs_order),
 			 ztest_unit_test(test_oom_reset),
-			 ztest_unit_test(test_multicontext)
+			 ztest_unit_test(test_multicontext),
+			 ztest_unit_test(test_dispatch_class),
+			 ztest_unit_test(test_merge),
+			 ztest_unit_test(test_merge_order)
 			 );
 
 	ztest_run_test_suite(event_manager_tests);
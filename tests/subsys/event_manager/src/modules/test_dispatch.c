@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <test_events.h>
+#include <dispatch_event.h>
+
+#define MODULE test_dispatch
+
+static bool high_received;
+
+static bool event_handler(const struct event_header *eh)
+{
+	if (is_test_start_event(eh)) {
+		struct test_start_event *st = cast_test_start_event(eh);
+
+		switch (st->test_id) {
+		case TEST_DISPATCH_CLASS:
+		{
+			/* Low class event is submitted first, but high class
+			 * event must be processed before it.
+			 */
+			struct dispatch_low_event *low =
+				new_dispatch_low_event();
+			struct dispatch_high_event *high =
+				new_dispatch_high_event();
+
+			high_received = false;
+			EVENT_SUBMIT(low);
+			EVENT_SUBMIT(high);
+			break;
+		}
+
+		default:
+			/* Ignore other test cases, check if proper test_id. */
+			zassert_true(st->test_id < TEST_CNT,
+				     "test_id out of range");
+			break;
+		}
+
+		return false;
+	}
+
+	if (is_dispatch_high_event(eh)) {
+		high_received = true;
+
+		return false;
+	}
+
+	if (is_dispatch_low_event(eh)) {
+		zassert_true(high_received,
+			     "Low class event processed before high class");
+
+		struct test_end_event *et = new_test_end_event();
+
+		et->test_id = TEST_DISPATCH_CLASS;
+		EVENT_SUBMIT(et);
+
+		return false;
+	}
+
+	zassert_true(false, "Event unhandled");
+
+	return false;
+}
+
+EVENT_LISTENER(MODULE, event_handler);
+EVENT_SUBSCRIBE(MODULE, test_start_event);
+EVENT_SUBSCRIBE(MODULE, dispatch_high_event);
+EVENT_SUBSCRIBE(MODULE, dispatch_low_event);
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <test_events.h>
+#include <merge_event.h>
+
+#include "test_config.h"
+
+#define MODULE test_merge
+
+static enum test_id cur_test_id;
+static size_t merge_cnt;
+static bool barrier_received;
+
+static void merge_events_submit(size_t cnt)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		struct merge_event *event = new_merge_event();
+
+		event->val = 1;
+		EVENT_SUBMIT(event);
+	}
+}
+
+static void test_end(void)
+{
+	struct test_end_event *et = new_test_end_event();
+
+	et->test_id = cur_test_id;
+	EVENT_SUBMIT(et);
+}
+
+static bool event_handler(const struct event_header *eh)
+{
+	if (is_test_start_event(eh)) {
+		struct test_start_event *st = cast_test_start_event(eh);
+
+		cur_test_id = st->test_id;
+
+		switch (st->test_id) {
+		case TEST_MERGE:
+			/* Events are queued while the start event is processed,
+			 * hence all of them should be merged into the first one.
+			 */
+			merge_events_submit(TEST_MERGE_CNT);
+			break;
+
+		case TEST_MERGE_ORDER:
+		{
+			/* Events submitted after the barrier must not be merged
+			 * into the event queued before it.
+			 */
+			struct merge_barrier_event *barrier =
+				new_merge_barrier_event();
+
+			merge_cnt = 0;
+			barrier_received = false;
+
+			merge_events_submit(TEST_MERGE_CNT);
+			EVENT_SUBMIT(barrier);
+			merge_events_submit(TEST_MERGE_CNT);
+			break;
+		}
+
+		default:
+			/* Ignore other test cases, check if proper test_id. */
+			zassert_true(st->test_id < TEST_CNT,
+				     "test_id out of range");
+			break;
+		}
+
+		return false;
+	}
+
+	if (is_merge_event(eh)) {
+		struct merge_event *event = cast_merge_event(eh);
+
+		zassert_equal(event->val, TEST_MERGE_CNT,
+			      "Events were not merged");
+
+		if (cur_test_id == TEST_MERGE_ORDER) {
+			merge_cnt++;
+			zassert_equal(barrier_received, (merge_cnt > 1),
+				      "Merged event delivered out of order");
+
+			if (merge_cnt < 2) {
+				return false;
+			}
+		}
+
+		test_end();
+
+		return false;
+	}
+
+	if (is_merge_barrier_event(eh)) {
+		zassert_equal(merge_cnt, 1, "Barrier delivered out of order");
+		barrier_received = true;
+
+		return false;
+	}
+
+	zassert_true(false, "Event unhandled");
+
+	return false;
+}
+
+EVENT_LISTENER(MODULE, event_handler);
+EVENT_SUBSCRIBE(MODULE, test_start_event);
+EVENT_SUBSCRIBE(MODULE, merge_event);
+EVENT_SUBSCRIBE(MODULE, merge_barrier_event);
@@ -47,7 +47,7 @@ static bool event_handler(const struct event_header *eh)
 			 */
 			i -= 2;
 			while (i != 0) {
-				k_free(event_tab[i]);
+				event_manager_free(event_tab[i]);
 				i--;
 			}
 
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Replaces the socket API for the download client. The functions are
+ * implemented by the test, which plays the role of the HTTP server.
+ */
+
+#ifndef MOCK_NET_SOCKET_H__
+#define MOCK_NET_SOCKET_H__
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <zephyr/types.h>
+#include <sys/byteorder.h>
+
+#define AF_INET         1
+#define AF_INET6        2
+#define AF_LTE          102
+#define SOCK_STREAM     1
+#define SOCK_MGMT       4
+#define IPPROTO_TCP     6
+#define IPPROTO_TLS_1_2 258
+#define NPROTO_PDN      770
+
+#define SOL_SOCKET      1
+#define SO_BINDTODEVICE 25
+#define SO_RCVTIMEO     20
+#define SOL_TLS         282
+#define TLS_SEC_TAG_LIST 1
+#define TLS_PEER_VERIFY  5
+
+#define IFNAMSIZ 64
+
+#define htons(x) sys_cpu_to_be16(x)
+
+typedef unsigned short sa_family_t;
+typedef size_t socklen_t;
+
+struct sockaddr {
+	sa_family_t sa_family;
+	char data[14];
+};
+
+struct sockaddr_in {
+	sa_family_t sin_family;
+	u16_t sin_port;
+	u32_t sin_addr;
+};
+
+struct sockaddr_in6 {
+	sa_family_t sin6_family;
+	u16_t sin6_port;
+	u8_t sin6_addr[16];
+};
+
+struct addrinfo {
+	struct addrinfo *ai_next;
+	int ai_flags;
+	int ai_family;
+	int ai_socktype;
+	int ai_protocol;
+	socklen_t ai_addrlen;
+	struct sockaddr *ai_addr;
+	char *ai_canonname;
+};
+
+struct timeval {
+	long tv_sec;
+	long tv_usec;
+};
+
+struct ifreq {
+	char ifr_name[IFNAMSIZ];
+};
+
+int getaddrinfo(const char *host, const char *service,
+		const struct addrinfo *hints, struct addrinfo **res);
+void freeaddrinfo(struct addrinfo *ai);
+int socket(int family, int type, int proto);
+int connect(int sock, const struct sockaddr *addr, socklen_t addrlen);
+int setsockopt(int sock, int level, int optname, const void *optval,
+	       socklen_t optlen);
+int close(int sock);
+ssize_t send(int sock, const void *buf, size_t len, int flags);
+ssize_t recv(int sock, void *buf, size_t max_len, int flags);
+
+#endif /* MOCK_NET_SOCKET_H__ */
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef MOCK_NET_TLS_CREDENTIALS_H__
+#define MOCK_NET_TLS_CREDENTIALS_H__
+
+typedef int sec_tag_t;
+
+#endif /* MOCK_NET_TLS_CREDENTIALS_H__ */
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <kernel.h>
+#include <net/socket.h>
+
+#include <download_client.h>
+
+#define TIMEOUT 1000
+
+#define RX_CHUNK_COUNT 8
+#define EVT_COUNT      8
+
+#define HOST      "example.com"
+#define FILE_NAME "file.bin"
+#define REQUEST   "GET /" FILE_NAME
+
+/* 100-byte fragments of a 1000-byte file */
+#define HEADER \
+	"HTTP/1.1 206 Partial Content\r\n" \
+	"Content-Range: bytes 0-99/1000\r\n" \
+	"\r\n"
+
+/* Socket mock, the test plays the role of the HTTP server. Data to be
+ * received by the client is taken from rx_msgq. A NULL chunk means that
+ * the server has closed the connection.
+ */
+K_MSGQ_DEFINE(rx_msgq, sizeof(const char *), RX_CHUNK_COUNT, 4);
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+};
+
+static struct addrinfo server_info = {
+	.ai_family = AF_INET,
+	.ai_addrlen = sizeof(server_addr),
+	.ai_addr = (struct sockaddr *)&server_addr,
+};
+
+static int requests_sent;
+
+int getaddrinfo(const char *host, const char *service,
+		const struct addrinfo *hints, struct addrinfo **res)
+{
+	if (hints->ai_family != AF_INET) {
+		return -1;
+	}
+
+	*res = &server_info;
+
+	return 0;
+}
+
+void freeaddrinfo(struct addrinfo *ai)
+{
+}
+
+int socket(int family, int type, int proto)
+{
+	zassert_equal(proto, IPPROTO_TCP, "Unexpected socket protocol");
+
+	return 1;
+}
+
+int connect(int sock, const struct sockaddr *addr, socklen_t addrlen)
+{
+	return 0;
+}
+
+int setsockopt(int sock, int level, int optname, const void *optval,
+	       socklen_t optlen)
+{
+	return 0;
+}
+
+int close(int sock)
+{
+	return 0;
+}
+
+ssize_t send(int sock, const void *buf, size_t len, int flags)
+{
+	zassert_equal(strncmp(buf, REQUEST, strlen(REQUEST)), 0,
+		      "Unexpected request");
+
+	requests_sent++;
+
+	return len;
+}
+
+ssize_t recv(int sock, void *buf, size_t max_len, int flags)
+{
+	const char *chunk;
+	size_t len;
+
+	k_msgq_get(&rx_msgq, &chunk, K_FOREVER);
+
+	if (chunk == NULL) {
+		return 0;
+	}
+
+	len = strlen(chunk);
+	zassert_true(len <= max_len, "Chunk does not fit");
+	memcpy(buf, chunk, len);
+
+	return len;
+}
+
+static void server_send(const char *chunk)
+{
+	zassert_equal(k_msgq_put(&rx_msgq, &chunk, K_NO_WAIT), 0,
+		      "Too many chunks");
+}
+
+static void server_close(void)
+{
+	server_send(NULL);
+}
+
+/* Events received by the application. */
+struct test_evt {
+	enum download_client_evt_id id;
+	int error;
+	char data[CONFIG_DOWNLOAD_CLIENT_MAX_FRAGMENT_SIZE + 1];
+	size_t len;
+};
+
+static struct test_evt evts[EVT_COUNT];
+static int evt_cnt;
+static K_SEM_DEFINE(download_stopped, 0, 1);
+
+static struct download_client client;
+
+static int client_callback(const struct download_client_evt *event)
+{
+	struct test_evt *evt;
+
+	zassert_true(evt_cnt < EVT_COUNT, "Too many events");
+	evt = &evts[evt_cnt++];
+	evt->id = event->id;
+
+	switch (event->id) {
+	case DOWNLOAD_CLIENT_EVT_FRAGMENT:
+		zassert_true(event->fragment.len < sizeof(evt->data),
+			     "Fragment too long");
+		memcpy(evt->data, event->fragment.buf, event->fragment.len);
+		evt->len = event->fragment.len;
+		return 0;
+	case DOWNLOAD_CLIENT_EVT_ERROR:
+		evt->error = event->error;
+		break;
+	default:
+		break;
+	}
+
+	/* Stop the download, the client thread suspends itself */
+	k_sem_give(&download_stopped);
+	return 1;
+}
+
+static void test_setup(void)
+{
+	int err;
+	const struct download_client_cfg config = {
+		.sec_tag = -1,
+	};
+
+	memset(evts, 0, sizeof(evts));
+	evt_cnt = 0;
+	requests_sent = 0;
+	k_msgq_purge(&rx_msgq);
+	k_sem_reset(&download_stopped);
+
+	err = download_client_connect(&client, HOST, &config);
+	zassert_equal(err, 0, "Failed to connect");
+
+	err = download_client_start(&client, FILE_NAME, 0);
+	zassert_equal(err, 0, "Failed to start download");
+	zassert_equal(requests_sent, 1, "Request not sent");
+}
+
+static void test_teardown(void)
+{
+	(void)download_client_disconnect(&client);
+}
+
+static void wait_stopped(void)
+{
+	zassert_equal(k_sem_take(&download_stopped, TIMEOUT), 0,
+		      "Download not stopped");
+}
+
+static void test_closed_after_header(void)
+{
+	server_send(HEADER);
+	server_close();
+	wait_stopped();
+
+	/* No payload was received, so there is no fragment to deliver */
+	zassert_equal(evt_cnt, 1, "Unexpected events");
+	zassert_equal(evts[0].id, DOWNLOAD_CLIENT_EVT_ERROR, "No error");
+	zassert_equal(evts[0].error, -ECONNRESET, "Wrong error");
+	zassert_equal(client.progress, 0, "Wrong progress");
+}
+
+static void test_closed_after_partial_payload(void)
+{
+	server_send(HEADER);
+	server_send("0123456789");
+	server_close();
+	wait_stopped();
+
+	/* The partial payload is delivered before the error */
+	zassert_equal(evt_cnt, 2, "Unexpected events");
+	zassert_equal(evts[0].id, DOWNLOAD_CLIENT_EVT_FRAGMENT, "No fragment");
+	zassert_equal(evts[0].len, 10, "Wrong fragment length");
+	zassert_equal(memcmp(evts[0].data, "0123456789", 10), 0,
+		      "Wrong fragment data");
+	zassert_equal(evts[1].id, DOWNLOAD_CLIENT_EVT_ERROR, "No error");
+	zassert_equal(evts[1].error, -ECONNRESET, "Wrong error");
+	zassert_equal(client.progress, 10, "Wrong progress");
+}
+
+void test_main(void)
+{
+	zassert_equal(download_client_init(&client, client_callback), 0,
+		      "Client initialization failed");
+
+	/* Let the client thread start and suspend itself */
+	k_sleep(10);
+
+	ztest_test_suite(download_client,
+			 ztest_unit_test_setup_teardown(
+				test_closed_after_header,
+				test_setup, test_teardown),
+			 ztest_unit_test_setup_teardown(
+				test_closed_after_partial_payload,
+				test_setup, test_teardown)
+			);
+
+	ztest_run_test_suite(download_client);
+}
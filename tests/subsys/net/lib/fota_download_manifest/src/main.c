@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <tinycrypt/sha256.h>
+#include <tinycrypt/constants.h>
+
+#include "fota_download_manifest.h"
+
+#define BLOCK_SIZE 256
+#define IMAGE_SIZE 600
+#define BLOCKS ceiling_fraction(IMAGE_SIZE, BLOCK_SIZE)
+#define CHUNK_SIZE 100
+#define MANIFEST_MAX_SIZE (sizeof(struct fota_manifest_header) + \
+	CONFIG_FOTA_DOWNLOAD_MANIFEST_MAX_BLOCKS * FOTA_MANIFEST_HASH_SIZE)
+
+static u8_t image[IMAGE_SIZE];
+static u8_t manifest[sizeof(struct fota_manifest_header) +
+		     BLOCKS * FOTA_MANIFEST_HASH_SIZE];
+
+/* Stubs and mocks */
+static u8_t written[IMAGE_SIZE];
+static size_t written_len;
+
+int dfu_target_write(const void *const buf, size_t len)
+{
+	zassert_true(written_len + len <= sizeof(written), "Too much data");
+	memcpy(&written[written_len], buf, len);
+	written_len += len;
+	return 0;
+}
+
+static void sha256(const u8_t *buf, size_t len, u8_t *hash)
+{
+	struct tc_sha256_state_struct sha;
+
+	zassert_equal(TC_CRYPTO_SUCCESS, tc_sha256_init(&sha), NULL);
+	zassert_equal(TC_CRYPTO_SUCCESS, tc_sha256_update(&sha, buf, len),
+		      NULL);
+	zassert_equal(TC_CRYPTO_SUCCESS, tc_sha256_final(hash, &sha), NULL);
+}
+
+static void manifest_load(void)
+{
+	fota_manifest_reset();
+	zassert_equal(0, fota_manifest_write(manifest, sizeof(manifest)),
+		      NULL);
+	zassert_equal(0, fota_manifest_finalize(), "Manifest should be valid");
+	written_len = 0;
+}
+
+static int image_write(size_t from)
+{
+	int err;
+
+	for (size_t i = from; i < IMAGE_SIZE; i += CHUNK_SIZE) {
+		err = fota_manifest_image_write(&image[i],
+						MIN(CHUNK_SIZE, IMAGE_SIZE - i));
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static void init(void)
+{
+	struct fota_manifest_header *hdr = (void *)manifest;
+
+	for (size_t i = 0; i < sizeof(image); i++) {
+		image[i] = i * 7;
+	}
+
+	hdr->magic = sys_cpu_to_le32(FOTA_MANIFEST_MAGIC);
+	hdr->block_size = sys_cpu_to_le32(BLOCK_SIZE);
+	hdr->image_size = sys_cpu_to_le32(IMAGE_SIZE);
+	sha256(image, IMAGE_SIZE, hdr->image_hash);
+
+	for (size_t i = 0; i < BLOCKS; i++) {
+		sha256(&image[i * BLOCK_SIZE],
+		       MIN(BLOCK_SIZE, IMAGE_SIZE - i * BLOCK_SIZE),
+		       &manifest[sizeof(*hdr) + i * FOTA_MANIFEST_HASH_SIZE]);
+	}
+}
+
+static void test_manifest_invalid(void)
+{
+	u8_t bad[sizeof(manifest)];
+	struct fota_manifest_header *hdr = (void *)bad;
+
+	init();
+
+	fota_manifest_reset();
+	zassert_equal(0, fota_manifest_write(manifest, sizeof(manifest) - 1),
+		      NULL);
+	zassert_equal(-EBADMSG, fota_manifest_finalize(),
+		      "Truncated manifest should be rejected");
+	zassert_false(fota_manifest_valid(), NULL);
+
+	memcpy(bad, manifest, sizeof(bad));
+	bad[0] ^= 0xff;
+	fota_manifest_reset();
+	zassert_equal(0, fota_manifest_write(bad, sizeof(bad)), NULL);
+	zassert_equal(-EBADMSG, fota_manifest_finalize(),
+		      "Invalid magic should be rejected");
+
+	/* Empty image, the manifest has no block hash */
+	memcpy(bad, manifest, sizeof(bad));
+	hdr->image_size = 0;
+	fota_manifest_reset();
+	zassert_equal(0, fota_manifest_write(bad, sizeof(*hdr)), NULL);
+	zassert_equal(-EBADMSG, fota_manifest_finalize(),
+		      "Manifest without blocks should be rejected");
+
+	/* The size of the block hashes overflows a 32-bit size_t and matches
+	 * a manifest with a single block hash.
+	 */
+	memcpy(bad, manifest, sizeof(bad));
+	hdr->block_size = sys_cpu_to_le32(1);
+	hdr->image_size = sys_cpu_to_le32(BIT(27) + 1);
+	fota_manifest_reset();
+	zassert_equal(0, fota_manifest_write(bad, sizeof(*hdr) +
+					     FOTA_MANIFEST_HASH_SIZE), NULL);
+	zassert_equal(-EBADMSG, fota_manifest_finalize(),
+		      "Too many blocks should be rejected");
+
+	fota_manifest_reset();
+	for (size_t size = sizeof(manifest); size <= MANIFEST_MAX_SIZE;
+	     size += sizeof(manifest)) {
+		zassert_equal(0, fota_manifest_write(manifest,
+						     sizeof(manifest)), NULL);
+	}
+	zassert_equal(-EFBIG, fota_manifest_write(manifest, sizeof(manifest)),
+		      "Too big manifest should be rejected");
+}
+
+static void test_manifest_image(void)
+{
+	u8_t hash[FOTA_MANIFEST_HASH_SIZE];
+
+	init();
+	manifest_load();
+
+	zassert_true(fota_manifest_valid(), NULL);
+	zassert_equal(IMAGE_SIZE, fota_manifest_image_size(), NULL);
+	sha256(image, IMAGE_SIZE, hash);
+	zassert_equal(0, memcmp(hash, fota_manifest_image_hash(), sizeof(hash)),
+		      "Image hash should be known before the image");
+
+	zassert_equal(-ENODATA, fota_manifest_image_done(), NULL);
+	zassert_equal(0, image_write(0), NULL);
+	zassert_equal(0, fota_manifest_image_done(), NULL);
+	zassert_equal(IMAGE_SIZE, written_len, NULL);
+	zassert_equal(0, memcmp(image, written, IMAGE_SIZE), NULL);
+
+	zassert_equal(-EFBIG, fota_manifest_image_write(image, 1),
+		      "Data beyond the image size should be rejected");
+}
+
+static void test_manifest_bad_block(void)
+{
+	init();
+	manifest_load();
+
+	image[BLOCK_SIZE + 10] ^= 1;
+	zassert_equal(-EBADMSG, image_write(0),
+		      "Corrupted block should be detected");
+	zassert_equal(BLOCK_SIZE, written_len,
+		      "Only the verified block should be written");
+
+	/* Download again from the start of the corrupted block */
+	image[BLOCK_SIZE + 10] ^= 1;
+	fota_manifest_image_offset_set(written_len);
+	zassert_equal(0, image_write(written_len), NULL);
+	zassert_equal(0, fota_manifest_image_done(), NULL);
+	zassert_equal(IMAGE_SIZE, written_len, NULL);
+	zassert_equal(0, memcmp(image, written, IMAGE_SIZE), NULL);
+}
+
+static void test_manifest_unaligned_offset(void)
+{
+	const size_t offset = BLOCK_SIZE + 10;
+
+	init();
+	manifest_load();
+
+	/* The beginning of the block was written before the restart */
+	memcpy(written, image, offset);
+	written_len = offset;
+
+	fota_manifest_image_offset_set(offset);
+	zassert_equal(0, image_write(offset), NULL);
+	zassert_equal(0, fota_manifest_image_done(), NULL);
+	zassert_equal(IMAGE_SIZE, written_len, NULL);
+	zassert_equal(0, memcmp(image, written, IMAGE_SIZE), NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lib_fota_download_manifest,
+	     ztest_unit_test(test_manifest_invalid),
+	     ztest_unit_test(test_manifest_image),
+	     ztest_unit_test(test_manifest_bad_block),
+	     ztest_unit_test(test_manifest_unaligned_offset)
+	 );
+
+	ztest_run_test_suite(lib_fota_download_manifest);
+}